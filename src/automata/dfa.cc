@@ -0,0 +1,444 @@
+#include "dfa.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace automata {
+
+namespace {
+
+/// A deterministic automaton as subset construction leaves it, with the
+/// transitions in next[state * classes + class]
+struct machine
+{
+	std::size_t classes;
+	std::vector<uint32_t> next;
+	std::vector<bool> accepting;
+	uint32_t start;
+
+	std::size_t size() const { return accepting.size(); }
+};
+
+/// Subset construction, with state 0 the empty set: the dead state
+machine subsets(const nfa & n, const std::vector<nfa::range_type> & ranges,
+                bool stop_at_accept, std::size_t max_states)
+{
+	machine m;
+	std::map<std::vector<nfa::state_id>, uint32_t> ids;
+	std::vector<std::vector<nfa::state_id>> sets;
+
+	m.classes = ranges.size();
+
+	auto id_of = [&] (std::vector<nfa::state_id> && set) -> uint32_t
+	{
+		auto i = ids.find(set);
+
+		if (i != ids.end())
+			return i->second;
+
+		if (sets.size() >= max_states)
+			throw std::length_error("dfa: too many states");
+
+		const uint32_t id = static_cast<uint32_t>(sets.size());
+
+		m.accepting.push_back(
+		  std::binary_search(set.begin(), set.end(), n.accept()));
+		ids.emplace(set, id);
+		sets.push_back(std::move(set));
+		return id;
+	};
+
+	id_of(std::vector<nfa::state_id>());
+
+	std::vector<nfa::state_id> start(1, n.start());
+	n.close(start);
+	m.start = id_of(std::move(start));
+
+	for (uint32_t id = 0; id < sets.size(); ++id)
+	{
+		for (std::size_t c = 0; c < m.classes; ++c)
+		{
+			// what comes after a match doesn't matter if it stops there
+			if (stop_at_accept && m.accepting[id])
+				m.next.push_back(id);
+			else
+				m.next.push_back(id_of(n.move(sets[id], ranges[c].min())));
+		}
+	}
+
+	return m;
+}
+
+/// Hopcroft's algorithm: the coarsest partition of the states of m that
+/// keeps accepting states apart from the rest and that the transitions
+/// respect. Returns each state's block.
+std::vector<uint32_t> minimize(const machine & m, std::size_t & block_count)
+{
+	const std::size_t n = m.size();
+	const std::size_t k = m.classes;
+
+	// the states going to t on c, in
+	// sources[offsets[t * k + c], offsets[t * k + c + 1])
+	std::vector<uint32_t> offsets(n * k + 1, 0);
+	std::vector<uint32_t> sources(n * k);
+
+	for (std::size_t s = 0; s < n; ++s)
+		for (std::size_t c = 0; c < k; ++c)
+			++offsets[m.next[s * k + c] * k + c + 1];
+
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+
+	for (std::size_t s = 0; s < n; ++s)
+		for (std::size_t c = 0; c < k; ++c)
+			sources[cursor[m.next[s * k + c] * k + c]++] = s;
+
+	// the partition: the states of block b are
+	// elements[first[b], end[b]), those marked while splitting first
+	std::vector<uint32_t> elements, position(n), block(n);
+	std::vector<uint32_t> first, end, marked;
+
+	for (int accepting = 1; accepting >= 0; --accepting)
+	{
+		const uint32_t begin = static_cast<uint32_t>(elements.size());
+
+		for (std::size_t s = 0; s < n; ++s)
+		{
+			if (m.accepting[s] == static_cast<bool>(accepting))
+			{
+				position[s] = static_cast<uint32_t>(elements.size());
+				block[s] = static_cast<uint32_t>(first.size());
+				elements.push_back(s);
+			}
+		}
+
+		if (elements.size() > begin)
+		{
+			first.push_back(begin);
+			end.push_back(static_cast<uint32_t>(elements.size()));
+			marked.push_back(0);
+		}
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> work;
+	std::vector<bool> in_work(first.size() * k, false);
+
+	if (first.size() == 2)
+	{
+		const uint32_t smaller = ((end[0] - first[0]) <= (end[1] - first[1]))
+		                         ? 0 : 1;
+
+		for (std::size_t c = 0; c < k; ++c)
+		{
+			work.emplace_back(smaller, c);
+			in_work[smaller * k + c] = true;
+		}
+	}
+
+	std::vector<uint32_t> splitter, touched;
+
+	while (! work.empty())
+	{
+		const uint32_t a = work.back().first;
+		const uint32_t c = work.back().second;
+
+		work.pop_back();
+		in_work[a * k + c] = false;
+
+		// mark the states going into a on c, moving them to the front
+		// of their blocks
+		splitter.assign(elements.begin() + first[a],
+		                elements.begin() + end[a]);
+
+		for (uint32_t t : splitter)
+		{
+			for (uint32_t i = offsets[t * k + c];
+			     i < offsets[t * k + c + 1]; ++i)
+			{
+				const uint32_t s = sources[i];
+				const uint32_t b = block[s];
+				const uint32_t at = position[s];
+				const uint32_t to = first[b] + marked[b];
+
+				if (at < to)
+					continue;
+
+				const uint32_t other = elements[to];
+
+				elements[to] = s;
+				elements[at] = other;
+				position[s] = to;
+				position[other] = at;
+
+				if (marked[b]++ == 0)
+					touched.push_back(b);
+			}
+		}
+
+		// split the blocks that were partly marked, the marked part
+		// becoming a new block
+		for (uint32_t b : touched)
+		{
+			if (marked[b] == (end[b] - first[b]))
+			{
+				marked[b] = 0;
+				continue;
+			}
+
+			const uint32_t nb = static_cast<uint32_t>(first.size());
+
+			first.push_back(first[b]);
+			end.push_back(first[b] + marked[b]);
+			marked.push_back(0);
+			first[b] += marked[b];
+			marked[b] = 0;
+
+			for (uint32_t i = first[nb]; i < end[nb]; ++i)
+				block[elements[i]] = nb;
+
+			in_work.resize(first.size() * k, false);
+
+			const uint32_t smaller =
+			  ((end[nb] - first[nb]) <= (end[b] - first[b])) ? nb : b;
+
+			for (uint32_t d = 0; d < k; ++d)
+			{
+				const uint32_t w = in_work[b * k + d] ? nb : smaller;
+
+				if (! in_work[w * k + d])
+				{
+					work.emplace_back(w, d);
+					in_work[w * k + d] = true;
+				}
+			}
+		}
+
+		touched.clear();
+	}
+
+	block_count = first.size();
+	return block;
+}
+
+/// The first byte in [p, end) that leaves a state, given the bytes that
+/// do, or end
+const uint8_t * skip(const uint8_t * p, const uint8_t * end,
+                     const std::array<uint8_t, 3> & bytes,
+                     unsigned count) noexcept
+{
+	if (count == 0)
+		return end;
+
+	if (count == 1)
+	{
+		const void * found = std::memchr(p, bytes[0], end - p);
+		return (found ? static_cast<const uint8_t *>(found) : end);
+	}
+
+#if defined(__SSE2__)
+	const __m128i a = _mm_set1_epi8(static_cast<char>(bytes[0]));
+	const __m128i b = _mm_set1_epi8(static_cast<char>(bytes[1]));
+	const __m128i c = _mm_set1_epi8(static_cast<char>(bytes[2]));
+
+	for (; (end - p) >= 16; p += 16)
+	{
+		const __m128i v = _mm_loadu_si128(
+		                    reinterpret_cast<const __m128i *>(p));
+		const unsigned found = _mm_movemask_epi8(
+		                         _mm_or_si128(
+		                           _mm_or_si128(_mm_cmpeq_epi8(v, a),
+		                                        _mm_cmpeq_epi8(v, b)),
+		                           _mm_cmpeq_epi8(v, c)));
+
+		if (found != 0)
+			return (p + __builtin_ctz(found));
+	}
+#endif
+
+	for (; p < end; ++p)
+		if ((*p == bytes[0]) || (*p == bytes[1]) || (*p == bytes[2]))
+			break;
+
+	return p;
+}
+
+} // namespace
+
+dfa::dfa(const nfa & n, bool stop_at_accept, std::size_t max_states)
+  : m_classes()
+  , m_class_count(0)
+  , m_stride_bits(0)
+  , m_table()
+  , m_start(0)
+  , m_stop(0)
+  , m_special(0)
+  , m_escapes()
+  , m_accepting()
+{
+	const std::vector<nfa::range_type> ranges = n.input_ranges();
+	const std::size_t k = ranges.size();
+	const machine m = subsets(n, ranges, stop_at_accept, max_states);
+
+	std::size_t blocks = 0;
+	const std::vector<uint32_t> block = minimize(m, blocks);
+
+	// the minimal automaton, over the ranges
+	std::vector<uint32_t> any_state(blocks);
+	std::vector<uint32_t> next(blocks * k);
+
+	for (std::size_t s = 0; s < m.size(); ++s)
+		any_state[block[s]] = s;
+
+	for (std::size_t b = 0; b < blocks; ++b)
+		for (std::size_t c = 0; c < k; ++c)
+			next[b * k + c] = block[m.next[any_state[b] * k + c]];
+
+	// ranges whose columns are the same become one class
+	std::map<std::vector<uint32_t>, uint8_t> columns;
+	std::vector<uint8_t> range_class(k);
+	std::array<uint8_t, 256> range_of;
+	std::vector<uint32_t> column(blocks);
+
+	for (std::size_t c = 0; c < k; ++c)
+	{
+		for (std::size_t b = 0; b < blocks; ++b)
+			column[b] = next[b * k + c];
+
+		auto i = columns.emplace(column, columns.size()).first;
+		range_class[c] = i->second;
+
+		for (unsigned v = ranges[c].min(); v <= ranges[c].max(); ++v)
+		{
+			range_of[v] = c;
+			m_classes[v] = range_class[c];
+		}
+	}
+
+	m_class_count = columns.size();
+
+	while ((1u << m_stride_bits) < m_class_count)
+		++m_stride_bits;
+
+	// the bytes that leave each block, if there are three or fewer; a
+	// count of 4 is for more
+	std::vector<escape> escapes(blocks);
+
+	for (std::size_t b = 0; b < blocks; ++b)
+	{
+		escape & e = escapes[b];
+
+		e.count = 0;
+
+		for (unsigned v = 0; (v < 256) && (e.count <= 3); ++v)
+		{
+			if (next[b * k + range_of[v]] != b)
+			{
+				if (e.count < 3)
+					e.bytes[e.count] = v;
+				++e.count;
+			}
+		}
+
+		for (unsigned i = 1; i < 3; ++i)
+			if ((e.count > 0) && (i >= e.count))
+				e.bytes[i] = e.bytes[i - 1];
+	}
+
+	// the order of the states: dead, the stops, the escapes, the rest
+	const uint32_t dead = block[0];
+	std::vector<uint32_t> order;
+
+	auto accepting = [&] (uint32_t b) { return m.accepting[any_state[b]]; };
+	auto stop = [&] (uint32_t b)
+		{ return (b == dead) || (stop_at_accept && accepting(b)); };
+
+	order.push_back(dead);
+
+	for (uint32_t b = 0; b < blocks; ++b)
+		if (stop(b) && (b != dead))
+			order.push_back(b);
+
+	const std::size_t stops = order.size();
+
+	for (uint32_t b = 0; b < blocks; ++b)
+		if (! stop(b) && (escapes[b].count <= 3))
+			order.push_back(b);
+
+	const std::size_t specials = order.size();
+
+	for (uint32_t b = 0; b < blocks; ++b)
+		if (! stop(b) && (escapes[b].count > 3))
+			order.push_back(b);
+
+	std::vector<uint32_t> index(blocks);
+
+	for (std::size_t i = 0; i < blocks; ++i)
+		index[order[i]] = i;
+
+	// and the table
+	const std::size_t stride = std::size_t(1) << m_stride_bits;
+
+	m_table.reset(new lookup_table<state_type, 2>(
+	  lookup_table<state_type, 2>::index_type{{ blocks, stride }}));
+	m_escapes.resize(specials);
+	m_accepting.resize(blocks);
+
+	for (std::size_t i = 0; i < blocks; ++i)
+	{
+		const uint32_t b = order[i];
+
+		for (std::size_t c = 0; c < k; ++c)
+		{
+			(*m_table)[{{ i, range_class[c] }}] =
+			  index[next[b * k + c]] << m_stride_bits;
+		}
+
+		if (i < specials)
+			m_escapes[i] = escapes[b];
+
+		m_accepting[i] = accepting(b);
+	}
+
+	m_start = index[block[m.start]] << m_stride_bits;
+	m_stop = stops << m_stride_bits;
+	m_special = specials << m_stride_bits;
+}
+
+const char * dfa::search(const char * begin, const char * end) const noexcept
+{
+	const state_type * const table = m_table->data();
+	const uint8_t * const classes = m_classes.data();
+	const uint8_t * p = reinterpret_cast<const uint8_t *>(begin);
+	const uint8_t * const last = reinterpret_cast<const uint8_t *>(end);
+	state_type s = m_start;
+
+	while (p < last)
+	{
+		if (s < m_special)
+		{
+			if (s < m_stop)
+				return (s ? reinterpret_cast<const char *>(p) : nullptr);
+
+			const escape & e = m_escapes[s >> m_stride_bits];
+			p = skip(p, last, e.bytes, e.count);
+
+			if (p == last)
+				break;
+		}
+
+		s = table[s + classes[*p]];
+		++p;
+	}
+
+	return (m_accepting[s >> m_stride_bits] ? end : nullptr);
+}
+
+} // namespace automata
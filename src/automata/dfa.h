@@ -0,0 +1,84 @@
+#ifndef GUARD_DFA_H
+#define GUARD_DFA_H 1
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "nfa.h"
+#include "table.h"
+
+namespace automata {
+
+//////////////////////////////////////////////////////////////////////
+/// A minimal deterministic automaton built from an nfa, laid out for
+/// scanning: bytes map to the fewest classes that tell the states apart,
+/// and the transitions are one flat table of rows a power of two wide,
+/// holding each next state premultiplied to the start of its row, so a
+/// step is a load of the class, an add and a load of the state.
+///
+/// States are ordered so that the few needing attention come first, and
+/// a single compare per byte finds them: the dead state, accepting states
+/// if the search stops at them, and states that all but three or fewer
+/// bytes leave unchanged. Those are skipped over with memchr() or SSE2
+/// compares rather than stepped through; for a search that's the start
+/// state of most patterns.
+///
+/// Construction is subset construction over the classes of the nfa's
+/// edges, then Hopcroft's partition refinement, then merging of classes
+/// whose columns have become the same. It throws std::length_error if
+/// subset construction makes more than max_states states, before they're
+/// minimized.
+class dfa
+{
+ public:
+	typedef uint32_t state_type;
+
+	/// If stop_at_accept, search() returns as soon as a match ends;
+	/// otherwise only the state at the end of the input counts, as for
+	/// a pattern anchored there
+	explicit dfa(const nfa & n,
+	             bool stop_at_accept = true,
+	             std::size_t max_states = 10000);
+
+	/// The end of the first match in [begin, end), or nullptr if there
+	/// isn't one. The first match is the one that ends first.
+	const char * search(const char * begin, const char * end) const noexcept;
+
+	std::size_t state_count() const noexcept { return m_accepting.size(); }
+
+	std::size_t class_count() const noexcept { return m_class_count; }
+
+	/// The class of byte b
+	uint8_t input_class(uint8_t b) const noexcept { return m_classes[b]; }
+
+ private:
+	/// Up to three bytes that leave a state; the last repeated if fewer
+	struct escape
+	{
+		std::array<uint8_t, 3> bytes;
+		uint8_t count;
+	};
+
+	std::array<uint8_t, 256> m_classes;
+	std::size_t m_class_count;
+	unsigned m_stride_bits;
+
+	std::unique_ptr<lookup_table<state_type, 2>> m_table;
+
+	state_type m_start;
+
+	/// States below m_stop end the search, the dead state, 0, without a
+	/// match; those from there to m_special are skipped over
+	state_type m_stop;
+	state_type m_special;
+
+	std::vector<escape> m_escapes;
+	std::vector<bool> m_accepting;
+};
+
+} // namespace automata
+
+#endif // GUARD_DFA_H
@@ -0,0 +1,305 @@
+#include "literal_set.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace automata {
+
+namespace {
+
+/// A node of the trie of the patterns
+struct node
+{
+	std::vector<std::pair<uint8_t, uint32_t>> children;
+	std::vector<uint32_t> patterns;
+	uint32_t depth;
+};
+
+#if defined(__SSSE3__)
+/// Teddy over M leading bytes: the first position in [p, end) whose
+/// bytes there and after are all allowed by some one bucket
+template <unsigned M>
+const uint8_t * teddy(const uint8_t * p, const uint8_t * end,
+                      const std::array<std::array<uint8_t, 16>, 3> & low,
+                      const std::array<std::array<uint8_t, 16>, 3> & high)
+{
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lows[M], highs[M];
+
+	for (unsigned j = 0; j < M; ++j)
+	{
+		lows[j] = _mm_loadu_si128(
+		            reinterpret_cast<const __m128i *>(low[j].data()));
+		highs[j] = _mm_loadu_si128(
+		             reinterpret_cast<const __m128i *>(high[j].data()));
+	}
+
+	for (; (end - p) >= static_cast<std::ptrdiff_t>(16 + M - 1); p += 16)
+	{
+		__m128i buckets = _mm_set1_epi8(-1);
+
+		for (unsigned j = 0; j < M; ++j)
+		{
+			const __m128i v = _mm_loadu_si128(
+			                    reinterpret_cast<const __m128i *>(p + j));
+			const __m128i lo = _mm_shuffle_epi8(lows[j],
+			                                    _mm_and_si128(v, nibble));
+			const __m128i hi = _mm_shuffle_epi8(highs[j],
+			                     _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+
+			buckets = _mm_and_si128(buckets, _mm_and_si128(lo, hi));
+		}
+
+		const unsigned found = 0xffffu ^ static_cast<unsigned>(
+		                         _mm_movemask_epi8(
+		                           _mm_cmpeq_epi8(buckets, zero)));
+
+		if (found != 0)
+			return (p + __builtin_ctz(found));
+	}
+
+	for (; (end - p) >= static_cast<std::ptrdiff_t>(M); ++p)
+	{
+		uint8_t buckets = 0xff;
+
+		for (unsigned j = 0; j < M; ++j)
+			buckets &= low[j][p[j] & 0x0f] & high[j][p[j] >> 4];
+
+		if (buckets != 0)
+			return p;
+	}
+
+	return end;
+}
+#endif
+
+} // namespace
+
+literal_set::literal_set(const std::vector<std::string> & patterns,
+                         bool prefilter)
+  : m_classes()
+  , m_class_count(0)
+  , m_stride_bits(0)
+  , m_table()
+  , m_root(0)
+  , m_special(0)
+  , m_output_offsets()
+  , m_outputs()
+  , m_lengths()
+  , m_depths()
+  , m_fingerprint(0)
+  , m_low()
+  , m_high()
+{
+	// the trie, and a class for each byte in it
+	std::vector<node> trie(1, node{ {}, {}, 0 });
+	std::array<bool, 256> used{};
+
+	for (std::size_t i = 0; i < patterns.size(); ++i)
+	{
+		const std::string & pattern = patterns[i];
+
+		if (pattern.empty())
+			throw std::invalid_argument("literal_set: empty pattern");
+
+		if (pattern.size() > std::numeric_limits<uint32_t>::max())
+			throw std::length_error("literal_set: pattern too long");
+
+		uint32_t at = 0;
+
+		for (char c : pattern)
+		{
+			const uint8_t b = static_cast<uint8_t>(c);
+			auto & children = trie[at].children;
+			auto child = std::find_if(children.begin(), children.end(),
+			  [b] (const std::pair<uint8_t, uint32_t> & x)
+				{ return (x.first == b); });
+
+			used[b] = true;
+
+			if (child != children.end())
+			{
+				at = child->second;
+				continue;
+			}
+
+			const uint32_t next = static_cast<uint32_t>(trie.size());
+			children.emplace_back(b, next);
+			trie.push_back(node{ {}, {}, trie[at].depth + 1 });
+			at = next;
+		}
+
+		trie[at].patterns.push_back(static_cast<uint32_t>(i));
+		m_lengths.push_back(static_cast<uint32_t>(pattern.size()));
+	}
+
+	// class 0 for the bytes in none of them, if there are any
+	m_class_count = std::count(used.begin(), used.end(), false) ? 1 : 0;
+
+	for (unsigned b = 0; b < 256; ++b)
+		m_classes[b] = used[b] ? m_class_count++ : 0;
+
+	const std::size_t n = trie.size();
+	const std::size_t k = m_class_count;
+
+	while ((std::size_t(1) << m_stride_bits) < k)
+		++m_stride_bits;
+
+	if (  (n << m_stride_bits)
+	    > std::numeric_limits<state_type>::max())
+		throw std::length_error("literal_set: too many states");
+
+	// breadth first, so that where a failure goes is done before it's
+	// needed: the transitions, as in the trie or else as from where the
+	// longest proper suffix that's in the trie is, and what ends where
+	std::vector<uint32_t> next(n * k, 0), fail(n, 0), order(1, 0);
+	std::vector<std::vector<uint32_t>> outputs(n);
+
+	for (std::size_t at = 0; at < order.size(); ++at)
+	{
+		const uint32_t u = order[at];
+
+		if (u != 0)
+			std::copy_n(&next[fail[u] * k], k, &next[u * k]);
+
+		outputs[u] = trie[u].patterns;
+		outputs[u].insert(outputs[u].end(),
+		                  outputs[fail[u]].begin(), outputs[fail[u]].end());
+
+		for (const auto & child : trie[u].children)
+		{
+			const uint32_t v = child.second;
+			const uint8_t c = m_classes[child.first];
+
+			fail[v] = (u == 0) ? 0 : next[fail[u] * k + c];
+			next[u * k + c] = v;
+			order.push_back(v);
+		}
+	}
+
+	// the states ending patterns first
+	std::vector<uint32_t> index(n);
+	uint32_t ends = 0;
+
+	for (std::size_t u = 0; u < n; ++u)
+		if (! outputs[u].empty())
+			index[u] = ends++;
+
+	uint32_t others = ends;
+
+	for (std::size_t u = 0; u < n; ++u)
+		if (outputs[u].empty())
+			index[u] = others++;
+
+	const std::size_t stride = std::size_t(1) << m_stride_bits;
+
+	m_table.reset(new lookup_table<state_type, 2>(
+	  lookup_table<state_type, 2>::index_type{{ n, stride }}));
+	m_output_offsets.assign(n + 1, 0);
+	m_depths.resize(n);
+
+	for (std::size_t u = 0; u < n; ++u)
+	{
+		for (std::size_t c = 0; c < k; ++c)
+		{
+			(*m_table)[{{ index[u], c }}] =
+			  index[next[u * k + c]] << m_stride_bits;
+		}
+
+		m_output_offsets[index[u] + 1] = outputs[u].size();
+		m_depths[index[u]] = trie[u].depth;
+	}
+
+	for (std::size_t i = 0; i < n; ++i)
+		m_output_offsets[i + 1] += m_output_offsets[i];
+
+	m_outputs.resize(m_output_offsets[n]);
+
+	for (std::size_t u = 0; u < n; ++u)
+		std::copy(outputs[u].begin(), outputs[u].end(),
+		          m_outputs.begin() + m_output_offsets[index[u]]);
+
+	m_root = index[0] << m_stride_bits;
+	m_special = ends << m_stride_bits;
+
+#if defined(__SSSE3__)
+	if (  ! prefilter || patterns.empty()
+	   || (patterns.size() > prefilter_limit))
+		return;
+
+	// the shortest pattern limits how many bytes can be looked at; the
+	// different runs of that many leading bytes are sorted and split in
+	// 8 buckets, so that alike ones share one and false hits are fewer
+	m_fingerprint = 3;
+
+	for (uint32_t length : m_lengths)
+		m_fingerprint = std::min<unsigned>(m_fingerprint, length);
+
+	std::vector<std::string> fingerprints;
+
+	for (const std::string & pattern : patterns)
+		fingerprints.push_back(pattern.substr(0, m_fingerprint));
+
+	std::sort(fingerprints.begin(), fingerprints.end());
+	fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()),
+	                   fingerprints.end());
+
+	for (std::size_t i = 0; i < fingerprints.size(); ++i)
+	{
+		const uint8_t bucket = 1u << (i * 8 / fingerprints.size());
+
+		for (unsigned j = 0; j < m_fingerprint; ++j)
+		{
+			const uint8_t b = static_cast<uint8_t>(fingerprints[i][j]);
+
+			m_low[j][b & 0x0f] |= bucket;
+			m_high[j][b >> 4] |= bucket;
+		}
+	}
+#else
+	(void) prefilter;
+#endif
+}
+
+const uint8_t * literal_set::candidate(const uint8_t * p,
+                                       const uint8_t * end) const noexcept
+{
+#if defined(__SSSE3__)
+	switch (m_fingerprint)
+	{
+	case 1: return teddy<1>(p, end, m_low, m_high);
+	case 2: return teddy<2>(p, end, m_low, m_high);
+	case 3: return teddy<3>(p, end, m_low, m_high);
+	}
+#endif
+
+	(void) p;
+	return end;
+}
+
+std::vector<literal_set::match>
+literal_set::find_all(const char * begin, const char * end) const
+{
+	std::vector<match> matches;
+
+	scan(begin, end, [&] (std::size_t pattern, const char * at)
+		{ matches.push_back(match{ pattern, std::size_t(at - begin) }); });
+
+	std::sort(matches.begin(), matches.end(),
+	  [] (const match & a, const match & b)
+		{
+			return (  (a.offset < b.offset)
+			       || ((a.offset == b.offset) && (a.pattern < b.pattern)));
+		});
+
+	return matches;
+}
+
+} // namespace automata
@@ -0,0 +1,172 @@
+#ifndef GUARD_LITERAL_SET_H
+#define GUARD_LITERAL_SET_H 1
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "table.h"
+
+namespace automata {
+
+//////////////////////////////////////////////////////////////////////
+/// Finds every occurrence of any of a set of literal strings, such as
+/// thousands of words to flag in a log, in one pass.
+///
+/// The strings are compiled into an Aho-Corasick automaton laid out as
+/// dfa lays out its table: the bytes that appear in some string each get
+/// a class and the rest share one, and the transitions, failure links
+/// folded in, are a flat table of rows a power of two wide holding next
+/// states premultiplied to the start of their row. States that end a
+/// string come first, so a step is two loads and an add, and a compare
+/// says whether there's anything to report.
+///
+/// For up to prefilter_limit strings, where SSSE3 is available, the
+/// automaton isn't run over everything: a Teddy prefilter looks for the
+/// first one to three bytes of the strings sixteen positions at a time
+/// with nibble shuffles, and the automaton is only run from where one
+/// might start, for as long as it stays on a string's path.
+class literal_set
+{
+ public:
+	typedef uint32_t state_type;
+
+	struct match
+	{
+		std::size_t pattern;
+		std::size_t offset;
+	};
+
+	static constexpr std::size_t prefilter_limit = 64;
+
+	/// Throws std::invalid_argument for an empty pattern, and
+	/// std::length_error if the table wouldn't fit state_type. Without
+	/// prefilter, the automaton is always run over all of the input.
+	explicit literal_set(const std::vector<std::string> & patterns,
+	                     bool prefilter = true);
+
+	/// Calls found(pattern, begin) for each occurrence of each pattern in
+	/// [begin, end), where pattern is its index and begin is where it
+	/// starts, overlapping ones included, in no particular order
+	template <class F>
+	void scan(const char * begin, const char * end, F && found) const;
+
+	/// Every occurrence, ordered by offset and then by pattern
+	std::vector<match> find_all(const char * begin, const char * end) const;
+
+	std::size_t size() const noexcept { return m_lengths.size(); }
+
+	std::size_t state_count() const noexcept { return m_depths.size(); }
+
+	std::size_t class_count() const noexcept { return m_class_count; }
+
+	bool prefiltered() const noexcept { return (m_fingerprint != 0); }
+
+ private:
+	/// The first position in [p, end) where a pattern might start, or end
+	const uint8_t * candidate(const uint8_t * p,
+	                          const uint8_t * end) const noexcept;
+
+	/// Reports the patterns that end at p in state s and are depth long,
+	/// or all of them if depth is 0
+	template <class F>
+	void report(state_type s, const uint8_t * p, std::size_t depth,
+	            F & found) const;
+
+	std::array<uint8_t, 256> m_classes;
+	std::size_t m_class_count;
+	unsigned m_stride_bits;
+
+	std::unique_ptr<lookup_table<state_type, 2>> m_table;
+
+	state_type m_root;
+
+	/// States below this end a pattern
+	state_type m_special;
+
+	/// The patterns ending in state i, longest first, are
+	/// m_outputs[m_output_offsets[i], m_output_offsets[i + 1])
+	std::vector<uint32_t> m_output_offsets;
+	std::vector<uint32_t> m_outputs;
+
+	std::vector<uint32_t> m_lengths;
+	std::vector<uint32_t> m_depths;
+
+	/// How many leading bytes the prefilter looks at, 0 if it's off, and
+	/// for each of them the buckets of patterns that allow each low and
+	/// high nibble there
+	unsigned m_fingerprint;
+	std::array<std::array<uint8_t, 16>, 3> m_low;
+	std::array<std::array<uint8_t, 16>, 3> m_high;
+};
+
+template <class F>
+void literal_set::report(state_type s, const uint8_t * p, std::size_t depth,
+                         F & found) const
+{
+	const std::size_t i = s >> m_stride_bits;
+
+	for (uint32_t k = m_output_offsets[i]; k < m_output_offsets[i + 1]; ++k)
+	{
+		const uint32_t pattern = m_outputs[k];
+
+		if ((depth != 0) && (m_lengths[pattern] != depth))
+			break;
+
+		found(static_cast<std::size_t>(pattern),
+		      reinterpret_cast<const char *>(p - m_lengths[pattern]));
+	}
+}
+
+template <class F>
+void literal_set::scan(const char * begin, const char * end, F && found) const
+{
+	const state_type * const table = m_table->data();
+	const uint8_t * const classes = m_classes.data();
+	const uint8_t * p = reinterpret_cast<const uint8_t *>(begin);
+	const uint8_t * const last = reinterpret_cast<const uint8_t *>(end);
+
+	if (m_fingerprint == 0)
+	{
+		state_type s = m_root;
+
+		while (p < last)
+		{
+			s = table[s + classes[*p]];
+			++p;
+
+			if (s < m_special)
+				report(s, p, 0, found);
+		}
+
+		return;
+	}
+
+	// follow the patterns from each candidate until it leaves them, and
+	// report only those starting there
+	for (p = candidate(p, last); p < last; p = candidate(p + 1, last))
+	{
+		state_type s = m_root;
+
+		for (const uint8_t * q = p; q < last; )
+		{
+			s = table[s + classes[*q]];
+			++q;
+
+			const std::size_t depth = q - p;
+
+			if (m_depths[s >> m_stride_bits] != depth)
+				break;
+
+			if (s < m_special)
+				report(s, q, depth, found);
+		}
+	}
+}
+
+} // namespace automata
+
+#endif // GUARD_LITERAL_SET_H
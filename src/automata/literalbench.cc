@@ -0,0 +1,195 @@
+// Finding many literal strings at once with automata::literal_set, over
+// text made by shuffling the lines of the UTF-8 sample in utfsample.cc,
+// with words from the sample as the patterns.
+//
+// usage: literalbench [megabytes]
+//
+// Small sets go through the Teddy prefilter, and again without it to
+// show the automaton alone; those are also found with a memmem() per
+// pattern, the obvious way. The large set, thousands of words of which
+// most never occur, is past what the prefilter takes and what memmem()
+// can do in reasonable time.
+
+#include "literal_set.h"
+#include "utfsample.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+void report(const char * what, std::size_t bytes, std::size_t found,
+            clock_type::duration d)
+{
+	double s = std::chrono::duration<double>(d).count();
+	printf("%-22s %10.1f %10.2f %10zu\n", what, bytes / s / 1e6,
+	       s * 1e9 / bytes, found);
+}
+
+std::vector<std::string> sample_lines()
+{
+	std::vector<std::string> lines;
+	const char * p = sample_utf8;
+
+	while (*p != '\0')
+	{
+		const char * eol = strchr(p, '\n');
+		const char * next = eol ? eol + 1 : p + strlen(p);
+
+		lines.emplace_back(p, next);
+		p = next;
+	}
+
+	return lines;
+}
+
+/// The sample's words of three bytes or more, UTF-8 ones included
+std::vector<std::string> sample_words(const std::vector<std::string> & lines)
+{
+	std::set<std::string> words;
+
+	for (const std::string & line : lines)
+	{
+		std::string word;
+
+		for (char c : line)
+		{
+			if (  (static_cast<unsigned char>(c) > ' ')
+			   && ! strchr(".,;:!?()[]<>\"'", c))
+				word += c;
+			else
+			{
+				if (word.size() >= 3)
+					words.insert(word);
+				word.clear();
+			}
+		}
+	}
+
+	return std::vector<std::string>(words.begin(), words.end());
+}
+
+std::size_t bench_set(const char * what, const automata::literal_set & set,
+                      const std::string & text)
+{
+	std::size_t found = 0;
+	clock_type::time_point start = clock_type::now();
+
+	set.scan(text.data(), text.data() + text.size(),
+	         [&found] (std::size_t, const char *) { ++found; });
+	report(what, text.size(), found, clock_type::now() - start);
+
+	return found;
+}
+
+std::size_t bench_memmem(const std::vector<std::string> & patterns,
+                         const std::string & text)
+{
+	std::size_t found = 0;
+	clock_type::time_point start = clock_type::now();
+
+	for (const std::string & pattern : patterns)
+	{
+		const char * p = text.data();
+		const char * const end = p + text.size();
+
+		while (const void * at = memmem(p, end - p, pattern.data(),
+		                                pattern.size()))
+		{
+			++found;
+			p = static_cast<const char *>(at) + 1;
+		}
+	}
+
+	report("memmem each", text.size(), found, clock_type::now() - start);
+	return found;
+}
+
+void bench(const std::vector<std::string> & patterns, const std::string & text)
+{
+	clock_type::time_point start = clock_type::now();
+	const automata::literal_set set(patterns);
+	const double build = std::chrono::duration<double>(
+	                       clock_type::now() - start).count();
+	const automata::literal_set plain(patterns, false);
+
+	printf("\n%zu patterns: %zu states, %zu classes, built in %.0f us\n",
+	       patterns.size(), set.state_count(), set.class_count(),
+	       build * 1e6);
+
+	const std::size_t found = bench_set("literal_set", plain, text);
+
+	if (! set.prefiltered())
+		return;
+
+	const std::size_t teddy = bench_set("literal_set teddy", set, text);
+	const std::size_t each = bench_memmem(patterns, text);
+
+	if ((teddy != found) || (each != found))
+		fprintf(stderr, "found %zu, %zu with teddy, %zu with memmem\n",
+		        found, teddy, each);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	const long mb = (argc > 1) ? atol(argv[1]) : 64;
+
+	if (mb <= 0)
+	{
+		fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+		return 1;
+	}
+
+	try {
+		const std::vector<std::string> lines = sample_lines();
+		std::vector<std::string> words = sample_words(lines);
+		std::mt19937 rng(42);
+		std::string text;
+
+		while (text.size() < (static_cast<std::size_t>(mb) << 20))
+			text += lines[rng() % lines.size()];
+
+		std::shuffle(words.begin(), words.end(), rng);
+
+		printf("%zu bytes of text, %zu words in the sample\n",
+		       text.size(), words.size());
+		printf("%-22s %10s %10s %10s\n", "", "MB/s", "ns/byte", "found");
+
+		bench(std::vector<std::string>(words.begin(), words.begin() + 8),
+		      text);
+		bench(std::vector<std::string>(words.begin(), words.begin() + 64),
+		      text);
+
+		// and made up words, mostly of letters, that aren't there
+		std::vector<std::string> many(words);
+
+		while (many.size() < 5000)
+		{
+			std::string word;
+
+			for (unsigned n = 4 + rng() % 8; n > 0; --n)
+				word += "etaoinshrdlucmfwypvbgkqjxz0123456789"[rng() % 36];
+
+			many.push_back(word);
+		}
+
+		bench(many, text);
+	} catch (std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "nfa.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace automata {
+
+void nfa::close(std::vector<state_id> & set) const
+{
+	std::vector<bool> seen(m_states.size(), false);
+	std::vector<state_id> pending(set);
+
+	set.clear();
+
+	while (! pending.empty())
+	{
+		const state_id id = pending.back();
+		pending.pop_back();
+
+		if (seen[id])
+			continue;
+
+		seen[id] = true;
+		set.push_back(id);
+
+		for (state_id next : m_states[id].empty_edges)
+			if (! seen[next])
+				pending.push_back(next);
+	}
+
+	std::sort(set.begin(), set.end());
+}
+
+std::vector<nfa::state_id>
+nfa::move(const std::vector<state_id> & set, input_type b) const
+{
+	std::vector<state_id> next;
+
+	for (state_id id : set)
+		for (const edge & e : m_states[id].edges)
+			if (e.range.contains(b))
+				next.push_back(e.target);
+
+	close(next);
+	return next;
+}
+
+std::vector<nfa::range_type> nfa::input_ranges() const
+{
+	constexpr unsigned input_count =
+	  1u + std::numeric_limits<input_type>::max();
+
+	// starts[v] if a range begins at v
+	std::vector<bool> starts(input_count + 1, false);
+	starts[0] = true;
+
+	for (const state & s : m_states)
+	{
+		for (const edge & e : s.edges)
+		{
+			starts[e.range.min()] = true;
+			starts[e.range.max() + 1u] = true;
+		}
+	}
+
+	std::vector<range_type> ranges;
+	unsigned begin = 0;
+
+	for (unsigned v = 1; v <= input_count; ++v)
+	{
+		if (starts[v] || (v == input_count))
+		{
+			ranges.emplace_back(begin, v - 1);
+			begin = v;
+		}
+	}
+
+	return ranges;
+}
+
+} // namespace automata
@@ -0,0 +1,79 @@
+#ifndef GUARD_NFA_H
+#define GUARD_NFA_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "value_range.h"
+
+namespace automata {
+
+//////////////////////////////////////////////////////////////////////
+/// A nondeterministic automaton over bytes, as Thompson's construction
+/// builds it: states joined by edges on ranges of bytes and by empty
+/// edges, with one start state and one accepting state.
+class nfa
+{
+ public:
+	typedef uint8_t input_type;
+	typedef value_range<input_type> range_type;
+	typedef uint32_t state_id;
+
+	struct edge
+	{
+		range_type range;
+		state_id target;
+	};
+
+	struct state
+	{
+		std::vector<edge> edges;
+		std::vector<state_id> empty_edges;
+	};
+
+	nfa() : m_states(), m_start(0), m_accept(0) { }
+
+	state_id add_state()
+	{
+		m_states.emplace_back();
+		return static_cast<state_id>(m_states.size() - 1);
+	}
+
+	void add_edge(state_id from, state_id to, const range_type & range)
+		{ m_states[from].edges.push_back(edge{ range, to }); }
+
+	void add_empty_edge(state_id from, state_id to)
+		{ m_states[from].empty_edges.push_back(to); }
+
+	void set_start(state_id id) { m_start = id; }
+	void set_accept(state_id id) { m_accept = id; }
+
+	state_id start() const { return m_start; }
+	state_id accept() const { return m_accept; }
+
+	std::size_t size() const { return m_states.size(); }
+
+	const state & operator [] (state_id id) const
+		{ return m_states[id]; }
+
+	/// Adds everything reachable from the states in set by empty edges
+	/// to it, and sorts it, so equal sets compare equal
+	void close(std::vector<state_id> & set) const;
+
+	/// The states reached from those in set on byte b, closed
+	std::vector<state_id> move(const std::vector<state_id> & set,
+	                           input_type b) const;
+
+	/// The bytes split into the fewest ranges that no edge splits: all
+	/// the bytes of one behave the same in every state
+	std::vector<range_type> input_ranges() const;
+
+ private:
+	std::vector<state> m_states;
+	state_id m_start;
+	state_id m_accept;
+};
+
+} // namespace automata
+
+#endif // GUARD_NFA_H
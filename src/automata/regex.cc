@@ -0,0 +1,551 @@
+#include "regex.h"
+
+#include <bitset>
+#include <vector>
+
+namespace automata {
+
+namespace {
+
+typedef std::bitset<256> byte_set;
+
+constexpr unsigned unbounded = ~0u;
+constexpr unsigned max_repeat = 1000;
+constexpr unsigned max_depth = 200;
+constexpr std::size_t max_nfa_states = 1u << 20;
+
+/// A node of the parse tree: a set of bytes, or its children in
+/// sequence, as alternatives, or repeated between min and max times
+struct node
+{
+	enum kind_type { bytes, sequence, choice, repeat };
+
+	kind_type kind;
+	byte_set set;
+	std::vector<std::size_t> children;
+	unsigned min;
+	unsigned max;
+};
+
+byte_set range_set(unsigned low, unsigned high)
+{
+	byte_set s;
+
+	for (unsigned v = low; v <= high; ++v)
+		s.set(v);
+
+	return s;
+}
+
+byte_set digits() { return range_set('0', '9'); }
+
+byte_set word()
+{
+	return (range_set('a', 'z') | range_set('A', 'Z') | digits()
+	        | range_set('_', '_'));
+}
+
+byte_set space()
+{
+	return (range_set(' ', ' ') | range_set('\t', '\r'));
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Recursive descent over the pattern, into a vector of nodes
+class parser
+{
+ public:
+	explicit parser(const std::string & pattern)
+	  : m_pattern(pattern)
+	  , m_pos(0)
+	  , m_end(pattern.size())
+	  , m_depth(0)
+	  , m_nodes()
+		{ }
+
+	/// Parses the whole pattern, returning the root
+	std::size_t parse(bool & anchored_start, bool & anchored_end)
+	{
+		anchored_start = (m_end > 0) && (m_pattern[0] == '^');
+
+		if (anchored_start)
+			++m_pos;
+
+		// a $ at the end is an anchor if the \s before it pair off
+		std::size_t escapes = 0;
+
+		while (  (escapes + 1 < m_end)
+		      && (m_pattern[m_end - 2 - escapes] == '\\'))
+			++escapes;
+
+		anchored_end = (  (m_end > m_pos)
+		               && (m_pattern[m_end - 1] == '$')
+		               && ((escapes % 2) == 0));
+
+		if (anchored_end)
+			--m_end;
+
+		const std::size_t root = alternation();
+
+		if (m_pos < m_end)
+			fail("unmatched )");
+
+		return root;
+	}
+
+	const std::vector<node> & nodes() const { return m_nodes; }
+
+ private:
+	[[noreturn]] void fail(const char * what) const
+		{ throw regex_error(std::string("regex: ") + what, m_pos); }
+
+	bool more() const { return (m_pos < m_end); }
+
+	char peek() const { return m_pattern[m_pos]; }
+
+	std::size_t add(node::kind_type kind)
+	{
+		m_nodes.push_back(node{ kind, byte_set(), {}, 1, 1 });
+		return (m_nodes.size() - 1);
+	}
+
+	std::size_t add(const byte_set & set)
+	{
+		const std::size_t i = add(node::bytes);
+		m_nodes[i].set = set;
+		return i;
+	}
+
+	std::size_t alternation()
+	{
+		if (++m_depth > max_depth)
+			fail("too deeply nested");
+
+		const std::size_t first = sequence();
+
+		if (! more() || (peek() != '|'))
+		{
+			--m_depth;
+			return first;
+		}
+
+		const std::size_t choice = add(node::choice);
+		m_nodes[choice].children.push_back(first);
+
+		while (more() && (peek() == '|'))
+		{
+			++m_pos;
+			const std::size_t next = sequence();
+			m_nodes[choice].children.push_back(next);
+		}
+
+		--m_depth;
+		return choice;
+	}
+
+	std::size_t sequence()
+	{
+		const std::size_t seq = add(node::sequence);
+
+		while (more() && (peek() != '|') && (peek() != ')'))
+		{
+			const std::size_t next = repetition();
+			m_nodes[seq].children.push_back(next);
+		}
+
+		return seq;
+	}
+
+	std::size_t repetition()
+	{
+		std::size_t item = atom();
+
+		while (more())
+		{
+			unsigned min, max;
+
+			switch (peek())
+			{
+			case '*': min = 0; max = unbounded; ++m_pos; break;
+			case '+': min = 1; max = unbounded; ++m_pos; break;
+			case '?': min = 0; max = 1; ++m_pos; break;
+			case '{': bounds(min, max); break;
+			default: return item;
+			}
+
+			const std::size_t rep = add(node::repeat);
+			m_nodes[rep].children.push_back(item);
+			m_nodes[rep].min = min;
+			m_nodes[rep].max = max;
+			item = rep;
+		}
+
+		return item;
+	}
+
+	/// {n}, {n,} or {n,m}
+	void bounds(unsigned & min, unsigned & max)
+	{
+		++m_pos;
+		min = number();
+		max = min;
+
+		if (more() && (peek() == ','))
+		{
+			++m_pos;
+			max = (more() && (peek() == '}')) ? unbounded : number();
+		}
+
+		if (! more() || (peek() != '}'))
+			fail("expected } after repeat count");
+
+		if (max < min)
+			fail("repeat counts out of order");
+
+		++m_pos;
+	}
+
+	unsigned number()
+	{
+		unsigned n = 0;
+		const std::size_t start = m_pos;
+
+		while (more() && (peek() >= '0') && (peek() <= '9'))
+		{
+			n = (n * 10) + (peek() - '0');
+
+			if (n > max_repeat)
+				fail("repeat count too large");
+
+			++m_pos;
+		}
+
+		if (m_pos == start)
+			fail("expected a repeat count");
+
+		return n;
+	}
+
+	std::size_t atom()
+	{
+		const char c = peek();
+
+		switch (c)
+		{
+		case '(':
+		{
+			++m_pos;
+
+			if (  ((m_end - m_pos) >= 2)
+			   && (m_pattern[m_pos] == '?') && (m_pattern[m_pos + 1] == ':'))
+				m_pos += 2;
+
+			const std::size_t inside = alternation();
+
+			if (! more() || (peek() != ')'))
+				fail("unmatched (");
+
+			++m_pos;
+			return inside;
+		}
+
+		case '[':
+			++m_pos;
+			return add(bracket());
+
+		case '.':
+			++m_pos;
+			return add(~(range_set('\n', '\n') | range_set('\r', '\r')));
+
+		case '\\':
+		{
+			byte_set set;
+			escape(set);
+			return add(set);
+		}
+
+		case '*': case '+': case '?': case '{':
+			fail("nothing to repeat");
+
+		case '^': case '$':
+			fail("anchors are only allowed at the ends of the pattern");
+
+		default:
+			++m_pos;
+			return add(range_set(static_cast<uint8_t>(c),
+			                     static_cast<uint8_t>(c)));
+		}
+	}
+
+	/// An escape, into set; true if it was a single byte
+	bool escape(byte_set & set)
+	{
+		++m_pos;
+
+		if (! more())
+			fail("trailing \\");
+
+		const char c = peek();
+		++m_pos;
+
+		switch (c)
+		{
+		case 'd': set = digits(); return false;
+		case 'D': set = ~digits(); return false;
+		case 'w': set = word(); return false;
+		case 'W': set = ~word(); return false;
+		case 's': set = space(); return false;
+		case 'S': set = ~space(); return false;
+
+		case 'n': set = range_set('\n', '\n'); return true;
+		case 'r': set = range_set('\r', '\r'); return true;
+		case 't': set = range_set('\t', '\t'); return true;
+		case 'f': set = range_set('\f', '\f'); return true;
+		case 'v': set = range_set('\v', '\v'); return true;
+		case '0': set = range_set(0, 0); return true;
+
+		case 'x':
+		{
+			unsigned v = 0;
+
+			for (int i = 0; i < 2; ++i, ++m_pos)
+			{
+				const char h = more() ? peek() : 0;
+
+				if ((h >= '0') && (h <= '9'))
+					v = (v << 4) | (h - '0');
+				else if ((h >= 'a') && (h <= 'f'))
+					v = (v << 4) | (h - 'a' + 10);
+				else if ((h >= 'A') && (h <= 'F'))
+					v = (v << 4) | (h - 'A' + 10);
+				else
+					fail("expected two hex digits after \\x");
+			}
+
+			set = range_set(v, v);
+			return true;
+		}
+
+		default:
+			if (  ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'))
+			   || ((c >= '0') && (c <= '9')))
+			{
+				--m_pos;
+				fail("unknown escape");
+			}
+
+			set = range_set(static_cast<uint8_t>(c), static_cast<uint8_t>(c));
+			return true;
+		}
+	}
+
+	/// One byte in a bracket, or a set for an escape like \d; true for a
+	/// byte, which is then the only one in set
+	bool bracket_item(byte_set & set)
+	{
+		if (peek() == '\\')
+			return escape(set);
+
+		set = range_set(static_cast<uint8_t>(peek()),
+		                static_cast<uint8_t>(peek()));
+		++m_pos;
+		return true;
+	}
+
+	static unsigned only(const byte_set & set)
+	{
+		unsigned v = 0;
+
+		while (! set.test(v))
+			++v;
+
+		return v;
+	}
+
+	/// [...] after the [
+	byte_set bracket()
+	{
+		byte_set set;
+		const bool negated = more() && (peek() == '^');
+
+		if (negated)
+			++m_pos;
+
+		for (bool first = true; ; first = false)
+		{
+			if (! more())
+				fail("unmatched [");
+
+			if ((peek() == ']') && ! first)
+				break;
+
+			byte_set item;
+			const bool single = bracket_item(item);
+
+			if (  single && ((m_end - m_pos) >= 2)
+			   && (peek() == '-') && (m_pattern[m_pos + 1] != ']'))
+			{
+				++m_pos;
+
+				byte_set high;
+
+				if (! bracket_item(high))
+					fail("bad range in []");
+
+				const unsigned low_v = only(item);
+				const unsigned high_v = only(high);
+
+				if (high_v < low_v)
+					fail("range out of order in []");
+
+				item = range_set(low_v, high_v);
+			}
+
+			set |= item;
+		}
+
+		++m_pos;
+		return (negated ? ~set : set);
+	}
+
+	const std::string & m_pattern;
+	std::size_t m_pos;
+	std::size_t m_end;
+	unsigned m_depth;
+	std::vector<node> m_nodes;
+};
+
+//////////////////////////////////////////////////////////////////////
+/// Thompson's construction
+struct fragment
+{
+	nfa::state_id start;
+	nfa::state_id end;
+};
+
+fragment emit(nfa & n, const std::vector<node> & nodes, std::size_t i)
+{
+	if (n.size() > max_nfa_states)
+		throw regex_error("regex: pattern too large", 0);
+
+	const node & x = nodes[i];
+	const nfa::state_id start = n.add_state();
+	nfa::state_id end = start;
+
+	switch (x.kind)
+	{
+	case node::bytes:
+		end = n.add_state();
+
+		for (unsigned v = 0; v < 256; )
+		{
+			if (! x.set.test(v))
+			{
+				++v;
+				continue;
+			}
+
+			unsigned last = v;
+
+			while ((last < 255) && x.set.test(last + 1))
+				++last;
+
+			n.add_edge(start, end, nfa::range_type(v, last));
+			v = last + 1;
+		}
+		break;
+
+	case node::sequence:
+		for (std::size_t child : x.children)
+		{
+			const fragment f = emit(n, nodes, child);
+			n.add_empty_edge(end, f.start);
+			end = f.end;
+		}
+		break;
+
+	case node::choice:
+		end = n.add_state();
+
+		for (std::size_t child : x.children)
+		{
+			const fragment f = emit(n, nodes, child);
+			n.add_empty_edge(start, f.start);
+			n.add_empty_edge(f.end, end);
+		}
+		break;
+
+	case node::repeat:
+		for (unsigned r = 0; r < x.min; ++r)
+		{
+			const fragment f = emit(n, nodes, x.children[0]);
+			n.add_empty_edge(end, f.start);
+			end = f.end;
+		}
+
+		if (x.max == unbounded)
+		{
+			const fragment f = emit(n, nodes, x.children[0]);
+			n.add_empty_edge(end, f.start);
+			n.add_empty_edge(f.end, end);
+		} else if (x.max > x.min)
+		{
+			// each of the optional ones can be the last
+			const nfa::state_id done = n.add_state();
+
+			for (unsigned r = x.min; r < x.max; ++r)
+			{
+				const fragment f = emit(n, nodes, x.children[0]);
+				n.add_empty_edge(end, done);
+				n.add_empty_edge(end, f.start);
+				end = f.end;
+			}
+
+			n.add_empty_edge(end, done);
+			end = done;
+		}
+		break;
+	}
+
+	return fragment{ start, end };
+}
+
+dfa compile(const std::string & pattern, std::size_t max_states)
+{
+	parser p(pattern);
+	bool anchored_start, anchored_end;
+	const std::size_t root = p.parse(anchored_start, anchored_end);
+
+	nfa n;
+	const fragment f = emit(n, p.nodes(), root);
+
+	n.set_accept(f.end);
+
+	if (anchored_start)
+		n.set_start(f.start);
+	else
+	{
+		// a match can start anywhere
+		const nfa::state_id any = n.add_state();
+		n.add_edge(any, any, nfa::range_type(0, 255));
+		n.add_empty_edge(any, f.start);
+		n.set_start(any);
+	}
+
+	try
+	{
+		return dfa(n, ! anchored_end, max_states);
+	} catch (const std::length_error &)
+	{
+		throw regex_error("regex: pattern needs too many states",
+		                  pattern.size());
+	}
+}
+
+} // namespace
+
+regex::regex(const std::string & pattern, std::size_t max_states)
+  : m_dfa(compile(pattern, max_states))
+{ }
+
+} // namespace automata
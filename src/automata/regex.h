@@ -0,0 +1,70 @@
+#ifndef GUARD_REGEX_H
+#define GUARD_REGEX_H 1
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include "dfa.h"
+
+namespace automata {
+
+//////////////////////////////////////////////////////////////////////
+/// Thrown for a pattern regex can't compile, with where in it
+class regex_error : public std::runtime_error
+{
+ public:
+	regex_error(const std::string & what, std::size_t offset)
+	  : std::runtime_error(what)
+	  , m_offset(offset)
+		{ }
+
+	std::size_t offset() const noexcept { return m_offset; }
+
+ private:
+	std::size_t m_offset;
+};
+
+//////////////////////////////////////////////////////////////////////
+/// A regular expression compiled to a minimal dfa, for searching a lot
+/// of text, such as filtering logs, at the speed of a table lookup a
+/// byte, or of memchr() over what can't start a match.
+///
+/// The syntax is the part of ECMAScript's that a DFA can do, over bytes:
+///
+///   - literals, and \ before anything that isn't a letter or digit
+///   - . for any byte but \n and \r
+///   - [abc], [a-z], [^...], with \d \w \s and escapes inside
+///   - \d \D \w \W \s \S, \n \r \t \f \v \0 and \xHH
+///   - grouping with ( ) or (?: ), alternation with |
+///   - * + ? {n} {n,} {n,m}, with n and m up to 1000
+///   - ^ at the start and $ at the end, for the ends of the text
+///
+/// There are no captures, back references, lookaround or lazy
+/// quantifiers; UTF-8 is matched a byte at a time.
+class regex
+{
+ public:
+	/// Throws regex_error if pattern is malformed or needs more states
+	/// than max_states
+	explicit regex(const std::string & pattern,
+	               std::size_t max_states = 10000);
+
+	/// The end of the first match in [begin, end), the one ending first,
+	/// or nullptr
+	const char * search(const char * begin, const char * end) const noexcept
+		{ return m_dfa.search(begin, end); }
+
+	/// Whether s has a match in it
+	bool search(const std::string & s) const noexcept
+		{ return (search(s.data(), s.data() + s.size()) != nullptr); }
+
+	const dfa & machine() const noexcept { return m_dfa; }
+
+ private:
+	dfa m_dfa;
+};
+
+} // namespace automata
+
+#endif // GUARD_REGEX_H
@@ -0,0 +1,172 @@
+// Filtering synthetic log lines with automata::regex and std::regex,
+// a line at a time as grep does, for a few patterns typical of looking
+// through logs: a rare literal, alternatives, and counted classes.
+//
+// usage: regexbench [megabytes]
+//
+// Each pattern is also run over the whole buffer, going on from the next
+// line after each match, which for the rare ones is mostly memchr() or
+// SSE2 compares for the bytes that can start a match.
+
+#include "regex.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <regex>
+#include <string>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+void report(const char * what, std::size_t bytes, std::size_t lines,
+            clock_type::duration d)
+{
+	double s = std::chrono::duration<double>(d).count();
+	printf("%-10s %10.1f %10.1f %10zu\n", what, bytes / s / 1e6,
+	       s * 1e9 / bytes, lines);
+}
+
+std::string make_log(std::size_t size)
+{
+	static const char * const levels[] = {
+		"INFO", "INFO", "INFO", "DEBUG", "DEBUG", "WARN"
+	};
+	static const char * const paths[] = {
+		"/api/v1/users", "/api/v1/orders", "/static/app.js", "/health"
+	};
+	static const char * const users[] = {
+		"alice", "bob", "carol", "dave", "erin"
+	};
+
+	std::mt19937 rng(42);
+	auto pick = [&rng] (unsigned n)
+		{ return static_cast<unsigned>(rng() % n); };
+	std::string log;
+	char line[256];
+
+	while (log.size() < size)
+	{
+		const unsigned kind = pick(1000);
+		const char * level = (kind == 0) ? "ERROR" : levels[pick(6)];
+		const char * tail = (kind == 1) ? " error=connection refused"
+		                  : (kind == 2) ? " error=timeout" : "";
+
+		snprintf(line, sizeof(line),
+		         "2026-10-19T%02u:%02u:%02u.%03u host%02u web[%u]: %s "
+		         "request id=%08x user=%s@example.com path=%s "
+		         "status=%u took %ums%s\n",
+		         pick(24), pick(60), pick(60), pick(1000), pick(16),
+		         1000 + pick(9000), level, static_cast<unsigned>(rng()),
+		         users[pick(5)], paths[pick(4)], pick(20) ? 200u : 500u,
+		         pick(500) ? pick(1000) : 1000 + pick(9000), tail);
+
+		log += line;
+	}
+
+	return log;
+}
+
+void bench(const char * pattern, const std::string & log)
+{
+	const char * const begin = log.data();
+	const char * const end = begin + log.size();
+	std::size_t dfa_lines = 0, whole_lines = 0, std_lines = 0;
+	clock_type::time_point start;
+
+	printf("\n%s\n", pattern);
+
+	start = clock_type::now();
+	const automata::regex re(pattern);
+	const double build = std::chrono::duration<double>(
+	                       clock_type::now() - start).count();
+
+	printf("%zu states, %zu classes, built in %.0f us\n",
+	       re.machine().state_count(), re.machine().class_count(),
+	       build * 1e6);
+
+	start = clock_type::now();
+	for (const char * p = begin; p < end; )
+	{
+		const char * eol = static_cast<const char *>(
+		                     memchr(p, '\n', end - p));
+
+		if (re.search(p, eol))
+			++dfa_lines;
+
+		p = eol + 1;
+	}
+	report("dfa", log.size(), dfa_lines, clock_type::now() - start);
+
+	// none of the patterns match across lines, so after a match the
+	// search can go on from the start of the next
+	start = clock_type::now();
+	for (const char * p = begin; p < end; )
+	{
+		const char * found = re.search(p, end);
+
+		if (! found)
+			break;
+
+		++whole_lines;
+
+		const char * eol = static_cast<const char *>(
+		                     memchr(found - 1, '\n', end - found + 1));
+		p = eol + 1;
+	}
+	report("dfa whole", log.size(), whole_lines, clock_type::now() - start);
+
+	const std::regex expected(pattern, std::regex::optimize);
+
+	start = clock_type::now();
+	for (const char * p = begin; p < end; )
+	{
+		const char * eol = static_cast<const char *>(
+		                     memchr(p, '\n', end - p));
+
+		if (std::regex_search(p, eol, expected))
+			++std_lines;
+
+		p = eol + 1;
+	}
+	report("std", log.size(), std_lines, clock_type::now() - start);
+
+	if ((dfa_lines != std_lines) || (whole_lines != std_lines))
+		fprintf(stderr, "dfa matched %zu lines, %zu in one pass, std %zu\n",
+		        dfa_lines, whole_lines, std_lines);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	const long mb = (argc > 1) ? atol(argv[1]) : 64;
+
+	if (mb <= 0)
+	{
+		fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+		return 1;
+	}
+
+	try {
+		const std::string log = make_log(mb << 20);
+
+		printf("%zu bytes of log\n", log.size());
+		printf("%-10s %10s %10s %10s\n", "", "MB/s", "ns/byte", "lines");
+
+		bench("ERROR", log);
+		bench("error=(timeout|refused|reset)", log);
+		bench("took [0-9]{4,}ms", log);
+		bench("user=(alice|bob)@[a-z]+\\.com path=/api/v1/\\w+ status=5",
+		      log);
+	} catch (std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -5,6 +5,8 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <numeric>
+#include <stdexcept>
 
 template <typename T, size_t N>
 class lookup_table
@@ -20,7 +22,7 @@ class lookup_table
 	lookup_table(const std::array<size_t, N> & dims,
 	             const std::initializer_list<T> & vals)
 	  : index_lengths(dims)
-	  , element_count(std::accumulate(dims.begin(), dims.end(), 1,
+	  , element_count(std::accumulate(dims.begin(), dims.end(), size_t(1),
                                       std::multiplies<size_t>()))
 	  , values(vals)
 		{ values.resize(element_count); }
@@ -28,7 +30,7 @@ class lookup_table
 	lookup_table(const std::array<size_t, N> & dims,
 	             const T & default_value = T())
 	  : index_lengths(dims)
-	  , element_count(std::accumulate(dims.begin(), dims.end(), 1,
+	  , element_count(std::accumulate(dims.begin(), dims.end(), size_t(1),
                                       std::multiplies<size_t>()))
 	  , values(element_count, default_value)
 		{ }
@@ -59,7 +61,7 @@ class lookup_table
 	{
 		auto length_iterator = index_lengths.begin();
 		return std::accumulate(
-		         idx.begin(), idx.end(), 0,
+		         idx.begin(), idx.end(), size_t(0),
 		         [&length_iterator] (size_t a, size_t b) {
 		             return (((*(length_iterator++)) * a) + b);
 		         });
@@ -70,11 +72,131 @@ class lookup_table
 	T at(Args ... args)
 	{
 		static_assert(sizeof...(args) == N, "Wrong number of parameters");
-		return values[translate_index({{args...}})];
+		return values[translate_index({{ static_cast<size_t>(args)... }})];
 	}
 
+	/// The values, last index varying fastest, for loops that do their
+	/// own indexing
+	const T * data() const noexcept
+		{ return values.data(); }
+
  private:
 	std::vector<T> values;
 };
 
+//////////////////////////////////////////////////////////////////////
+/// The strides of a table with dimensions DIMS..., last varying fastest
+template <size_t ... DIMS>
+struct table_strides;
+
+template <>
+struct table_strides<>
+{
+	static constexpr size_t element_count = 1;
+
+	static constexpr size_t offset() { return 0; }
+};
+
+template <size_t DIM, size_t ... DIMS>
+struct table_strides<DIM, DIMS...>
+{
+	static constexpr size_t stride = table_strides<DIMS...>::element_count;
+	static constexpr size_t element_count = DIM * stride;
+
+	template <typename ... Args>
+	static constexpr size_t offset(size_t i, Args ... rest)
+		{ return ((i * stride) + table_strides<DIMS...>::offset(rest...)); }
+};
+
+//////////////////////////////////////////////////////////////////////
+/// A lookup_table with its dimensions fixed at compile time: indexing
+/// is constant strides that fold into the addressing, there's no
+/// allocation to go through, and a table built from constants can be
+/// constexpr, and live in read-only data.
+template <typename T, size_t ... DIMS>
+class static_lookup_table
+{
+	typedef table_strides<DIMS...> strides;
+
+ public:
+	typedef std::array<size_t, sizeof...(DIMS)> index_type;
+
+	static constexpr size_t num_indexes = sizeof...(DIMS);
+	static constexpr index_type index_lengths = {{ DIMS... }};
+	static constexpr size_t element_count = strides::element_count;
+
+	static_assert(element_count > 0, "static_lookup_table can't be empty");
+
+	/// The values, last index varying fastest; an aggregate, as
+	/// std::array is, but one whose elements constant expressions can read
+	struct values_type
+	{
+		T elements[element_count];
+	};
+
+	/// Value initialized, all zero for numbers
+	constexpr static_lookup_table() : values() { }
+
+	explicit constexpr static_lookup_table(const values_type & vals)
+	  : values(vals)
+		{ }
+
+	T & at(const index_type & idx)
+	{
+		for (size_t i = 0; i < num_indexes; ++i)
+			if (idx[i] >= index_lengths[i])
+				throw std::out_of_range("static_lookup_table::at");
+		return values.elements[translate_index(idx)];
+	}
+
+	T at(const index_type & idx) const
+	{
+		for (size_t i = 0; i < num_indexes; ++i)
+			if (idx[i] >= index_lengths[i])
+				throw std::out_of_range("static_lookup_table::at");
+		return values.elements[translate_index(idx)];
+	}
+
+	T operator [] (const index_type & idx) const
+		{ return values.elements[translate_index(idx)]; }
+
+	T & operator [] (const index_type & idx)
+		{ return values.elements[translate_index(idx)]; }
+
+	size_t translate_index(const index_type & idx) const
+	{
+		size_t offset = 0;
+
+		for (size_t i = 0; i < num_indexes; ++i)
+			offset = (offset * index_lengths[i]) + idx[i];
+
+		return offset;
+	}
+
+	/// Unchecked, and usable in constant expressions
+	template <typename ... Args>
+	constexpr T at(Args ... args) const
+	{
+		static_assert(sizeof...(args) == num_indexes,
+		              "Wrong number of parameters");
+		return values.elements[strides::offset(args...)];
+	}
+
+	constexpr const T * data() const noexcept
+		{ return values.elements; }
+
+ private:
+	values_type values;
+};
+
+template <typename T, size_t ... DIMS>
+constexpr size_t static_lookup_table<T, DIMS...>::num_indexes;
+
+template <typename T, size_t ... DIMS>
+constexpr typename static_lookup_table<T, DIMS...>::index_type
+static_lookup_table<T, DIMS...>::index_lengths;
+
+template <typename T, size_t ... DIMS>
+constexpr size_t static_lookup_table<T, DIMS...>::element_count;
+
 #endif // GUARD_TABLE_H
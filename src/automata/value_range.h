@@ -64,7 +64,7 @@ class value_range
 	bool contains(const value_range & r) const
 		{ return ((r.begin >= begin) && (r.end <= end)); }
 
-	bool intersects(const value_range & other)
+	bool intersects(const value_range & other) const
 	{
 		return (  ( other.begin >= begin && other.begin <= end )
 		       || ( other.end >= begin   && other.end <= end )
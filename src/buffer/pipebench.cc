@@ -0,0 +1,89 @@
+// Relays a file to /dev/null through pipes of increasing capacity and
+// reports throughput and splice() calls for each.
+//
+// usage: pipebench [MiB] [file]
+//
+// Without a file, a sparse scratch file of the given size is used, so
+// the numbers reflect the pipe and page cache rather than the disk.
+
+#include "pipebuffer.h"
+#include "splicerelay.h"
+#include "utility/util.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+int main(int argc, char ** argv)
+{
+	const long mib = (argc > 1) ? atol(argv[1]) : 1024;
+	const char * fname = (argc > 2) ? argv[2] : nullptr;
+	char scratch[] = "/tmp/pipebench.XXXXXX";
+	int in = -1;
+
+	if (mib <= 0)
+	{
+		fprintf(stderr, "usage: %s [MiB] [file]\n", argv[0]);
+		return 1;
+	}
+
+	try {
+		if (fname == nullptr)
+		{
+			if ((in = mkstemp(scratch)) < 0)
+				throw make_syserr("mkstemp failed");
+			unlink(scratch);
+			if (ftruncate(in, mib * 1024 * 1024) < 0)
+				throw make_syserr("ftruncate failed");
+		} else if ((in = open(fname, O_RDONLY | O_CLOEXEC)) < 0)
+			throw make_syserr(std::string("Could not open ") + fname);
+
+		int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+		if (out < 0)
+			throw make_syserr("open of /dev/null failed");
+
+		// one untimed pass so every round finds the file cached
+		SpliceRelayOptions warm;
+		warm.maxBytes = mib * 1024 * 1024;
+		spliceRelay(in, out, warm);
+
+		printf("%10s %12s %12s %10s\n",
+		       "capacity", "MiB/s", "splices", "bytes/call");
+
+		for (int cap = 64 * 1024; ; cap *= 2)
+		{
+			if (cap > PipeBuffer::maxCapacity())
+				cap = PipeBuffer::maxCapacity();
+
+			SpliceRelayOptions opts;
+			opts.pipeSize = cap;
+			opts.maxBytes = mib * 1024 * 1024;
+
+			if (lseek(in, 0, SEEK_SET) < 0)
+				throw make_syserr("lseek failed");
+
+			SpliceRelayStats s = spliceRelay(in, out, opts);
+
+			printf("%10d %12.1f %12llu %10llu\n", cap,
+			       s.bytesPerSecond() / (1024 * 1024),
+			       static_cast<unsigned long long>(s.spliceCalls),
+			       static_cast<unsigned long long>(
+			           s.spliceCalls ? s.bytes / s.spliceCalls : 0));
+
+			if (cap >= PipeBuffer::maxCapacity())
+				break;
+		}
+
+		close(out);
+		close(in);
+	} catch (std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,9 +1,12 @@
 #include "pipebuffer.h"
-#include "util.h"
+#include "utility/util.h"
 
+#include <sys/ioctl.h>
 #include <unistd.h>
 #include <fcntl.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <cerrno>
@@ -12,7 +15,7 @@
 std::atomic<int> PipeBuffer::devNullFd(-1);
 
 //////////////////////////////////////////////////////////////////////
-PipeBuffer::PipeBuffer(int flags)
+PipeBuffer::PipeBuffer(int flags, int capacity)
   : pipeFds{-1, -1}
   , fillLevel(0)
 {
@@ -31,10 +34,23 @@ PipeBuffer::PipeBuffer(int flags)
 		
 	if (pipe2(pipeFds, flags) < 0)
 		throw make_syserr(errno, "Pipe creation failed");
+
+	if (capacity > 0)
+	{
+		try {
+			resize(capacity);
+		} catch (...) {
+			close(pipeFds[WR]);
+			close(pipeFds[RD]);
+			throw;
+		}
+	}
 }
 
 //////////////////////////////////////////////////////////////////////
 PipeBuffer::PipeBuffer(PipeBuffer && p) noexcept
+  : pipeFds{-1, -1}
+  , fillLevel(0)
 {
 	this->swap(p);
 }
@@ -66,6 +82,55 @@ void PipeBuffer::swap(PipeBuffer & other) noexcept
 	other.fillLevel.store(tmp);
 }
 
+//////////////////////////////////////////////////////////////////////
+int PipeBuffer::size() const
+{
+	int n = 0;
+	if (ioctl(pipeFds[RD], FIONREAD, &n) < 0)
+		throw make_syserr(errno, "FIONREAD on pipe failed");
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+int PipeBuffer::capacity() const
+{
+	int n = fcntl(pipeFds[WR], F_GETPIPE_SZ);
+	if (n < 0)
+		throw make_syserr(errno, "F_GETPIPE_SZ failed");
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+int PipeBuffer::resize(int bytes)
+{
+	int n = fcntl(pipeFds[WR], F_SETPIPE_SZ, std::min(bytes, maxCapacity()));
+	if (n < 0)
+		throw make_syserr(errno, "F_SETPIPE_SZ failed");
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+int PipeBuffer::maxCapacity()
+{
+	static std::atomic<int> maxSize(0);
+	int n = maxSize.load(std::memory_order_relaxed);
+
+	if (n == 0)
+	{
+		FILE * f = fopen("/proc/sys/fs/pipe-max-size", "re");
+
+		// without /proc, assume the kernel's default limit
+		if (f == NULL || fscanf(f, "%d", &n) != 1 || n <= 0)
+			n = 1024 * 1024;
+		if (f != NULL)
+			fclose(f);
+
+		maxSize.store(n, std::memory_order_relaxed);
+	}
+
+	return n;
+}
+
 //////////////////////////////////////////////////////////////////////
 int PipeBuffer::readOut(char * buffer, size_t bufsize) noexcept
 {
@@ -84,6 +149,38 @@ int PipeBuffer::writeIn(const char * buffer, size_t bufsize) noexcept
 	return n;
 }
 
+//////////////////////////////////////////////////////////////////////
+int PipeBuffer::vmspliceIn(const struct iovec * iov, unsigned long count)
+                           noexcept
+{
+	int n = vmsplice(pipeFds[WR], iov, count, 0);
+	if (n > 0)
+		fillLevel += n;
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+int PipeBuffer::giftIn(const struct iovec * iov, unsigned long count)
+                       noexcept
+{
+	static const uintptr_t pageMask = sysconf(_SC_PAGESIZE) - 1;
+
+	for (unsigned long i = 0; i < count; ++i)
+	{
+		if (  (reinterpret_cast<uintptr_t>(iov[i].iov_base) & pageMask)
+		   || (iov[i].iov_len & pageMask) )
+		{
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	int n = vmsplice(pipeFds[WR], iov, count, SPLICE_F_GIFT);
+	if (n > 0)
+		fillLevel += n;
+	return n;
+}
+
 //////////////////////////////////////////////////////////////////////
 int PipeBuffer::spliceIn(int fd, int numBytes, loff_t * offset) noexcept
 {
@@ -104,6 +201,16 @@ int PipeBuffer::spliceOut(int fd, int numBytes, loff_t * offset) noexcept
 	return n;
 }
 
+//////////////////////////////////////////////////////////////////////
+int PipeBuffer::teeOut(PipeBuffer & p, int numBytes, unsigned int flags)
+                       noexcept
+{
+	int n = tee(pipeFds[RD], p.pipeFds[WR], numBytes, flags);
+	if (n > 0)
+		p.fillLevel += n;
+	return n;
+}
+
 //////////////////////////////////////////////////////////////////////
 int PipeBuffer::spliceAllOut(int fd, loff_t * offset)
 {
@@ -134,6 +241,14 @@ int PipeBuffer::spliceAllOut(int fd, loff_t * offset)
 	return n;
 }
 
+//////////////////////////////////////////////////////////////////////
+bool PipeBuffer::drain() noexcept
+{
+	if (fillLevel > 0)
+		spliceAllOut(devNullFd, NULL);
+	return (fillLevel == 0);
+}
+
 //////////////////////////////////////////////////////////////////////
 void PipeBuffer::closePipe()
 {
@@ -143,9 +258,14 @@ void PipeBuffer::closePipe()
 	// cause  a  SIGPIPE signal to be generated for the calling process.
 	//
 	// We close the write end before the read end for this reason.
-	if (close(pipeFds[WR]) < 0)
+	//
+	// A moved-from PipeBuffer holds no pipe at all.
+	if (pipeFds[WR] >= 0 && close(pipeFds[WR]) < 0)
 		throw make_syserr(errno, "close of write end of pipe failed");
 
+	if (pipeFds[RD] < 0)
+		return;
+
 	spliceAllOut(devNullFd, NULL);
 
 	if (close(pipeFds[RD]) < 0)
@@ -1,6 +1,8 @@
 #ifndef PIPEBUFFER_H
 #define PIPEBUFFER_H 1
 
+#include <sys/types.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 
 #include <cstddef>
@@ -9,7 +11,8 @@
 class PipeBuffer
 {
  public:
-	PipeBuffer(int flags = 0);
+	// A capacity of 0 keeps the kernel's default (normally 64 KiB)
+	PipeBuffer(int flags = 0, int capacity = 0);
 
 	PipeBuffer(PipeBuffer && p) noexcept;
 
@@ -23,6 +26,25 @@ class PipeBuffer
 
 	int writeIn(const char * buffer, size_t bufsize) noexcept;
 
+	// Maps the user pages described by iov into the pipe with vmsplice()
+	// instead of copying them like writeIn(). May move less than asked
+	// for, like writev().
+	//
+	// The pipe refers to the caller's memory until the bytes leave it,
+	// so the memory must not change until then: spliced into a file,
+	// that is when spliceOut() returns; spliced into a socket, the
+	// network stack may hold the pages until the peer has acknowledged
+	// them. Reuse buffers in a rotation at least that deep, or use
+	// giftIn().
+	int vmspliceIn(const struct iovec * iov, unsigned long count) noexcept;
+
+	// vmspliceIn() with SPLICE_F_GIFT: ownership of the pages passes to
+	// the pipe. Every iov entry must be page aligned and a whole number
+	// of pages long (else -1/EINVAL). Afterwards the caller must never
+	// write to that memory again; unmapping it is fine, the pipe keeps
+	// its own reference to the pages.
+	int giftIn(const struct iovec * iov, unsigned long count) noexcept;
+
 	int spliceIn(int fd, int numBytes, loff_t * offset = NULL) noexcept;
 
 	int spliceIn(PipeBuffer & p, int numBytes) noexcept
@@ -43,8 +65,33 @@ class PipeBuffer
 		return n;
 	}
 
+	// Duplicates up to numBytes from the front of this pipe into p
+	// without consuming them
+	int teeOut(PipeBuffer & p, int numBytes, unsigned int flags = 0) noexcept;
+
 	int spliceAllOut(int fd, loff_t * offset = NULL);
 
+	// Discards whatever the pipe holds. Returns true if it is now empty.
+	bool drain() noexcept;
+
+	// Bytes currently held, as tracked by this object
+	int level() const noexcept { return fillLevel; }
+
+	// Bytes currently held, as reported by the kernel (FIONREAD)
+	int size() const;
+
+	// Bytes the pipe can hold (F_GETPIPE_SZ)
+	int capacity() const;
+
+	// Changes the capacity with F_SETPIPE_SZ. Requests are clamped to
+	// maxCapacity(); the kernel rounds up to a power-of-two number of
+	// pages. Returns the new capacity. Fails with EBUSY when shrinking
+	// below what the pipe currently holds.
+	int resize(int bytes);
+
+	// /proc/sys/fs/pipe-max-size, read once
+	static int maxCapacity();
+
  private:
 	enum { RD = 0, WR = 1 };
 
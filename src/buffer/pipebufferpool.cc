@@ -0,0 +1,118 @@
+#include "pipebufferpool.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> nextPoolId(1);
+
+struct FreeList
+{
+	uint64_t pool;
+	std::vector<PipeBuffer> pipes;
+};
+
+// Free lists are keyed by pool id rather than address, so a pool
+// allocated where a destroyed one lived doesn't inherit its pipes.
+// There are seldom more than a couple of pools, hence the linear scan.
+thread_local std::vector<FreeList> freeLists;
+
+std::vector<PipeBuffer> * findFreeList(uint64_t pool) noexcept
+{
+	for (auto & f : freeLists)
+		if (f.pool == pool)
+			return &f.pipes;
+	return nullptr;
+}
+
+std::vector<PipeBuffer> & freeList(uint64_t pool)
+{
+	std::vector<PipeBuffer> * f = findFreeList(pool);
+
+	if (f == nullptr)
+	{
+		freeLists.push_back(FreeList{ pool, std::vector<PipeBuffer>() });
+		f = &freeLists.back().pipes;
+	}
+
+	return *f;
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+PipeBufferPool::Lease::~Lease()
+{
+	if (pool != nullptr)
+		pool->release(std::move(buffer));
+}
+
+//////////////////////////////////////////////////////////////////////
+PipeBufferPool::PipeBufferPool(int _capacity, size_t _maxIdle, int _flags)
+  : id(nextPoolId.fetch_add(1, std::memory_order_relaxed))
+  , capacity(_capacity)
+  , maxIdle(_maxIdle)
+  , flags(_flags)
+  , createdCount(0)
+	{ }
+
+//////////////////////////////////////////////////////////////////////
+PipeBufferPool::~PipeBufferPool()
+{
+	freeLists.erase(std::remove_if(freeLists.begin(), freeLists.end(),
+	                               [this](const FreeList & f)
+	                               { return f.pool == id; }),
+	                freeLists.end());
+}
+
+//////////////////////////////////////////////////////////////////////
+PipeBuffer PipeBufferPool::create()
+{
+	PipeBuffer p(flags, capacity);
+	createdCount.fetch_add(1, std::memory_order_relaxed);
+	return p;
+}
+
+//////////////////////////////////////////////////////////////////////
+PipeBufferPool::Lease PipeBufferPool::acquire()
+{
+	std::vector<PipeBuffer> * f = findFreeList(id);
+
+	if (f == nullptr || f->empty())
+		return Lease(this, create());
+
+	Lease l(this, std::move(f->back()));
+	f->pop_back();
+	return l;
+}
+
+//////////////////////////////////////////////////////////////////////
+void PipeBufferPool::release(PipeBuffer && p)
+{
+	if (! p.drain())
+		return; // p closes when it goes out of scope
+
+	std::vector<PipeBuffer> & f = freeList(id);
+
+	if (f.size() < maxIdle)
+		f.push_back(std::move(p));
+}
+
+//////////////////////////////////////////////////////////////////////
+void PipeBufferPool::reserve(size_t n)
+{
+	std::vector<PipeBuffer> & f = freeList(id);
+
+	f.reserve(n);
+	while (f.size() < n)
+		f.push_back(create());
+}
+
+//////////////////////////////////////////////////////////////////////
+size_t PipeBufferPool::idle() const
+{
+	const std::vector<PipeBuffer> * f = findFreeList(id);
+	return f ? f->size() : 0;
+}
@@ -0,0 +1,90 @@
+#ifndef PIPEBUFFERPOOL_H
+#define PIPEBUFFERPOOL_H 1
+
+#include <fcntl.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "pipebuffer.h"
+
+// PipeBufferPool keeps emptied pipes for reuse, so a short transfer costs
+// a splice or two rather than pipe2(), fcntl() and two close()s.
+//
+// Each thread has its own free list for each pool, so acquire() and
+// release() never take a lock; a pipe released on another thread than
+// the one that acquired it simply joins that thread's list. Pipes are
+// drained on release and discarded when they can't be emptied or the
+// thread's list already holds maxIdle of them.
+//
+// Idle pipes belong to their thread: they are closed when the thread
+// exits, or, for the destroying thread, when the pool is destroyed.
+// A pipe given a different capacity with resize() keeps it.
+class PipeBufferPool
+{
+ public:
+	// Returned pipes go back to the pool when a Lease is destroyed
+	class Lease
+	{
+	 public:
+		Lease(Lease && l) noexcept
+		  : pool(l.pool)
+		  , buffer(std::move(l.buffer))
+			{ l.pool = nullptr; }
+
+		~Lease();
+
+		PipeBuffer & operator * () noexcept { return buffer; }
+		PipeBuffer * operator -> () noexcept { return &buffer; }
+
+	 private:
+		friend class PipeBufferPool;
+
+		Lease(PipeBufferPool * p, PipeBuffer && b) noexcept
+		  : pool(p)
+		  , buffer(std::move(b))
+			{ }
+
+		Lease(const Lease &) = delete;
+		Lease & operator = (const Lease &) = delete;
+		Lease & operator = (Lease &&) = delete;
+
+		PipeBufferPool * pool;
+		PipeBuffer buffer;
+	};
+
+	explicit PipeBufferPool(int capacity = 0, size_t maxIdle = 16,
+	                        int flags = O_CLOEXEC);
+
+	~PipeBufferPool();
+
+	Lease acquire();
+
+	// Returns a pipe obtained from acquire() (or any compatible one)
+	void release(PipeBuffer && p);
+
+	// Creates pipes until the calling thread has n idle ones
+	void reserve(size_t n);
+
+	// Idle pipes held for the calling thread
+	size_t idle() const;
+
+	// Pipes this pool has ever had to create
+	uint64_t created() const noexcept
+		{ return createdCount.load(std::memory_order_relaxed); }
+
+ private:
+	PipeBuffer create();
+
+	const uint64_t id;
+	const int capacity;
+	const size_t maxIdle;
+	const int flags;
+	std::atomic<uint64_t> createdCount;
+
+	PipeBufferPool(const PipeBufferPool &) = delete;
+	PipeBufferPool & operator = (const PipeBufferPool &) = delete;
+};
+
+#endif // PIPEBUFFERPOOL_H
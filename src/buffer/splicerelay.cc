@@ -0,0 +1,147 @@
+#include "splicerelay.h"
+#include "pipebuffer.h"
+#include "utility/util.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////
+// Sleeps until a descriptor is ready. Only the one descriptor that
+// reported EAGAIN is polled, so a source that is still readable can't
+// wake a wait for the sink to drain.
+class ReadyWaiter
+{
+ public:
+	ReadyWaiter(int timeoutMs, uint64_t & waits)
+	  : timeout(timeoutMs)
+	  , waitCount(waits)
+		{ }
+
+	void wait(int fd, short events)
+	{
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = events;
+		pfd.revents = 0;
+
+		++waitCount;
+
+		int rc;
+		while ((rc = poll(&pfd, 1, timeout)) < 0)
+			if (errno != EINTR)
+				throw make_syserr("poll failed");
+
+		if (rc == 0)
+			throw make_syserr(ETIMEDOUT, "Splice relay timed out");
+	}
+
+ private:
+	int timeout;
+	uint64_t & waitCount;
+
+	ReadyWaiter(const ReadyWaiter &) = delete;
+	ReadyWaiter & operator = (const ReadyWaiter &) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////
+// Splices exactly numBytes from the front of p into fd
+void drain(PipeBuffer & p, int fd, int numBytes, ReadyWaiter & waiter,
+           uint64_t & calls)
+{
+	while (numBytes > 0)
+	{
+		++calls;
+		int n = p.spliceOut(fd, numBytes);
+
+		if (n > 0)
+			numBytes -= n;
+		else if (n < 0 && errno == EAGAIN)
+			waiter.wait(fd, POLLOUT);
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else
+			throw make_syserr(n < 0 ? errno : EPIPE,
+			                  "Splice relay could not write");
+	}
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+SpliceRelayStats spliceRelay(int inFd, int outFd,
+                             const SpliceRelayOptions & opts)
+{
+	typedef std::chrono::steady_clock clock;
+
+	SpliceRelayStats stats = SpliceRelayStats();
+	const clock::time_point start = clock::now();
+	const bool teeing = (opts.teeFd >= 0);
+
+	ReadyWaiter waiter(opts.timeoutMs, stats.waits);
+	PipeBuffer relay(O_CLOEXEC, opts.pipeSize);
+	PipeBuffer copy(O_CLOEXEC, teeing ? opts.pipeSize : 0);
+
+	const int chunk = (opts.chunkSize == 0) ? relay.capacity()
+	                : static_cast<int>(std::min<size_t>(opts.chunkSize,
+	                                                    1 << 30));
+
+	for (;;)
+	{
+		int want = chunk;
+
+		if (opts.maxBytes > 0)
+		{
+			if (stats.bytes >= opts.maxBytes)
+				break;
+			want = static_cast<int>(
+			    std::min<uint64_t>(want, opts.maxBytes - stats.bytes));
+		}
+
+		++stats.spliceCalls;
+		int n = relay.spliceIn(inFd, want);
+
+		if (n == 0)
+			break;
+
+		if (n < 0)
+		{
+			if (errno == EAGAIN)
+				waiter.wait(inFd, POLLIN);
+			else if (errno != EINTR)
+				throw make_syserr("Splice relay could not read");
+			continue;
+		}
+
+		// tee() always copies from the front of the pipe, so each
+		// round duplicates what it can and then consumes exactly that
+		// much; the copy pipe is empty at the start of every round.
+		while (relay.level() > 0)
+		{
+			int m = relay.level();
+
+			if (teeing)
+			{
+				++stats.spliceCalls;
+				if ((m = relay.teeOut(copy, m)) <= 0)
+					throw make_syserr(m < 0 ? errno : EPIPE,
+					                  "Splice relay could not tee");
+			}
+
+			drain(relay, outFd, m, waiter, stats.spliceCalls);
+			stats.bytes += m;
+
+			if (teeing)
+			{
+				drain(copy, opts.teeFd, m, waiter, stats.spliceCalls);
+				stats.teeBytes += m;
+			}
+		}
+	}
+
+	stats.elapsed = clock::now() - start;
+	return stats;
+}
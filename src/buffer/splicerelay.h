@@ -0,0 +1,63 @@
+#ifndef SPLICERELAY_H
+#define SPLICERELAY_H 1
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+struct SpliceRelayOptions
+{
+	SpliceRelayOptions()
+	  : chunkSize(0)
+	  , pipeSize(0)
+	  , teeFd(-1)
+	  , maxBytes(0)
+	  , timeoutMs(-1)
+		{ }
+
+	// Most bytes pulled from the source per splice() call; 0 uses the
+	// pipe's capacity, which moves the most per call
+	size_t chunkSize;
+
+	// Capacity for the relay's pipes (see PipeBuffer::resize); 0 keeps
+	// the kernel default. Larger pipes mean proportionally fewer calls.
+	int pipeSize;
+
+	// When >= 0, every byte relayed is also written here via tee()
+	int teeFd;
+
+	// Stop after this many bytes; 0 relays until end of file
+	uint64_t maxBytes;
+
+	// How long to wait for a nonblocking descriptor to become ready
+	// before giving up with ETIMEDOUT; negative waits forever
+	int timeoutMs;
+};
+
+struct SpliceRelayStats
+{
+	uint64_t bytes;
+	uint64_t teeBytes;
+	uint64_t spliceCalls;
+	uint64_t waits;
+	std::chrono::steady_clock::duration elapsed;
+
+	double bytesPerSecond() const noexcept
+	{
+		double s = std::chrono::duration<double>(elapsed).count();
+		return (s > 0) ? (bytes / s) : 0;
+	}
+};
+
+// Moves a stream from inFd to outFd through a PipeBuffer with splice(),
+// so the data never passes through user space. Either side may be a
+// nonblocking descriptor; on EAGAIN the relay sleeps in poll() until it
+// is ready again. Both descriptors must be something splice() accepts,
+// such as a pipe, socket or regular file.
+//
+// Throws std::system_error on failure.
+SpliceRelayStats spliceRelay(int inFd, int outFd,
+                             const SpliceRelayOptions & opts
+                               = SpliceRelayOptions());
+
+#endif // SPLICERELAY_H
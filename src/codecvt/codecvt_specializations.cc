@@ -1,5 +1,6 @@
 #include "codecvt_specializations.h"
 #include "utf_conversion_helpers.h"
+#include "utf_length_helpers.h"
 
 #include <cassert>
 
@@ -161,6 +162,10 @@ codecvt<char16_t, char, mbstate_t>::do_length(
 	size_t count = 0;
 	const char * i = from_begin;
 
+	// characters of up to three bytes are one unit each
+	if (state.__count == 0)
+		count += utf_length::skip_utf8(i, from_end, max, 3);
+
 	while (  (i < from_end)
 	      && (count < max)
 	      && utf8::update_mbstate(state, *i))
@@ -343,6 +348,9 @@ codecvt<char32_t, char, mbstate_t>::do_length(
 	size_t count = 0;
 	const char * i = from_begin;
 
+	if (state.__count == 0)
+		count += utf_length::skip_utf8(i, from_end, max, 3);
+
 	while (  (i < from_end)
 	      && (count < max)
 	      && utf8::update_mbstate(state, *i))
@@ -7,6 +7,8 @@
 #include "codecvt_specializations.h"
 #include "codecvt_mode.h"
 #include "utf_conversion_helpers.h"
+#include "utf_simd_helpers.h"
+#include "utf_length_helpers.h"
 
 namespace std {
 
@@ -72,6 +74,87 @@ class codecvt_utf16 : public codecvt<Elem, char, mbstate_t>
 	       char * to_begin,
 	       char * to_end,
 	       char * & to_last) const override
+	{
+		return convert_out(state, from_begin, from_end, from_last,
+		                   to_begin, to_end, to_last, true);
+	}
+
+	virtual codecvt_base::result
+	do_unshift(mbstate_t & state,
+	           char * to_begin,
+	           char * to_end,
+	           char * & to_last) const override
+	{
+		assert(to_begin <= to_end);
+
+		to_last = to_begin;
+
+//		printf("--> ");
+		for (; (to_last < to_end) && (state.__count != 0);
+		     --state.__count, ++to_last)
+		{
+//			printf("%02hhx ", state.__value.__wchb[state.__count - 1]);
+			*to_last = state.__value.__wchb[state.__count - 1];
+		}
+
+		return ( (state.__count == 0) ?
+		         codecvt_base::ok :
+		         codecvt_base::partial );
+	}
+
+	virtual codecvt_base::result
+	do_in(mbstate_t & state,
+	      const char * from_begin,
+	      const char * from_end,
+	      const char * & from_last,
+	      intern_type * to_begin,
+	      intern_type * to_end,
+	      intern_type * & to_last) const override
+	{
+		return convert_in(state, from_begin, from_end, from_last,
+		                  to_begin, to_end, to_last, true);
+	}
+
+	virtual int
+	do_length(mbstate_t & state,
+	          const char * from_begin,
+	          const char * from_end,
+	          size_t max) const override
+	{
+		return measure_length(state, from_begin, from_end, max, true);
+	}
+
+	virtual int
+	do_encoding() const noexcept override
+	{ return 0; }
+
+	virtual bool
+	do_always_noconv() const noexcept override
+	{ return false; }
+
+	virtual int
+	do_max_length() const noexcept override
+	{
+		int val = 4;
+		if (this->consume_bom())
+			val += 2;
+		return val;
+	}
+
+	//
+	// do_out(), do_in() and do_length(), handing ranges of a block or
+	// more to utf_simd_helpers.h and utf_length_helpers.h if use_kernels.
+	// The results are the same either way, which the unit tests check.
+	//
+	codecvt_base::result
+	convert_out(mbstate_t & state,
+	            const intern_type * from_begin,
+	            const intern_type * from_end,
+	            const intern_type * & from_last,
+	            char * to_begin,
+	            char * to_end,
+	            char * & to_last,
+	            bool use_kernels) const
 	{
 		namespace utf16 = utf16_conversion;
 		result res = codecvt_base::ok;
@@ -93,6 +176,27 @@ class codecvt_utf16 : public codecvt<Elem, char, mbstate_t>
 		      && (from_last < from_end)
 		      && (to_last < to_end) )
 		{
+			if (  use_kernels
+			   && (state.__count == 0)
+			   && ((from_end - from_last) >= utf_simd::block_size))
+			{
+				const intern_type * before = from_last;
+				utf_simd::utf16_encode(from_last, from_end, to_last, to_end,
+				                       this->little_endian_out(),
+				                       this->max_encodable());
+
+				// leave the state as converting them one by one would
+				if (from_last != before)
+				{
+					utf16::set_mbstate(state, from_last[-1],
+					                   this->little_endian_out());
+					state.__count = 0;
+				}
+
+				if ((from_last == from_end) || (to_last == to_end))
+					break;
+			}
+
 			if (  (static_cast<uint32_t>(*from_last) > this->max_encodable())
 			   || (utf16::is_surrogate(*from_last)) )
 			{
@@ -117,37 +221,15 @@ class codecvt_utf16 : public codecvt<Elem, char, mbstate_t>
 		return res;
 	}
 
-	virtual codecvt_base::result
-	do_unshift(mbstate_t & state,
-	           char * to_begin,
-	           char * to_end,
-	           char * & to_last) const override
-	{
-		assert(to_begin <= to_end);
-
-		to_last = to_begin;
-
-//		printf("--> ");
-		for (; (to_last < to_end) && (state.__count != 0);
-		     --state.__count, ++to_last)
-		{
-//			printf("%02hhx ", state.__value.__wchb[state.__count - 1]);
-			*to_last = state.__value.__wchb[state.__count - 1];
-		}
-
-		return ( (state.__count == 0) ?
-		         codecvt_base::ok :
-		         codecvt_base::partial );
-	}
-
-	virtual codecvt_base::result
-	do_in(mbstate_t & state,
-	      const char * from_begin,
-	      const char * from_end,
-	      const char * & from_last,
-	      intern_type * to_begin,
-	      intern_type * to_end,
-	      intern_type * & to_last) const override
+	codecvt_base::result
+	convert_in(mbstate_t & state,
+	           const char * from_begin,
+	           const char * from_end,
+	           const char * & from_last,
+	           intern_type * to_begin,
+	           intern_type * to_end,
+	           intern_type * & to_last,
+	           bool use_kernels) const
 	{
 		namespace utf16 = utf16_conversion;
 
@@ -180,11 +262,26 @@ class codecvt_utf16 : public codecvt<Elem, char, mbstate_t>
 		      && (from_last < from_end)
 		      && (to_last < to_end) )
 		{
-			if (state.__count == 0 && state.__value.__wch != 0)
+			if (state.__count < 0)
 			{
 				*to_last = state.__value.__wch;
 				++to_last;
+				state.__count = 0;
 				state.__value.__wch = 0;
+
+				// there may be no room for another
+				continue;
+			}
+
+			if (  use_kernels
+			   && (state.__count == 0)
+			   && ((from_end - from_last) >= 2 * utf_simd::block_size))
+			{
+				utf_simd::utf16_decode(from_last, from_end,
+				                       to_last, to_end, le);
+
+				if ((from_last == from_end) || (to_last == to_end))
+					break;
 			}
 
 			if (utf16::update_mbstate(state, *from_last, le))
@@ -194,23 +291,24 @@ class codecvt_utf16 : public codecvt<Elem, char, mbstate_t>
 		}
 
 		if (  res == codecvt_base::ok
-		   && state.__count == 0
-		   && state.__value.__wch != 0
+		   && state.__count < 0
 		   && to_last < to_end)
 		{
 			*to_last = state.__value.__wch;
 			++to_last;
+			state.__count = 0;
 			state.__value.__wch = 0;
 		}
 
 		return res;
 	}
 
-	virtual int
-	do_length(mbstate_t & state,
-	          const char * from_begin,
-	          const char * from_end,
-	          size_t max) const override
+	int
+	measure_length(mbstate_t & state,
+	               const char * from_begin,
+	               const char * from_end,
+	               size_t max,
+	               bool use_kernels) const
 	{
 		namespace utf16 = utf16_conversion;
 		assert(from_begin <= from_end);
@@ -236,14 +334,19 @@ class codecvt_utf16 : public codecvt<Elem, char, mbstate_t>
 			}
 		}
 
+		if (use_kernels && (state.__count == 0))
+			converted += utf_length::skip_utf16(from_last, from_end, max, le);
+
 		while (  (res == codecvt_base::ok)
 		      && (from_last < from_end)
 		      && (converted < max) )
 		{
-			if (state.__count == 0 && state.__value.__wch != 0)
+			if (state.__count < 0)
 			{
 				++converted;
+				state.__count = 0;
 				state.__value.__wch = 0;
+				continue;
 			}
 
 			if (utf16::update_mbstate(state, *from_last, le))
@@ -253,34 +356,16 @@ class codecvt_utf16 : public codecvt<Elem, char, mbstate_t>
 		}
 
 		if (  res == codecvt_base::ok
-		   && state.__count == 0
-		   && state.__value.__wch != 0
+		   && state.__count < 0
 		   && converted < max)
 		{
 			++converted;
+			state.__count = 0;
 			state.__value.__wch = 0;
 		}
 
 		return (from_last - from_begin);
 	}
-
-
-	virtual int
-	do_encoding() const noexcept override
-	{ return 0; }
-
-	virtual bool
-	do_always_noconv() const noexcept override
-	{ return false; }
-
-	virtual int
-	do_max_length() const noexcept override
-	{
-		int val = 4;
-		if (this->consume_bom())
-			val += 2;
-		return val;
-	}
 };
 
 //
@@ -8,6 +8,8 @@
 #include "codecvt_specializations.h"
 #include "codecvt_mode.h"
 #include "utf_conversion_helpers.h"
+#include "utf_length_helpers.h"
+#include "utf8_dfa.h"
 
 
 namespace std {
@@ -156,13 +158,58 @@ class codecvt_utf8
 	}
 
 	virtual codecvt_base::result
-	do_in(mbstate_t &state,
+	do_in(mbstate_t & state,
 	      const char * from_begin,
-	      const char *from_end,
+	      const char * from_end,
 	      const char * & from_last,
 	      intern_type * to_begin,
 	      intern_type * to_end,
 	      intern_type * & to_last) const override
+	{
+		return convert_in(state, from_begin, from_end, from_last,
+		                  to_begin, to_end, to_last, true);
+	}
+
+	virtual int
+	do_length(mbstate_t & state,
+	          const char * from_begin,
+	          const char * from_end,
+	          size_t max) const override
+	{
+		return measure_length(state, from_begin, from_end, max, true);
+	}
+
+	virtual int
+	do_encoding() const noexcept override
+	{ return 0; }
+
+	virtual bool
+	do_always_noconv() const noexcept override
+	{ return false; }
+
+	virtual int
+	do_max_length() const noexcept override
+	{
+		return ( (this->consume_bom() ?
+		          utf8_conversion::bytes_needed(bom_value()) : 0)
+		       + utf8_conversion::bytes_needed(this->max_encodable()));
+	}
+
+	//
+	// do_in(), decoding with the tables of utf8_dfa.h if use_dfa, and
+	// do_length(), passing over chunks of short characters with
+	// utf_length_helpers.h if use_kernels. The results are the same either
+	// way, which the unit tests check.
+	//
+	codecvt_base::result
+	convert_in(mbstate_t & state,
+	           const char * from_begin,
+	           const char * from_end,
+	           const char * & from_last,
+	           intern_type * to_begin,
+	           intern_type * to_end,
+	           intern_type * & to_last,
+	           bool use_dfa) const
 	{
 		namespace utf8 = utf8_conversion;
 
@@ -184,6 +231,12 @@ class codecvt_utf8
 			}
 		}
 
+		if (use_dfa)
+		{
+			utf8_dfa::decode(state, from_last, from_end, to_last, to_end,
+			                 this->max_encodable());
+		}
+
 		while ( (from_last < from_end) && (to_last < to_end) )
 		{
 			if ( ! utf8::update_mbstate(state, *from_last))
@@ -207,11 +260,12 @@ class codecvt_utf8
 		        codecvt_base::partial : codecvt_base::ok );
 	}
 
-	virtual int
-	do_length(mbstate_t & state,
-	          const char * from_begin,
-	          const char * from_end,
-	          size_t max) const override
+	int
+	measure_length(mbstate_t & state,
+	               const char * from_begin,
+	               const char * from_end,
+	               size_t max,
+	               bool use_kernels) const
 	{
 		namespace utf8 = utf8_conversion;
 
@@ -230,6 +284,12 @@ class codecvt_utf8
 			}
 		}
 
+		if (use_kernels && (state.__count == 0) && (skip_length() > 0))
+		{
+			count += utf_length::skip_utf8(from_last, from_end, max,
+			                               skip_length());
+		}
+
 		while (  (from_last < from_end)
 		      && (count < max)
 		      && utf8::update_mbstate(state, *from_last))
@@ -239,26 +299,20 @@ class codecvt_utf8
 			{
 				if (state.__value.__wch > Maxcode)
 					break;
+				++count;
 			}
 		}
 
 		return (from_last - from_begin);
 	}
 
-	virtual int
-	do_encoding() const noexcept override
-	{ return 0; }
-
-	virtual bool
-	do_always_noconv() const noexcept override
-	{ return false; }
-
-	virtual int
-	do_max_length() const noexcept override
+	/// The longest sequences measure_length() can pass over without
+	/// decoding them, as none of them can be greater than Maxcode
+	static constexpr int skip_length()
 	{
-		return ( (this->consume_bom() ?
-		          utf8_conversion::bytes_needed(bom_value()) : 0)
-		       + utf8_conversion::bytes_needed(this->max_encodable()));
+		return ( (Maxcode >= 0xffffu) ? 3 :
+		       ( (Maxcode >= 0x7ffu) ? 2 :
+		       ( (Maxcode >= 0x7fu) ? 1 : 0 ) ) );
 	}
 };
 
@@ -7,6 +7,8 @@
 #include "codecvt_specializations.h"
 #include "codecvt_mode.h"
 #include "utf_conversion_helpers.h"
+#include "utf_simd_helpers.h"
+#include "utf_length_helpers.h"
 
 namespace std {
 
@@ -68,6 +70,89 @@ class codecvt_utf8_utf16 : public codecvt<Elem, char, mbstate_t>
 	       char * to_begin,
 	       char * to_end,
 	       char * & to_last) const override
+	{
+		return convert_out(state, from_begin, from_end, from_last,
+		                   to_begin, to_end, to_last, true);
+	}
+
+	virtual codecvt_base::result
+	do_unshift(mbstate_t & state,
+	           char * to_begin,
+	           char * to_end,
+	           char * & to_last) const override
+	{
+		namespace utf8 = utf8_conversion;
+
+		assert((state.__count) >= 0 && (state.__count < this->do_max_length()));
+
+		to_last = to_begin;
+
+		while ((to_last < to_end) && (state.__count > 0))
+		{
+			*to_last = utf8::next_byte(state);
+			++to_last;
+			--state.__count;
+		}
+
+		return ( (state.__count == 0) ?
+		         codecvt_base::ok :
+		         codecvt_base::partial );
+	}
+
+	virtual codecvt_base::result
+	do_in(mbstate_t & state,
+	      const char * from_begin,
+	      const char * from_end,
+	      const char * & from_last,
+	      intern_type * to_begin,
+	      intern_type * to_end,
+	      intern_type * & to_last) const override
+	{
+		return convert_in(state, from_begin, from_end, from_last,
+		                  to_begin, to_end, to_last, true);
+	}
+
+	virtual int
+	do_length(mbstate_t & state,
+	          const char * from_begin,
+	          const char * from_end,
+	          size_t max) const override
+	{
+		return measure_length(state, from_begin, from_end, max, true);
+	}
+
+	virtual int
+	do_encoding() const noexcept override
+	{ return 0; }
+
+	virtual bool
+	do_always_noconv() const noexcept override
+	{ return false; }
+
+	virtual int
+	do_max_length() const noexcept override
+	{
+		int val = 4;
+		if (this->consume_bom())
+			val += 3;
+		return val;
+	}
+
+	//
+	// do_out(), do_in() and do_length(), using the block conversions in
+	// utf_simd_helpers.h and utf_length_helpers.h where they can if
+	// use_kernels. The results are the same either way, which the unit
+	// tests check.
+	//
+	codecvt_base::result
+	convert_out(mbstate_t & state,
+	            const intern_type * from_begin,
+	            const intern_type * from_end,
+	            const intern_type * & from_last,
+	            char * to_begin,
+	            char * to_end,
+	            char * & to_last,
+	            bool use_kernels) const
 	{
 		namespace utf8 = utf8_conversion;
 		namespace utf16 = utf16_conversion;
@@ -80,22 +165,49 @@ class codecvt_utf8_utf16 : public codecvt<Elem, char, mbstate_t>
 		from_last = from_begin;
 		to_last = to_begin;
 
-		if (this->generate_bom() && (from_last < from_end))
+		// the rest of a character that didn't fit last time goes first
+		if (state.__count > 0)
+			res = this->do_unshift(state, to_last, to_end, to_last);
+
+		if (  this->generate_bom()
+		   && (res == codecvt_base::ok)
+		   && (from_last < from_end))
 		{
 			if (bom_value() > this->max_encodable())
 				return codecvt_base::error;
 
+			// all of it or none of it
+			if ((to_end - to_last) < 3)
+				return codecvt_base::partial;
+
 			state.__value.__wch = bom_value();
 			char val = utf8::extract_leader_byte(state);
 
 			*to_last = val;
 			++to_last;
+			res = this->do_unshift(state, to_last, to_end, to_last);
 		}
 
 		while (  (to_last < to_end)
 		      && (from_last < from_end)
 		      && (res == codecvt_base::ok))
 		{
+			if (use_kernels && (state.__count == 0))
+			{
+				const intern_type * before = from_last;
+				utf_simd::utf16_to_utf8(from_last, from_end, to_last, to_end);
+
+				// leave the state as converting them one by one would
+				if (from_last != before)
+				{
+					const char32_t c = from_last[-1];
+					state.__value.__wch = (c < 0x80u) ? 0 : c;
+				}
+
+				if ((from_last == from_end) || (to_last == to_end))
+					break;
+			}
+
 			if (utf16::update_mbstate(state, *from_last))
 				++from_last;
 			else
@@ -121,38 +233,15 @@ class codecvt_utf8_utf16 : public codecvt<Elem, char, mbstate_t>
 		return res;
 	}
 
-	virtual codecvt_base::result
-	do_unshift(mbstate_t & state,
-	           char * to_begin,
-	           char * to_end,
-	           char * & to_last) const override
-	{
-		namespace utf8 = utf8_conversion;
-
-		assert((state.__count) >= 0 && (state.__count < this->do_max_length()));
-
-		to_last = to_begin;
-
-		while ((to_last < to_end) && (state.__count > 0))
-		{
-			*to_last = utf8::next_byte(state);
-			++to_last;
-			--state.__count;
-		}
-
-		return ( (state.__count == 0) ?
-		         codecvt_base::ok :
-		         codecvt_base::partial );
-	}
-
-	virtual codecvt_base::result
-	do_in(mbstate_t & state,
-	      const char * from_begin,
-	      const char * from_end,
-	      const char * & from_last,
-	      intern_type * to_begin,
-	      intern_type * to_end,
-	      intern_type * & to_last) const override
+	codecvt_base::result
+	convert_in(mbstate_t & state,
+	           const char * from_begin,
+	           const char * from_end,
+	           const char * & from_last,
+	           intern_type * to_begin,
+	           intern_type * to_end,
+	           intern_type * & to_last,
+	           bool use_kernels) const
 	{
 		namespace utf8 = utf8_conversion;
 		namespace utf16 = utf16_conversion;
@@ -185,6 +274,21 @@ class codecvt_utf8_utf16 : public codecvt<Elem, char, mbstate_t>
 				*to_last = state.__value.__wch;
 				++to_last;
 				state.__count = 0;
+
+				// there may be no room for another
+				continue;
+			}
+
+			if (use_kernels && (state.__count == 0))
+			{
+				const intern_type * before = to_last;
+				utf_simd::utf8_to_utf16(from_last, from_end, to_last, to_end);
+
+				if (to_last != before)
+					state.__value.__wch = to_last[-1];
+
+				if ((from_last == from_end) || (to_last == to_end))
+					break;
 			}
 
 			if (utf8::update_mbstate(state, *from_last))
@@ -214,11 +318,12 @@ class codecvt_utf8_utf16 : public codecvt<Elem, char, mbstate_t>
 		return res;
 	}
 
-	virtual int
-	do_length(mbstate_t & state,
-	          const char * from_begin,
-	          const char * from_end,
-	          size_t max) const override
+	int
+	measure_length(mbstate_t & state,
+	               const char * from_begin,
+	               const char * from_end,
+	               size_t max,
+	               bool use_kernels) const
 	{
 		namespace utf8 = utf8_conversion;
 		namespace utf16 = utf16_conversion;
@@ -238,6 +343,10 @@ class codecvt_utf8_utf16 : public codecvt<Elem, char, mbstate_t>
 			}
 		}
 
+		// characters of up to three bytes are one unit each
+		if (use_kernels && (state.__count == 0))
+			count += utf_length::skip_utf8(from_last, from_end, max, 3);
+
 		while (  (from_last < from_end)
 		      && (count < max)
 		      && utf8::update_mbstate(state, *from_last))
@@ -261,23 +370,6 @@ class codecvt_utf8_utf16 : public codecvt<Elem, char, mbstate_t>
 
 		return (from_last - from_begin);
 	}
-
-	virtual int
-	do_encoding() const noexcept override
-	{ return 0; }
-
-	virtual bool
-	do_always_noconv() const noexcept override
-	{ return false; }
-
-	virtual int
-	do_max_length() const noexcept override
-	{
-		int val = 4;
-		if (this->consume_bom())
-			val += 3;
-		return val;
-	}
 };
 
 extern template class codecvt_utf8_utf16<wchar_t, max_unicode_codepoint()>;
@@ -0,0 +1,223 @@
+#ifndef GUARD_UTF8_DFA_H
+#define GUARD_UTF8_DFA_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+
+#include "utility/index_sequence.h"
+
+//
+// Table driven UTF-8 decoding, after Bjoern Hoehrmann's decoder, for
+// codecvt_utf8 to use where there's no block conversion to be had.
+//
+// The machine is automata/samples/utf8-input-basic.dot: a state for each
+// number of continuation bytes still to come, up to the five of the six
+// byte sequences of the original UTF-8, and one more for input it has no
+// edge for. Bytes are first mapped to a class, then the class to a row
+// of the transition table, which holds the next state for every state,
+// six bits each, so the state is a shift of the row: the one step in the
+// loop that each byte has to wait for. Both tables are generated at
+// compile time from the functions describing the machine.
+//
+// A state is the __count of the facets' mbstate_t, and the code point is
+// accumulated in __wch as utf8_conversion::update_mbstate() does it, so
+// decoding can start from, and stop in, the middle of a character.
+// Anything the machine rejects is left to update_mbstate(), which decides
+// what it means.
+//
+namespace utf8_dfa {
+
+/// Byte classes, numbered so 0xff >> class masks the data bits of the
+/// byte
+enum byte_class_type : uint8_t
+{
+	invalid      = 0,
+	ascii        = 1,
+	continuation = 2,
+	two_bytes    = 3,
+	three_bytes  = 4,
+	four_bytes   = 5,
+	five_bytes   = 6,
+	six_bytes    = 7
+};
+
+constexpr std::size_t class_count = 8;
+
+/// next_char in the .dot file, and one_byte to five_bytes after it
+constexpr uint8_t accept = 0;
+constexpr uint8_t reject = 6;
+constexpr std::size_t state_count = 7;
+
+/// Bits for each state in a row of the transition table; states are
+/// kept as their offset in the row
+constexpr unsigned state_bits = 6;
+constexpr uint64_t state_mask = (1u << state_bits) - 1;
+
+constexpr uint8_t byte_class(std::size_t b)
+{
+	return ( (b < 0x80u) ? ascii :
+	       ( (b < 0xc0u) ? continuation :
+	       ( (b < 0xe0u) ? two_bytes :
+	       ( (b < 0xf0u) ? three_bytes :
+	       ( (b < 0xf8u) ? four_bytes :
+	       ( (b < 0xfcu) ? five_bytes :
+	       ( (b < 0xfeu) ? six_bytes :
+	          invalid ) ) ) ) ) ) );
+}
+
+/// The edges of the machine: continuation bytes count down to accept,
+/// and anything else has to come at accept
+constexpr uint8_t transition(std::size_t state, std::size_t cls)
+{
+	return ( (state == reject) ? reject :
+	       ( (cls == continuation) ?
+	           ((state == accept) ? reject : state - 1) :
+	       ( (state != accept) ? reject :
+	       ( (cls == ascii) ? accept :
+	       ( (cls == invalid) ? reject :
+	          cls - 2 ) ) ) ) );
+}
+
+/// The next states for cls from state and those after it, each at its
+/// offset
+constexpr uint64_t transition_row(std::size_t cls, std::size_t state = 0)
+{
+	return ( (state == state_count) ? 0 :
+	         ( (static_cast<uint64_t>(transition(state, cls)) * state_bits)
+	           << (state * state_bits))
+	         | transition_row(cls, state + 1) );
+}
+
+/// values[i] is Gen::at(i) for each i of the index_sequence
+template <class Gen, class Seq>
+struct generated_table;
+
+template <class Gen, std::size_t ... IDX>
+struct generated_table<Gen, index_sequence<IDX ...>>
+{
+	typedef typename Gen::value_type value_type;
+
+	static constexpr value_type values[sizeof...(IDX)] = { Gen::at(IDX)... };
+};
+
+template <class Gen, std::size_t ... IDX>
+constexpr typename Gen::value_type
+generated_table<Gen, index_sequence<IDX ...>>::values[sizeof...(IDX)];
+
+struct class_generator
+{
+	typedef uint8_t value_type;
+
+	static constexpr value_type at(std::size_t b)
+	{ return byte_class(b); }
+};
+
+struct transition_generator
+{
+	typedef uint64_t value_type;
+
+	static constexpr value_type at(std::size_t cls)
+	{ return transition_row(cls); }
+};
+
+typedef generated_table<class_generator,
+                        index_sequence_generator<256>::type>
+        class_table;
+
+typedef generated_table<transition_generator,
+                        index_sequence_generator<class_count>::type>
+        transition_table;
+
+/// The state after one of class cls in state
+constexpr uint8_t next_state(std::size_t state, std::size_t cls)
+{
+	return ( ( (transition_table::values[cls] >> (state * state_bits))
+	           & state_mask) / state_bits );
+}
+
+/// One byte through the machine, unless it rejects it or the code point
+/// it completes is greater than max. What's decoded so far is dropped at
+/// the start of a character, and the value written out each time, to be
+/// kept when it's whole, so nothing depends on the byte but the way out.
+template <typename Elem>
+inline bool step(uint64_t & s, uint32_t & wch,
+                 const char * & p, Elem * & q,
+                 uint32_t max) noexcept
+{
+	const uint8_t b = static_cast<uint8_t>(*p);
+	const uint8_t cls = class_table::values[b];
+	const uint64_t next = (transition_table::values[cls] >> s) & state_mask;
+	const uint32_t keep = 0u - static_cast<uint32_t>(s != accept);
+	const uint32_t value = ((wch << 6) & keep) | (b & (0xffu >> cls));
+	const bool whole = (next == accept);
+
+	if ((next == reject * state_bits) | (whole & (value > max)))
+		return false;
+
+	*q = static_cast<Elem>(value);
+	q += whole;
+	s = next;
+	wch = value;
+	++p;
+	return true;
+}
+
+/// Decodes from the start of [from, from_end) into [to, to_end), starting
+/// in state, for as long as the machine accepts the input and the code
+/// points are no greater than max, advancing both pointers and leaving
+/// state as update_mbstate() would have. Units of the output past the
+/// new to may have been written.
+template <typename Elem>
+inline void decode(std::mbstate_t & state,
+                   const char * & from, const char * from_end,
+                   Elem * & to, Elem * to_end,
+                   uint32_t max) noexcept
+{
+	constexpr uint64_t high_bits = 0x8080808080808080ull;
+
+	if ((state.__count < 0) || (state.__count >= reject))
+		return;
+
+	uint64_t s = state.__count * state_bits;
+	uint32_t wch = state.__value.__wch;
+	const char * p = from;
+	Elem * q = to;
+	bool going = true;
+
+	// eight bytes at a time while there's room for them: words of ASCII
+	// between characters are widened as they are, and anything else goes
+	// through the machine
+	while (going && ((from_end - p) >= 8) && ((to_end - q) >= 8))
+	{
+		uint64_t word;
+		std::memcpy(&word, p, sizeof(word));
+
+		if ((s == accept) && ((word & high_bits) == 0))
+		{
+			for (int i = 0; i < 8; ++i)
+				q[i] = static_cast<uint8_t>(p[i]);
+
+			wch = static_cast<uint8_t>(p[7]);
+			p += 8;
+			q += 8;
+			continue;
+		}
+
+		for (const char * stop = p + 8; going && (p < stop); )
+			going = step(s, wch, p, q, max);
+	}
+
+	while (going && (p < from_end) && (q < to_end))
+		going = step(s, wch, p, q, max);
+
+	state.__count = s / state_bits;
+	state.__value.__wch = wch;
+	from = p;
+	to = q;
+}
+
+} // namespace utf8_dfa
+
+#endif // GUARD_UTF8_DFA_H
@@ -236,6 +236,13 @@ inline bool update_mbstate(std::mbstate_t & s, char16_t c)
 	return rc;
 }
 
+//
+// Bytes of UTF-16 in the given order. A complete character leaves
+// __count at -1 with the value in __wch until the caller collects it;
+// another byte before then starts over. A low surrogate where a
+// character should start, or anything else after a high one, is an
+// error.
+//
 inline bool update_mbstate(std::mbstate_t & s, char c, bool le)
 {
 	bool rc = true;
@@ -244,10 +251,11 @@ inline bool update_mbstate(std::mbstate_t & s, char c, bool le)
 	{
 		switch (s.__count)
 		{
+		 case -1:
 		 case 0:
 			s.__value.__wch = 0;
 			s.__value.__wchb[1] = c;
-			++s.__count;
+			s.__count = 1;
 			break;
 
 		 case 1:
@@ -258,12 +266,16 @@ inline bool update_mbstate(std::mbstate_t & s, char c, bool le)
 				std::wint_t tmp = static_cast<uint8_t>(s.__value.__wchb[1]);
 				tmp |= (static_cast<uint8_t>(s.__value.__wchb[0]) << 8);
 				s.__value.__wch = tmp;
-				s.__count = 0;
+				s.__count = -1;
 			}
-			else
+			else if (static_cast<uint8_t>(c) < 0xdcu)
 			{
 				++s.__count;
 			}
+			else
+			{
+				rc = false;
+			}
 			break;
 
 		 case 2:
@@ -284,7 +296,7 @@ inline bool update_mbstate(std::mbstate_t & s, char c, bool le)
 				tmp += 0x10000u;
 				s.__value.__wch = tmp;
 
-				s.__count = 0;
+				s.__count = -1;
 			}
 			else
 			{
@@ -297,10 +309,11 @@ inline bool update_mbstate(std::mbstate_t & s, char c, bool le)
 	{
 		switch (s.__count)
 		{
+		 case -1:
 		 case 0:
 			s.__value.__wch = 0;
 			s.__value.__wchb[0] = c;
-			++s.__count;
+			s.__count = 1;
 			break;
 
 		 case 1:
@@ -311,12 +324,16 @@ inline bool update_mbstate(std::mbstate_t & s, char c, bool le)
 				std::wint_t tmp = static_cast<uint8_t>(s.__value.__wchb[1]);
 				tmp |= (static_cast<uint8_t>(s.__value.__wchb[0]) << 8);
 				s.__value.__wch = tmp;
-				s.__count = 0;
+				s.__count = -1;
 			}
-			else
+			else if (static_cast<uint8_t>(s.__value.__wchb[0]) < 0xdcu)
 			{
 				++s.__count;
 			}
+			else
+			{
+				rc = false;
+			}
 			break;
 
 		 case 2:
@@ -333,8 +350,18 @@ inline bool update_mbstate(std::mbstate_t & s, char c, bool le)
 			break;
 
 		 case 3:
-			s.__value.__wchb[3] = c;
-			s.__count = 0;
+			{
+				s.__value.__wchb[3] = c;
+
+				std::wint_t tmp = static_cast<uint8_t>(s.__value.__wchb[3]);
+				tmp |= (static_cast<uint8_t>(s.__value.__wchb[2] & 0x03) << 8);
+				tmp |= (static_cast<uint8_t>(s.__value.__wchb[1] ) << 10);
+				tmp |= (static_cast<uint8_t>(s.__value.__wchb[0] & 0x03) << 18);
+				tmp += 0x10000u;
+				s.__value.__wch = tmp;
+
+				s.__count = -1;
+			}
 			break;
 		}
 	}
@@ -384,7 +411,7 @@ inline bool set_mbstate(std::mbstate_t & s, char32_t c, bool little_endian)
 	{
 		rc = false;
 	}
-	else if (c > surrogate_transform_value)
+	else if (c >= surrogate_transform_value)
 	{
 		tmp = low_surrogate_value(c);
 		if (little_endian)
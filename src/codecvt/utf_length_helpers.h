@@ -0,0 +1,373 @@
+#ifndef GUARD_UTF_LENGTH_HELPERS_H
+#define GUARD_UTF_LENGTH_HELPERS_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include "utf_simd_helpers.h"
+
+//
+// Exact lengths of conversions between UTF-8, UTF-16 and UTF-32, so the
+// output of one can be allocated once, at its final size, before doing it.
+//
+// The lengths are what converting well-formed input produces, in units of
+// the output: bytes of UTF-8, 16 bit units of UTF-16 and code points of
+// UTF-32. For anything else the number means little; the conversion
+// itself is what reports the error. UTF-8 is taken to be the original
+// definition, with sequences of up to six bytes, as the facets read it.
+//
+// UTF-8 and char16_t UTF-16 are counted with SSE2, or AVX2, a block at a
+// time. Wider units go one at a time, in loops the compiler vectorizes.
+//
+// skip_utf8() and skip_utf16() are for the facets' do_length(): they
+// check the structure of what they pass over, so it can be counted
+// without being decoded.
+//
+namespace utf_length {
+
+/// Bits for the 64 bytes at a position, byte i at bit i: continuation
+/// bytes, and those starting sequences of at least two, three and four
+/// bytes
+struct utf8_chunk
+{
+	uint64_t continuation;
+	uint64_t two;
+	uint64_t three;
+	uint64_t four;
+};
+
+constexpr std::ptrdiff_t chunk_size = 64;
+
+#if defined(__SSE2__)
+
+#if defined(__AVX2__)
+typedef __m256i bytes_type;
+#else
+typedef __m128i bytes_type;
+#endif
+
+constexpr std::ptrdiff_t bytes_per_register = sizeof(bytes_type);
+
+/// Bit i set if byte i of v, unsigned, is at least least
+inline uint64_t at_least(bytes_type v, uint8_t least) noexcept
+{
+#if defined(__AVX2__)
+	const __m256i floor = _mm256_set1_epi8(static_cast<char>(least));
+	return static_cast<uint32_t>(_mm256_movemask_epi8(
+	           _mm256_cmpeq_epi8(_mm256_max_epu8(v, floor), v)));
+#else
+	const __m128i floor = _mm_set1_epi8(static_cast<char>(least));
+	return static_cast<uint32_t>(_mm_movemask_epi8(
+	           _mm_cmpeq_epi8(_mm_max_epu8(v, floor), v)));
+#endif
+}
+
+/// Bit i set if byte i of v is a continuation byte
+inline uint64_t continuations(bytes_type v) noexcept
+{
+	// 0x80 to 0xbf are the signed bytes below -64
+#if defined(__AVX2__)
+	return static_cast<uint32_t>(_mm256_movemask_epi8(
+	           _mm256_cmpgt_epi8(_mm256_set1_epi8(-64), v)));
+#else
+	return static_cast<uint32_t>(_mm_movemask_epi8(
+	           _mm_cmpgt_epi8(_mm_set1_epi8(-64), v)));
+#endif
+}
+
+#endif // __SSE2__
+
+inline utf8_chunk classify(const char * p) noexcept
+{
+	utf8_chunk c = { 0, 0, 0, 0 };
+
+#if defined(__SSE2__)
+	for (std::ptrdiff_t i = 0; i < chunk_size; i += bytes_per_register)
+	{
+#if defined(__AVX2__)
+		const __m256i v = _mm256_loadu_si256(
+		                      reinterpret_cast<const __m256i *>(p + i));
+#else
+		const __m128i v = _mm_loadu_si128(
+		                      reinterpret_cast<const __m128i *>(p + i));
+#endif
+		c.continuation |= continuations(v) << i;
+		c.two |= at_least(v, 0xc0u) << i;
+		c.three |= at_least(v, 0xe0u) << i;
+		c.four |= at_least(v, 0xf0u) << i;
+	}
+#else
+	for (std::ptrdiff_t i = 0; i < chunk_size; ++i)
+	{
+		const uint64_t b = static_cast<uint8_t>(p[i]);
+		c.continuation |= static_cast<uint64_t>((b & 0xc0u) == 0x80u) << i;
+		c.two |= static_cast<uint64_t>(b >= 0xc0u) << i;
+		c.three |= static_cast<uint64_t>(b >= 0xe0u) << i;
+		c.four |= static_cast<uint64_t>(b >= 0xf0u) << i;
+	}
+#endif
+
+	return c;
+}
+
+inline std::size_t bits(uint64_t mask) noexcept
+{ return __builtin_popcountll(mask); }
+
+//
+// From UTF-8
+//
+
+/// Code points in the UTF-8 in [begin, end): the bytes that aren't
+/// continuation bytes
+inline std::size_t utf32_length_from_utf8(const char * begin,
+                                          const char * end) noexcept
+{
+	std::size_t n = 0;
+	const char * p = begin;
+
+	for (; (end - p) >= chunk_size; p += chunk_size)
+		n += chunk_size - bits(classify(p).continuation);
+
+	for (; p < end; ++p)
+		n += ((static_cast<uint8_t>(*p) & 0xc0u) != 0x80u);
+
+	return n;
+}
+
+/// UTF-16 units for the UTF-8 in [begin, end): a code point each, and
+/// another for each sequence of four bytes or more
+inline std::size_t utf16_length_from_utf8(const char * begin,
+                                          const char * end) noexcept
+{
+	std::size_t n = 0;
+	const char * p = begin;
+
+	for (; (end - p) >= chunk_size; p += chunk_size)
+	{
+		const utf8_chunk c = classify(p);
+		n += chunk_size - bits(c.continuation) + bits(c.four);
+	}
+
+	for (; p < end; ++p)
+	{
+		const uint8_t b = static_cast<uint8_t>(*p);
+		n += ((b & 0xc0u) != 0x80u) + (b >= 0xf0u);
+	}
+
+	return n;
+}
+
+//
+// From UTF-16
+//
+
+/// Bytes of UTF-8 for unit u, counting two for each half of a pair
+constexpr std::size_t utf8_bytes(uint32_t u)
+{
+	return (3 - (u < 0x80u) - (u < 0x800u) - ((u & 0xfffff800u) == 0xd800u));
+}
+
+/// Bytes of UTF-8 for the UTF-16 in [begin, end)
+template <typename Elem>
+inline std::size_t utf8_length_from_utf16(const Elem * begin,
+                                          const Elem * end) noexcept
+{
+	std::size_t n = 0;
+
+	for (; begin < end; ++begin)
+		n += utf8_bytes(static_cast<uint32_t>(*begin));
+
+	return n;
+}
+
+/// Code points in the UTF-16 in [begin, end): the units that aren't low
+/// surrogates
+template <typename Elem>
+inline std::size_t utf32_length_from_utf16(const Elem * begin,
+                                           const Elem * end) noexcept
+{
+	std::size_t n = 0;
+
+	for (; begin < end; ++begin)
+		n += ((static_cast<uint32_t>(*begin) & 0xfffffc00u) != 0xdc00u);
+
+	return n;
+}
+
+#if defined(__SSE2__)
+inline std::size_t utf8_length_from_utf16(const char16_t * begin,
+                                          const char16_t * end) noexcept
+{
+	using namespace utf_simd;
+
+	std::size_t n = 0;
+	const char16_t * p = begin;
+
+	// three bytes a unit, less one for each that's ASCII, below 0x800 or
+	// a surrogate; the masks have two bits a unit
+	for (; (end - p) >= block_size; p += block_size)
+	{
+		const units_type a = load_half(p);
+		const units_type b = load_half(p + half_block);
+
+		n += 3 * block_size
+		   - ( bits(block_bits(a, b, 0xff80u, 0))
+		     + bits(block_bits(a, b, 0xf800u, 0))
+		     + bits(block_bits(a, b, 0xf800u, 0xd800u))) / 2;
+	}
+
+	for (; p < end; ++p)
+		n += utf8_bytes(*p);
+
+	return n;
+}
+
+inline std::size_t utf32_length_from_utf16(const char16_t * begin,
+                                           const char16_t * end) noexcept
+{
+	using namespace utf_simd;
+
+	std::size_t n = 0;
+	const char16_t * p = begin;
+
+	for (; (end - p) >= block_size; p += block_size)
+	{
+		const units_type a = load_half(p);
+		const units_type b = load_half(p + half_block);
+		n += block_size - bits(block_bits(a, b, 0xfc00u, 0xdc00u)) / 2;
+	}
+
+	for (; p < end; ++p)
+		n += ((*p & 0xfc00u) != 0xdc00u);
+
+	return n;
+}
+#endif // __SSE2__
+
+//
+// From UTF-32
+//
+
+/// Bytes of UTF-8 for the code points in [begin, end)
+template <typename Elem>
+inline std::size_t utf8_length_from_utf32(const Elem * begin,
+                                          const Elem * end) noexcept
+{
+	std::size_t n = 0;
+
+	for (; begin < end; ++begin)
+	{
+		const uint32_t c = static_cast<uint32_t>(*begin);
+		n += 1 + (c >= 0x80u) + (c >= 0x800u) + (c >= 0x10000u)
+		       + (c >= 0x200000u) + (c >= 0x4000000u);
+	}
+
+	return n;
+}
+
+/// UTF-16 units for the code points in [begin, end)
+template <typename Elem>
+inline std::size_t utf16_length_from_utf32(const Elem * begin,
+                                           const Elem * end) noexcept
+{
+	std::size_t n = 0;
+
+	for (; begin < end; ++begin)
+		n += 1 + (static_cast<uint32_t>(*begin) >= 0x10000u);
+
+	return n;
+}
+
+//
+// For do_length()
+//
+
+/// Passes over whole characters of UTF-8 from the start of the input, a
+/// chunk of 64 bytes at a time, while each chunk is well formed and
+/// made of sequences no longer than longest bytes (one to three), and
+/// returns how many characters that was. It stops short of the end of
+/// the input and of max characters, so the caller's own loop always has
+/// the last of them.
+inline std::size_t skip_utf8(const char * & from, const char * from_end,
+                             std::size_t max, int longest) noexcept
+{
+	std::size_t count = 0;
+	uint64_t carry = 0;
+	const char * p = from;
+
+	while ((from_end - p) > chunk_size)
+	{
+		const utf8_chunk c = classify(p);
+		const uint64_t too_long = (longest < 2) ? c.two
+		                        : (longest < 3) ? c.three : c.four;
+		const uint64_t expected = (c.two << 1) | (c.three << 2) | carry;
+		const std::size_t chars = chunk_size - bits(c.continuation);
+
+		if (  (too_long != 0)
+		   || (expected != c.continuation)
+		   || ((count + chars) >= max))
+			break;
+
+		count += chars;
+		carry = (c.two >> 63) | (c.three >> 62);
+		p += chunk_size;
+	}
+
+	// the last character goes back to the caller, whether or not the
+	// chunk holds all of it, so its state ends up as if it had done it all
+	if (count > 0)
+	{
+		do --p;
+		while ((static_cast<uint8_t>(*p) & 0xc0u) == 0x80u);
+		--count;
+	}
+
+	from = p;
+	return count;
+}
+
+/// The same for UTF-16 in the given byte order, a block at a time, while
+/// each block is free of surrogates or made of whole pairs
+inline std::size_t skip_utf16(const char * & from, const char * from_end,
+                              std::size_t max, bool little_endian) noexcept
+{
+	std::size_t count = 0;
+
+#if defined(__SSSE3__)
+	using namespace utf_simd;
+
+	while ((from_end - from) > 2 * block_size)
+	{
+		units_type a = load_half(from);
+		units_type b = load_half(from + block_size);
+
+		if (! little_endian)
+		{
+			a = swap_bytes(a);
+			b = swap_bytes(b);
+		}
+
+		const uint64_t surrogates = block_bits(a, b, 0xf800u, 0xd800u);
+		const uint64_t high = block_bits(a, b, 0xfc00u, 0xd800u);
+		const std::size_t chars = block_size - bits(high) / 2;
+
+		if (  ((surrogates & ~high) != (high << 2))
+		   || ((high >> (2 * block_size - 2)) != 0)
+		   || ((count + chars) >= max))
+			break;
+
+		count += chars;
+		from += 2 * block_size;
+	}
+#else
+	(void) from;
+	(void) from_end;
+	(void) max;
+	(void) little_endian;
+#endif
+
+	return count;
+}
+
+} // namespace utf_length
+
+#endif // GUARD_UTF_LENGTH_HELPERS_H
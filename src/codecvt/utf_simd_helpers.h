@@ -0,0 +1,700 @@
+#ifndef GUARD_UTF_SIMD_HELPERS_H
+#define GUARD_UTF_SIMD_HELPERS_H 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+//
+// Block conversions between UTF-8 and UTF-16 for the common case, for the
+// facets to use before falling back to their per-unit state machines.
+//
+// Each function converts from the start of its input for as long as the
+// input is made of characters it handles and whole characters fit in the
+// output, advancing both pointers past what it converted. What stops it
+// is left for the caller: the result is the same as if the caller had
+// converted those characters itself, one unit at a time.
+//
+// Runs of ASCII go through SSE2, or AVX2, a block at a time; other BMP
+// characters are converted without any state. Surrogates, four byte
+// sequences and anything malformed stop the run.
+//
+// For codecvt_utf16 there are the same between UTF-16 bytes, in either
+// order, and code points: blocks without surrogates are byte swapped with
+// SSSE3 or AVX2 shuffles, and blocks with them are checked for pairing
+// before they're decoded.
+//
+namespace utf_simd {
+
+#if defined(__AVX2__)
+constexpr std::ptrdiff_t block_size = 32;
+#else
+constexpr std::ptrdiff_t block_size = 16;
+#endif
+
+#if defined(__SSE2__)
+
+/// True if the block_size units at p are all ASCII
+inline bool ascii_block(const char16_t * p) noexcept
+{
+#if defined(__AVX2__)
+	const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+	const __m256i b = _mm256_loadu_si256(
+	                      reinterpret_cast<const __m256i *>(p + 16));
+	const __m256i high = _mm256_set1_epi16(static_cast<short>(0xff80));
+	return _mm256_testz_si256(_mm256_or_si256(a, b), high);
+#else
+	const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 8));
+	const __m128i high = _mm_set1_epi16(static_cast<short>(0xff80));
+	const __m128i bits = _mm_and_si128(_mm_or_si128(a, b), high);
+	return (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, _mm_setzero_si128()))
+	        == 0xffff);
+#endif
+}
+
+/// Narrows block_size ASCII units at from to bytes at to
+inline void narrow_block(const char16_t * from, char * to) noexcept
+{
+#if defined(__AVX2__)
+	const __m256i a = _mm256_loadu_si256(
+	                      reinterpret_cast<const __m256i *>(from));
+	const __m256i b = _mm256_loadu_si256(
+	                      reinterpret_cast<const __m256i *>(from + 16));
+	// packus works within lanes, so the quarters come out as a0 b0 a1 b1
+	const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b),
+	                                                0xd8);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(to), packed);
+#else
+	const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from));
+	const __m128i b = _mm_loadu_si128(
+	                      reinterpret_cast<const __m128i *>(from + 8));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(to), _mm_packus_epi16(a, b));
+#endif
+}
+
+/// True if the block_size bytes at p are all ASCII
+inline bool ascii_block(const char * p) noexcept
+{
+#if defined(__AVX2__)
+	return (_mm256_movemask_epi8(_mm256_loadu_si256(
+	            reinterpret_cast<const __m256i *>(p))) == 0);
+#else
+	return (_mm_movemask_epi8(_mm_loadu_si128(
+	            reinterpret_cast<const __m128i *>(p))) == 0);
+#endif
+}
+
+/// Widens block_size ASCII bytes at from to units at to
+inline void widen_block(const char * from, char16_t * to) noexcept
+{
+#if defined(__AVX2__)
+	const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from));
+	const __m128i hi = _mm_loadu_si128(
+	                       reinterpret_cast<const __m128i *>(from + 16));
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(to),
+	                    _mm256_cvtepu8_epi16(lo));
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(to + 16),
+	                    _mm256_cvtepu8_epi16(hi));
+#else
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from));
+	const __m128i zero = _mm_setzero_si128();
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(to),
+	                 _mm_unpacklo_epi8(v, zero));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(to + 8),
+	                 _mm_unpackhi_epi8(v, zero));
+#endif
+}
+
+/// True if none of the block_size units at p is a surrogate
+inline bool bmp_block(const char16_t * p) noexcept
+{
+#if defined(__AVX2__)
+	const __m256i mask = _mm256_set1_epi16(static_cast<short>(0xf800));
+	const __m256i surrogate = _mm256_set1_epi16(static_cast<short>(0xd800));
+	const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+	const __m256i b = _mm256_loadu_si256(
+	                      reinterpret_cast<const __m256i *>(p + 16));
+	const __m256i hits = _mm256_or_si256(
+	    _mm256_cmpeq_epi16(_mm256_and_si256(a, mask), surrogate),
+	    _mm256_cmpeq_epi16(_mm256_and_si256(b, mask), surrogate));
+	return _mm256_testz_si256(hits, hits);
+#else
+	const __m128i mask = _mm_set1_epi16(static_cast<short>(0xf800));
+	const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xd800));
+	const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 8));
+	const __m128i hits = _mm_or_si128(
+	    _mm_cmpeq_epi16(_mm_and_si128(a, mask), surrogate),
+	    _mm_cmpeq_epi16(_mm_and_si128(b, mask), surrogate));
+	return (_mm_movemask_epi8(hits) == 0);
+#endif
+}
+
+#endif // __SSE2__
+
+/// Whole blocks of ASCII, while there's room for them. Only 16 bit
+/// units get the vector path; wider ones go a character at a time.
+template <typename Elem>
+inline void ascii_blocks(const Elem * &, const Elem *, char * &, char *)
+{ }
+
+template <typename Elem>
+inline void ascii_blocks(const char * &, const char *, Elem * &, Elem *)
+{ }
+
+#if defined(__SSE2__)
+inline void ascii_blocks(const char16_t * & from, const char16_t * from_end,
+                         char * & to, char * to_end)
+{
+	while (  (from_end - from) >= block_size
+	      && (to_end - to) >= block_size
+	      && ascii_block(from))
+	{
+		narrow_block(from, to);
+		from += block_size;
+		to += block_size;
+	}
+}
+
+inline void ascii_blocks(const char * & from, const char * from_end,
+                         char16_t * & to, char16_t * to_end)
+{
+	while (  (from_end - from) >= block_size
+	      && (to_end - to) >= block_size
+	      && ascii_block(from))
+	{
+		widen_block(from, to);
+		from += block_size;
+		to += block_size;
+	}
+}
+#endif // __SSE2__
+
+/// True if none of the block_size units at p is a surrogate or too big
+/// for UTF-16
+template <typename Elem>
+inline bool bmp_block(const Elem * p) noexcept
+{
+	bool rc = true;
+
+	for (std::ptrdiff_t i = 0; i < block_size; ++i)
+	{
+		const uint32_t c = static_cast<uint32_t>(p[i]);
+		rc &= ((c < 0xd800u) || ((c >= 0xe000u) && (c <= 0xffffu)));
+	}
+
+	return rc;
+}
+
+/// Writes the one to three byte UTF-8 for c, which must not be a
+/// surrogate, returning the end of it. Always writes three bytes, so the
+/// choice of length is a select rather than a branch.
+inline char * encode_bmp(uint32_t c, char * to) noexcept
+{
+	const uint32_t two = (c >= 0x80u);
+	const uint32_t three = (c >= 0x800u);
+
+	to[0] = static_cast<char>(three ? (0xe0u | (c >> 12))
+	                        : two ? (0xc0u | (c >> 6)) : c);
+	to[1] = static_cast<char>(0x80u | ((three ? (c >> 6) : c) & 0x3fu));
+	to[2] = static_cast<char>(0x80u | (c & 0x3fu));
+	return to + 1 + two + three;
+}
+
+/// UTF-16 to UTF-8, for characters outside the surrogate range
+template <typename Elem>
+inline void utf16_to_utf8(const Elem * & from_begin, const Elem * from_end,
+                          char * & to_begin, char * to_end)
+{
+	const Elem * from = from_begin;
+	char * to = to_begin;
+	bool more = true;
+
+	while (more && from < from_end)
+	{
+		ascii_blocks(from, from_end, to, to_end);
+
+		// a block with no surrogates, and room for it at its longest
+		if (  (from_end - from) >= block_size
+		   && (to_end - to) >= 3 * block_size
+		   && bmp_block(from))
+		{
+			for (std::ptrdiff_t i = 0; i < block_size; ++i)
+				to = encode_bmp(static_cast<uint32_t>(from[i]), to);
+			from += block_size;
+			continue;
+		}
+
+		// otherwise a block's worth one at a time, stopping at whatever
+		// needs the caller
+		const Elem * stop = from + std::min(block_size, from_end - from);
+
+		while (from < stop)
+		{
+			const uint32_t c = static_cast<uint32_t>(*from);
+			const std::ptrdiff_t length = (c < 0x80u) ? 1
+			                            : (c < 0x800u) ? 2 : 3;
+
+			if (  ((c >= 0xd800u) && (c < 0xe000u))
+			   || (c > 0xffffu)
+			   || ((to_end - to) < length))
+				break;
+
+			if (length == 1)
+				*to++ = static_cast<char>(c);
+			else if (length == 2)
+			{
+				to[0] = static_cast<char>(0xc0u | (c >> 6));
+				to[1] = static_cast<char>(0x80u | (c & 0x3fu));
+				to += 2;
+			}
+			else
+			{
+				to[0] = static_cast<char>(0xe0u | (c >> 12));
+				to[1] = static_cast<char>(0x80u | ((c >> 6) & 0x3fu));
+				to[2] = static_cast<char>(0x80u | (c & 0x3fu));
+				to += 3;
+			}
+
+			++from;
+		}
+
+		more = (from == stop);
+	}
+
+	from_begin = from;
+	to_begin = to;
+}
+
+/// UTF-8 to UTF-16, for sequences of up to three bytes. Which sequence
+/// a byte starts comes from a table, and its value is a select among
+/// the three, so only a sequence this can't take is a branch.
+template <typename Elem>
+inline void utf8_to_utf16(const char * & from_begin, const char * from_end,
+                          Elem * & to_begin, Elem * to_end)
+{
+	// by the top four bits of the first byte; 0 for those it can't start
+	static const uint8_t lengths[16] = {
+		1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 2, 2, 3, 0
+	};
+
+	const char * from = from_begin;
+	Elem * to = to_begin;
+
+	while (from < from_end && to < to_end)
+	{
+		ascii_blocks(from, from_end, to, to_end);
+
+		const char * stop = from + std::min(block_size, from_end - from);
+		bool more = true;
+
+		while (more && from < stop && to < to_end)
+		{
+			const std::ptrdiff_t left = from_end - from;
+			const uint32_t b0 = static_cast<uint8_t>(from[0]);
+			const uint32_t b1 = (left > 1) ? static_cast<uint8_t>(from[1]) : 0;
+			const uint32_t b2 = (left > 2) ? static_cast<uint8_t>(from[2]) : 0;
+			const uint32_t length = lengths[b0 >> 4];
+
+			const bool c1 = ((b1 & 0xc0u) == 0x80u);
+			const bool c2 = ((b2 & 0xc0u) == 0x80u);
+
+			more = (  (length == 1)
+			       || ((length == 2) && c1)
+			       || ((length == 3) && c1 && c2));
+
+			if (more)
+			{
+				const uint32_t two = ((b0 & 0x1fu) << 6) | (b1 & 0x3fu);
+				const uint32_t three = ((b0 & 0x0fu) << 12)
+				                     | ((b1 & 0x3fu) << 6) | (b2 & 0x3fu);
+
+				*to++ = static_cast<Elem>((length == 1) ? b0
+				                        : (length == 2) ? two : three);
+				from += length;
+			}
+		}
+
+		if (! more)
+			break;
+	}
+
+	from_begin = from;
+	to_begin = to;
+}
+
+//
+// UTF-16 in either byte order and code points, for codecvt_utf16
+//
+
+/// The unit at p, in the given byte order
+inline uint32_t unit_at(const char * p, bool little_endian) noexcept
+{
+	const uint32_t low = static_cast<uint8_t>(p[little_endian ? 0 : 1]);
+	const uint32_t high = static_cast<uint8_t>(p[little_endian ? 1 : 0]);
+	return ((high << 8) | low);
+}
+
+/// Writes u at p in the given byte order
+inline void put_unit(char * p, uint32_t u, bool little_endian) noexcept
+{
+	p[little_endian ? 0 : 1] = static_cast<char>(u & 0xffu);
+	p[little_endian ? 1 : 0] = static_cast<char>(u >> 8);
+}
+
+#if defined(__SSE2__)
+
+// A block is handled as two halves, each one register of units
+#if defined(__AVX2__)
+typedef __m256i units_type;
+#else
+typedef __m128i units_type;
+#endif
+
+constexpr std::ptrdiff_t half_block = block_size / 2;
+
+inline units_type load_half(const void * p) noexcept
+{
+#if defined(__AVX2__)
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+#else
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+#endif
+}
+
+inline void store_half(void * p, units_type v) noexcept
+{
+#if defined(__AVX2__)
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+#else
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+#endif
+}
+
+/// Two bits for each unit of the block a, b for which (unit & mask) is
+/// value, unit i at bit 2i
+inline uint64_t block_bits(units_type a, units_type b,
+                           uint16_t mask, uint16_t value) noexcept
+{
+#if defined(__AVX2__)
+	const __m256i m = _mm256_set1_epi16(static_cast<short>(mask));
+	const __m256i v = _mm256_set1_epi16(static_cast<short>(value));
+	const uint32_t x = _mm256_movemask_epi8(
+	                       _mm256_cmpeq_epi16(_mm256_and_si256(a, m), v));
+	const uint32_t y = _mm256_movemask_epi8(
+	                       _mm256_cmpeq_epi16(_mm256_and_si256(b, m), v));
+	return ((static_cast<uint64_t>(y) << 32) | x);
+#else
+	const __m128i m = _mm_set1_epi16(static_cast<short>(mask));
+	const __m128i v = _mm_set1_epi16(static_cast<short>(value));
+	const uint32_t x = _mm_movemask_epi8(
+	                       _mm_cmpeq_epi16(_mm_and_si128(a, m), v));
+	const uint32_t y = _mm_movemask_epi8(
+	                       _mm_cmpeq_epi16(_mm_and_si128(b, m), v));
+	return ((static_cast<uint64_t>(y) << 16) | x);
+#endif
+}
+
+/// True if any unit of v is greater than the matching one of limit
+inline bool over(units_type v, units_type limit) noexcept
+{
+#if defined(__AVX2__)
+	const __m256i excess = _mm256_subs_epu16(v, limit);
+	return (! _mm256_testz_si256(excess, excess));
+#else
+	const __m128i excess = _mm_subs_epu16(v, limit);
+	return (_mm_movemask_epi8(_mm_cmpeq_epi16(excess, _mm_setzero_si128()))
+	        != 0xffff);
+#endif
+}
+
+#endif // __SSE2__
+
+#if defined(__SSSE3__)
+
+/// Swaps the two bytes of each unit, to or from little endian, which is
+/// the host's order
+inline units_type swap_bytes(units_type v) noexcept
+{
+#if defined(__AVX2__)
+	return _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+	           1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+	           1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+#else
+	return _mm_shuffle_epi8(v, _mm_setr_epi8(
+	           1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+#endif
+}
+
+/// Half a block of code points at p as units, false if any needs more
+/// than 16 bits
+inline bool load_code_points(const char16_t * p, units_type & v) noexcept
+{
+	v = load_half(p);
+	return true;
+}
+
+template <typename Elem>
+inline bool load_code_points(const Elem * p, units_type & v) noexcept
+{
+	static_assert(sizeof(Elem) == 4, "code points are 16 or 32 bits");
+
+#if defined(__AVX2__)
+	const __m256i x = load_half(p);
+	const __m256i y = load_half(p + 8);
+	const __m256i wide = _mm256_and_si256(_mm256_or_si256(x, y),
+	                                      _mm256_set1_epi32(0xffff0000));
+	v = _mm256_permute4x64_epi64(_mm256_packus_epi32(x, y), 0xd8);
+	return _mm256_testz_si256(wide, wide);
+#else
+	const __m128i x = load_half(p);
+	const __m128i y = load_half(p + 4);
+	const __m128i wide = _mm_and_si128(_mm_or_si128(x, y),
+	                                   _mm_set1_epi32(0xffff0000));
+	// packs saturates as signed, so move the units into its range and back
+	const __m128i bias = _mm_set1_epi32(0x8000);
+	v = _mm_add_epi16(_mm_packs_epi32(_mm_sub_epi32(x, bias),
+	                                  _mm_sub_epi32(y, bias)),
+	                  _mm_set1_epi16(static_cast<short>(0x8000)));
+	return (_mm_movemask_epi8(_mm_cmpeq_epi32(wide, _mm_setzero_si128()))
+	        == 0xffff);
+#endif
+}
+
+/// Half a block of units as code points at p
+inline void store_code_points(char16_t * p, units_type v) noexcept
+{
+	store_half(p, v);
+}
+
+template <typename Elem>
+inline void store_code_points(Elem * p, units_type v) noexcept
+{
+	static_assert(sizeof(Elem) == 4, "code points are 16 or 32 bits");
+
+#if defined(__AVX2__)
+	store_half(p, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+	store_half(p + 8, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+#else
+	store_half(p, _mm_unpacklo_epi16(v, _mm_setzero_si128()));
+	store_half(p + 4, _mm_unpackhi_epi16(v, _mm_setzero_si128()));
+#endif
+}
+
+/// Whole blocks of UTF-16 to code points, while each is either free of
+/// surrogates or made of whole pairs, and there's room for it
+template <typename Elem>
+inline void decode_blocks(const char * & from, const char * from_end,
+                          Elem * & to, Elem * to_end, bool little_endian)
+{
+	while (  (from_end - from) >= 2 * block_size
+	      && (to_end - to) >= block_size)
+	{
+		units_type a = load_half(from);
+		units_type b = load_half(from + block_size);
+
+		if (! little_endian)
+		{
+			a = swap_bytes(a);
+			b = swap_bytes(b);
+		}
+
+		const uint64_t surrogates = block_bits(a, b, 0xf800u, 0xd800u);
+
+		if (surrogates == 0)
+		{
+			store_code_points(to, a);
+			store_code_points(to + half_block, b);
+			from += 2 * block_size;
+			to += block_size;
+			continue;
+		}
+
+		// each high surrogate followed by a low one, and neither split
+		// from the other by the ends of the block
+		const uint64_t high = block_bits(a, b, 0xfc00u, 0xd800u);
+
+		if (  ((surrogates & ~high) != (high << 2))
+		   || ((high >> (2 * block_size - 2)) != 0))
+			break;
+
+		char16_t units[block_size];
+		store_half(units, a);
+		store_half(units + half_block, b);
+
+		for (std::ptrdiff_t i = 0; i < block_size; ++i)
+		{
+			uint32_t c = units[i];
+
+			if ((c & 0xfc00u) == 0xd800u)
+			{
+				c = ((c & 0x3ffu) << 10) | (units[++i] & 0x3ffu);
+				c += 0x10000u;
+			}
+
+			*to++ = static_cast<Elem>(c);
+		}
+
+		from += 2 * block_size;
+	}
+}
+
+/// Whole blocks of code points to UTF-16, while they're all in the BMP,
+/// none is a surrogate or greater than limit, and there's room for them
+template <typename Elem>
+inline void encode_blocks(const Elem * & from, const Elem * from_end,
+                          char * & to, char * to_end, bool little_endian,
+                          uint32_t limit)
+{
+#if defined(__AVX2__)
+	const units_type top = _mm256_set1_epi16(
+	                           static_cast<short>(std::min(limit, 0xffffu)));
+#else
+	const units_type top = _mm_set1_epi16(
+	                           static_cast<short>(std::min(limit, 0xffffu)));
+#endif
+
+	while (  (from_end - from) >= block_size
+	      && (to_end - to) >= 2 * block_size)
+	{
+		units_type a, b;
+
+		if (  ! load_code_points(from, a)
+		   || ! load_code_points(from + half_block, b)
+		   || (block_bits(a, b, 0xf800u, 0xd800u) != 0)
+		   || over(a, top)
+		   || over(b, top))
+			break;
+
+		if (! little_endian)
+		{
+			a = swap_bytes(a);
+			b = swap_bytes(b);
+		}
+
+		store_half(to, a);
+		store_half(to + block_size, b);
+		from += block_size;
+		to += 2 * block_size;
+	}
+}
+
+#endif // __SSSE3__
+
+/// UTF-16 in the given byte order to code points, for single units and
+/// whole surrogate pairs. A pair is one code point, cast to Elem as the
+/// facet's own conversion does.
+template <typename Elem>
+inline void utf16_decode(const char * & from_begin, const char * from_end,
+                         Elem * & to_begin, Elem * to_end,
+                         bool little_endian)
+{
+	const char * from = from_begin;
+	Elem * to = to_begin;
+	bool more = true;
+
+	while (more && (from_end - from) >= 2 && to < to_end)
+	{
+#if defined(__SSSE3__)
+		decode_blocks(from, from_end, to, to_end, little_endian);
+#endif
+
+		// otherwise a block's worth one at a time, stopping at whatever
+		// needs the caller
+		const char * stop = from + 2 * std::min(block_size,
+		                                        (from_end - from) / 2);
+
+		while (from < stop && to < to_end)
+		{
+			const uint32_t u = unit_at(from, little_endian);
+
+			if ((u & 0xf800u) != 0xd800u)
+			{
+				*to++ = static_cast<Elem>(u);
+				from += 2;
+				continue;
+			}
+
+			if ((u >= 0xdc00u) || ((from_end - from) < 4))
+				break;
+
+			const uint32_t low = unit_at(from + 2, little_endian);
+
+			if ((low & 0xfc00u) != 0xdc00u)
+				break;
+
+			*to++ = static_cast<Elem>(
+			          (((u & 0x3ffu) << 10) | (low & 0x3ffu)) + 0x10000u);
+			from += 4;
+		}
+
+		// a pair may end past stop
+		more = (from >= stop);
+	}
+
+	from_begin = from;
+	to_begin = to;
+}
+
+/// Code points to UTF-16 in the given byte order, for those up to limit
+/// that aren't surrogates
+template <typename Elem>
+inline void utf16_encode(const Elem * & from_begin, const Elem * from_end,
+                         char * & to_begin, char * to_end,
+                         bool little_endian, uint32_t limit)
+{
+	const Elem * from = from_begin;
+	char * to = to_begin;
+	bool more = true;
+
+	while (more && from < from_end)
+	{
+#if defined(__SSSE3__)
+		encode_blocks(from, from_end, to, to_end, little_endian, limit);
+#endif
+
+		const Elem * stop = from + std::min(block_size, from_end - from);
+
+		while (from < stop)
+		{
+			const uint32_t c = static_cast<uint32_t>(*from);
+
+			if ((c > limit) || ((c & 0xfffff800u) == 0xd800u))
+				break;
+
+			if (c < 0x10000u)
+			{
+				if ((to_end - to) < 2)
+					break;
+
+				put_unit(to, c, little_endian);
+				to += 2;
+			}
+			else
+			{
+				if ((to_end - to) < 4)
+					break;
+
+				put_unit(to, 0xd800u | ((c - 0x10000u) >> 10), little_endian);
+				put_unit(to + 2, 0xdc00u | (c & 0x3ffu), little_endian);
+				to += 4;
+			}
+
+			++from;
+		}
+
+		more = (from == stop);
+	}
+
+	from_begin = from;
+	to_begin = to;
+}
+
+} // namespace utf_simd
+
+#endif // GUARD_UTF_SIMD_HELPERS_H
@@ -40,13 +40,14 @@ descriptor::set_bad_close_handler(bad_close_handler_t * new_handler)
 }
 
 //////////////////////////////////////////////////////////////////////
-descriptor::descriptor(descriptor && other)
+descriptor::descriptor(descriptor && other) noexcept
+  : fd(-1)
 {
 	std::swap(fd, other.fd);
 }
 
 //////////////////////////////////////////////////////////////////////
-descriptor & descriptor::operator = (descriptor && other)
+descriptor & descriptor::operator = (descriptor && other) noexcept
 {
 	if (this != &other)
 		std::swap(fd, other.fd);
@@ -94,4 +95,443 @@ descriptor descriptor::dup(int newFd, bool close_on_exec)
 	return ret;
 }
 
+//////////////////////////////////////////////////////////////////////
+file_descriptor::file_descriptor(const filesystem::path & p, int flags,
+                                 mode_t mode)
+  : descriptor()
+{
+	open(p, flags, mode);
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::open(const filesystem::path & p, int flags,
+                           mode_t mode)
+{
+	std::error_code ec;
+	open(p, flags, mode, ec);
+	if (ec) throw make_syserr(ec.value(), "Could not open " + p.native());
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::open(const filesystem::path & p, int flags,
+                           mode_t mode, std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (fd >= 0)
+	{
+		int old = fd;
+		fd = -1;
+		if (::close(old) != 0)
+		{
+			ec = std::error_code(errno, std::system_category());
+			return;
+		}
+	}
+
+	do {
+		fd = ::open(p.c_str(), flags | O_CLOEXEC, mode);
+	} while (fd < 0 && errno == EINTR);
+
+	if (fd < 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::advise(advice a, off_t offset, off_t length)
+{
+	std::error_code ec;
+	advise(a, offset, length, ec);
+	if (ec) throw make_syserr(ec.value(), "posix_fadvise failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::advise(advice a, off_t offset, off_t length,
+                             std::error_code & ec) noexcept
+{
+	// posix_fadvise() returns the error rather than setting errno
+	int rc = ::posix_fadvise(fd, offset, length, static_cast<int>(a));
+	ec = (rc == 0) ? std::error_code()
+	               : std::error_code(rc, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::allocate(off_t offset, off_t length,
+                               allocate_mode mode)
+{
+	std::error_code ec;
+	allocate(offset, length, mode, ec);
+	if (ec) throw make_syserr(ec.value(), "fallocate failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::allocate(off_t offset, off_t length,
+                               allocate_mode mode,
+                               std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	int rc;
+	do {
+		rc = ::fallocate(fd, static_cast<int>(mode), offset, length);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::truncate(off_t length)
+{
+	std::error_code ec;
+	truncate(length, ec);
+	if (ec) throw make_syserr(ec.value(), "ftruncate failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::truncate(off_t length, std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (::ftruncate(fd, length) < 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::sync(bool data_only)
+{
+	std::error_code ec;
+	sync(data_only, ec);
+	if (ec) throw make_syserr(ec.value(), "fsync failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_descriptor::sync(bool data_only, std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if ((data_only ? ::fdatasync(fd) : ::fsync(fd)) < 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+off_t file_descriptor::size() const
+{
+	std::error_code ec;
+	off_t n = size(ec);
+	if (ec) throw make_syserr(ec.value(), "fstat failed");
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+off_t file_descriptor::size(std::error_code & ec) const noexcept
+{
+	struct stat st;
+
+	ec.clear();
+
+	if (::fstat(fd, &st) < 0)
+	{
+		ec = std::error_code(errno, std::system_category());
+		return -1;
+	}
+
+	return st.st_size;
+}
+
+//////////////////////////////////////////////////////////////////////
+signal_descriptor::signal_descriptor(const sigset_t & mask, bool nonblock,
+                                     bool close_on_exec)
+  : descriptor(signalfd(-1, &mask, (nonblock ? SFD_NONBLOCK : 0)
+                                 | (close_on_exec ? SFD_CLOEXEC : 0)))
+{
+	if (fd < 0) throw make_syserr("Could not create signal descriptor");
+}
+
+//////////////////////////////////////////////////////////////////////
+signal_descriptor::signal_descriptor(std::initializer_list<int> signals,
+                                     bool nonblock, bool close_on_exec)
+  : signal_descriptor(make_mask(signals), nonblock, close_on_exec)
+{
+	const sigset_t mask = make_mask(signals);
+	int rc = pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+	if (rc != 0) throw make_syserr(rc, "Could not block signals");
+}
+
+//////////////////////////////////////////////////////////////////////
+sigset_t signal_descriptor::make_mask(std::initializer_list<int> signals)
+  noexcept
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	for (int s : signals)
+		sigaddset(&mask, s);
+	return mask;
+}
+
+//////////////////////////////////////////////////////////////////////
+void signal_descriptor::set_mask(const sigset_t & mask)
+{
+	if (signalfd(fd, &mask, 0) < 0)
+		throw make_syserr("Could not change signal descriptor mask");
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t signal_descriptor::read_signals(signalfd_siginfo * info,
+                                            std::size_t count)
+{
+	std::error_code ec;
+	std::size_t n = read_signals(info, count, ec);
+	if (ec && ec != std::errc::resource_unavailable_try_again)
+		throw make_syserr(ec.value(), "Could not read signal descriptor");
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t signal_descriptor::read_signals(signalfd_siginfo * info,
+                                            std::size_t count,
+                                            std::error_code & ec) noexcept
+{
+	const int d = fd;
+	std::size_t n = detail::retry_io([&]()
+	    { return ::read(d, info, count * sizeof(signalfd_siginfo)); }, ec);
+	return n / sizeof(signalfd_siginfo);
+}
+
+//////////////////////////////////////////////////////////////////////
+socket_descriptor::socket_descriptor(int domain, int type, int protocol)
+  : descriptor(::socket(domain, type | SOCK_CLOEXEC, protocol))
+{
+	if (fd < 0) throw make_syserr("Could not create socket");
+}
+
+//////////////////////////////////////////////////////////////////////
+std::pair<socket_descriptor, socket_descriptor>
+socket_descriptor::pair(int domain, int type, int protocol)
+{
+	int fds[2];
+
+	if (::socketpair(domain, type | SOCK_CLOEXEC, protocol, fds) != 0)
+		throw make_syserr("Could not create socket pair");
+
+	return std::make_pair(socket_descriptor(fds[0]),
+	                      socket_descriptor(fds[1]));
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::bind(const struct sockaddr * addr, socklen_t length)
+{
+	std::error_code ec;
+	bind(addr, length, ec);
+	if (ec) throw make_syserr(ec.value(), "bind failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::bind(const struct sockaddr * addr, socklen_t length,
+                             std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (::bind(fd, addr, length) != 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::listen(int backlog)
+{
+	std::error_code ec;
+	listen(backlog, ec);
+	if (ec) throw make_syserr(ec.value(), "listen failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::listen(int backlog, std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (::listen(fd, backlog) != 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::connect(const struct sockaddr * addr,
+                                socklen_t length)
+{
+	std::error_code ec;
+	connect(addr, length, ec);
+	if (ec) throw make_syserr(ec.value(), "connect failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::connect(const struct sockaddr * addr,
+                                socklen_t length,
+                                std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	// an interrupted connect carries on in the background, so it isn't
+	// retried; the caller waits for writability as for EINPROGRESS
+	if (::connect(fd, addr, length) != 0)
+	{
+		const int err = (errno == EINTR) ? EINPROGRESS : errno;
+		ec = std::error_code(err, std::system_category());
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+socket_descriptor socket_descriptor::accept(bool nonblock)
+{
+	std::error_code ec;
+	socket_descriptor s = accept(nonblock, ec);
+	if (ec) throw make_syserr(ec.value(), "accept failed");
+	return s;
+}
+
+//////////////////////////////////////////////////////////////////////
+socket_descriptor socket_descriptor::accept(bool nonblock,
+                                            std::error_code & ec) noexcept
+{
+	int s;
+
+	ec.clear();
+
+	do {
+		s = ::accept4(fd, nullptr, nullptr,
+		              SOCK_CLOEXEC | (nonblock ? SOCK_NONBLOCK : 0));
+	} while (s < 0 && errno == EINTR);
+
+	if (s < 0)
+		ec = std::error_code(errno, std::system_category());
+
+	return socket_descriptor(s);
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::shutdown(int how)
+{
+	std::error_code ec;
+	shutdown(how, ec);
+	if (ec) throw make_syserr(ec.value(), "shutdown failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::shutdown(int how, std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (::shutdown(fd, how) != 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::set_option(int level, int name, int value)
+{
+	std::error_code ec;
+	set_option(level, name, value, ec);
+	if (ec) throw make_syserr(ec.value(), "setsockopt failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void socket_descriptor::set_option(int level, int name, int value,
+                                   std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (::setsockopt(fd, level, name, &value, sizeof(value)) != 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+std::error_code socket_descriptor::error() const
+{
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+		throw make_syserr("getsockopt(SO_ERROR) failed");
+
+	return err ? std::error_code(err, std::system_category())
+	           : std::error_code();
+}
+
+//////////////////////////////////////////////////////////////////////
+socklen_t socket_descriptor::local_address(struct sockaddr * addr,
+                                           socklen_t length) const
+{
+	if (::getsockname(fd, addr, &length) != 0)
+		throw make_syserr("getsockname failed");
+
+	return length;
+}
+
+//////////////////////////////////////////////////////////////////////
+inotify_descriptor::inotify_descriptor(bool nonblock, bool close_on_exec)
+  : descriptor(inotify_init1( (nonblock ? IN_NONBLOCK : 0)
+                            | (close_on_exec ? IN_CLOEXEC : 0) ))
+{
+	if (fd < 0) throw make_syserr("Could not create inotify descriptor");
+}
+
+//////////////////////////////////////////////////////////////////////
+int inotify_descriptor::add_watch(const filesystem::path & p,
+                                  std::uint32_t mask)
+{
+	std::error_code ec;
+	int wd = add_watch(p, mask, ec);
+	if (ec) throw make_syserr(ec.value(), "Could not add inotify watch for "
+	                                      + p.native());
+	return wd;
+}
+
+//////////////////////////////////////////////////////////////////////
+int inotify_descriptor::add_watch(const filesystem::path & p,
+                                  std::uint32_t mask,
+                                  std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	int wd = inotify_add_watch(fd, p.c_str(), mask);
+	if (wd < 0)
+		ec = std::error_code(errno, std::system_category());
+
+	return wd;
+}
+
+//////////////////////////////////////////////////////////////////////
+void inotify_descriptor::remove_watch(int wd)
+{
+	std::error_code ec;
+	remove_watch(wd, ec);
+	if (ec) throw make_syserr(ec.value(), "Could not remove inotify watch");
+}
+
+//////////////////////////////////////////////////////////////////////
+void inotify_descriptor::remove_watch(int wd, std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (inotify_rm_watch(fd, wd) != 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t inotify_descriptor::read_events(char * buffer, std::size_t length)
+{
+	ssize_t rc = -1;
+
+	do {
+		rc = ::read(fd, buffer, length);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+
+		throw make_syserr("Could not read inotify events");
+	}
+
+	return static_cast<std::size_t>(rc);
+}
+
 } // namespace io
@@ -1,18 +1,30 @@
 #ifndef GUARD_DESCRIPTOR_H
 #define GUARD_DESCRIPTOR_H 1
 
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <cstdint>
 #include <cstdio>
+#include <initializer_list>
 #include <system_error>
+#include <utility>
 
-#include "util.h"
+#include "utility/util.h"
+#include "time/timeutil.h"
+#include "utility/bitmask_operators.h"
+#include "filesystem/path.h"
 
 namespace io {
 
-class fs_path;
-
 //////////////////////////////////////////////////////////////////////
 void default_bad_close_handler(int fd, std::exception * ex) noexcept;
 
@@ -29,8 +41,8 @@ class descriptor
 	descriptor(const descriptor &) = delete;
 	descriptor & operator = (const descriptor &) = delete;
 
-	descriptor(descriptor &&);
-	descriptor & operator = (descriptor &&);
+	descriptor(descriptor &&) noexcept;
+	descriptor & operator = (descriptor &&) noexcept;
 
 	virtual ~descriptor();
 
@@ -38,6 +50,8 @@ class descriptor
 
 	virtual descriptor dup(int newFd = -1, bool close_on_exec = true);
 
+	int native_handle() const noexcept { return fd; }
+
  protected:
 	descriptor(int _fd = -1) noexcept : fd(_fd) { }
 
@@ -47,95 +61,556 @@ class descriptor
 };
 
 //////////////////////////////////////////////////////////////////////
-template <int CLOCK>
-class timer_descriptor : descriptor
+/// Flags for preadv2()/pwritev2()
+enum class rw_flags
+{
+	none   = 0,
+	hipri  = RWF_HIPRI,   // poll for completion (O_DIRECT, polled queues)
+	dsync  = RWF_DSYNC,   // per-write O_DSYNC
+	sync   = RWF_SYNC,    // per-write O_SYNC
+	nowait = RWF_NOWAIT,  // fail with EAGAIN rather than block, e.g. on
+	                      // data that isn't in the page cache
+	append = RWF_APPEND,  // per-write O_APPEND
+};
+
+DEFINE_BITMASK_OPERATORS(rw_flags, unsigned int);
+
+/// posix_fadvise() advice
+enum class advice
+{
+	normal      = POSIX_FADV_NORMAL,
+	sequential  = POSIX_FADV_SEQUENTIAL,
+	random      = POSIX_FADV_RANDOM,
+	no_reuse    = POSIX_FADV_NOREUSE,
+	will_need   = POSIX_FADV_WILLNEED,
+	dont_need   = POSIX_FADV_DONTNEED,
+};
+
+/// fallocate() modes
+enum class allocate_mode
+{
+	none           = 0,
+	keep_size      = FALLOC_FL_KEEP_SIZE,
+	punch_hole     = FALLOC_FL_PUNCH_HOLE,    // requires keep_size
+	collapse_range = FALLOC_FL_COLLAPSE_RANGE,
+	zero_range     = FALLOC_FL_ZERO_RANGE,
+	insert_range   = FALLOC_FL_INSERT_RANGE,
+};
+
+DEFINE_BITMASK_OPERATORS(allocate_mode, unsigned int);
+
+namespace detail {
+
+/// Runs a read/write style system call, retrying on EINTR. Errors,
+/// EAGAIN included, are reported through ec with a return of 0.
+template <class F>
+inline std::size_t retry_io(F f, std::error_code & ec) noexcept
+{
+	ssize_t rc;
+
+	do {
+		rc = f();
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+	{
+		ec = std::error_code(errno, std::system_category());
+		return 0;
+	}
+
+	ec.clear();
+	return static_cast<std::size_t>(rc);
+}
+
+template <class D>
+inline int handle_of(const D * d) noexcept
+	{ return d->native_handle(); }
+
+} // namespace detail
+
+//////////////////////////////////////////////////////////////////////
+/// The operations below are mixed into concrete descriptor classes with
+/// CRTP rather than declared virtual on descriptor, so each call is
+/// inlined straight down to the system call.
+///
+/// Every operation comes in two forms: one throws std::system_error, the
+/// other reports through an error_code. The throwing forms treat EAGAIN
+/// as an error like any other, so nonblocking descriptors want the
+/// error_code forms. A return of 0 without an error is end of file.
+template <class D>
+class input_operations
 {
  public:
-	timer_descriptor(bool nonblock = false, bool close_on_exec = true)
-	  : descriptor(timerfd_create(CLOCK, (nonblock ? TFD_NONBLOCK : 0) |
-	                                      close_on_exec ? TFD_CLOEXEC : 0))
+	std::size_t read(void * buffer, std::size_t length)
 	{
-		if (fd < 0) throw make_syserr("Could not create timer fd");
+		std::error_code ec;
+		std::size_t n = read(buffer, length, ec);
+		if (ec) throw make_syserr(ec.value(), "read failed");
+		return n;
 	}
 
-	void arm_relative_timer(void * initial, void * interval);
-	void arm_absolute_timer(void * initial, void * interval);
-	void disarm_timer();
+	std::size_t read(void * buffer, std::size_t length,
+	                 std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		return detail::retry_io([&]() { return ::read(fd, buffer, length); },
+		                        ec);
+	}
 
-	
+	std::size_t readv(const struct iovec * iov, int count)
+	{
+		std::error_code ec;
+		std::size_t n = readv(iov, count, ec);
+		if (ec) throw make_syserr(ec.value(), "readv failed");
+		return n;
+	}
+
+	std::size_t readv(const struct iovec * iov, int count,
+	                  std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		return detail::retry_io([&]() { return ::readv(fd, iov, count); },
+		                        ec);
+	}
+
+ protected:
+	~input_operations() = default;
 };
 
 //////////////////////////////////////////////////////////////////////
-class file_descriptor : public descriptor
+template <class D>
+class output_operations
 {
  public:
-	file_descriptor();
-	file_descriptor(const fs_path &);
+	std::size_t write(const void * buffer, std::size_t length)
+	{
+		std::error_code ec;
+		std::size_t n = write(buffer, length, ec);
+		if (ec) throw make_syserr(ec.value(), "write failed");
+		return n;
+	}
 
-	bool open(const fs_path &);
+	std::size_t write(const void * buffer, std::size_t length,
+	                  std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		return detail::retry_io([&]() { return ::write(fd, buffer, length); },
+		                        ec);
+	}
+
+	std::size_t writev(const struct iovec * iov, int count)
+	{
+		std::error_code ec;
+		std::size_t n = writev(iov, count, ec);
+		if (ec) throw make_syserr(ec.value(), "writev failed");
+		return n;
+	}
+
+	std::size_t writev(const struct iovec * iov, int count,
+	                   std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		return detail::retry_io([&]() { return ::writev(fd, iov, count); },
+		                        ec);
+	}
+
+ protected:
+	~output_operations() = default;
 };
 
-class socket_descriptor { };
+//////////////////////////////////////////////////////////////////////
+/// Operations at explicit offsets, for descriptors that can seek. An
+/// offset of -1 to preadv2()/pwritev2() means the current file position.
+template <class D>
+class positional_operations
+{
+ public:
+	std::size_t pread(void * buffer, std::size_t length, off_t offset)
+	{
+		std::error_code ec;
+		std::size_t n = pread(buffer, length, offset, ec);
+		if (ec) throw make_syserr(ec.value(), "pread failed");
+		return n;
+	}
 
-class signal_descriptor { };
-class inotify_descriptor { };
+	std::size_t pread(void * buffer, std::size_t length, off_t offset,
+	                  std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		return detail::retry_io(
+		    [&]() { return ::pread(fd, buffer, length, offset); }, ec);
+	}
+
+	std::size_t pwrite(const void * buffer, std::size_t length, off_t offset)
+	{
+		std::error_code ec;
+		std::size_t n = pwrite(buffer, length, offset, ec);
+		if (ec) throw make_syserr(ec.value(), "pwrite failed");
+		return n;
+	}
+
+	std::size_t pwrite(const void * buffer, std::size_t length, off_t offset,
+	                   std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		return detail::retry_io(
+		    [&]() { return ::pwrite(fd, buffer, length, offset); }, ec);
+	}
+
+	std::size_t preadv(const struct iovec * iov, int count, off_t offset,
+	                   rw_flags flags = rw_flags::none)
+	{
+		std::error_code ec;
+		std::size_t n = preadv(iov, count, offset, flags, ec);
+		if (ec) throw make_syserr(ec.value(), "preadv2 failed");
+		return n;
+	}
+
+	/// With rw_flags::nowait, fails with EAGAIN instead of waiting for
+	/// the disk, so a caller can serve cached data inline and hand the
+	/// rest to another thread.
+	std::size_t preadv(const struct iovec * iov, int count, off_t offset,
+	                   rw_flags flags, std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		const int f = static_cast<int>(flags);
+		return detail::retry_io(
+		    [&]() { return ::preadv2(fd, iov, count, offset, f); }, ec);
+	}
+
+	std::size_t pwritev(const struct iovec * iov, int count, off_t offset,
+	                    rw_flags flags = rw_flags::none)
+	{
+		std::error_code ec;
+		std::size_t n = pwritev(iov, count, offset, flags, ec);
+		if (ec) throw make_syserr(ec.value(), "pwritev2 failed");
+		return n;
+	}
+
+	std::size_t pwritev(const struct iovec * iov, int count, off_t offset,
+	                    rw_flags flags, std::error_code & ec) noexcept
+	{
+		const int fd = detail::handle_of(static_cast<const D *>(this));
+		const int f = static_cast<int>(flags);
+		return detail::retry_io(
+		    [&]() { return ::pwritev2(fd, iov, count, offset, f); }, ec);
+	}
+
+ protected:
+	~positional_operations() = default;
+};
 
-#if 0
 //////////////////////////////////////////////////////////////////////
-class read_interface
+/// A descriptor for sequential I/O: pipes, sockets, terminals, or any
+/// descriptor obtained elsewhere.
+class io_descriptor final
+  : public descriptor
+  , public input_operations<io_descriptor>
+  , public output_operations<io_descriptor>
 {
  public:
-	virtual ~read_interface() { }
-	virtual int read(char * buffer, std::size_t length) = 0;
-	virtual int readvec(const struct iovec * iov, int count) = 0;
+	io_descriptor() noexcept : descriptor() { }
+
+	/// Takes ownership of fd
+	explicit io_descriptor(int fd) noexcept : descriptor(fd) { }
+
+	io_descriptor(io_descriptor &&) = default;
+	io_descriptor & operator = (io_descriptor &&) = default;
 };
 
 //////////////////////////////////////////////////////////////////////
-class write_interface
+/// A descriptor for a file opened by path. Files are always opened
+/// close-on-exec.
+class file_descriptor final
+  : public descriptor
+  , public input_operations<file_descriptor>
+  , public output_operations<file_descriptor>
+  , public positional_operations<file_descriptor>
 {
  public:
-	virtual ~write_interface() { }
-	virtual int write(char * buffer, std::size_t length) = 0;
-	virtual int writevec(const struct iovec * iov, int count) = 0;
+	file_descriptor() noexcept : descriptor() { }
+
+	/// Takes ownership of fd
+	explicit file_descriptor(int fd) noexcept : descriptor(fd) { }
+
+	explicit file_descriptor(const filesystem::path & p,
+	                         int flags = O_RDONLY, mode_t mode = 0666);
+
+	file_descriptor(file_descriptor &&) = default;
+	file_descriptor & operator = (file_descriptor &&) = default;
+
+	/// Closes any file already open, then opens p
+	void open(const filesystem::path & p, int flags = O_RDONLY,
+	          mode_t mode = 0666);
+	void open(const filesystem::path & p, int flags, mode_t mode,
+	          std::error_code & ec) noexcept;
+
+	bool is_open() const noexcept { return (fd >= 0); }
+
+	void advise(advice a, off_t offset = 0, off_t length = 0);
+	void advise(advice a, off_t offset, off_t length,
+	            std::error_code & ec) noexcept;
+
+	void allocate(off_t offset, off_t length,
+	              allocate_mode mode = allocate_mode::none);
+	void allocate(off_t offset, off_t length, allocate_mode mode,
+	              std::error_code & ec) noexcept;
+
+	void truncate(off_t length);
+	void truncate(off_t length, std::error_code & ec) noexcept;
+
+	/// fsync(), or fdatasync() when only the data must be durable
+	void sync(bool data_only = false);
+	void sync(bool data_only, std::error_code & ec) noexcept;
+
+	off_t size() const;
+	off_t size(std::error_code & ec) const noexcept;
 };
 
 //////////////////////////////////////////////////////////////////////
-class rw_interface
-  : public read_interface
-  , public write_interface
+/// A timerfd on clock CLOCK. Each expiration makes the descriptor
+/// readable; read_expirations() collects how many have happened.
+template <int CLOCK>
+class timer_descriptor final : public descriptor
 {
  public:
-	virtual ~rw_interface() { }
+	typedef posix_clock<static_cast<clock_source>(CLOCK)> clock_type;
+	typedef typename clock_type::duration duration;
+	typedef typename clock_type::time_point time_point;
+
+	explicit timer_descriptor(bool nonblock = false, bool close_on_exec = true)
+	  : descriptor(timerfd_create(CLOCK, (nonblock ? TFD_NONBLOCK : 0) |
+	                                     (close_on_exec ? TFD_CLOEXEC : 0)))
+	{
+		if (fd < 0) throw make_syserr("Could not create timer fd");
+	}
+
+	timer_descriptor(timer_descriptor &&) = default;
+	timer_descriptor & operator = (timer_descriptor &&) = default;
+
+	/// Expires after initial, then every interval unless that is zero.
+	/// Rearming replaces any earlier setting; an initial of zero expires
+	/// at once rather than disarming.
+	void arm_relative_timer(duration initial,
+	                        duration interval = duration::zero())
+	{
+		if (initial <= duration::zero())
+			initial = duration(1);
+		set_time(0, to_timespec(initial), to_timespec(interval));
+	}
+
+	/// Expires at initial (at once if that has passed), then every
+	/// interval unless that is zero
+	void arm_absolute_timer(time_point initial,
+	                        duration interval = duration::zero())
+	{
+		struct timespec ts = to_timespec(initial);
+		if (ts.tv_sec == 0 && ts.tv_nsec == 0)
+			ts.tv_nsec = 1;
+		set_time(TFD_TIMER_ABSTIME, ts, to_timespec(interval));
+	}
+
+	void disarm_timer()
+	{
+		const struct timespec zero = { 0, 0 };
+		set_time(0, zero, zero);
+	}
+
+	/// Time left until the next expiration; zero when disarmed
+	duration remaining() const
+	{
+		struct itimerspec its;
+		if (timerfd_gettime(fd, &its) != 0)
+			throw make_syserr("timerfd_gettime failed");
+		return to_duration<duration>(its.it_value);
+	}
+
+	/// Expirations since the last read. Waits for one unless the
+	/// descriptor is nonblocking, in which case 0 means none yet.
+	std::uint64_t read_expirations()
+	{
+		std::error_code ec;
+		std::uint64_t n = read_expirations(ec);
+		if (ec && ec != std::errc::resource_unavailable_try_again)
+			throw make_syserr(ec.value(), "Could not read timer fd");
+		return n;
+	}
+
+	std::uint64_t read_expirations(std::error_code & ec) noexcept
+	{
+		std::uint64_t n = 0;
+		const int d = fd;
+		detail::retry_io([&]() { return ::read(d, &n, sizeof(n)); }, ec);
+		return ec ? 0 : n;
+	}
+
+ private:
+	void set_time(int flags, const struct timespec & initial,
+	              const struct timespec & interval)
+	{
+		const struct itimerspec its = { interval, initial };
+		if (timerfd_settime(fd, flags, &its, nullptr) != 0)
+			throw make_syserr("timerfd_settime failed");
+	}
 };
 
 //////////////////////////////////////////////////////////////////////
-class input_descriptor : public virtual descriptor
+/// A signalfd. The signals it reports must be blocked, in every thread
+/// that might otherwise receive them, or they are delivered as usual
+/// instead of being queued for the descriptor.
+class signal_descriptor final : public descriptor
 {
  public:
-	virtual ~input_descriptor() { }
+	explicit signal_descriptor(const sigset_t & mask, bool nonblock = true,
+	                           bool close_on_exec = true);
+
+	/// Blocks signals in the calling thread and reports them. Create it
+	/// before starting other threads, which then inherit the mask.
+	explicit signal_descriptor(std::initializer_list<int> signals,
+	                           bool nonblock = true, bool close_on_exec = true);
+
+	signal_descriptor(signal_descriptor &&) = default;
+	signal_descriptor & operator = (signal_descriptor &&) = default;
 
-	virtual int read(char * buffer, std::size_t size)
-		{ return ::read(fd, buffer, size); }
+	static sigset_t make_mask(std::initializer_list<int> signals) noexcept;
+
+	/// Replaces the set of signals reported
+	void set_mask(const sigset_t & mask);
+
+	/// Reads up to count queued signals and returns how many were read;
+	/// 0 means nothing is queued on a nonblocking descriptor.
+	std::size_t read_signals(signalfd_siginfo * info, std::size_t count);
+	std::size_t read_signals(signalfd_siginfo * info, std::size_t count,
+	                         std::error_code & ec) noexcept;
 };
 
 //////////////////////////////////////////////////////////////////////
-class output_descriptor : public virtual descriptor
+/// A socket. Sockets are always created close-on-exec; pass
+/// SOCK_NONBLOCK in type for a nonblocking one.
+class socket_descriptor final
+  : public descriptor
+  , public input_operations<socket_descriptor>
+  , public output_operations<socket_descriptor>
 {
  public:
-	virtual ~output_descriptor() { }
+	socket_descriptor() noexcept : descriptor() { }
+
+	/// Takes ownership of fd
+	explicit socket_descriptor(int fd) noexcept : descriptor(fd) { }
+
+	socket_descriptor(int domain, int type, int protocol = 0);
+
+	socket_descriptor(socket_descriptor &&) = default;
+	socket_descriptor & operator = (socket_descriptor &&) = default;
+
+	/// A connected pair, from socketpair()
+	static std::pair<socket_descriptor, socket_descriptor>
+	pair(int domain = AF_UNIX, int type = SOCK_STREAM, int protocol = 0);
+
+	bool is_open() const noexcept { return (fd >= 0); }
+
+	void bind(const struct sockaddr * addr, socklen_t length);
+	void bind(const struct sockaddr * addr, socklen_t length,
+	          std::error_code & ec) noexcept;
+
+	void listen(int backlog = SOMAXCONN);
+	void listen(int backlog, std::error_code & ec) noexcept;
+
+	/// On a nonblocking socket the error_code form reports
+	/// operation_in_progress; the descriptor becomes writable once the
+	/// connection is made or fails, and error() then tells which.
+	void connect(const struct sockaddr * addr, socklen_t length);
+	void connect(const struct sockaddr * addr, socklen_t length,
+	             std::error_code & ec) noexcept;
+
+	/// Accepts a connection; nonblock applies to the new socket. On a
+	/// nonblocking listener the error_code form returns a closed
+	/// descriptor and reports resource_unavailable_try_again when no
+	/// connection is waiting.
+	socket_descriptor accept(bool nonblock = false);
+	socket_descriptor accept(bool nonblock, std::error_code & ec) noexcept;
+
+	void shutdown(int how = SHUT_RDWR);
+	void shutdown(int how, std::error_code & ec) noexcept;
+
+	void set_option(int level, int name, int value);
+	void set_option(int level, int name, int value,
+	                std::error_code & ec) noexcept;
+
+	/// The pending error (SO_ERROR), which also clears it
+	std::error_code error() const;
 
-	virtual int write(const char * buffer, std::size_t size)
-		{ return ::write(fd, buffer, size); }
+	/// The bound address, e.g. to learn the port picked for port 0
+	socklen_t local_address(struct sockaddr * addr, socklen_t length) const;
+
+	std::size_t send(const void * buffer, std::size_t length, int flags = 0)
+	{
+		std::error_code ec;
+		std::size_t n = send(buffer, length, flags, ec);
+		if (ec) throw make_syserr(ec.value(), "send failed");
+		return n;
+	}
+
+	/// send() with MSG_NOSIGNAL, so a closed peer is EPIPE rather than
+	/// SIGPIPE
+	std::size_t send(const void * buffer, std::size_t length, int flags,
+	                 std::error_code & ec) noexcept
+	{
+		const int d = fd;
+		return detail::retry_io([&]()
+		    { return ::send(d, buffer, length, flags | MSG_NOSIGNAL); }, ec);
+	}
+
+	std::size_t recv(void * buffer, std::size_t length, int flags = 0)
+	{
+		std::error_code ec;
+		std::size_t n = recv(buffer, length, flags, ec);
+		if (ec) throw make_syserr(ec.value(), "recv failed");
+		return n;
+	}
+
+	std::size_t recv(void * buffer, std::size_t length, int flags,
+	                 std::error_code & ec) noexcept
+	{
+		const int d = fd;
+		return detail::retry_io([&]()
+		    { return ::recv(d, buffer, length, flags); }, ec);
+	}
 };
 
 //////////////////////////////////////////////////////////////////////
-class io_descriptor : public input_descriptor
-                    , public output_descriptor
+class inotify_descriptor : public descriptor
 {
  public:
-	virtual ~io_descriptor() { }
+	inotify_descriptor(bool nonblock = true, bool close_on_exec = true);
+
+	int add_watch(const filesystem::path & p, std::uint32_t mask);
+	int add_watch(const filesystem::path & p, std::uint32_t mask,
+	              std::error_code & ec) noexcept;
+
+	void remove_watch(int wd);
+	void remove_watch(int wd, std::error_code & ec) noexcept;
+
+	/// Reads as many queued events as fit into buffer and returns the
+	/// number of bytes read; 0 means nothing is queued on a nonblocking
+	/// descriptor. buffer should be aligned for struct inotify_event and
+	/// hold at least sizeof(inotify_event) + NAME_MAX + 1 bytes.
+	std::size_t read_events(char * buffer, std::size_t length);
+
+	/// Calls f(const inotify_event &) for every event in a buffer filled
+	/// by read_events()
+	template <class F>
+	static void for_each_event(const char * buffer, std::size_t length, F f)
+	{
+		for (std::size_t off = 0; off < length; )
+		{
+			const inotify_event * ev
+			  = reinterpret_cast<const inotify_event *>(buffer + off);
+			f(*ev);
+			off += sizeof(inotify_event) + ev->len;
+		}
+	}
 };
-#endif
 
 } // namespace io
 
@@ -0,0 +1,448 @@
+#include "file_watcher.h"
+
+#include "filesystem/fs_operations.h"
+#include "filesystem/recursive_directory_iterator.h"
+
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace io {
+
+namespace fs = filesystem;
+
+namespace {
+
+constexpr std::uint32_t dir_watch_mask = ( IN_CREATE | IN_DELETE
+                                         | IN_MODIFY | IN_CLOSE_WRITE
+                                         | IN_ATTRIB
+                                         | IN_MOVED_FROM | IN_MOVED_TO
+                                         | IN_DELETE_SELF
+                                         | IN_ONLYDIR | IN_DONT_FOLLOW
+                                         | IN_EXCL_UNLINK );
+
+constexpr std::size_t event_buffer_size = 64 * 1024;
+
+inline bool is_under(const std::string & p, const std::string & dir)
+{
+	return (  (p.size() > dir.size())
+	       && (p.compare(0, dir.size(), dir) == 0)
+	       && (p[dir.size()] == fs::path::preferred_separator) );
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+bool change_set::contains(const filesystem::path & p) const
+{
+	auto i = std::lower_bound(changes.begin(), changes.end(), p,
+	                          [](const change & c, const fs::path & v)
+	                          { return c.path < v; });
+
+	return (i != changes.end() && i->path == p);
+}
+
+//////////////////////////////////////////////////////////////////////
+bool change_set::invalidate(filesystem::directory_entry & e) const
+{
+	const fs::path & p = e.path();
+
+	if (  contains(p)
+	   || (overflowed && (p == root || is_under(p.native(), root.native()))) )
+	{
+		e.invalidate();
+		return true;
+	}
+
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////
+file_watcher::file_watcher(std::chrono::milliseconds debounce,
+                           std::chrono::milliseconds max_latency)
+  : m_inotify(true, true)
+  , m_wakeup(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+  , m_stopped(false)
+  , m_debounce(debounce)
+  , m_max_latency(std::max(debounce, max_latency))
+  , m_watches()
+  , m_dirs()
+  , m_roots()
+{
+	if (m_wakeup < 0) throw make_syserr("Could not create wakeup eventfd");
+}
+
+//////////////////////////////////////////////////////////////////////
+file_watcher::~file_watcher()
+{
+	::close(m_wakeup);
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::watch(const filesystem::path & root, callback_t callback)
+{
+	if (! fs::is_directory(root))
+		throw fs::filesystem_error("Watch root is not a directory", root,
+		                  std::make_error_code(std::errc::not_a_directory));
+
+	root_state s;
+	s.root = root;
+	s.callback = std::move(callback);
+	s.overflowed = false;
+	s.active = true;
+
+	m_roots.push_back(std::move(s));
+	add_tree(m_roots.size() - 1, root, false);
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::unwatch(const filesystem::path & root)
+{
+	for (std::size_t r = 0; r < m_roots.size(); ++r)
+	{
+		if (! m_roots[r].active || m_roots[r].root != root)
+			continue;
+
+		for (auto i = m_watches.begin(); i != m_watches.end(); )
+		{
+			if (i->second.root == r)
+			{
+				std::error_code ec;
+				m_inotify.remove_watch(i->first, ec);
+				m_dirs.erase(i->second.dir.native());
+				i = m_watches.erase(i);
+			} else
+				++i;
+		}
+
+		m_roots[r].active = false;
+		m_roots[r].pending.clear();
+		m_roots[r].callback = nullptr;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::add_dir(std::size_t r, const filesystem::path & dir)
+{
+	std::error_code ec;
+	int wd = m_inotify.add_watch(dir, dir_watch_mask, ec);
+
+	// directories that vanish or turn out not to be directories between
+	// the scan and the watch simply aren't watched
+	if (ec)
+	{
+		if (  ec == std::errc::no_such_file_or_directory
+		   || ec == std::errc::not_a_directory
+		   || ec == std::errc::permission_denied )
+			return;
+
+		throw make_syserr(ec.value(), "Could not watch " + dir.native());
+	}
+
+	m_watches[wd] = watched_dir{ r, dir };
+	m_dirs[dir.native()] = wd;
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::add_tree(std::size_t r, const filesystem::path & dir,
+                            bool report)
+{
+	std::error_code ec;
+
+	add_dir(r, dir);
+
+	fs::recursive_directory_iterator i(dir, ec), end;
+	for ( ; ! ec && i != end; i.increment(ec))
+	{
+		std::error_code sec;
+		if (fs::is_directory(i->symlink_status(sec)))
+			add_dir(r, i->path());
+
+		// anything found below a directory that appeared after the
+		// initial scan was created too recently to have had an event
+		if (report)
+			record(r, i->path(), change_type::created);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::drop_tree(const filesystem::path & dir)
+{
+	const std::string & d = dir.native();
+
+	for (auto i = m_dirs.begin(); i != m_dirs.end(); )
+	{
+		if (i->first == d || is_under(i->first, d))
+		{
+			std::error_code ec;
+			m_inotify.remove_watch(i->second, ec);
+			m_watches.erase(i->second);
+			i = m_dirs.erase(i);
+		} else
+			++i;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::record(std::size_t r, const filesystem::path & p,
+                          change_type t)
+{
+	root_state & s = m_roots[r];
+	const clock::time_point now = clock::now();
+
+	if (s.pending.empty() && ! s.overflowed)
+		s.first_event = now;
+	s.last_event = now;
+
+	auto i = s.pending.find(p.native());
+
+	if (i == s.pending.end())
+	{
+		s.pending.emplace(p.native(), t);
+	} else if (  (t == change_type::removed)
+	          && ((i->second & change_type::created) != change_type::none) )
+	{
+		s.pending.erase(i); // transient; never observable to the consumer
+	} else if (  (t == change_type::created)
+	          && ((i->second & change_type::removed) != change_type::none) )
+	{
+		i->second = change_type::modified; // replaced
+	} else
+		i->second |= t;
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::handle_event(const inotify_event & ev)
+{
+	if (ev.mask & IN_Q_OVERFLOW)
+	{
+		rescan();
+		return;
+	}
+
+	auto w = m_watches.find(ev.wd);
+	if (w == m_watches.end())
+		return;
+
+	if (ev.mask & IN_IGNORED)
+	{
+		m_dirs.erase(w->second.dir.native());
+		m_watches.erase(w);
+		return;
+	}
+
+	const std::size_t r = w->second.root;
+	fs::path p = w->second.dir;
+
+	if (ev.len > 0)
+		p /= ev.name;
+
+	if (ev.mask & (IN_CREATE | IN_MOVED_TO))
+	{
+		record(r, p, change_type::created);
+		if (ev.mask & IN_ISDIR)
+			add_tree(r, p, true);
+	}
+
+	if (ev.mask & (IN_DELETE | IN_MOVED_FROM))
+	{
+		record(r, p, change_type::removed);
+		if ((ev.mask & IN_ISDIR) && (ev.mask & IN_MOVED_FROM))
+			drop_tree(p);
+	}
+
+	if (ev.mask & (IN_MODIFY | IN_CLOSE_WRITE))
+		record(r, p, change_type::modified);
+
+	if (ev.mask & IN_ATTRIB)
+		record(r, p, change_type::attributes);
+
+	if ((ev.mask & IN_DELETE_SELF) && p == m_roots[r].root)
+		record(r, p, change_type::removed);
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Events were lost, so whatever is pending is incomplete: each root is
+/// walked again to pick up directories that appeared unseen, and its
+/// next batch carries a rescan entry for the root itself.
+void file_watcher::rescan()
+{
+	for (std::size_t r = 0; r < m_roots.size(); ++r)
+	{
+		root_state & s = m_roots[r];
+
+		if (! s.active)
+			continue;
+
+		add_tree(r, s.root, false);
+
+		if (s.pending.empty() && ! s.overflowed)
+			s.first_event = clock::now();
+		s.last_event = clock::now();
+		s.overflowed = true;
+		s.pending[s.root.native()] |= change_type::rescan;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::drain()
+{
+	alignas(inotify_event) char buffer[event_buffer_size];
+	std::size_t n = 0;
+
+	while ((n = m_inotify.read_events(buffer, sizeof(buffer))) > 0)
+	{
+		inotify_descriptor::for_each_event(buffer, n,
+		    [this](const inotify_event & ev) { handle_event(ev); });
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+bool file_watcher::due(const root_state & s, clock::time_point now) const
+{
+	return (  (! s.pending.empty() || s.overflowed)
+	       && (  (now - s.last_event >= m_debounce)
+	          || (now - s.first_event >= m_max_latency) ) );
+}
+
+//////////////////////////////////////////////////////////////////////
+/// The batch held for s, which is left with nothing pending
+change_set file_watcher::take(root_state & s)
+{
+	change_set cs;
+	cs.root = s.root;
+	cs.overflowed = s.overflowed;
+	cs.changes.reserve(s.pending.size());
+
+	for (const auto & p : s.pending)
+		cs.changes.push_back(change{ fs::path(p.first), p.second });
+
+	std::sort(cs.changes.begin(), cs.changes.end(),
+	          [](const change & a, const change & b)
+	          { return a.path < b.path; });
+
+	s.pending.clear();
+	s.overflowed = false;
+
+	return cs;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Runs the callbacks for batches taken from roots, given by index. A
+/// callback may watch() or unwatch(), which can move m_roots or clear a
+/// callback, so each root is looked up again and a copy of its callback
+/// is what runs.
+std::size_t file_watcher::deliver(
+    std::vector<std::pair<std::size_t, change_set>> & batches)
+{
+	std::size_t delivered = 0;
+
+	for (auto & b : batches)
+	{
+		if (! m_roots[b.first].active || ! m_roots[b.first].callback)
+			continue;
+
+		callback_t callback = m_roots[b.first].callback;
+		callback(b.second);
+		++delivered;
+	}
+
+	return delivered;
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t file_watcher::poll(std::chrono::milliseconds timeout)
+{
+	using std::chrono::duration_cast;
+	using std::chrono::milliseconds;
+
+	clock::time_point now = clock::now();
+	milliseconds wait = timeout;
+
+	for (const auto & s : m_roots)
+	{
+		if (s.active && (! s.pending.empty() || s.overflowed))
+		{
+			clock::time_point deadline
+			  = std::min(s.last_event + m_debounce,
+			             s.first_event + m_max_latency);
+			milliseconds left = (deadline > now)
+			  ? duration_cast<milliseconds>(deadline - now) + milliseconds(1)
+			  : milliseconds(0);
+
+			if (wait.count() < 0 || left < wait)
+				wait = left;
+		}
+	}
+
+	struct pollfd fds[2] = {
+		{ m_inotify.native_handle(), POLLIN, 0 },
+		{ m_wakeup, POLLIN, 0 },
+	};
+
+	int timeout_ms = (wait.count() < 0) ? -1
+	               : static_cast<int>(std::min<long long>(wait.count(),
+	                                                      INT_MAX));
+	int rc = ::poll(fds, 2, timeout_ms);
+
+	if (rc < 0 && errno != EINTR)
+		throw make_syserr("file_watcher poll failed");
+
+	if (rc > 0 && (fds[1].revents & POLLIN))
+	{
+		std::uint64_t v;
+		while (::read(m_wakeup, &v, sizeof(v)) > 0) { }
+	}
+
+	if (rc > 0 && (fds[0].revents & POLLIN))
+		drain();
+
+	std::vector<std::pair<std::size_t, change_set>> batches;
+	now = clock::now();
+
+	for (std::size_t r = 0; r < m_roots.size(); ++r)
+		if (m_roots[r].active && due(m_roots[r], now))
+			batches.emplace_back(r, take(m_roots[r]));
+
+	return deliver(batches);
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t file_watcher::flush()
+{
+	std::vector<std::pair<std::size_t, change_set>> batches;
+
+	drain();
+
+	for (std::size_t r = 0; r < m_roots.size(); ++r)
+	{
+		root_state & s = m_roots[r];
+
+		if (s.active && (! s.pending.empty() || s.overflowed))
+			batches.emplace_back(r, take(s));
+	}
+
+	return deliver(batches);
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::run()
+{
+	// clears the request on the way out, so run() can be called again
+	while (! m_stopped.exchange(false))
+		poll(std::chrono::milliseconds(-1));
+}
+
+//////////////////////////////////////////////////////////////////////
+void file_watcher::stop() noexcept
+{
+	const std::uint64_t one = 1;
+
+	m_stopped = true;
+	if (::write(m_wakeup, &one, sizeof(one)) < 0) { }
+}
+
+} // namespace io
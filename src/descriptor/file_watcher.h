@@ -0,0 +1,155 @@
+#ifndef GUARD_FILE_WATCHER_H
+#define GUARD_FILE_WATCHER_H 1
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "descriptor.h"
+#include "filesystem/directory_entry.h"
+#include "filesystem/path.h"
+#include "utility/bitmask_operators.h"
+
+namespace io {
+
+//////////////////////////////////////////////////////////////////////
+enum class change_type
+{
+	none       = 0,
+	created    = (1 << 0),
+	modified   = (1 << 1),
+	removed    = (1 << 2),
+	attributes = (1 << 3),
+
+	// the event queue overflowed; anything under the path may have
+	// changed and consumers should resynchronize it
+	rescan     = (1 << 4),
+};
+
+DEFINE_BITMASK_OPERATORS(change_type, unsigned int);
+
+struct change
+{
+	filesystem::path path;
+	change_type type;
+};
+
+/// A batch of coalesced changes under one watched root, sorted by path.
+/// Each path appears at most once, with the union of what happened to
+/// it during the batch, except that something created and removed again
+/// within a batch is dropped entirely.
+struct change_set
+{
+	filesystem::path root;
+	std::vector<change> changes;
+	bool overflowed;
+
+	bool contains(const filesystem::path & p) const;
+
+	/// Drops the cached metadata of e if this batch may have changed it,
+	/// i.e. it names e's path or it overflowed and e is under root.
+	/// Returns true when e was invalidated.
+	bool invalidate(filesystem::directory_entry & e) const;
+};
+
+//////////////////////////////////////////////////////////////////////
+/// file_watcher watches directory trees through a single inotify
+/// descriptor and delivers debounced change_sets to per-root callbacks.
+///
+/// Watches are placed on every directory below a root (found with
+/// recursive_directory_iterator) and follow directories as they are
+/// created, moved in or moved away. When the kernel queue overflows,
+/// every root is rescanned and its next change_set is flagged as
+/// overflowed.
+///
+/// Events for a root are held until it has been quiet for the debounce
+/// interval, or until max_latency has passed since the first held
+/// event, and are then delivered as one batch. Nothing runs while the
+/// trees are idle: poll() blocks in the kernel until an event arrives.
+///
+/// Roots must not overlap. A file_watcher is not synchronized; only
+/// stop() may be called from another thread. Callbacks may call watch()
+/// and unwatch(), including on their own root; a batch for a root that
+/// is unwatched before its callback runs is dropped.
+class file_watcher
+{
+ public:
+	typedef std::chrono::steady_clock clock;
+	typedef std::function<void (const change_set &)> callback_t;
+
+	explicit file_watcher(
+	    std::chrono::milliseconds debounce = std::chrono::milliseconds(50),
+	    std::chrono::milliseconds max_latency = std::chrono::seconds(1));
+
+	file_watcher(const file_watcher &) = delete;
+	file_watcher & operator = (const file_watcher &) = delete;
+
+	~file_watcher();
+
+	void watch(const filesystem::path & root, callback_t callback);
+	void unwatch(const filesystem::path & root);
+
+	/// Waits up to timeout (forever when negative) for events, then
+	/// delivers every batch whose debounce interval has expired. Returns
+	/// the number of change_sets delivered.
+	std::size_t poll(std::chrono::milliseconds timeout);
+
+	/// Calls poll() until stop() is called
+	void run();
+	void stop() noexcept;
+
+	/// Delivers every held batch immediately
+	std::size_t flush();
+
+	std::size_t watch_count() const noexcept { return m_watches.size(); }
+
+	int native_handle() const noexcept { return m_inotify.native_handle(); }
+
+ private:
+	struct watched_dir
+	{
+		std::size_t root;
+		filesystem::path dir;
+	};
+
+	struct root_state
+	{
+		filesystem::path root;
+		callback_t callback;
+		std::unordered_map<std::string, change_type> pending;
+		clock::time_point first_event;
+		clock::time_point last_event;
+		bool overflowed;
+		bool active;
+	};
+
+	void add_tree(std::size_t r, const filesystem::path & dir, bool report);
+	void add_dir(std::size_t r, const filesystem::path & dir);
+	void drop_tree(const filesystem::path & dir);
+	void drain();
+	void handle_event(const inotify_event & ev);
+	void rescan();
+	void record(std::size_t r, const filesystem::path & p, change_type t);
+	bool due(const root_state & s, clock::time_point now) const;
+	change_set take(root_state & s);
+	std::size_t deliver(std::vector<std::pair<std::size_t, change_set>> &
+	                    batches);
+
+	inotify_descriptor m_inotify;
+	int m_wakeup;
+	std::atomic<bool> m_stopped;
+	std::chrono::milliseconds m_debounce;
+	std::chrono::milliseconds m_max_latency;
+	std::unordered_map<int, watched_dir> m_watches;
+	std::unordered_map<std::string, int> m_dirs;
+	std::vector<root_state> m_roots;
+};
+
+} // namespace io
+
+#endif // GUARD_FILE_WATCHER_H
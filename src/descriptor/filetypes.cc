@@ -3,6 +3,7 @@
 #include <sys/timerfd.h>
 #include <sys/epoll.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
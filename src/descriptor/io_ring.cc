@@ -0,0 +1,707 @@
+#include "io_ring.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+namespace io {
+
+namespace {
+
+inline int io_uring_setup(unsigned entries, struct io_uring_params * p)
+	{ return static_cast<int>(syscall(SYS_io_uring_setup, entries, p)); }
+
+inline int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                          unsigned flags)
+{
+	return static_cast<int>(syscall(SYS_io_uring_enter, fd, to_submit,
+	                                min_complete, flags, nullptr, 0));
+}
+
+inline int io_uring_register(int fd, unsigned opcode, const void * arg,
+                             unsigned nr_args)
+{
+	return static_cast<int>(syscall(SYS_io_uring_register, fd, opcode, arg,
+	                                nr_args));
+}
+
+inline unsigned load_acquire(const unsigned * p) noexcept
+	{ return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+inline void store_release(unsigned * p, unsigned v) noexcept
+	{ __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+template <typename T>
+inline T * at_offset(void * base, std::uint32_t off) noexcept
+	{ return reinterpret_cast<T *>(static_cast<char *>(base) + off); }
+
+inline int result_of(long rc) noexcept
+	{ return (rc < 0) ? -errno : static_cast<int>(rc); }
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+io_ring::io_ring(unsigned entries, bool force_fallback,
+                 unsigned fallback_threads)
+  : m_ring_fd(-1)
+  , m_sq_map(MAP_FAILED)
+  , m_sq_map_size(0)
+  , m_cq_map(MAP_FAILED)
+  , m_cq_map_size(0)
+  , m_sqes(nullptr)
+  , m_sqes_size(0)
+  , m_sq_head(nullptr)
+  , m_sq_tail(nullptr)
+  , m_sq_mask(0)
+  , m_sq_entries(0)
+  , m_sq_array(nullptr)
+  , m_cq_head(nullptr)
+  , m_cq_tail(nullptr)
+  , m_cq_mask(0)
+  , m_cq_entries(0)
+  , m_cqes(nullptr)
+  , m_to_submit(0)
+  , m_in_flight(0)
+  , m_stopping(false)
+{
+	if (! force_fallback)
+		setup_ring(std::max(entries, 1u));
+
+	if (m_ring_fd < 0)
+		start_fallback(std::max(fallback_threads, 1u));
+}
+
+//////////////////////////////////////////////////////////////////////
+io_ring::~io_ring()
+{
+	try {
+		while (m_in_flight > 0)
+			wait(static_cast<unsigned>(m_in_flight));
+	} catch (...) {
+		// nothing sensible to do; the kernel still owns the buffers, but
+		// the ring's teardown below cancels what is left
+	}
+
+	stop_fallback();
+	unmap_ring();
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Unmaps whatever of the rings is mapped and closes the ring, leaving
+/// the io_ring as if io_uring had never been set up
+void io_ring::unmap_ring() noexcept
+{
+	if (m_sqes) munmap(m_sqes, m_sqes_size);
+	if (m_cq_map != MAP_FAILED && m_cq_map != m_sq_map)
+		munmap(m_cq_map, m_cq_map_size);
+	if (m_sq_map != MAP_FAILED) munmap(m_sq_map, m_sq_map_size);
+	if (m_ring_fd >= 0) ::close(m_ring_fd);
+
+	m_ring_fd = -1;
+	m_sq_map = MAP_FAILED;
+	m_cq_map = MAP_FAILED;
+	m_sqes = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::setup_ring(unsigned entries)
+{
+	struct io_uring_params p;
+	std::memset(&p, 0, sizeof(p));
+
+	int fd = io_uring_setup(entries, &p);
+	if (fd < 0)
+	{
+		if (errno == ENOSYS || errno == EPERM)
+			return;
+		throw make_syserr("Could not set up io_uring");
+	}
+
+	m_ring_fd = fd;
+	m_sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	m_cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+	// recent kernels put both rings in one mapping
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		m_sq_map_size = m_cq_map_size
+		  = std::max(m_sq_map_size, m_cq_map_size);
+
+	// a throw from here leaves the constructor without running the
+	// destructor, so what's been set up is undone before each one
+	m_sq_map = mmap(nullptr, m_sq_map_size, PROT_READ | PROT_WRITE,
+	                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (m_sq_map == MAP_FAILED)
+	{
+		const int err = errno;
+		unmap_ring();
+		throw make_syserr(err, "Could not map io_uring submission ring");
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		m_cq_map = m_sq_map;
+	else
+	{
+		m_cq_map = mmap(nullptr, m_cq_map_size, PROT_READ | PROT_WRITE,
+		                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (m_cq_map == MAP_FAILED)
+		{
+			const int err = errno;
+			unmap_ring();
+			throw make_syserr(err,
+			                  "Could not map io_uring completion ring");
+		}
+	}
+
+	m_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+	void * sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE,
+	                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+	{
+		const int err = errno;
+		unmap_ring();
+		throw make_syserr(err, "Could not map io_uring submission entries");
+	}
+	m_sqes = static_cast<io_uring_sqe *>(sqes);
+
+	m_sq_head = at_offset<unsigned>(m_sq_map, p.sq_off.head);
+	m_sq_tail = at_offset<unsigned>(m_sq_map, p.sq_off.tail);
+	m_sq_mask = *at_offset<unsigned>(m_sq_map, p.sq_off.ring_mask);
+	m_sq_entries = p.sq_entries;
+	m_sq_array = at_offset<unsigned>(m_sq_map, p.sq_off.array);
+
+	m_cq_head = at_offset<unsigned>(m_cq_map, p.cq_off.head);
+	m_cq_tail = at_offset<unsigned>(m_cq_map, p.cq_off.tail);
+	m_cq_mask = *at_offset<unsigned>(m_cq_map, p.cq_off.ring_mask);
+	m_cq_entries = p.cq_entries;
+	m_cqes = at_offset<io_uring_cqe>(m_cq_map, p.cq_off.cqes);
+}
+
+//////////////////////////////////////////////////////////////////////
+int io_ring::enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	for (;;)
+	{
+		int rc = io_uring_enter(m_ring_fd, to_submit, min_complete, flags);
+		if (rc >= 0)
+			return rc;
+
+		if (errno == EINTR)
+			continue;
+
+		// completions are backed up; the caller reaps and tries again
+		if (errno == EBUSY || errno == EAGAIN)
+			return 0;
+
+		throw make_syserr("io_uring_enter failed");
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Claims the next submission entry, pushing queued ones to the kernel
+/// first when the ring is full
+::io_uring_sqe * io_ring::next_sqe()
+{
+	unsigned tail = *m_sq_tail;
+
+	while (tail - load_acquire(m_sq_head) >= m_sq_entries)
+	{
+		if (submit() == 0)
+			reap();
+	}
+
+	io_uring_sqe * sqe = &m_sqes[tail & m_sq_mask];
+	std::memset(sqe, 0, sizeof(*sqe));
+
+	m_sq_array[tail & m_sq_mask] = tail & m_sq_mask;
+	store_release(m_sq_tail, tail + 1);
+	++m_to_submit;
+
+	return sqe;
+}
+
+//////////////////////////////////////////////////////////////////////
+unsigned io_ring::reap()
+{
+	unsigned n = 0;
+
+	// the head is read afresh for each entry: a callback can poll() or
+	// wait(), or queue enough to make submission wait, and so reap the
+	// entries after its own before this loop gets to them
+	for (;;)
+	{
+		const unsigned head = *m_cq_head;
+
+		if (head == load_acquire(m_cq_tail))
+			break;
+
+		const io_uring_cqe & cqe = m_cqes[head & m_cq_mask];
+		const std::uint32_t slot = static_cast<std::uint32_t>(cqe.user_data);
+		const int res = cqe.res;
+
+		// release the entry before the callback, which may queue more
+		store_release(m_cq_head, head + 1);
+		complete(slot, res);
+		++n;
+	}
+
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Takes a slot for a new operation. The number in flight is kept below
+/// the completion ring's size, so the kernel never has to hold back
+/// completions for lack of room.
+std::uint32_t io_ring::allocate_slot(completion_t && cb)
+{
+	if (m_ring_fd >= 0)
+	{
+		while (m_in_flight >= m_cq_entries)
+			wait(1);
+	}
+
+	std::uint32_t slot;
+
+	if (m_free_slots.empty())
+	{
+		slot = static_cast<std::uint32_t>(m_ops.size());
+		m_ops.emplace_back();
+	} else
+	{
+		slot = m_free_slots.back();
+		m_free_slots.pop_back();
+	}
+
+	m_ops[slot].callback = std::move(cb);
+	++m_in_flight;
+	return slot;
+}
+
+std::uint32_t io_ring::allocate_slot(completion_t && cb,
+                                     const filesystem::path & p)
+{
+	std::uint32_t slot = allocate_slot(std::move(cb));
+	m_ops[slot].path = p.native();
+	return slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::complete(std::uint32_t slot, int result)
+{
+	completion_t cb = std::move(m_ops[slot].callback);
+	m_ops[slot].callback = nullptr;
+	m_ops[slot].path.clear();
+	m_free_slots.push_back(slot);
+	--m_in_flight;
+
+	if (cb) cb(result);
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::read(ring_file f, void * buffer, std::size_t length,
+                   off_t offset, completion_t cb)
+{
+	std::uint32_t slot = allocate_slot(std::move(cb));
+
+	if (m_ring_fd < 0)
+	{
+		int fd = fallback_fd(f);
+		queue_task(slot, [=]()
+		    { return result_of(::pread(fd, buffer, length, offset)); });
+		return;
+	}
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = f.fd();
+	sqe->flags = f.is_fixed() ? IOSQE_FIXED_FILE : 0;
+	sqe->addr = reinterpret_cast<std::uintptr_t>(buffer);
+	sqe->len = static_cast<std::uint32_t>(length);
+	sqe->off = static_cast<std::uint64_t>(offset);
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::write(ring_file f, const void * buffer, std::size_t length,
+                    off_t offset, completion_t cb)
+{
+	std::uint32_t slot = allocate_slot(std::move(cb));
+
+	if (m_ring_fd < 0)
+	{
+		int fd = fallback_fd(f);
+		queue_task(slot, [=]()
+		    { return result_of(::pwrite(fd, buffer, length, offset)); });
+		return;
+	}
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = f.fd();
+	sqe->flags = f.is_fixed() ? IOSQE_FIXED_FILE : 0;
+	sqe->addr = reinterpret_cast<std::uintptr_t>(buffer);
+	sqe->len = static_cast<std::uint32_t>(length);
+	sqe->off = static_cast<std::uint64_t>(offset);
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::read_fixed(ring_file f, void * buffer, std::size_t length,
+                         off_t offset, unsigned buffer_index, completion_t cb)
+{
+	if (m_ring_fd < 0)
+		return read(f, buffer, length, offset, std::move(cb));
+
+	std::uint32_t slot = allocate_slot(std::move(cb));
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_READ_FIXED;
+	sqe->fd = f.fd();
+	sqe->flags = f.is_fixed() ? IOSQE_FIXED_FILE : 0;
+	sqe->addr = reinterpret_cast<std::uintptr_t>(buffer);
+	sqe->len = static_cast<std::uint32_t>(length);
+	sqe->off = static_cast<std::uint64_t>(offset);
+	sqe->buf_index = static_cast<std::uint16_t>(buffer_index);
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::write_fixed(ring_file f, const void * buffer, std::size_t length,
+                          off_t offset, unsigned buffer_index, completion_t cb)
+{
+	if (m_ring_fd < 0)
+		return write(f, buffer, length, offset, std::move(cb));
+
+	std::uint32_t slot = allocate_slot(std::move(cb));
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_WRITE_FIXED;
+	sqe->fd = f.fd();
+	sqe->flags = f.is_fixed() ? IOSQE_FIXED_FILE : 0;
+	sqe->addr = reinterpret_cast<std::uintptr_t>(buffer);
+	sqe->len = static_cast<std::uint32_t>(length);
+	sqe->off = static_cast<std::uint64_t>(offset);
+	sqe->buf_index = static_cast<std::uint16_t>(buffer_index);
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::fsync(ring_file f, bool data_only, completion_t cb)
+{
+	std::uint32_t slot = allocate_slot(std::move(cb));
+
+	if (m_ring_fd < 0)
+	{
+		int fd = fallback_fd(f);
+		queue_task(slot, [=]()
+		    { return result_of(data_only ? ::fdatasync(fd) : ::fsync(fd)); });
+		return;
+	}
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_FSYNC;
+	sqe->fd = f.fd();
+	sqe->flags = f.is_fixed() ? IOSQE_FIXED_FILE : 0;
+	sqe->fsync_flags = data_only ? IORING_FSYNC_DATASYNC : 0;
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::openat(ring_file dir, const filesystem::path & p, int flags,
+                     mode_t mode, completion_t cb)
+{
+	std::uint32_t slot = allocate_slot(std::move(cb), p);
+	const char * name = m_ops[slot].path.c_str();
+
+	if (m_ring_fd < 0)
+	{
+		int fd = fallback_fd(dir);
+		queue_task(slot, [=]()
+		    { return result_of(::openat(fd, name, flags, mode)); });
+		return;
+	}
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = dir.fd();
+	sqe->addr = reinterpret_cast<std::uintptr_t>(name);
+	sqe->len = mode;
+	sqe->open_flags = static_cast<std::uint32_t>(flags);
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::statx(ring_file dir, const filesystem::path & p, int flags,
+                    unsigned int mask, struct statx * result, completion_t cb)
+{
+	std::uint32_t slot = allocate_slot(std::move(cb), p);
+	const char * name = m_ops[slot].path.c_str();
+
+	if (m_ring_fd < 0)
+	{
+		int fd = fallback_fd(dir);
+		queue_task(slot, [=]()
+		    { return result_of(::statx(fd, name, flags, mask, result)); });
+		return;
+	}
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_STATX;
+	sqe->fd = dir.fd();
+	sqe->addr = reinterpret_cast<std::uintptr_t>(name);
+	sqe->len = mask;
+	sqe->off = reinterpret_cast<std::uintptr_t>(result);
+	sqe->statx_flags = static_cast<std::uint32_t>(flags);
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::splice(ring_file in, off_t in_offset, ring_file out,
+                     off_t out_offset, std::size_t length, unsigned int flags,
+                     completion_t cb)
+{
+	std::uint32_t slot = allocate_slot(std::move(cb));
+
+	if (m_ring_fd < 0)
+	{
+		int in_fd = fallback_fd(in);
+		int out_fd = fallback_fd(out);
+
+		queue_task(slot, [=]() {
+			loff_t in_off = in_offset;
+			loff_t out_off = out_offset;
+			return result_of(::splice(in_fd, (in_offset < 0) ? nullptr
+			                                                 : &in_off,
+			                          out_fd, (out_offset < 0) ? nullptr
+			                                                   : &out_off,
+			                          length, flags));
+		});
+		return;
+	}
+
+	io_uring_sqe * sqe = next_sqe();
+	sqe->opcode = IORING_OP_SPLICE;
+	sqe->fd = out.fd();
+	sqe->flags = out.is_fixed() ? IOSQE_FIXED_FILE : 0;
+	sqe->off = static_cast<std::uint64_t>(out_offset);
+	sqe->splice_fd_in = in.fd();
+	sqe->splice_off_in = static_cast<std::uint64_t>(in_offset);
+	sqe->len = static_cast<std::uint32_t>(length);
+	sqe->splice_flags = flags | (in.is_fixed() ? SPLICE_F_FD_IN_FIXED : 0);
+	sqe->user_data = slot;
+}
+
+//////////////////////////////////////////////////////////////////////
+std::future<int> io_ring::read(ring_file f, void * buffer, std::size_t length,
+                               off_t offset)
+{
+	auto p = std::make_shared<std::promise<int>>();
+	read(f, buffer, length, offset, [p](int r) { p->set_value(r); });
+	return p->get_future();
+}
+
+std::future<int> io_ring::write(ring_file f, const void * buffer,
+                                std::size_t length, off_t offset)
+{
+	auto p = std::make_shared<std::promise<int>>();
+	write(f, buffer, length, offset, [p](int r) { p->set_value(r); });
+	return p->get_future();
+}
+
+std::future<int> io_ring::fsync(ring_file f, bool data_only)
+{
+	auto p = std::make_shared<std::promise<int>>();
+	fsync(f, data_only, [p](int r) { p->set_value(r); });
+	return p->get_future();
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::register_buffers(const struct iovec * iov, unsigned count)
+{
+	if (m_ring_fd < 0)
+		return;
+
+	unregister_buffers();
+
+	if (io_uring_register(m_ring_fd, IORING_REGISTER_BUFFERS, iov, count) < 0)
+		throw make_syserr("Could not register io_uring buffers");
+}
+
+void io_ring::unregister_buffers()
+{
+	if (m_ring_fd < 0)
+		return;
+
+	if (  io_uring_register(m_ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0)
+	      < 0
+	   && errno != ENXIO )
+		throw make_syserr("Could not unregister io_uring buffers");
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::register_files(const int * fds, unsigned count)
+{
+	if (m_ring_fd < 0)
+	{
+		m_fixed_files.assign(fds, fds + count);
+		return;
+	}
+
+	unregister_files();
+
+	if (io_uring_register(m_ring_fd, IORING_REGISTER_FILES, fds, count) < 0)
+		throw make_syserr("Could not register io_uring files");
+}
+
+void io_ring::unregister_files()
+{
+	if (m_ring_fd < 0)
+	{
+		m_fixed_files.clear();
+		return;
+	}
+
+	if (  io_uring_register(m_ring_fd, IORING_UNREGISTER_FILES, nullptr, 0)
+	      < 0
+	   && errno != ENXIO )
+		throw make_syserr("Could not unregister io_uring files");
+}
+
+//////////////////////////////////////////////////////////////////////
+unsigned io_ring::submit()
+{
+	if (m_ring_fd < 0 || m_to_submit == 0)
+		return 0;
+
+	unsigned n = static_cast<unsigned>(enter(m_to_submit, 0, 0));
+	m_to_submit -= n;
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+unsigned io_ring::poll()
+{
+	if (m_ring_fd < 0)
+		return drain_fallback(0);
+
+	submit();
+	return reap();
+}
+
+//////////////////////////////////////////////////////////////////////
+unsigned io_ring::wait(unsigned min_complete)
+{
+	min_complete = std::min<std::size_t>(min_complete, m_in_flight);
+
+	if (m_ring_fd < 0)
+		return drain_fallback(min_complete);
+
+	unsigned n = reap();
+
+	while (n < min_complete)
+	{
+		unsigned submitted = static_cast<unsigned>(
+		    enter(m_to_submit, min_complete - n, IORING_ENTER_GETEVENTS));
+		m_to_submit -= submitted;
+		n += reap();
+	}
+
+	submit();
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::start_fallback(unsigned threads)
+{
+	m_threads.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i)
+		m_threads.emplace_back(&io_ring::fallback_worker, this);
+}
+
+void io_ring::stop_fallback()
+{
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		m_stopping = true;
+	}
+	m_task_ready.notify_all();
+
+	for (auto & t : m_threads)
+		t.join();
+	m_threads.clear();
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::fallback_worker()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+
+	for (;;)
+	{
+		m_task_ready.wait(lk, [this] { return m_stopping || ! m_tasks.empty(); });
+
+		if (m_tasks.empty())
+			return;
+
+		fallback_task t = std::move(m_tasks.front());
+		m_tasks.pop_front();
+
+		lk.unlock();
+		const int result = t.call();
+		lk.lock();
+
+		m_done.emplace_back(t.slot, result);
+		m_task_done.notify_one();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+void io_ring::queue_task(std::uint32_t slot, std::function<int ()> call)
+{
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		m_tasks.push_back(fallback_task{ slot, std::move(call) });
+	}
+	m_task_ready.notify_one();
+}
+
+//////////////////////////////////////////////////////////////////////
+unsigned io_ring::drain_fallback(unsigned min_complete)
+{
+	std::vector<std::pair<std::uint32_t, int>> done;
+	unsigned n = 0;
+
+	do {
+		{
+			std::unique_lock<std::mutex> lk(m_mutex);
+			m_task_done.wait(lk, [&] { return n + m_done.size() >= min_complete; });
+			done.swap(m_done);
+		}
+
+		for (const auto & d : done)
+			complete(d.first, d.second);
+
+		n += static_cast<unsigned>(done.size());
+		done.clear();
+	} while (n < min_complete);
+
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+int io_ring::fallback_fd(ring_file f) const noexcept
+{
+	if (! f.is_fixed())
+		return f.fd();
+
+	const std::size_t i = static_cast<std::size_t>(f.fd());
+	return (i < m_fixed_files.size()) ? m_fixed_files[i] : -1;
+}
+
+} // namespace io
@@ -0,0 +1,229 @@
+#ifndef GUARD_IO_RING_H
+#define GUARD_IO_RING_H 1
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "descriptor.h"
+#include "filesystem/path.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace io {
+
+//////////////////////////////////////////////////////////////////////
+/// The file an io_ring operation works on: either an open descriptor or
+/// a slot in the ring's registered file table (see register_files()).
+class ring_file
+{
+ public:
+	ring_file(const descriptor & d) noexcept
+	  : m_fd(d.native_handle()), m_fixed(false) { }
+
+	static ring_file fixed(unsigned index) noexcept
+		{ return ring_file(static_cast<int>(index), true); }
+
+	/// A plain descriptor number, e.g. AT_FDCWD for openat()/statx()
+	static ring_file raw(int fd) noexcept
+		{ return ring_file(fd, false); }
+
+	int fd() const noexcept { return m_fd; }
+	bool is_fixed() const noexcept { return m_fixed; }
+
+ private:
+	ring_file(int fd, bool fixed) noexcept : m_fd(fd), m_fixed(fixed) { }
+
+	int m_fd;
+	bool m_fixed;
+};
+
+//////////////////////////////////////////////////////////////////////
+/// io_ring batches asynchronous file and socket operations through a
+/// Linux io_uring, set up with the raw system calls.
+///
+/// Operations are queued by the submission calls and handed to the
+/// kernel together by submit(), or implicitly by poll()/wait() and when
+/// the queue fills up. Each completes with the system call's result:
+/// a byte count or descriptor on success, -errno on failure.
+/// Completions are only ever delivered inside poll() and wait(), on the
+/// calling thread; that goes for futures too, which become ready once
+/// poll() or wait() has seen their operation finish.
+///
+/// Where io_uring is missing (ENOSYS) or disabled by the administrator
+/// (EPERM), the same interface runs on a small thread pool issuing the
+/// equivalent blocking calls; uses_io_uring() tells which is in use.
+///
+/// Buffers, descriptors and paths handed to an operation must stay
+/// valid until it completes. An io_ring is not synchronized; use one
+/// per thread.
+class io_ring
+{
+ public:
+	typedef std::function<void (int result)> completion_t;
+
+	explicit io_ring(unsigned entries = 256, bool force_fallback = false,
+	                 unsigned fallback_threads = 4);
+
+	io_ring(const io_ring &) = delete;
+	io_ring & operator = (const io_ring &) = delete;
+
+	/// Waits for every outstanding operation; their callbacks still run
+	~io_ring();
+
+	bool uses_io_uring() const noexcept { return (m_ring_fd >= 0); }
+
+	//////////////////////////////////////////////////////////////////
+	// submission
+	void read(ring_file f, void * buffer, std::size_t length, off_t offset,
+	          completion_t cb);
+	void write(ring_file f, const void * buffer, std::size_t length,
+	           off_t offset, completion_t cb);
+
+	/// Read/write through buffer buffer_index of register_buffers(); the
+	/// range must lie inside that buffer
+	void read_fixed(ring_file f, void * buffer, std::size_t length,
+	                off_t offset, unsigned buffer_index, completion_t cb);
+	void write_fixed(ring_file f, const void * buffer, std::size_t length,
+	                 off_t offset, unsigned buffer_index, completion_t cb);
+
+	void fsync(ring_file f, bool data_only, completion_t cb);
+
+	/// Completes with the new descriptor, which the caller then owns
+	void openat(ring_file dir, const filesystem::path & p, int flags,
+	            mode_t mode, completion_t cb);
+
+	void statx(ring_file dir, const filesystem::path & p, int flags,
+	           unsigned int mask, struct statx * result, completion_t cb);
+
+	/// An offset of -1 uses (and advances) the file position; pipes
+	/// need -1
+	void splice(ring_file in, off_t in_offset, ring_file out,
+	            off_t out_offset, std::size_t length, unsigned int flags,
+	            completion_t cb);
+
+	// the same, completing a future instead of calling back
+	std::future<int> read(ring_file f, void * buffer, std::size_t length,
+	                      off_t offset);
+	std::future<int> write(ring_file f, const void * buffer,
+	                       std::size_t length, off_t offset);
+	std::future<int> fsync(ring_file f, bool data_only = false);
+
+	//////////////////////////////////////////////////////////////////
+	// registered resources
+
+	/// Pins buffers for read_fixed()/write_fixed(), sparing the kernel
+	/// from mapping them on every operation. Replaces any earlier set.
+	void register_buffers(const struct iovec * iov, unsigned count);
+	void unregister_buffers();
+
+	/// Registers descriptors for use through ring_file::fixed(i),
+	/// sparing the kernel a descriptor table lookup per operation.
+	/// Replaces any earlier set.
+	void register_files(const int * fds, unsigned count);
+	void unregister_files();
+
+	//////////////////////////////////////////////////////////////////
+	// completion
+
+	/// Passes queued operations to the kernel; returns how many
+	unsigned submit();
+
+	/// Submits, then runs the callbacks of whatever has completed
+	/// without waiting. Returns the number of completions.
+	unsigned poll();
+
+	/// Submits, then waits until at least min_complete operations (or
+	/// all outstanding ones, if fewer) have completed and runs their
+	/// callbacks. Returns the number of completions.
+	unsigned wait(unsigned min_complete = 1);
+
+	/// Operations queued or in flight
+	std::size_t pending() const noexcept { return m_in_flight; }
+
+ private:
+	struct operation
+	{
+		completion_t callback;
+		std::string path; // keeps openat()/statx() names alive
+	};
+
+	struct fallback_task
+	{
+		std::uint32_t slot;
+		std::function<int ()> call;
+	};
+
+	std::uint32_t allocate_slot(completion_t && cb);
+	std::uint32_t allocate_slot(completion_t && cb,
+	                            const filesystem::path & p);
+	void complete(std::uint32_t slot, int result);
+
+	// io_uring
+	void setup_ring(unsigned entries);
+	void unmap_ring() noexcept;
+	::io_uring_sqe * next_sqe();
+	unsigned reap();
+	int enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+	// thread pool
+	void start_fallback(unsigned threads);
+	void stop_fallback();
+	void fallback_worker();
+	void queue_task(std::uint32_t slot, std::function<int ()> call);
+	unsigned drain_fallback(unsigned min_complete);
+	int fallback_fd(ring_file f) const noexcept;
+
+	int m_ring_fd;
+
+	// the mapped rings
+	void * m_sq_map;
+	std::size_t m_sq_map_size;
+	void * m_cq_map;
+	std::size_t m_cq_map_size;
+	::io_uring_sqe * m_sqes;
+	std::size_t m_sqes_size;
+
+	unsigned * m_sq_head;
+	unsigned * m_sq_tail;
+	unsigned m_sq_mask;
+	unsigned m_sq_entries;
+	unsigned * m_sq_array;
+	unsigned * m_cq_head;
+	unsigned * m_cq_tail;
+	unsigned m_cq_mask;
+	unsigned m_cq_entries;
+	::io_uring_cqe * m_cqes;
+
+	unsigned m_to_submit;
+	std::size_t m_in_flight;
+
+	// a deque, so operations don't move as more are added
+	std::deque<operation> m_ops;
+	std::vector<std::uint32_t> m_free_slots;
+
+	// fallback
+	std::vector<std::thread> m_threads;
+	std::deque<fallback_task> m_tasks;
+	std::vector<std::pair<std::uint32_t, int>> m_done;
+	std::mutex m_mutex;
+	std::condition_variable m_task_ready;
+	std::condition_variable m_task_done;
+	std::vector<int> m_fixed_files;
+	bool m_stopping;
+};
+
+} // namespace io
+
+#endif // GUARD_IO_RING_H
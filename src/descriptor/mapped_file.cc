@@ -0,0 +1,243 @@
+#include "mapped_file.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace io {
+
+namespace {
+
+int protection(map_mode m) noexcept
+{
+	return (m == map_mode::read_only) ? PROT_READ : (PROT_READ | PROT_WRITE);
+}
+
+int sharing(map_mode m) noexcept
+{
+	return (m == map_mode::copy_on_write) ? MAP_PRIVATE : MAP_SHARED;
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+std::size_t mapped_file::page_size() noexcept
+{
+	static const std::size_t size = static_cast<std::size_t>(
+	    sysconf(_SC_PAGESIZE));
+	return size;
+}
+
+//////////////////////////////////////////////////////////////////////
+mapped_file::mapped_file() noexcept
+  : m_file()
+  , m_mode(map_mode::read_only)
+  , m_window(0)
+  , m_file_size(0)
+  , m_base(nullptr)
+  , m_length(0)
+  , m_data(nullptr)
+  , m_size(0)
+  , m_offset(0)
+{ }
+
+//////////////////////////////////////////////////////////////////////
+mapped_file::mapped_file(const filesystem::path & p, map_mode mode,
+                         std::size_t window)
+  : mapped_file(file_descriptor(p, (mode == map_mode::read_write) ? O_RDWR
+                                                                  : O_RDONLY),
+                mode, window)
+{ }
+
+//////////////////////////////////////////////////////////////////////
+mapped_file::mapped_file(file_descriptor && f, map_mode mode,
+                         std::size_t window)
+  : mapped_file()
+{
+	m_file = std::move(f);
+	m_mode = mode;
+	m_window = window;
+	map(0);
+}
+
+//////////////////////////////////////////////////////////////////////
+mapped_file::mapped_file(mapped_file && o) noexcept
+  : m_file(std::move(o.m_file))
+  , m_mode(o.m_mode)
+  , m_window(o.m_window)
+  , m_file_size(o.m_file_size)
+  , m_base(o.m_base)
+  , m_length(o.m_length)
+  , m_data(o.m_data)
+  , m_size(o.m_size)
+  , m_offset(o.m_offset)
+{
+	o.m_base = o.m_data = nullptr;
+	o.m_length = o.m_size = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+mapped_file & mapped_file::operator = (mapped_file && o) noexcept
+{
+	if (this != &o)
+	{
+		unmap();
+
+		m_file = std::move(o.m_file);
+		m_mode = o.m_mode;
+		m_window = o.m_window;
+		m_file_size = o.m_file_size;
+		m_base = o.m_base;
+		m_length = o.m_length;
+		m_data = o.m_data;
+		m_size = o.m_size;
+		m_offset = o.m_offset;
+
+		o.m_base = o.m_data = nullptr;
+		o.m_length = o.m_size = 0;
+	}
+
+	return *this;
+}
+
+//////////////////////////////////////////////////////////////////////
+mapped_file::~mapped_file()
+{
+	unmap();
+}
+
+//////////////////////////////////////////////////////////////////////
+void mapped_file::unmap() noexcept
+{
+	if (m_base != nullptr)
+		::munmap(m_base, m_length);
+
+	m_base = m_data = nullptr;
+	m_length = m_size = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+span<const char> mapped_file::map(off_t offset, std::size_t length)
+{
+	std::error_code ec;
+	span<const char> s = map(offset, length, ec);
+	if (ec) throw make_syserr(ec.value(), "Could not map file");
+	return s;
+}
+
+//////////////////////////////////////////////////////////////////////
+span<const char> mapped_file::map(off_t offset, std::size_t length,
+                                  std::error_code & ec) noexcept
+{
+	// picks up growth of the file, and shrinkage that would otherwise
+	// mean SIGBUS on touching the new mapping
+	const off_t file_size = m_file.size(ec);
+	if (ec)
+		return bytes();
+
+	if (offset < 0)
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return bytes();
+	}
+
+	unmap();
+	m_file_size = file_size;
+	m_offset = std::min(offset, file_size);
+
+	if (length == 0)
+		length = m_window ? m_window
+		                  : static_cast<std::size_t>(file_size - m_offset);
+	length = std::min<std::size_t>(length, file_size - m_offset);
+
+	// mmap() of nothing fails; an empty range just has no mapping
+	if (length == 0)
+		return bytes();
+
+	const off_t start = m_offset - (m_offset % page_size());
+	const std::size_t lead = static_cast<std::size_t>(m_offset - start);
+
+	void * p = ::mmap(nullptr, lead + length, protection(m_mode),
+	                  sharing(m_mode), m_file.native_handle(), start);
+
+	if (p == MAP_FAILED)
+	{
+		ec = std::error_code(errno, std::system_category());
+		return bytes();
+	}
+
+	m_base = static_cast<char *>(p);
+	m_length = lead + length;
+	m_data = m_base + lead;
+	m_size = length;
+	return bytes();
+}
+
+//////////////////////////////////////////////////////////////////////
+std::pair<char *, std::size_t>
+mapped_file::pages(std::size_t offset, std::size_t length) const noexcept
+{
+	offset = std::min(offset, m_size);
+	if (length == 0 || length > m_size - offset)
+		length = m_size - offset;
+
+	char * first = m_data + offset;
+	char * aligned = m_base + ((first - m_base) / page_size()) * page_size();
+
+	return std::make_pair(aligned, length + (first - aligned));
+}
+
+//////////////////////////////////////////////////////////////////////
+void mapped_file::advise(map_advice a, std::size_t offset, std::size_t length)
+{
+	std::error_code ec;
+	advise(a, offset, length, ec);
+	if (ec) throw make_syserr(ec.value(), "madvise failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void mapped_file::advise(map_advice a, std::size_t offset, std::size_t length,
+                         std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (m_base == nullptr)
+		return;
+
+	const std::pair<char *, std::size_t> r = pages(offset, length);
+	int rc;
+
+	// the populate advice faults pages in, and can be interrupted
+	do {
+		rc = ::madvise(r.first, r.second, static_cast<int>(a));
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+//////////////////////////////////////////////////////////////////////
+void mapped_file::sync(std::size_t offset, std::size_t length, bool async)
+{
+	std::error_code ec;
+	sync(offset, length, async, ec);
+	if (ec) throw make_syserr(ec.value(), "msync failed");
+}
+
+//////////////////////////////////////////////////////////////////////
+void mapped_file::sync(std::size_t offset, std::size_t length, bool async,
+                       std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	// private mappings have nothing to write back
+	if (m_base == nullptr || m_mode != map_mode::read_write)
+		return;
+
+	const std::pair<char *, std::size_t> r = pages(offset, length);
+
+	if (::msync(r.first, r.second, async ? MS_ASYNC : MS_SYNC) < 0)
+		ec = std::error_code(errno, std::system_category());
+}
+
+} // namespace io
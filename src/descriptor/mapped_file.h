@@ -0,0 +1,187 @@
+#ifndef GUARD_MAPPED_FILE_H
+#define GUARD_MAPPED_FILE_H 1
+
+#include <sys/mman.h>
+
+#include <cstddef>
+#include <system_error>
+#include <utility>
+
+#include "descriptor.h"
+
+namespace io {
+
+//////////////////////////////////////////////////////////////////////
+/// A non-owning pointer+length reference to a run of T, such as the
+/// bytes of a mapping
+template <class T>
+class span
+{
+ public:
+	typedef T element_type;
+	typedef T * iterator;
+
+	constexpr span() noexcept : m_data(nullptr), m_size(0) { }
+	constexpr span(T * p, std::size_t n) noexcept : m_data(p), m_size(n) { }
+
+	/// span<const T> from span<T>
+	template <class U>
+	constexpr span(const span<U> & s) noexcept
+	  : m_data(s.data()), m_size(s.size()) { }
+
+	T * data() const noexcept { return m_data; }
+	std::size_t size() const noexcept { return m_size; }
+	bool empty() const noexcept { return (m_size == 0); }
+
+	T * begin() const noexcept { return m_data; }
+	T * end() const noexcept { return m_data + m_size; }
+
+	T & operator [] (std::size_t i) const noexcept { return m_data[i]; }
+
+	/// The n elements from offset on, or as many as there are
+	span subspan(std::size_t offset,
+	             std::size_t n = static_cast<std::size_t>(-1)) const noexcept
+	{
+		if (offset > m_size) offset = m_size;
+		if (n > m_size - offset) n = m_size - offset;
+		return span(m_data + offset, n);
+	}
+
+ private:
+	T * m_data;
+	std::size_t m_size;
+};
+
+//////////////////////////////////////////////////////////////////////
+enum class map_mode
+{
+	read_only,
+	read_write,     // stores go to the file
+	copy_on_write,  // stores stay private to the process
+};
+
+/// madvise() advice. Not every kind of file supports every one: huge
+/// pages need a filesystem and kernel that allow them for page cache,
+/// and the populate advice needs Linux 5.14.
+enum class map_advice
+{
+	normal         = MADV_NORMAL,
+	sequential     = MADV_SEQUENTIAL,  // aggressive readahead, early reclaim
+	random         = MADV_RANDOM,      // no readahead
+	will_need      = MADV_WILLNEED,    // start readahead now
+	dont_need      = MADV_DONTNEED,
+	huge_page      = MADV_HUGEPAGE,
+	no_huge_page   = MADV_NOHUGEPAGE,
+	populate_read  = 22,               // MADV_POPULATE_READ: fault in now
+	populate_write = 23,               // MADV_POPULATE_WRITE
+};
+
+//////////////////////////////////////////////////////////////////////
+/// A file mapped into memory, so its contents can be used in place
+/// rather than copied out with read().
+///
+/// The whole file is mapped unless a window size is given, in which
+/// case at most that much of it is mapped at a time and map() moves the
+/// window, for files larger than the address space that can be spent on
+/// them. bytes() is the mapped part, starting at file offset offset();
+/// windows may start at any offset, not just on page boundaries.
+///
+/// The mapping reflects the file's size when it was made. Touching a
+/// page that the file has since been truncated away from raises
+/// SIGBUS, as with any mapping.
+class mapped_file
+{
+ public:
+	mapped_file() noexcept;
+
+	/// Opens p and maps it, or its first window bytes if window isn't 0
+	explicit mapped_file(const filesystem::path & p,
+	                     map_mode mode = map_mode::read_only,
+	                     std::size_t window = 0);
+
+	/// Maps an open file, taking ownership of it. It must have been
+	/// opened for reading, and also for writing for map_mode::read_write.
+	explicit mapped_file(file_descriptor && f,
+	                     map_mode mode = map_mode::read_only,
+	                     std::size_t window = 0);
+
+	mapped_file(const mapped_file &) = delete;
+	mapped_file & operator = (const mapped_file &) = delete;
+
+	mapped_file(mapped_file && o) noexcept;
+	mapped_file & operator = (mapped_file && o) noexcept;
+
+	~mapped_file();
+
+	/// Replaces the mapping with length bytes from offset, clamped to the
+	/// end of the file; 0 means the window size, or the rest of the file
+	/// when there is no window. Returns the new bytes().
+	span<const char> map(off_t offset, std::size_t length = 0);
+	span<const char> map(off_t offset, std::size_t length,
+	                     std::error_code & ec) noexcept;
+
+	/// Maps the window after the current one; an empty span at the end
+	/// of the file
+	span<const char> next() { return map(m_offset + m_size); }
+
+	void unmap() noexcept;
+
+	bool is_mapped() const noexcept { return (m_base != nullptr); }
+
+	span<const char> bytes() const noexcept
+		{ return span<const char>(m_data, m_size); }
+
+	/// The mapped bytes, for modes other than read_only
+	span<char> writable_bytes() const noexcept
+		{ return span<char>(m_data, m_size); }
+
+	const char * data() const noexcept { return m_data; }
+	std::size_t size() const noexcept { return m_size; }
+
+	/// File offset of data()
+	off_t offset() const noexcept { return m_offset; }
+
+	/// Size of the file when it was last mapped
+	off_t file_size() const noexcept { return m_file_size; }
+
+	std::size_t window() const noexcept { return m_window; }
+	map_mode mode() const noexcept { return m_mode; }
+
+	const file_descriptor & file() const noexcept { return m_file; }
+
+	/// Advice for length bytes of the mapping from offset, both relative
+	/// to data(); a length of 0 means to the end of the mapping
+	void advise(map_advice a, std::size_t offset = 0, std::size_t length = 0);
+	void advise(map_advice a, std::size_t offset, std::size_t length,
+	            std::error_code & ec) noexcept;
+
+	/// Writes modified pages in a range of the mapping back to the file,
+	/// waiting for the writes unless async; 0 length means to the end
+	void sync(std::size_t offset = 0, std::size_t length = 0,
+	          bool async = false);
+	void sync(std::size_t offset, std::size_t length, bool async,
+	          std::error_code & ec) noexcept;
+
+	static std::size_t page_size() noexcept;
+
+ private:
+	/// The page aligned range covering length bytes at offset into
+	/// data(), clamped to the mapping
+	std::pair<char *, std::size_t> pages(std::size_t offset,
+	                                     std::size_t length) const noexcept;
+
+	file_descriptor m_file;
+	map_mode m_mode;
+	std::size_t m_window;
+	off_t m_file_size;
+
+	char * m_base;           // start of the mapping, page aligned
+	std::size_t m_length;    // of the mapping
+	char * m_data;           // first byte at m_offset
+	std::size_t m_size;
+	off_t m_offset;
+};
+
+} // namespace io
+
+#endif // GUARD_MAPPED_FILE_H
@@ -0,0 +1,249 @@
+#include "reactor.h"
+
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace io {
+
+namespace {
+
+/// The wakeup eventfd's epoll data; no registration can have it, since
+/// slot indexes stay far below 2^32 - 1
+constexpr std::uint64_t wakeup_token = ~std::uint64_t(0);
+
+constexpr std::size_t signal_batch = 16;
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+reactor::reactor(std::size_t max_events)
+  : m_epoll(epoll_create1(EPOLL_CLOEXEC))
+  , m_wakeup(-1)
+  , m_stopped(false)
+  , m_events(std::max<std::size_t>(max_events, 1))
+  , m_slots()
+  , m_free()
+  , m_pending_free()
+  , m_removed()
+  , m_active(0)
+{
+	if (m_epoll < 0) throw make_syserr("Could not create epoll descriptor");
+
+	m_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wakeup < 0)
+	{
+		::close(m_epoll);
+		throw make_syserr("Could not create wakeup eventfd");
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.u64 = wakeup_token;
+
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &ev) != 0)
+	{
+		::close(m_wakeup);
+		::close(m_epoll);
+		throw make_syserr("Could not watch wakeup eventfd");
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+reactor::~reactor()
+{
+	::close(m_wakeup);
+	::close(m_epoll);
+}
+
+//////////////////////////////////////////////////////////////////////
+reactor::handle reactor::add(int fd, std::uint32_t events, handler_t h)
+{
+	int fl = fcntl(fd, F_GETFL);
+	if (fl < 0 || ((fl & O_NONBLOCK) == 0
+	               && fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0))
+		throw make_syserr("Could not make descriptor nonblocking");
+
+	std::uint32_t index;
+
+	if (m_free.empty())
+	{
+		index = static_cast<std::uint32_t>(m_slots.size());
+		m_slots.push_back(slot{ -1, 1, nullptr });
+	} else
+	{
+		index = m_free.back();
+		m_free.pop_back();
+	}
+
+	slot & s = m_slots[index];
+	const handle id = make_handle(index, s.generation);
+
+	struct epoll_event ev;
+	ev.events = events | EPOLLET;
+	ev.data.u64 = id;
+
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) != 0)
+	{
+		m_free.push_back(index);
+		throw make_syserr("Could not add descriptor to epoll");
+	}
+
+	s.fd = fd;
+	s.handler = std::move(h);
+	++m_active;
+
+	return id;
+}
+
+//////////////////////////////////////////////////////////////////////
+reactor::handle reactor::add_signals(signal_descriptor & s,
+                       std::function<void (const signalfd_siginfo &)> h)
+{
+	signal_descriptor * sd = &s;
+
+	return add(s, EPOLLIN, [sd, h](std::uint32_t) {
+		signalfd_siginfo info[signal_batch];
+		std::error_code ec;
+		std::size_t n;
+
+		while ((n = sd->read_signals(info, signal_batch, ec)) > 0)
+		{
+			for (std::size_t i = 0; i < n; ++i)
+				h(info[i]);
+		}
+	});
+}
+
+//////////////////////////////////////////////////////////////////////
+reactor::slot * reactor::find(handle h) noexcept
+{
+	const std::uint32_t index = static_cast<std::uint32_t>(h);
+	const std::uint32_t generation = static_cast<std::uint32_t>(h >> 32);
+
+	if (index >= m_slots.size())
+		return nullptr;
+
+	slot & s = m_slots[index];
+	return (s.fd >= 0 && s.generation == generation) ? &s : nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////
+void reactor::modify(handle h, std::uint32_t events)
+{
+	slot * s = find(h);
+	if (! s)
+		throw make_syserr(EBADF, "No such reactor registration");
+
+	struct epoll_event ev;
+	ev.events = events | EPOLLET;
+	ev.data.u64 = h;
+
+	if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, s->fd, &ev) != 0)
+		throw make_syserr("Could not modify epoll registration");
+}
+
+//////////////////////////////////////////////////////////////////////
+void reactor::remove(handle h) noexcept
+{
+	slot * s = find(h);
+	if (! s)
+		return;
+
+	// the descriptor may already be closed, which removed it from the
+	// epoll set anyway
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, s->fd, nullptr);
+
+	// the handler may be the one running; it is destroyed after the
+	// batch, and the slot isn't reused until then either, since add()
+	// would overwrite the storage of a handler that is still running
+	m_removed.push_back(std::move(s->handler));
+	s->handler = nullptr;
+	s->fd = -1;
+
+	// a new generation makes events already collected for this slot stale
+	if (++s->generation == 0)
+		s->generation = 1;
+
+	m_pending_free.push_back(static_cast<std::uint32_t>(h));
+	--m_active;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Destroys removed handlers and makes their slots reusable, once no
+/// handler is running
+void reactor::release()
+{
+	m_removed.clear();
+	m_free.insert(m_free.end(), m_pending_free.begin(),
+	              m_pending_free.end());
+	m_pending_free.clear();
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t reactor::run_once(std::chrono::milliseconds timeout)
+{
+	const int timeout_ms
+	  = (timeout.count() < 0) ? -1
+	  : static_cast<int>(std::min<long long>(timeout.count(), INT_MAX));
+
+	// what was removed outside a batch, or by a handler that threw
+	release();
+
+	int n = epoll_wait(m_epoll, m_events.data(),
+	                   static_cast<int>(m_events.size()), timeout_ms);
+
+	if (n < 0)
+	{
+		if (errno == EINTR)
+			return 0;
+		throw make_syserr("epoll_wait failed");
+	}
+
+	std::size_t dispatched = 0;
+
+	for (int i = 0; i < n; ++i)
+	{
+		const struct epoll_event & ev = m_events[i];
+
+		if (ev.data.u64 == wakeup_token)
+		{
+			std::uint64_t v;
+			while (::read(m_wakeup, &v, sizeof(v)) > 0) { }
+			continue;
+		}
+
+		slot * s = find(ev.data.u64);
+		if (! s)
+			continue;
+
+		s->handler(ev.events);
+		++dispatched;
+	}
+
+	release();
+
+	return dispatched;
+}
+
+//////////////////////////////////////////////////////////////////////
+void reactor::run()
+{
+	// clears the request on the way out, so run() can be called again
+	while (! m_stopped.exchange(false))
+		run_once();
+}
+
+//////////////////////////////////////////////////////////////////////
+void reactor::stop() noexcept
+{
+	const std::uint64_t one = 1;
+
+	m_stopped = true;
+	if (::write(m_wakeup, &one, sizeof(one)) < 0) { }
+}
+
+} // namespace io
@@ -0,0 +1,129 @@
+#ifndef GUARD_REACTOR_H
+#define GUARD_REACTOR_H 1
+
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "descriptor.h"
+
+namespace io {
+
+//////////////////////////////////////////////////////////////////////
+/// A single-threaded, edge-triggered epoll event loop.
+///
+/// Every registration is edge-triggered: a handler hears about a
+/// descriptor becoming readable or writable once, and must then read or
+/// write until EAGAIN before it hears about it again. Descriptors are
+/// switched to nonblocking when they are added. add_timer() and
+/// add_signals() wrap handlers that do the draining themselves.
+///
+/// Events are collected in batches of up to max_events per epoll_wait()
+/// into an array allocated once, and dispatched through handlers stored
+/// at registration, so the loop itself allocates nothing per event. A
+/// handler may add or remove registrations, its own included; events
+/// already collected for a removed registration are dropped.
+///
+/// Only stop() may be called from another thread.
+class reactor
+{
+ public:
+	typedef std::function<void (std::uint32_t events)> handler_t;
+
+	/// Identifies a registration; 0 is never a valid one
+	typedef std::uint64_t handle;
+
+	explicit reactor(std::size_t max_events = 1024);
+
+	reactor(const reactor &) = delete;
+	reactor & operator = (const reactor &) = delete;
+
+	~reactor();
+
+	/// Calls h with the epoll events (EPOLLIN, EPOLLOUT, EPOLLHUP...)
+	/// whenever fd becomes ready for any of events. The descriptor must
+	/// stay open until it is removed.
+	handle add(int fd, std::uint32_t events, handler_t h);
+	handle add(const descriptor & d, std::uint32_t events, handler_t h)
+		{ return add(d.native_handle(), events, std::move(h)); }
+
+	/// Calls h with the number of expirations each time the timer fires
+	template <int CLOCK>
+	handle add_timer(timer_descriptor<CLOCK> & t,
+	                 std::function<void (std::uint64_t expirations)> h);
+
+	/// Calls h once for every signal that arrives
+	handle add_signals(signal_descriptor & s,
+	                   std::function<void (const signalfd_siginfo &)> h);
+
+	/// Changes the events a registration waits for
+	void modify(handle h, std::uint32_t events);
+
+	/// Unregisters; does nothing for a handle already removed
+	void remove(handle h) noexcept;
+
+	/// Waits up to timeout (forever if negative) for events and
+	/// dispatches one batch. Returns the number of events dispatched.
+	std::size_t run_once(std::chrono::milliseconds timeout
+	                       = std::chrono::milliseconds(-1));
+
+	/// Dispatches events until stop() is called
+	void run();
+
+	/// Makes run() return after the batch in progress; safe from any
+	/// thread and from handlers
+	void stop() noexcept;
+
+	/// Number of registrations
+	std::size_t size() const noexcept { return m_active; }
+
+ private:
+	struct slot
+	{
+		int fd;
+		std::uint32_t generation;
+		handler_t handler;
+	};
+
+	static handle make_handle(std::uint32_t index,
+	                          std::uint32_t generation) noexcept
+		{ return (static_cast<handle>(generation) << 32) | index; }
+
+	slot * find(handle h) noexcept;
+	void release();
+
+	int m_epoll;
+	int m_wakeup;
+	std::atomic<bool> m_stopped;
+	std::vector<struct epoll_event> m_events;
+	std::deque<slot> m_slots;   // a deque, so a running handler never moves
+	std::vector<std::uint32_t> m_free;
+	std::vector<std::uint32_t> m_pending_free; // reusable after the batch
+	std::vector<handler_t> m_removed; // kept until the batch is done
+	std::size_t m_active;
+};
+
+//////////////////////////////////////////////////////////////////////
+template <int CLOCK>
+reactor::handle reactor::add_timer(timer_descriptor<CLOCK> & t,
+                     std::function<void (std::uint64_t expirations)> h)
+{
+	timer_descriptor<CLOCK> * timer = &t;
+
+	return add(t, EPOLLIN, [timer, h](std::uint32_t) {
+		std::error_code ec;
+		std::uint64_t n;
+
+		while ((n = timer->read_expirations(ec)) > 0)
+			h(n);
+	});
+}
+
+} // namespace io
+
+#endif // GUARD_REACTOR_H
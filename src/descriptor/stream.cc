@@ -0,0 +1,345 @@
+#include "stream.h"
+
+namespace io {
+
+constexpr std::size_t reader::default_capacity;
+constexpr std::size_t writer::default_capacity;
+
+namespace {
+
+/// Enough for any shortest round-trip float or double, with sign and
+/// exponent: "-1.7976931348623157e+308"
+constexpr std::size_t float_chars = 32;
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+reader::reader(const descriptor & d, std::size_t capacity)
+  : m_fd(d.native_handle())
+  , m_buffer(new char[std::max<std::size_t>(capacity, 16)])
+  , m_capacity(std::max<std::size_t>(capacity, 16))
+  , m_begin(m_buffer.get())
+  , m_end(m_buffer.get())
+  , m_eof(false)
+{ }
+
+//////////////////////////////////////////////////////////////////////
+/// Makes room for n more bytes after the buffered ones, first by moving
+/// them to the front, then by growing the buffer. False if it can't.
+bool reader::make_room(std::size_t n) noexcept
+{
+	char * const start = m_buffer.get();
+	const std::size_t held = m_end - m_begin;
+
+	if (static_cast<std::size_t>(start + m_capacity - m_end) >= n)
+		return true;
+
+	if (m_capacity - held >= n)
+	{
+		std::memmove(start, m_begin, held);
+	} else
+	{
+		std::size_t c = m_capacity * 2;
+		while (c - held < n)
+			c *= 2;
+
+		char * p = new (std::nothrow) char[c];
+		if (p == nullptr)
+			return false;
+
+		std::memcpy(p, m_begin, held);
+		m_buffer.reset(p);
+		m_capacity = c;
+	}
+
+	m_begin = m_buffer.get();
+	m_end = m_begin + held;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t reader::fill()
+{
+	std::error_code ec;
+	std::size_t n = fill(ec);
+	if (ec) throw make_syserr(ec.value(), "read failed");
+	return n;
+}
+
+std::size_t reader::fill(std::error_code & ec) noexcept
+{
+	// an empty buffer starts over at the front, keeping reads aligned
+	if (m_begin == m_end)
+		m_begin = m_end = m_buffer.get();
+
+	// half the buffer at least, so a dribble of small reads can't make
+	// every fill a memmove
+	if (! make_room(m_capacity / 2))
+	{
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return 0;
+	}
+
+	const std::size_t space = m_buffer.get() + m_capacity - m_end;
+	const std::size_t n = detail::retry_io(
+	    [&]() { return ::read(m_fd, m_end, space); }, ec);
+
+	m_end += n;
+	if (n == 0 && ! ec)
+		m_eof = true;
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+text_view reader::peek(std::size_t n)
+{
+	std::error_code ec;
+	text_view v = peek(n, ec);
+	if (ec) throw make_syserr(ec.value(), "read failed");
+	return v;
+}
+
+text_view reader::peek(std::size_t n, std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (size() < n && ! make_room(n - size()))
+	{
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return peek();
+	}
+
+	while (size() < n && fill(ec) > 0) { }
+
+	return peek();
+}
+
+//////////////////////////////////////////////////////////////////////
+bool reader::getline(text_view & line, char delim)
+{
+	std::error_code ec;
+	bool got = getline(line, delim, ec);
+	if (ec) throw make_syserr(ec.value(), "read failed");
+	return got;
+}
+
+bool reader::getline(text_view & line, char delim,
+                     std::error_code & ec) noexcept
+{
+	// offset rather than pointer: filling may move the buffer
+	std::size_t searched = 0;
+
+	ec.clear();
+
+	for (;;)
+	{
+		const char * p = static_cast<const char *>(
+		    std::memchr(m_begin + searched, delim, size() - searched));
+
+		if (p != nullptr)
+		{
+			line = text_view(m_begin, p - m_begin);
+			m_begin = const_cast<char *>(p) + 1;
+			return true;
+		}
+
+		searched = size();
+
+		if (fill(ec) == 0)
+			break;
+	}
+
+	if (ec || searched == 0)
+		return false;
+
+	line = text_view(m_begin, searched);
+	m_begin = m_end;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t reader::read(void * buffer, std::size_t length)
+{
+	std::error_code ec;
+	std::size_t n = read(buffer, length, ec);
+	if (ec) throw make_syserr(ec.value(), "read failed");
+	return n;
+}
+
+std::size_t reader::read(void * buffer, std::size_t length,
+                         std::error_code & ec) noexcept
+{
+	ec.clear();
+
+	if (m_begin == m_end)
+	{
+		// too big to be worth staging through the buffer
+		if (length >= m_capacity / 2)
+		{
+			const std::size_t n = detail::retry_io(
+			    [&]() { return ::read(m_fd, buffer, length); }, ec);
+			if (n == 0 && ! ec)
+				m_eof = true;
+			return n;
+		}
+
+		if (fill(ec) == 0)
+			return 0;
+	}
+
+	const std::size_t n = std::min(length, size());
+	std::memcpy(buffer, m_begin, n);
+	m_begin += n;
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////
+writer::writer(const descriptor & d, std::size_t capacity,
+               flush_policy policy)
+  : m_fd(d.native_handle())
+  , m_buffer(new char[std::max<std::size_t>(capacity, float_chars)])
+  , m_capacity(std::max<std::size_t>(capacity, float_chars))
+  , m_end(m_buffer.get())
+  , m_limit(m_buffer.get() + m_capacity)
+  , m_policy(policy)
+{ }
+
+//////////////////////////////////////////////////////////////////////
+writer::~writer()
+{
+	std::error_code ec;
+	flush(ec);
+}
+
+//////////////////////////////////////////////////////////////////////
+void writer::flush()
+{
+	std::error_code ec;
+	flush(ec);
+	if (ec) throw make_syserr(ec.value(), "write failed");
+}
+
+void writer::flush(std::error_code & ec) noexcept
+{
+	char * const start = m_buffer.get();
+	const char * p = start;
+
+	ec.clear();
+
+	while (p < m_end)
+	{
+		const std::size_t n = detail::retry_io(
+		    [&]() { return ::write(m_fd, p, m_end - p); }, ec);
+		if (ec)
+			break;
+		p += n;
+	}
+
+	// keep whatever didn't go, at the front
+	const std::size_t left = m_end - p;
+	if (left > 0 && p != start)
+		std::memmove(start, p, left);
+	m_end = start + left;
+}
+
+//////////////////////////////////////////////////////////////////////
+char * writer::prepare(std::size_t n)
+{
+	if (static_cast<std::size_t>(m_limit - m_end) >= n)
+		return m_end;
+
+	flush();
+
+	if (m_capacity < n)
+	{
+		m_buffer.reset(new char[n]);
+		m_capacity = n;
+		m_end = m_buffer.get();
+		m_limit = m_end + n;
+	}
+
+	return m_end;
+}
+
+//////////////////////////////////////////////////////////////////////
+void writer::commit(std::size_t n)
+{
+	m_end += n;
+	if (m_policy != flush_policy::full)
+		written(m_end - n, n);
+}
+
+//////////////////////////////////////////////////////////////////////
+void writer::written(const char * p, std::size_t n)
+{
+	if (  m_policy == flush_policy::always
+	   || (m_policy == flush_policy::line && std::memchr(p, '\n', n)) )
+		flush();
+}
+
+//////////////////////////////////////////////////////////////////////
+void writer::write(const void * buffer, std::size_t length)
+{
+	std::error_code ec;
+	write(buffer, length, ec);
+	if (ec) throw make_syserr(ec.value(), "write failed");
+}
+
+void writer::write(const void * buffer, std::size_t length,
+                   std::error_code & ec) noexcept
+{
+	const char * src = static_cast<const char *>(buffer);
+
+	ec.clear();
+
+	if (static_cast<std::size_t>(m_limit - m_end) >= length)
+	{
+		std::memcpy(m_end, src, length);
+		m_end += length;
+	} else
+	{
+		flush(ec);
+		if (ec)
+			return;
+
+		if (length < m_capacity)
+		{
+			std::memcpy(m_end, src, length);
+			m_end += length;
+		} else
+		{
+			// no point copying what would fill the buffer by itself
+			while (length > 0)
+			{
+				const std::size_t n = detail::retry_io(
+				    [&]() { return ::write(m_fd, src, length); }, ec);
+				if (ec)
+					return;
+				src += n;
+				length -= n;
+			}
+			return;
+		}
+	}
+
+	if (  m_policy == flush_policy::always
+	   || (m_policy == flush_policy::line && std::memchr(src, '\n', length)) )
+		flush(ec);
+}
+
+//////////////////////////////////////////////////////////////////////
+writer & writer::operator << (double value)
+{
+	char * p = prepare(float_chars);
+	commit(to_chars(p, p + float_chars, value).ptr - p);
+	return *this;
+}
+
+writer & writer::operator << (float value)
+{
+	char * p = prepare(float_chars);
+	commit(to_chars(p, p + float_chars, value).ptr - p);
+	return *this;
+}
+
+} // namespace io
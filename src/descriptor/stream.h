@@ -0,0 +1,240 @@
+#ifndef GUARD_STREAM_H
+#define GUARD_STREAM_H 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "descriptor.h"
+#include "utility/to_chars.h"
+
+namespace io {
+
+//////////////////////////////////////////////////////////////////////
+/// A non-owning pointer+length reference to characters, as handed out
+/// by reader; it stays valid only as long as the reader says.
+class text_view
+{
+ public:
+	constexpr text_view() noexcept : m_data(""), m_size(0) { }
+
+	constexpr text_view(const char * s, std::size_t n) noexcept
+	  : m_data(s), m_size(n) { }
+
+	text_view(const char * s) noexcept : m_data(s), m_size(std::strlen(s)) { }
+
+	text_view(const std::string & s) noexcept
+	  : m_data(s.data()), m_size(s.size()) { }
+
+	const char * data() const noexcept { return m_data; }
+	std::size_t size() const noexcept { return m_size; }
+	bool empty() const noexcept { return (m_size == 0); }
+
+	const char * begin() const noexcept { return m_data; }
+	const char * end() const noexcept { return m_data + m_size; }
+
+	char operator [] (std::size_t i) const noexcept { return m_data[i]; }
+
+	std::string string() const { return std::string(m_data, m_size); }
+
+	bool operator == (text_view v) const noexcept
+	{
+		return (m_size == v.m_size
+		        && (m_size == 0 || std::memcmp(m_data, v.m_data, m_size) == 0));
+	}
+
+	bool operator != (text_view v) const noexcept { return !(*this == v); }
+
+ private:
+	const char * m_data;
+	std::size_t m_size;
+};
+
+//////////////////////////////////////////////////////////////////////
+/// Buffered input from a descriptor, in place of std::istream.
+///
+/// The buffer is one contiguous block that callers look into directly:
+/// peek() makes sure enough bytes are there and shows them, consume()
+/// discards bytes from the front. Nothing is copied out and there are
+/// no virtual calls or locale lookups per character. getline() returns
+/// lines as views into the buffer.
+///
+/// Views and pointers into the buffer stay valid until the next call
+/// that reads from the descriptor (fill(), peek(n), getline(), read()),
+/// which may move or reallocate the buffer. The buffer grows when a
+/// peek() or a line needs more than it holds.
+///
+/// The reader refers to the descriptor but doesn't own it.
+class reader
+{
+ public:
+	static constexpr std::size_t default_capacity = 64 * 1024;
+
+	explicit reader(const descriptor & d,
+	                std::size_t capacity = default_capacity);
+
+	reader(const reader &) = delete;
+	reader & operator = (const reader &) = delete;
+
+	/// What's buffered
+	text_view peek() const noexcept
+		{ return text_view(m_begin, m_end - m_begin); }
+
+	/// Buffers at least n bytes, unless end of file comes first, and
+	/// returns everything buffered
+	text_view peek(std::size_t n);
+	text_view peek(std::size_t n, std::error_code & ec) noexcept;
+
+	/// Discards n buffered bytes, at most size()
+	void consume(std::size_t n) noexcept
+		{ m_begin += std::min<std::size_t>(n, m_end - m_begin); }
+
+	/// One read() into the free space after the buffered bytes; returns
+	/// how many bytes arrived, 0 at end of file
+	std::size_t fill();
+	std::size_t fill(std::error_code & ec) noexcept;
+
+	/// The next line, without its delimiter. A last line that lacks one
+	/// is still returned. False at end of file, or on an error through
+	/// ec, in which case a partial line stays buffered for the next try.
+	bool getline(text_view & line, char delim = '\n');
+	bool getline(text_view & line, char delim, std::error_code & ec) noexcept;
+
+	/// Copies up to length bytes out, buffered ones first; a large read
+	/// goes straight from the descriptor. 0 at end of file.
+	std::size_t read(void * buffer, std::size_t length);
+	std::size_t read(void * buffer, std::size_t length,
+	                 std::error_code & ec) noexcept;
+
+	/// Number of bytes buffered
+	std::size_t size() const noexcept { return (m_end - m_begin); }
+
+	std::size_t capacity() const noexcept { return m_capacity; }
+
+	/// True once a read has returned end of file
+	bool eof() const noexcept { return m_eof; }
+
+ private:
+	bool make_room(std::size_t n) noexcept;
+
+	int m_fd;
+	std::unique_ptr<char[]> m_buffer;
+	std::size_t m_capacity;
+	char * m_begin;
+	char * m_end;
+	bool m_eof;
+};
+
+//////////////////////////////////////////////////////////////////////
+/// When writer hands its buffer to the descriptor, besides whenever the
+/// buffer fills up or flush() is called
+enum class flush_policy
+{
+	full,    // only then: files and pipes
+	line,    // also after anything that ends a line: terminals
+	always,  // also after every output call: unbuffered, like stderr
+};
+
+//////////////////////////////////////////////////////////////////////
+/// Buffered output to a descriptor, in place of std::ostream.
+///
+/// Text goes into one contiguous buffer, either through write(), put()
+/// and operator <<, or by formatting straight into the space returned
+/// by prepare() and then commit()ing it. Numbers are formatted with
+/// to_chars(): no locale, no virtual calls, no temporaries.
+///
+/// The destructor flushes but has no way to report a failure; call
+/// flush() first where that matters. The writer refers to the
+/// descriptor but doesn't own it.
+class writer
+{
+ public:
+	static constexpr std::size_t default_capacity = 64 * 1024;
+
+	explicit writer(const descriptor & d,
+	                std::size_t capacity = default_capacity,
+	                flush_policy policy = flush_policy::full);
+
+	writer(const writer &) = delete;
+	writer & operator = (const writer &) = delete;
+
+	~writer();
+
+	/// At least n bytes of free buffer to format into, flushing first if
+	/// there isn't that much; the buffer grows if n exceeds its capacity
+	char * prepare(std::size_t n);
+
+	/// Makes n bytes written at prepare()'s pointer part of the output
+	void commit(std::size_t n);
+
+	void write(const void * buffer, std::size_t length);
+	void write(const void * buffer, std::size_t length,
+	           std::error_code & ec) noexcept;
+
+	void put(char c)
+	{
+		if (m_end == m_limit) flush();
+		*m_end++ = c;
+		if (m_policy != flush_policy::full) written(m_end - 1, 1);
+	}
+
+	/// Writes out everything buffered. With the error_code form on a
+	/// nonblocking descriptor, what couldn't be written stays buffered.
+	void flush();
+	void flush(std::error_code & ec) noexcept;
+
+	writer & operator << (text_view s)
+		{ write(s.data(), s.size()); return *this; }
+	writer & operator << (const char * s)
+		{ return *this << text_view(s); }
+	writer & operator << (const std::string & s)
+		{ return *this << text_view(s); }
+	writer & operator << (char c)
+		{ put(c); return *this; }
+	writer & operator << (bool b)
+		{ return *this << (b ? text_view("true", 4) : text_view("false", 5)); }
+
+	template <class T>
+	typename std::enable_if<  std::is_integral<T>::value
+	                       && ! std::is_same<T, bool>::value
+	                       && ! std::is_same<T, char>::value,
+	                       writer &>::type
+		operator << (T value)
+	{
+		// sign plus the 20 digits of a 64 bit value
+		char * p = prepare(21);
+		commit(to_chars(p, p + 21, value).ptr - p);
+		return *this;
+	}
+
+	/// Text that reads back as the same value; see to_chars()
+	writer & operator << (double value);
+	writer & operator << (float value);
+
+	/// Number of bytes buffered
+	std::size_t size() const noexcept { return (m_end - m_buffer.get()); }
+
+	std::size_t capacity() const noexcept { return m_capacity; }
+
+	flush_policy policy() const noexcept { return m_policy; }
+	void policy(flush_policy p) noexcept { m_policy = p; }
+
+ private:
+	/// Flushes when the policy calls for it after n bytes at p were added
+	void written(const char * p, std::size_t n);
+
+	int m_fd;
+	std::unique_ptr<char[]> m_buffer;
+	std::size_t m_capacity;
+	char * m_end;
+	char * m_limit;
+	flush_policy m_policy;
+};
+
+} // namespace io
+
+#endif // GUARD_STREAM_H
@@ -0,0 +1,184 @@
+// io::writer and io::reader against std::ofstream/std::ifstream and
+// stdio: formatting integers and doubles one per line into a file, then
+// reading the lines back.
+//
+// usage: streambench [count] [dir]
+//
+// The files go in dir (default /tmp) and are removed afterwards. Reads
+// come from the page cache, so the numbers are the per-line cost of
+// each library rather than of the disk.
+
+#include "stream.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+void report(const char * what, std::size_t n, clock_type::duration d)
+{
+	double s = std::chrono::duration<double>(d).count();
+	printf("%-24s %12.0f %10.1f\n", what, n / s, s * 1e9 / n);
+}
+
+template <class T>
+void write_xos(const std::string & name, const std::vector<T> & v)
+{
+	io::file_descriptor f(filesystem::path(name),
+	                      O_WRONLY | O_CREAT | O_TRUNC);
+	io::writer w(f);
+
+	for (const T & x : v)
+		w << x << '\n';
+	w.flush();
+}
+
+template <class T>
+void write_fstream(const std::string & name, const std::vector<T> & v)
+{
+	std::ofstream out(name);
+
+	// as many digits as the other two, which print round-trip values
+	out.precision(17);
+	for (const T & x : v)
+		out << x << '\n';
+}
+
+void write_stdio(const std::string & name, const std::vector<long> & v)
+{
+	FilePtr f(fopen(name.c_str(), "w"));
+	for (long x : v)
+		fprintf(f.get(), "%ld\n", x);
+}
+
+void write_stdio(const std::string & name, const std::vector<double> & v)
+{
+	FilePtr f(fopen(name.c_str(), "w"));
+	for (double x : v)
+		fprintf(f.get(), "%.17g\n", x);
+}
+
+std::size_t read_xos(const std::string & name)
+{
+	io::file_descriptor f(filesystem::path(name), O_RDONLY);
+	io::reader r(f);
+	io::text_view line;
+	std::size_t total = 0;
+
+	while (r.getline(line))
+		total += line.size();
+	return total;
+}
+
+std::size_t read_fstream(const std::string & name)
+{
+	std::ifstream in(name);
+	std::string line;
+	std::size_t total = 0;
+
+	while (std::getline(in, line))
+		total += line.size();
+	return total;
+}
+
+std::size_t read_stdio(const std::string & name)
+{
+	FilePtr f(fopen(name.c_str(), "r"));
+	char * line = nullptr;
+	std::size_t cap = 0;
+	ssize_t n;
+	std::size_t total = 0;
+
+	// getline(3) rather than fgets(), so long lines aren't split
+	while ((n = ::getline(&line, &cap, f.get())) > 0)
+		total += n - (line[n - 1] == '\n');
+	free(line);
+	return total;
+}
+
+template <class F>
+clock_type::duration timed(F f)
+{
+	clock_type::time_point start = clock_type::now();
+	f();
+	return clock_type::now() - start;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	const long n = (argc > 1) ? atol(argv[1]) : 5000000;
+	const std::string dir = (argc > 2) ? argv[2] : "/tmp";
+
+	if (n <= 0)
+	{
+		fprintf(stderr, "usage: %s [count] [dir]\n", argv[0]);
+		return 1;
+	}
+
+	const std::string ints = dir + "/streambench.ints";
+	const std::string reals = dir + "/streambench.reals";
+
+	try {
+		std::mt19937_64 rng(42);
+		std::vector<long> iv(n);
+		std::vector<double> dv(n);
+
+		// mixed magnitudes, like counters and sizes
+		for (auto & x : iv)
+			x = static_cast<long>(rng() >> (rng() % 64));
+
+		std::uniform_real_distribution<double> pick(-1e6, 1e6);
+		for (auto & x : dv)
+			x = pick(rng);
+
+		printf("%ld values, one per line\n", n);
+		printf("%-24s %12s %10s\n", "", "lines/s", "ns/line");
+
+		report("ints io::writer", n, timed([&]() { write_xos(ints, iv); }));
+		report("ints ofstream", n, timed([&]() { write_fstream(ints, iv); }));
+		report("ints fprintf", n, timed([&]() { write_stdio(ints, iv); }));
+
+		report("doubles io::writer", n,
+		       timed([&]() { write_xos(reals, dv); }));
+		report("doubles ofstream", n,
+		       timed([&]() { write_fstream(reals, dv); }));
+		report("doubles fprintf", n,
+		       timed([&]() { write_stdio(reals, dv); }));
+
+		// every reader sees the same bytes
+		write_xos(ints, iv);
+		std::size_t a = 0, b = 0, c = 0;
+
+		read_xos(ints); // untimed, to warm the page cache
+		report("lines io::reader", n,
+		       timed([&]() { a = read_xos(ints); }));
+		report("lines ifstream", n,
+		       timed([&]() { b = read_fstream(ints); }));
+		report("lines getline(3)", n,
+		       timed([&]() { c = read_stdio(ints); }));
+
+		if (a != b || a != c)
+			fprintf(stderr, "readers disagree: %zu %zu %zu\n", a, b, c);
+	} catch (std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		unlink(ints.c_str());
+		unlink(reals.c_str());
+		return 1;
+	}
+
+	unlink(ints.c_str());
+	unlink(reals.c_str());
+	return 0;
+}
@@ -0,0 +1,356 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace io {
+
+constexpr unsigned timer_wheel::level_bits;
+constexpr unsigned timer_wheel::slots;
+constexpr unsigned timer_wheel::levels;
+constexpr std::uint32_t timer_wheel::nil;
+constexpr std::uint16_t timer_wheel::unlinked;
+
+namespace {
+
+/// Index of the first set bit at or after from in a 256-bit map, or -1
+inline int next_set_bit(const std::uint64_t * map, unsigned from) noexcept
+{
+	for (unsigned w = from / 64; w < 4; ++w)
+	{
+		std::uint64_t bits = map[w];
+		if (w == from / 64)
+			bits &= ~std::uint64_t(0) << (from % 64);
+		if (bits)
+			return static_cast<int>(w * 64 + __builtin_ctzll(bits));
+	}
+	return -1;
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+timer_wheel::timer_wheel(duration tick)
+  : m_timer(true)
+  , m_tick(std::max(tick, duration(1)))
+  , m_origin(clock_type::now())
+  , m_now(0)
+  , m_armed(0)
+  , m_entries()
+  , m_callbacks()
+  , m_free()
+  , m_size(0)
+{
+	std::fill(std::begin(m_heads), std::end(m_heads), nil);
+	std::memset(m_occupied, 0, sizeof(m_occupied));
+}
+
+//////////////////////////////////////////////////////////////////////
+std::uint64_t timer_wheel::deadline_tick(time_point t) const noexcept
+{
+	if (t <= m_origin)
+		return 0;
+	return static_cast<std::uint64_t>((t - m_origin + m_tick - duration(1))
+	                                  / m_tick);
+}
+
+std::uint64_t timer_wheel::current_tick(time_point t) const noexcept
+{
+	if (t <= m_origin)
+		return 0;
+	return static_cast<std::uint64_t>((t - m_origin) / m_tick);
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Files a timer by how far ahead of the current tick it expires. A
+/// timer already due goes in the current level 0 slot, which only
+/// happens while cascading, just before that slot fires.
+void timer_wheel::link(std::uint32_t index) noexcept
+{
+	entry & e = m_entries[index];
+	const std::uint64_t delta = e.expires - m_now;
+	std::uint64_t expires = e.expires;
+	unsigned level = 0;
+
+	while (level < levels - 1 && delta >= (std::uint64_t(1)
+	                                       << (level_bits * (level + 1))))
+		++level;
+
+	// beyond the wheel's reach: park at the far end until it comes round
+	if (delta >= (std::uint64_t(1) << (level_bits * levels)))
+		expires = m_now + (std::uint64_t(1) << (level_bits * levels)) - 1;
+
+	const unsigned slot = (expires >> (level_bits * level)) & (slots - 1);
+	const std::uint16_t list = static_cast<std::uint16_t>(level * slots + slot);
+
+	e.list = list;
+	e.prev = nil;
+	e.next = m_heads[list];
+	if (e.next != nil)
+		m_entries[e.next].prev = index;
+	m_heads[list] = index;
+	m_occupied[level][slot / 64] |= std::uint64_t(1) << (slot % 64);
+}
+
+//////////////////////////////////////////////////////////////////////
+void timer_wheel::unlink(std::uint32_t index) noexcept
+{
+	entry & e = m_entries[index];
+
+	if (e.prev != nil)
+		m_entries[e.prev].next = e.next;
+	else
+		m_heads[e.list] = e.next;
+
+	if (e.next != nil)
+		m_entries[e.next].prev = e.prev;
+
+	if (m_heads[e.list] == nil)
+	{
+		const unsigned level = e.list / slots;
+		const unsigned slot = e.list % slots;
+		m_occupied[level][slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+	}
+
+	e.list = unlinked;
+}
+
+//////////////////////////////////////////////////////////////////////
+void timer_wheel::release(std::uint32_t index) noexcept
+{
+	entry & e = m_entries[index];
+
+	if (++e.generation == 0)
+		e.generation = 1;
+
+	m_callbacks[index] = nullptr;
+	m_free.push_back(index);
+	--m_size;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Refiles everything in the slot of level that the current tick has
+/// just reached; it all lands in lower levels
+void timer_wheel::cascade(unsigned level) noexcept
+{
+	const unsigned slot = (m_now >> (level_bits * level)) & (slots - 1);
+	const unsigned list = level * slots + slot;
+	std::uint32_t i = m_heads[list];
+
+	m_heads[list] = nil;
+	m_occupied[level][slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+
+	while (i != nil)
+	{
+		const std::uint32_t next = m_entries[i].next;
+		link(i);
+		i = next;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+timer_wheel::entry * timer_wheel::find(timer_id id) noexcept
+{
+	const std::uint32_t index = static_cast<std::uint32_t>(id);
+	const std::uint32_t generation = static_cast<std::uint32_t>(id >> 32);
+
+	if (index >= m_entries.size())
+		return nullptr;
+
+	entry & e = m_entries[index];
+	return (e.generation == generation && e.list != unlinked) ? &e : nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////
+timer_wheel::timer_id timer_wheel::add_at(time_point deadline, callback_t cb)
+{
+	std::uint32_t index;
+
+	if (m_free.empty())
+	{
+		index = static_cast<std::uint32_t>(m_entries.size());
+		m_entries.push_back(entry{ 0, nil, nil, 1, unlinked });
+		m_callbacks.emplace_back();
+	} else
+	{
+		index = m_free.back();
+		m_free.pop_back();
+	}
+
+	entry & e = m_entries[index];
+	e.expires = std::max(deadline_tick(deadline), m_now + 1);
+	m_callbacks[index] = std::move(cb);
+	link(index);
+	++m_size;
+
+	if (m_armed == 0 || e.expires < m_armed)
+		arm(e.expires);
+
+	return (static_cast<timer_id>(e.generation) << 32) | index;
+}
+
+//////////////////////////////////////////////////////////////////////
+bool timer_wheel::cancel(timer_id id) noexcept
+{
+	entry * e = find(id);
+	if (! e)
+		return false;
+
+	// the timerfd stays armed; an early wakeup with nothing due is cheap
+	const std::uint32_t index = static_cast<std::uint32_t>(id);
+	unlink(index);
+	release(index);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+bool timer_wheel::restart_at(timer_id id, time_point deadline)
+{
+	entry * e = find(id);
+	if (! e)
+		return false;
+
+	const std::uint32_t index = static_cast<std::uint32_t>(id);
+	unlink(index);
+	e->expires = std::max(deadline_tick(deadline), m_now + 1);
+	link(index);
+
+	if (m_armed == 0 || e->expires < m_armed)
+		arm(e->expires);
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+std::size_t timer_wheel::expire(time_point now)
+{
+	const std::uint64_t target = current_tick(now);
+	std::size_t fired = 0;
+
+	// clear the timerfd's readiness once it has gone off; rearming it
+	// below would too, but only if the next wakeup differs
+	if (m_armed != 0 && m_armed <= target)
+	{
+		std::error_code ec;
+		m_timer.read_expirations(ec);
+	}
+
+	while (m_now < target)
+	{
+		if (m_size == 0)
+		{
+			m_now = target;
+			break;
+		}
+
+		// jump to the next level 0 slot with timers in it, or to the end
+		// of this turn of level 0, where the levels above cascade
+		const std::uint64_t base = m_now & ~std::uint64_t(slots - 1);
+		std::uint64_t next = base + slots;
+		const unsigned from = static_cast<unsigned>(m_now - base) + 1;
+
+		if (from < slots)
+		{
+			int s = next_set_bit(m_occupied[0], from);
+			if (s >= 0)
+				next = base + static_cast<unsigned>(s);
+		}
+
+		if (next > target)
+		{
+			m_now = target;
+			break;
+		}
+
+		m_now = next;
+
+		if ((m_now & (slots - 1)) == 0)
+		{
+			unsigned top = 1;
+			while (  top < levels - 1
+			      && (m_now & ((std::uint64_t(1) << (level_bits * (top + 1)))
+			                   - 1)) == 0 )
+				++top;
+
+			for (unsigned l = top; l > 0; --l)
+				cascade(l);
+		}
+
+		const std::uint16_t list
+		  = static_cast<std::uint16_t>(m_now & (slots - 1));
+
+		while (m_heads[list] != nil)
+		{
+			const std::uint32_t i = m_heads[list];
+			callback_t cb = std::move(m_callbacks[i]);
+
+			unlink(i);
+			release(i);
+			++fired;
+
+			// may add or cancel timers; nothing is held across the call
+			if (cb) cb();
+		}
+	}
+
+	const std::uint64_t wake = next_wakeup();
+	if (wake != m_armed)
+		arm(wake);
+
+	return fired;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// The next tick worth waking for: the first occupied slot ahead of the
+/// current one, looking at the lowest level first. For level 0 that is
+/// when the timers fire; above, it is when the slot cascades. Occupied
+/// slots behind the current one belong to the level's next turn, which
+/// starts where the level above moves on. 0 when there are no timers.
+std::uint64_t timer_wheel::next_wakeup() const noexcept
+{
+	if (m_size == 0)
+		return 0;
+
+	for (unsigned l = 0; l < levels; ++l)
+	{
+		const unsigned shift = level_bits * l;
+		const std::uint64_t pos = m_now >> shift;
+		const unsigned cur = static_cast<unsigned>(pos & (slots - 1));
+
+		int s = (cur + 1 < slots) ? next_set_bit(m_occupied[l], cur + 1) : -1;
+		if (s >= 0)
+			return (pos - cur + static_cast<unsigned>(s)) << shift;
+
+		if (next_set_bit(m_occupied[l], 0) >= 0)
+			return ((pos >> level_bits) + 1) << (shift + level_bits);
+	}
+
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+void timer_wheel::arm(std::uint64_t tick)
+{
+	if (tick == 0)
+		m_timer.disarm_timer();
+	else
+		m_timer.arm_absolute_timer(m_origin + m_tick * tick);
+
+	m_armed = tick;
+}
+
+//////////////////////////////////////////////////////////////////////
+reactor::handle timer_wheel::attach(reactor & r)
+{
+	return r.add(m_timer, EPOLLIN, [this](std::uint32_t) { expire(); });
+}
+
+//////////////////////////////////////////////////////////////////////
+void timer_wheel::reserve(std::size_t n)
+{
+	m_entries.reserve(n);
+	m_callbacks.reserve(n);
+	m_free.reserve(n);
+}
+
+} // namespace io
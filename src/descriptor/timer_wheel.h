@@ -0,0 +1,130 @@
+#ifndef GUARD_TIMER_WHEEL_H
+#define GUARD_TIMER_WHEEL_H 1
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "descriptor.h"
+#include "reactor.h"
+
+namespace io {
+
+//////////////////////////////////////////////////////////////////////
+/// Any number of timeouts driven by a single timerfd.
+///
+/// Timers live in a hierarchical timing wheel: four levels of 256 slots,
+/// each level's slot covering 256 times the span of the level below, so
+/// with the default 1 ms tick the wheel reaches about 49 days ahead (and
+/// anything further is parked at the far end until it comes in range).
+/// Adding, cancelling and restarting a timer are O(1); a timer moves down
+/// a level at most three times before it fires.
+///
+/// Deadlines are rounded up to whole ticks, so a timer never fires early
+/// and all timers due in the same tick expire as one batch. The timerfd
+/// is armed for the next tick with work in it rather than for every
+/// tick, so an idle wheel doesn't wake the process.
+///
+/// Not synchronized; use it from the thread that calls expire(), e.g.
+/// the one running the reactor it is attached to.
+class timer_wheel
+{
+ public:
+	typedef timer_descriptor<CLOCK_MONOTONIC> timer_type;
+	typedef timer_type::clock_type clock_type;
+	typedef timer_type::duration duration;
+	typedef timer_type::time_point time_point;
+
+	typedef std::function<void ()> callback_t;
+
+	/// Identifies a timer; 0 is never a valid one
+	typedef std::uint64_t timer_id;
+
+	explicit timer_wheel(duration tick = std::chrono::milliseconds(1));
+
+	timer_wheel(const timer_wheel &) = delete;
+	timer_wheel & operator = (const timer_wheel &) = delete;
+
+	/// Calls cb once timeout has passed
+	timer_id add(duration timeout, callback_t cb)
+		{ return add_at(clock_type::now() + timeout, std::move(cb)); }
+
+	/// Calls cb once deadline has passed
+	timer_id add_at(time_point deadline, callback_t cb);
+
+	/// Stops a timer; false if it has already fired or been cancelled
+	bool cancel(timer_id id) noexcept;
+
+	/// Moves a pending timer's deadline, keeping its callback, as for an
+	/// idle timeout that restarts on activity. False if it has already
+	/// fired or been cancelled.
+	bool restart(timer_id id, duration timeout)
+		{ return restart_at(id, clock_type::now() + timeout); }
+	bool restart_at(timer_id id, time_point deadline);
+
+	/// Fires every timer due by now and rearms the timerfd for the next.
+	/// Returns the number fired.
+	std::size_t expire() { return expire(clock_type::now()); }
+	std::size_t expire(time_point now);
+
+	/// Registers the timerfd with r, so that r's loop calls expire()
+	reactor::handle attach(reactor & r);
+
+	/// The timerfd, which becomes readable when a timer is due
+	const timer_type & descriptor() const noexcept { return m_timer; }
+
+	/// Makes room for n timers without reallocating
+	void reserve(std::size_t n);
+
+	/// Number of pending timers
+	std::size_t size() const noexcept { return m_size; }
+
+	duration tick() const noexcept { return m_tick; }
+
+ private:
+	static constexpr unsigned level_bits = 8;
+	static constexpr unsigned slots = 1u << level_bits;
+	static constexpr unsigned levels = 4;
+	static constexpr std::uint32_t nil = ~std::uint32_t(0);
+	static constexpr std::uint16_t unlinked = 0xffff;
+
+	struct entry
+	{
+		std::uint64_t expires;     // tick
+		std::uint32_t prev;
+		std::uint32_t next;
+		std::uint32_t generation;
+		std::uint16_t list;        // level * slots + slot, or unlinked
+	};
+
+	entry * find(timer_id id) noexcept;
+
+	std::uint64_t deadline_tick(time_point t) const noexcept;
+	std::uint64_t current_tick(time_point t) const noexcept;
+
+	void link(std::uint32_t index) noexcept;
+	void unlink(std::uint32_t index) noexcept;
+	void release(std::uint32_t index) noexcept;
+	void cascade(unsigned level) noexcept;
+	std::uint64_t next_wakeup() const noexcept;
+	void arm(std::uint64_t tick);
+
+	timer_type m_timer;
+	duration m_tick;
+	time_point m_origin;
+	std::uint64_t m_now;           // last tick processed
+	std::uint64_t m_armed;         // tick the timerfd is set for; 0 if none
+
+	std::vector<entry> m_entries;
+	std::vector<callback_t> m_callbacks;
+	std::vector<std::uint32_t> m_free;
+	std::size_t m_size;
+
+	std::uint32_t m_heads[levels * slots];
+	std::uint64_t m_occupied[levels][slots / 64];
+};
+
+} // namespace io
+
+#endif // GUARD_TIMER_WHEEL_H
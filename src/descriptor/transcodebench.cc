@@ -0,0 +1,183 @@
+// io::transcoder converting a UTF-16LE file to UTF-8, by way of char32_t
+// and straight from native order UTF-16, from a descriptor and from a
+// mapping, against reading the whole file into a u16string and using
+// wstring_convert, and against copying the bytes unconverted.
+//
+// usage: transcodebench [megabytes] [dir]
+//
+// The files go in dir (default /tmp) and are removed afterwards. The
+// input comes from the page cache, so the copy is the bandwidth the
+// conversions are measured against.
+
+#include "transcoder.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <locale>
+#include <random>
+#include <string>
+
+#include "codecvt/codecvt"
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+typedef std::codecvt_utf16<char32_t, 0x10ffff, std::little_endian> utf16le;
+typedef std::codecvt_utf8<char32_t> utf8;
+typedef std::codecvt_utf8_utf16<char16_t> utf8_utf16;
+
+void report(const char * what, std::size_t bytes, clock_type::duration d)
+{
+	double s = std::chrono::duration<double>(d).count();
+	printf("%-28s %10.0f %10.3f\n", what, bytes / s / 1e6, s);
+}
+
+/// Mostly ASCII, some Latin and CJK, the odd surrogate pair: like a
+/// database export with names in it
+void make_input(const std::string & name, std::size_t bytes)
+{
+	std::mt19937 rng(42);
+	std::u16string text;
+	text.reserve(bytes / 2 + 1);
+
+	while (text.size() * 2 < bytes)
+	{
+		const unsigned kind = rng() % 100;
+		if (kind < 85)
+			text += static_cast<char16_t>(' ' + rng() % 95);
+		else if (kind < 93)
+			text += static_cast<char16_t>(0xc0 + rng() % 0x180);
+		else if (kind < 99)
+			text += static_cast<char16_t>(0x4e00 + rng() % 0x5000);
+		else
+		{
+			text += static_cast<char16_t>(0xd83d);
+			text += static_cast<char16_t>(0xde00 + rng() % 0x50);
+		}
+	}
+
+	io::file_descriptor f(filesystem::path(name),
+	                      O_WRONLY | O_CREAT | O_TRUNC);
+	f.write(text.data(), text.size() * 2);
+}
+
+template <class T>
+std::size_t transcode_fd(T & t, const std::string & in,
+                         const std::string & out)
+{
+	io::file_descriptor from(filesystem::path(in), O_RDONLY);
+	io::file_descriptor to(filesystem::path(out),
+	                       O_WRONLY | O_CREAT | O_TRUNC);
+	return t.run(from, to).bytes_out;
+}
+
+template <class T>
+std::size_t transcode_mapped(T & t, const std::string & in,
+                             const std::string & out)
+{
+	io::mapped_file m(filesystem::path(in), io::map_mode::read_only);
+	io::file_descriptor to(filesystem::path(out),
+	                       O_WRONLY | O_CREAT | O_TRUNC);
+	m.advise(io::map_advice::sequential);
+	return t.run(m.bytes(), to).bytes_out;
+}
+
+std::size_t whole_string(const std::string & in, const std::string & out)
+{
+	io::file_descriptor from(filesystem::path(in), O_RDONLY);
+	std::u16string text(from.size() / 2, u'\0');
+	from.read(&text[0], text.size() * 2);
+
+	std::wstring_convert<utf8_utf16, char16_t> convert;
+	const std::string bytes = convert.to_bytes(text);
+
+	io::file_descriptor to(filesystem::path(out),
+	                       O_WRONLY | O_CREAT | O_TRUNC);
+	to.write(bytes.data(), bytes.size());
+	return bytes.size();
+}
+
+std::size_t copy(const std::string & in, const std::string & out)
+{
+	io::file_descriptor from(filesystem::path(in), O_RDONLY);
+	io::file_descriptor to(filesystem::path(out),
+	                       O_WRONLY | O_CREAT | O_TRUNC);
+	std::string buf(io::transcoder<utf16le, utf8>::default_chunk, '\0');
+	std::size_t total = 0, n;
+
+	while ((n = from.read(&buf[0], buf.size())) > 0)
+		total += to.write(buf.data(), n);
+	return total;
+}
+
+template <class F>
+clock_type::duration timed(F f)
+{
+	clock_type::time_point start = clock_type::now();
+	f();
+	return clock_type::now() - start;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	const long mb = (argc > 1) ? atol(argv[1]) : 256;
+	const std::string dir = (argc > 2) ? argv[2] : "/tmp";
+
+	if (mb <= 0)
+	{
+		fprintf(stderr, "usage: %s [megabytes] [dir]\n", argv[0]);
+		return 1;
+	}
+
+	const std::string in = dir + "/transcodebench.utf16";
+	const std::string out = dir + "/transcodebench.utf8";
+	const std::size_t bytes = static_cast<std::size_t>(mb) << 20;
+
+	try {
+		make_input(in, bytes);
+
+		utf16le decoder;
+		utf8 encoder;
+		io::native_utf16 copier;
+		utf8_utf16 encoder16;
+
+		io::transcoder<utf16le, utf8> by_char32(decoder, encoder);
+		io::transcoder<io::native_utf16, utf8_utf16> native(copier, encoder16);
+
+		std::size_t a = 0, b = 0, c = 0, d = 0;
+
+		printf("%ld MB of UTF-16LE to UTF-8\n", mb);
+		printf("%-28s %10s %10s\n", "", "MB/s in", "seconds");
+
+		copy(in, out); // untimed, to warm the page cache
+		report("copy, unconverted", bytes,
+		       timed([&]() { copy(in, out); }));
+		report("transcoder via char32_t", bytes,
+		       timed([&]() { a = transcode_fd(by_char32, in, out); }));
+		report("transcoder native_utf16", bytes,
+		       timed([&]() { b = transcode_fd(native, in, out); }));
+		report("transcoder native, mapped", bytes,
+		       timed([&]() { c = transcode_mapped(native, in, out); }));
+		report("wstring_convert, whole file", bytes,
+		       timed([&]() { d = whole_string(in, out); }));
+
+		if (a != b || a != c || a != d)
+			fprintf(stderr, "outputs disagree: %zu %zu %zu %zu\n", a, b, c, d);
+	} catch (std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		unlink(in.c_str());
+		unlink(out.c_str());
+		return 1;
+	}
+
+	unlink(in.c_str());
+	unlink(out.c_str());
+	return 0;
+}
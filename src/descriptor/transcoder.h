@@ -0,0 +1,500 @@
+#ifndef GUARD_TRANSCODER_H
+#define GUARD_TRANSCODER_H 1
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <locale>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+
+#include "descriptor.h"
+#include "mapped_file.h"
+
+namespace io {
+
+//////////////////////////////////////////////////////////////////////
+struct transcode_result
+{
+	enum status_type
+	{
+		ok,
+		invalid,    // the input had a sequence the facets can't convert
+		truncated,  // the input ended partway through a sequence
+	};
+
+	status_type status;
+
+	/// Input bytes converted. When the status isn't ok, this is where the
+	/// decoder stopped: the start of the sequence that couldn't be
+	/// converted, or for a decoder that reads a few bytes into it before
+	/// saying so, a little after.
+	std::uint64_t bytes_in;
+
+	/// Output bytes written
+	std::uint64_t bytes_out;
+
+	/// Characters passed from the decoder to the encoder
+	std::uint64_t characters;
+
+	explicit operator bool () const noexcept { return (status == ok); }
+};
+
+//////////////////////////////////////////////////////////////////////
+/// A decoder for UTF-16 already in the host's byte order, which only
+/// has to copy it, for a transcoder that feeds codecvt_utf8_utf16.
+/// A high surrogate at the end of the input is held back until the
+/// rest of its pair arrives; anything else is the encoder's to check.
+class native_utf16
+{
+ public:
+	typedef char16_t intern_type;
+	typedef char extern_type;
+	typedef std::mbstate_t state_type;
+
+	std::codecvt_base::result
+	in(state_type &, const char * from, const char * from_end,
+	   const char * & from_next, char16_t * to, char16_t * to_end,
+	   char16_t * & to_next) const noexcept
+	{
+		std::size_t n = std::min<std::size_t>((from_end - from) / 2,
+		                                      to_end - to);
+		std::memcpy(to, from, n * 2);
+
+		if (n > 0 && (to[n - 1] & 0xfc00) == 0xd800)
+			--n;
+
+		from_next = from + n * 2;
+		to_next = to + n;
+		return (from_next == from_end) ? std::codecvt_base::ok
+		                               : std::codecvt_base::partial;
+	}
+
+	int max_length() const noexcept { return 4; }
+};
+
+//////////////////////////////////////////////////////////////////////
+/// Converts a whole descriptor, or a mapped file, from one encoding to
+/// another, writing the result to a descriptor as it goes.
+///
+/// Decoder's in() turns input bytes into characters, and Encoder's out()
+/// turns those into output bytes, so a UTF-16 file becomes UTF-8 with
+/// e.g. codecvt_utf16<char32_t, 0x10ffff, consume_header> feeding
+/// codecvt_utf8<char32_t>, or, when it is in the host's byte order,
+/// native_utf16 feeding codecvt_utf8_utf16<char16_t>, which saves
+/// decoding it. Both conversion states, and input left over
+/// from a sequence cut by a buffer boundary, carry over from one buffer
+/// to the next. The three buffers are allocated once, by the
+/// constructor, and used for every run(); nothing else is copied.
+///
+/// Conversion errors stop the run and are reported in the result, with
+/// the offset of the offending input. I/O errors throw, or go through
+/// ec. Either way, output before the error has been written.
+///
+/// The facets are used, not owned, and must outlive the transcoder.
+/// out() is called once per buffer, so an encoder that writes a header
+/// would write one per buffer; give it no generate_header mode, and
+/// write a BOM first if one is wanted.
+template <class Decoder, class Encoder>
+class transcoder
+{
+ public:
+	typedef typename Decoder::intern_type intern_type;
+
+	static_assert(std::is_same<intern_type,
+	                           typename Encoder::intern_type>::value,
+	              "The facets must share an internal character type");
+	static_assert(  std::is_same<typename Decoder::extern_type, char>::value
+	             && std::is_same<typename Encoder::extern_type, char>::value,
+	              "The facets must convert to and from char");
+
+	static constexpr std::size_t default_chunk = 64 * 1024;
+
+	/// chunk is the size of each buffer, in bytes or characters
+	transcoder(const Decoder & d, const Encoder & e,
+	           std::size_t chunk = default_chunk);
+
+	transcoder(const transcoder &) = delete;
+	transcoder & operator = (const transcoder &) = delete;
+
+	/// Converts everything from, to end of file, into to
+	transcode_result run(const descriptor & from, const descriptor & to);
+	transcode_result run(const descriptor & from, const descriptor & to,
+	                     std::error_code & ec) noexcept;
+
+	/// Converts from, e.g. a mapped_file's bytes(), into to
+	transcode_result run(span<const char> from, const descriptor & to);
+	transcode_result run(span<const char> from, const descriptor & to,
+	                     std::error_code & ec) noexcept;
+
+ private:
+	typedef std::codecvt_base codecvt_base;
+
+	void reset() noexcept;
+
+	const char * convert(const char * p, const char * end, bool last,
+	                     transcode_result & r, std::error_code & ec) noexcept;
+	void finish(transcode_result & r, std::error_code & ec) noexcept;
+
+	std::size_t encode(const intern_type * from, const intern_type * end,
+	                   transcode_result & r, std::error_code & ec) noexcept;
+	void flush(std::error_code & ec) noexcept;
+
+	const Decoder & m_decoder;
+	const Encoder & m_encoder;
+	const std::size_t m_chunk;
+
+	std::unique_ptr<char[]> m_in;
+	std::unique_ptr<intern_type[]> m_mid;
+	std::unique_ptr<char[]> m_out;
+	std::size_t m_out_used;
+	int m_to;
+
+	std::mbstate_t m_in_state;
+	std::mbstate_t m_out_state;
+};
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+constexpr std::size_t transcoder<D, E>::default_chunk;
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+transcoder<D, E>::transcoder(const D & d, const E & e, std::size_t chunk)
+  : m_decoder(d)
+  , m_encoder(e)
+  , m_chunk(std::max<std::size_t>(chunk, 64))
+  , m_in(new char[m_chunk])
+  , m_mid(new intern_type[m_chunk])
+  , m_out(new char[m_chunk])
+  , m_out_used(0)
+  , m_to(-1)
+  , m_in_state()
+  , m_out_state()
+{ }
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+void transcoder<D, E>::reset() noexcept
+{
+	m_out_used = 0;
+	std::memset(&m_in_state, 0, sizeof(m_in_state));
+	std::memset(&m_out_state, 0, sizeof(m_out_state));
+}
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+transcode_result transcoder<D, E>::run(const descriptor & from,
+                                       const descriptor & to)
+{
+	std::error_code ec;
+	transcode_result r = run(from, to, ec);
+	if (ec) throw make_syserr(ec.value(), "transcoding I/O failed");
+	return r;
+}
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+transcode_result transcoder<D, E>::run(const descriptor & from,
+                                       const descriptor & to,
+                                       std::error_code & ec) noexcept
+{
+	transcode_result r = { transcode_result::ok, 0, 0, 0 };
+	const int fd = from.native_handle();
+	std::size_t held = 0;
+
+	ec.clear();
+	reset();
+	m_to = to.native_handle();
+
+	for (;;)
+	{
+		char * const buf = m_in.get();
+		const std::size_t n = detail::retry_io(
+		    [&]() { return ::read(fd, buf + held, m_chunk - held); }, ec);
+		if (ec)
+			return r;
+
+		if (n == 0)
+		{
+			// whatever is still held is the start of a sequence that
+			// never got finished, unless the decoder says otherwise
+			if (held > 0)
+			{
+				convert(buf, buf + held, true, r, ec);
+				if (! ec && r.status == transcode_result::ok)
+					r.status = transcode_result::truncated;
+			}
+			else
+				finish(r, ec);
+			break;
+		}
+
+		const char * end = buf + held + n;
+		const char * p = convert(buf, end, false, r, ec);
+		if (ec || r.status != transcode_result::ok)
+			break;
+
+		// a sequence cut off by the end of the buffer goes round again
+		held = end - p;
+		std::memmove(buf, p, held);
+	}
+
+	if (! ec)
+		flush(ec);
+	return r;
+}
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+transcode_result transcoder<D, E>::run(span<const char> from,
+                                       const descriptor & to)
+{
+	std::error_code ec;
+	transcode_result r = run(from, to, ec);
+	if (ec) throw make_syserr(ec.value(), "transcoding I/O failed");
+	return r;
+}
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+transcode_result transcoder<D, E>::run(span<const char> from,
+                                       const descriptor & to,
+                                       std::error_code & ec) noexcept
+{
+	transcode_result r = { transcode_result::ok, 0, 0, 0 };
+
+	ec.clear();
+	reset();
+	m_to = to.native_handle();
+
+	// no input buffer: the decoder reads the mapping directly
+	const char * p = convert(from.begin(), from.end(), true, r, ec);
+
+	if (! ec && r.status == transcode_result::ok)
+	{
+		if (p != from.end())
+			r.status = transcode_result::truncated;
+		else
+			finish(r, ec);
+	}
+
+	if (! ec)
+		flush(ec);
+	return r;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Decodes and encodes as much of [p, end) as makes whole characters,
+/// returning where it stopped. Stops early, with r's status set, at a
+/// conversion error.
+///
+/// Some decoders call a sequence cut off by the end of their input an
+/// error rather than partial, so unless this is the last of the input,
+/// an error within max_length() of the end waits for more.
+template <class D, class E>
+const char * transcoder<D, E>::convert(const char * p, const char * end,
+                                       bool last, transcode_result & r,
+                                       std::error_code & ec) noexcept
+{
+	intern_type * const mid = m_mid.get();
+	intern_type * const mid_end = mid + m_chunk;
+	const std::ptrdiff_t longest = std::max(m_decoder.max_length(), 1);
+
+	while (p < end)
+	{
+		const std::mbstate_t before = m_in_state;
+		const char * next = p;
+		intern_type * mid_next = mid;
+
+		const codecvt_base::result res
+		  = m_decoder.in(m_in_state, p, end, next, mid, mid_end, mid_next);
+
+		if (res == codecvt_base::noconv)
+		{
+			r.status = transcode_result::invalid;
+			return p;
+		}
+
+		const std::size_t encoded = encode(mid, mid_next, r, ec);
+		if (ec)
+			return p;
+
+		if (mid + encoded != mid_next)
+		{
+			// find the input offset of the character the encoder refused
+			// by decoding just up to it again
+			std::mbstate_t s = before;
+			const char * at = p;
+			intern_type * ignored;
+			m_decoder.in(s, p, end, at, mid, mid + encoded, ignored);
+
+			r.status = transcode_result::invalid;
+			r.bytes_in += at - p;
+			return at;
+		}
+
+		r.bytes_in += next - p;
+
+		if (res == codecvt_base::error)
+		{
+			if (! last && end - next < longest)
+				return next;
+
+			r.status = transcode_result::invalid;
+			return next;
+		}
+
+		// no whole character left in the input
+		if (next == p && mid_next == mid)
+			break;
+
+		p = next;
+	}
+
+	return p;
+}
+
+//////////////////////////////////////////////////////////////////////
+/// At the end of the input: lets a decoder that keeps characters in its
+/// state produce what it has, and has the encoder return to its
+/// initial state
+template <class D, class E>
+void transcoder<D, E>::finish(transcode_result & r,
+                              std::error_code & ec) noexcept
+{
+	intern_type * const mid = m_mid.get();
+	const char * const none = m_in.get();
+
+	for (int tries = 0; tries < 4; ++tries)
+	{
+		const char * next = none;
+		intern_type * mid_next = mid;
+
+		m_decoder.in(m_in_state, none, none, next,
+		             mid, mid + m_chunk, mid_next);
+
+		if (mid_next == mid)
+			break;
+
+		if (encode(mid, mid_next, r, ec) != std::size_t(mid_next - mid))
+		{
+			r.status = transcode_result::invalid;
+			return;
+		}
+		if (ec)
+			return;
+	}
+
+	// mbsinit() looks at the state's count, which is also where these
+	// facets keep track of a sequence in progress
+	if (! std::mbsinit(&m_in_state))
+	{
+		r.status = transcode_result::truncated;
+		return;
+	}
+
+	for (int tries = 0; tries < 4; ++tries)
+	{
+		if (m_chunk - m_out_used < static_cast<std::size_t>(
+		                               m_encoder.max_length()))
+		{
+			flush(ec);
+			if (ec)
+				return;
+		}
+
+		char * const to = m_out.get() + m_out_used;
+		char * to_next = to;
+		const codecvt_base::result res
+		  = m_encoder.unshift(m_out_state, to, m_out.get() + m_chunk, to_next);
+
+		m_out_used += to_next - to;
+		r.bytes_out += to_next - to;
+
+		if (res != codecvt_base::partial)
+			break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Encodes [from, end) into the output buffer, writing it out whenever
+/// it fills. Returns the number of characters encoded, short of the
+/// whole range only if the encoder refused one.
+template <class D, class E>
+std::size_t transcoder<D, E>::encode(const intern_type * from,
+                                     const intern_type * end,
+                                     transcode_result & r,
+                                     std::error_code & ec) noexcept
+{
+	const intern_type * const start = from;
+	const std::size_t room = std::max(m_encoder.max_length(), 1);
+
+	while (from < end)
+	{
+		if (m_chunk - m_out_used < room)
+		{
+			flush(ec);
+			if (ec)
+				break;
+		}
+
+		char * const to = m_out.get() + m_out_used;
+		char * to_next = to;
+		const intern_type * from_next = from;
+
+		const codecvt_base::result res
+		  = m_encoder.out(m_out_state, from, end, from_next,
+		                  to, m_out.get() + m_chunk, to_next);
+
+		m_out_used += to_next - to;
+		r.bytes_out += to_next - to;
+		r.characters += from_next - from;
+
+		if (res == codecvt_base::error || res == codecvt_base::noconv)
+			return from_next - start;
+
+		// stuck with room for a whole character: nothing more will go
+		if (from_next == from && to_next == to && m_out_used == 0)
+			return from_next - start;
+
+		from = from_next;
+
+		// the output is full, possibly partway through a character
+		if (res == codecvt_base::partial)
+		{
+			flush(ec);
+			if (ec)
+				break;
+		}
+	}
+
+	return end - start;
+}
+
+//////////////////////////////////////////////////////////////////////
+template <class D, class E>
+void transcoder<D, E>::flush(std::error_code & ec) noexcept
+{
+	const char * p = m_out.get();
+	const char * const end = p + m_out_used;
+
+	while (p < end)
+	{
+		const std::size_t n = detail::retry_io(
+		    [&]() { return ::write(m_to, p, end - p); }, ec);
+		if (ec)
+			return;
+		p += n;
+	}
+
+	m_out_used = 0;
+}
+
+} // namespace io
+
+#endif // GUARD_TRANSCODER_H
@@ -0,0 +1,162 @@
+// A million pending timers: adding them, cancelling half, restarting
+// the rest, and expiring everything by stepping simulated time forward
+// a tick at a time, in a timer_wheel and in a std::multimap ordered by
+// deadline (the usual priority queue that still supports cancelling).
+//
+// usage: wheelbench [timers]
+//
+// Timeouts are spread uniformly over ten minutes at the default 1 ms
+// tick, so most timers start out on the upper levels and cascade.
+// Each expire() that fires anything also reads and rearms the timerfd,
+// two system calls that dominate when it is called every tick; the
+// wheel is run again expiring every 100 ms to show the batched cost.
+
+#include "timer_wheel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+typedef io::timer_wheel::time_point time_point;
+typedef std::chrono::milliseconds ms;
+
+constexpr long span_ms = 10 * 60 * 1000;
+
+void report(const char * what, std::size_t n, clock_type::duration d)
+{
+	double s = std::chrono::duration<double>(d).count();
+	printf("%-22s %12.0f %10.1f\n", what, n / s, s * 1e9 / n);
+}
+
+/// Counts firings through a pointer, which fits std::function's inline
+/// storage, so neither container allocates for the callback itself
+struct counter
+{
+	std::size_t * fired;
+	void operator () () const { ++*fired; }
+};
+
+void bench_wheel(const std::vector<long> & timeouts, time_point t0,
+                 long step)
+{
+	const std::size_t n = timeouts.size();
+	io::timer_wheel w;
+	std::vector<io::timer_wheel::timer_id> ids(n);
+	std::size_t fired = 0;
+	clock_type::time_point start;
+
+	w.reserve(n);
+
+	start = clock_type::now();
+	for (std::size_t i = 0; i < n; ++i)
+		ids[i] = w.add_at(t0 + ms(timeouts[i]), counter{ &fired });
+	report("wheel add", n, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (std::size_t i = 0; i < n; i += 2)
+		w.cancel(ids[i]);
+	report("wheel cancel", n / 2, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (std::size_t i = 1; i < n; i += 2)
+		w.restart_at(ids[i], t0 + ms(timeouts[i - 1]));
+	report("wheel restart", n / 2, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (long t = step; t <= span_ms + step; t += step)
+		w.expire(t0 + ms(t));
+	report(step == 1 ? "wheel expire" : "wheel expire batched",
+	       n / 2, clock_type::now() - start);
+
+	if (fired != n / 2 || w.size() != 0)
+		fprintf(stderr, "wheel fired %zu of %zu\n", fired, n / 2);
+}
+
+void bench_multimap(const std::vector<long> & timeouts, time_point t0)
+{
+	typedef std::multimap<time_point, counter> queue_type;
+
+	const std::size_t n = timeouts.size();
+	queue_type q;
+	std::vector<queue_type::iterator> ids(n);
+	std::size_t fired = 0;
+	clock_type::time_point start;
+
+	start = clock_type::now();
+	for (std::size_t i = 0; i < n; ++i)
+		ids[i] = q.emplace(t0 + ms(timeouts[i]), counter{ &fired });
+	report("multimap add", n, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (std::size_t i = 0; i < n; i += 2)
+		q.erase(ids[i]);
+	report("multimap cancel", n / 2, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (std::size_t i = 1; i < n; i += 2)
+	{
+		counter c = ids[i]->second;
+		q.erase(ids[i]);
+		ids[i] = q.emplace(t0 + ms(timeouts[i - 1]), c);
+	}
+	report("multimap restart", n / 2, clock_type::now() - start);
+
+	start = clock_type::now();
+	for (long t = 1; t <= span_ms + 1; ++t)
+	{
+		const time_point now = t0 + ms(t);
+		while (! q.empty() && q.begin()->first <= now)
+		{
+			counter c = q.begin()->second;
+			q.erase(q.begin());
+			c();
+		}
+	}
+	report("multimap expire", n / 2, clock_type::now() - start);
+
+	if (fired != n / 2)
+		fprintf(stderr, "multimap fired %zu of %zu\n", fired, n / 2);
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	const long n = (argc > 1) ? atol(argv[1]) : 1000000;
+
+	if (n <= 0)
+	{
+		fprintf(stderr, "usage: %s [timers]\n", argv[0]);
+		return 1;
+	}
+
+	try {
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<long> pick(1, span_ms);
+		std::vector<long> timeouts(n);
+
+		for (auto & t : timeouts)
+			t = pick(rng);
+
+		const time_point t0 = io::timer_wheel::clock_type::now();
+
+		printf("%ld timers over %ld s, 1 ms ticks\n", n, span_ms / 1000);
+		printf("%-22s %12s %10s\n", "", "ops/s", "ns/op");
+
+		bench_wheel(timeouts, t0, 1);
+		bench_multimap(timeouts, t0);
+		bench_wheel(timeouts, t0, 100);
+	} catch (std::exception & e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
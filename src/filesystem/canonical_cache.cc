@@ -0,0 +1,81 @@
+#include "canonical_cache.h"
+#include "filesystem_error.h"
+#include "fs_operations.h"
+#include "path_view.h"
+
+#include <sys/stat.h>
+
+namespace filesystem {
+inline namespace v1 {
+
+canonical_cache::canonical_cache(std::size_t capacity)
+  : m_dirs()
+  , m_capacity(capacity)
+  , m_hits(0)
+  , m_misses(0)
+	{ }
+
+canonical_cache::~canonical_cache() { }
+
+path canonical_cache::canonical(const path & p)
+{
+	std::error_code ec;
+	path ret = canonical(p, ec);
+	if (ec) throw filesystem_error("Could not find canonical path", p, ec);
+	return ret;
+}
+
+path canonical_cache::canonical(const path & p, std::error_code & ec)
+{
+	ec.clear();
+
+	path abs = p.is_absolute() ? p : absolute(p, current_path());
+	const path_view v(abs);
+	const path_view name = v.filename();
+
+	// names that move through the directory itself need the full walk
+	if (  name.empty() || is_linking_directory(name)
+	   || (name.size() == 1 && name[0] == path::preferred_separator) )
+		return filesystem::canonical(abs, ec);
+
+	const std::string parent = v.parent_path().string();
+	auto i = m_dirs.find(parent);
+
+	if (i == m_dirs.end())
+	{
+		++m_misses;
+
+		path dir = filesystem::canonical(path(parent), ec);
+		if (ec)
+			return path();
+
+		if (m_dirs.size() >= m_capacity)
+			m_dirs.clear();
+
+		i = m_dirs.emplace(parent, dir.native()).first;
+	} else
+		++m_hits;
+
+	path ret(i->second);
+	ret /= name.to_path();
+
+	struct stat st;
+	if (lstat(ret.c_str(), &st) != 0)
+	{
+		ec = make_errno_ec();
+		return path();
+	}
+
+	if (S_ISLNK(st.st_mode))
+		return filesystem::canonical(ret, ec);
+
+	return ret;
+}
+
+void canonical_cache::clear() noexcept
+{
+	m_dirs.clear();
+}
+
+} // inline namespace v1
+} // namespace filesystem
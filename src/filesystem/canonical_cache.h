@@ -0,0 +1,49 @@
+#ifndef GUARD_FS_CANONICAL_CACHE_H
+#define GUARD_FS_CANONICAL_CACHE_H 1
+
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+#include "path.h"
+
+namespace filesystem {
+inline namespace v1 {
+
+/// canonical_cache memoizes the canonical form of parent directories, so
+/// that resolving many names in the same few directories costs a single
+/// lstat() per call instead of a full path resolution.
+///
+/// Cached directories are not revalidated: if a directory on a cached
+/// path is renamed or a symlink on it is repointed, results are stale
+/// until clear() is called. When the cache reaches its capacity it is
+/// simply emptied.
+///
+/// A canonical_cache is not synchronized.
+class canonical_cache
+{
+ public:
+	explicit canonical_cache(std::size_t capacity = 256);
+	~canonical_cache();
+
+	path canonical(const path & p);
+	path canonical(const path & p, std::error_code & ec);
+
+	void clear() noexcept;
+	std::size_t size() const noexcept { return m_dirs.size(); }
+	std::size_t capacity() const noexcept { return m_capacity; }
+
+	std::size_t hits() const noexcept { return m_hits; }
+	std::size_t misses() const noexcept { return m_misses; }
+
+ private:
+	std::unordered_map<std::string, std::string> m_dirs;
+	std::size_t m_capacity;
+	std::size_t m_hits;
+	std::size_t m_misses;
+};
+
+} // inline namespace v1
+} // namespace filesystem
+
+#endif // GUARD_FS_CANONICAL_CACHE_H
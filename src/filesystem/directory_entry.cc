@@ -1,7 +1,15 @@
 #include "directory_entry.h"
+#include "filesystem_error.h"
 #include "fs_operations.h"
 #include "path.h"
+#include "stat_conversions.h"
+#include "time/timeutil.h"
 
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include <atomic>
+#include <cerrno>
 
 namespace filesystem {
 inline namespace v1 {
@@ -16,34 +24,266 @@ directory_entry::~directory_entry()
 void directory_entry::assign(const class path & p)
 {
 	pathname = p;
+	invalidate();
 }
 
 void directory_entry::replace_filename(const class path & p)
 {
 	pathname.replace_filename(p);
+	invalidate();
+}
+
+void directory_entry::refresh()
+{
+	std::error_code ec;
+	refresh(ec);
+	if (ec) throw filesystem_error("Could not refresh directory entry",
+	                               pathname, ec);
+}
+
+void directory_entry::refresh(std::error_code & ec) noexcept
+{
+	invalidate();
+	link_attributes(ec);
+}
+
+//////////////////////////////////////////////////////////////////////
+/// Fills a from one stat of p, following a final symlink when asked to.
+/// A missing file is not an error; it is cached as not_found.
+bool directory_entry::fetch(const char * p, bool follow, attributes & a,
+                            std::error_code & ec) noexcept
+{
+	ec.clear();
+
+#ifdef STATX_TYPE
+	static std::atomic<bool> have_statx{true};
+
+	if (have_statx.load(std::memory_order_relaxed))
+	{
+		struct statx stx;
+		const unsigned int mask = ( STATX_TYPE | STATX_MODE | STATX_NLINK
+		                          | STATX_SIZE | STATX_MTIME );
+
+		if (statx(AT_FDCWD, p,
+		          AT_STATX_SYNC_AS_STAT | (follow ? 0 : AT_SYMLINK_NOFOLLOW),
+		          mask, &stx) == 0)
+		{
+			struct timespec ts;
+			ts.tv_sec = stx.stx_mtime.tv_sec;
+			ts.tv_nsec = stx.stx_mtime.tv_nsec;
+
+			a.status = file_status(st_mode_to_file_type(stx.stx_mode),
+			                       st_mode_to_perms(stx.stx_mode));
+			a.size = stx.stx_size;
+			a.nlink = stx.stx_nlink;
+			a.mtime = to_timepoint<file_time_type::clock,
+			                       file_time_type::duration>(ts);
+			return true;
+		}
+
+		if (errno == ENOSYS)
+			have_statx.store(false, std::memory_order_relaxed);
+	}
+
+	if (! have_statx.load(std::memory_order_relaxed))
+#endif
+	{
+		struct stat st;
+
+		if ((follow ? stat(p, &st) : lstat(p, &st)) == 0)
+		{
+			a.status = file_status(st_mode_to_file_type(st.st_mode),
+			                       st_mode_to_perms(st.st_mode));
+			a.size = st.st_size;
+			a.nlink = st.st_nlink;
+			a.mtime = to_timepoint<file_time_type::clock,
+			                       file_time_type::duration>(st.st_mtim);
+			return true;
+		}
+	}
+
+	if (errno == ENOENT || errno == ENOTDIR)
+	{
+		a.status = file_status(file_type::not_found);
+		a.size = static_cast<uintmax_t>(-1);
+		a.nlink = static_cast<uintmax_t>(-1);
+		a.mtime = file_time_type::min();
+		return true;
+	}
+
+	ec = make_errno_ec();
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////
+const directory_entry::attributes *
+directory_entry::link_attributes(std::error_code & ec) const noexcept
+{
+	ec.clear();
+
+	if (m_cached & link_cached)
+		return &m_link;
+
+	if (! fetch(pathname.c_str(), false, m_link, ec))
+		return nullptr;
+
+	m_cached |= link_cached;
+
+	// anything but a symlink is its own target, so one call answers both
+	if (m_link.status.type() != file_type::symlink)
+	{
+		m_target = m_link;
+		m_cached |= target_cached;
+	}
+
+	return &m_link;
+}
+
+const directory_entry::attributes *
+directory_entry::target_attributes(std::error_code & ec) const noexcept
+{
+	ec.clear();
+
+	if (m_cached & target_cached)
+		return &m_target;
+
+	if (! link_attributes(ec))
+		return nullptr;
+
+	if (m_cached & target_cached)
+		return &m_target;
+
+	if (! fetch(pathname.c_str(), true, m_target, ec))
+		return nullptr;
+
+	m_cached |= target_cached;
+	return &m_target;
 }
 
+//////////////////////////////////////////////////////////////////////
 file_status directory_entry::status() const
 {
-	return filesystem::status(pathname);
+	std::error_code ec;
+	file_status ret = status(ec);
+	if (ec) throw filesystem_error("Could not stat file", pathname, ec);
+	return ret;
 }
 
 file_status directory_entry::status(std::error_code & ec) const noexcept
 {
-	return filesystem::status(pathname, ec);
+	const attributes * a = target_attributes(ec);
+	return a ? a->status : file_status();
 }
 
 file_status directory_entry::symlink_status() const
 {
-	return filesystem::symlink_status(pathname);
+	std::error_code ec;
+	file_status ret = symlink_status(ec);
+	if (ec) throw filesystem_error("Could not stat file", pathname, ec);
+	return ret;
 }
 
 file_status
 directory_entry::symlink_status(std::error_code & ec) const noexcept
 {
-	return filesystem::symlink_status(pathname, ec);
+	const attributes * a = link_attributes(ec);
+	return a ? a->status : file_status();
+}
+
+bool directory_entry::exists() const
+	{ return filesystem::exists(status()); }
+
+bool directory_entry::exists(std::error_code & ec) const noexcept
+	{ return filesystem::exists(status(ec)); }
+
+bool directory_entry::is_directory() const
+	{ return filesystem::is_directory(status()); }
+
+bool directory_entry::is_directory(std::error_code & ec) const noexcept
+	{ return filesystem::is_directory(status(ec)); }
+
+bool directory_entry::is_regular_file() const
+	{ return filesystem::is_regular_file(status()); }
+
+bool directory_entry::is_regular_file(std::error_code & ec) const noexcept
+	{ return filesystem::is_regular_file(status(ec)); }
+
+bool directory_entry::is_symlink() const
+	{ return filesystem::is_symlink(symlink_status()); }
+
+bool directory_entry::is_symlink(std::error_code & ec) const noexcept
+	{ return filesystem::is_symlink(symlink_status(ec)); }
+
+//////////////////////////////////////////////////////////////////////
+uintmax_t directory_entry::file_size() const
+{
+	std::error_code ec;
+	uintmax_t ret = file_size(ec);
+	if (ec) throw filesystem_error("Could not read file size", pathname, ec);
+	return ret;
+}
+
+uintmax_t directory_entry::file_size(std::error_code & ec) const noexcept
+{
+	const attributes * a = target_attributes(ec);
+
+	if (! a)
+		return static_cast<uintmax_t>(-1);
+
+	if (a->status.type() == file_type::not_found)
+	{
+		ec = std::make_error_code(std::errc::no_such_file_or_directory);
+		return static_cast<uintmax_t>(-1);
+	}
+
+	if (a->status.type() != file_type::regular)
+	{
+		ec = std::make_error_code(std::errc::not_supported);
+		return static_cast<uintmax_t>(-1);
+	}
+
+	return a->size;
+}
+
+uintmax_t directory_entry::hard_link_count() const
+{
+	std::error_code ec;
+	uintmax_t ret = hard_link_count(ec);
+	if (ec) throw filesystem_error("Could not read link count", pathname, ec);
+	return ret;
 }
 
+uintmax_t directory_entry::hard_link_count(std::error_code & ec) const
+                                           noexcept
+{
+	const attributes * a = target_attributes(ec);
+
+	if (a && a->status.type() == file_type::not_found)
+		ec = std::make_error_code(std::errc::no_such_file_or_directory);
+
+	return (a && ! ec) ? a->nlink : static_cast<uintmax_t>(-1);
+}
+
+file_time_type directory_entry::last_write_time() const
+{
+	std::error_code ec;
+	file_time_type ret = last_write_time(ec);
+	if (ec)
+		throw filesystem_error("Could not read file modification time",
+		                       pathname, ec);
+	return ret;
+}
+
+file_time_type directory_entry::last_write_time(std::error_code & ec) const
+                                                noexcept
+{
+	const attributes * a = target_attributes(ec);
+
+	if (a && a->status.type() == file_type::not_found)
+		ec = std::make_error_code(std::errc::no_such_file_or_directory);
+
+	return (a && ! ec) ? a->mtime : file_time_type::min();
+}
 
 } // inline namespace v1
 } // namespace filesystem
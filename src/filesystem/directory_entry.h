@@ -1,15 +1,25 @@
 #ifndef GUARD_DIRECTORY_ENTRY_H
 #define GUARD_DIRECTORY_ENTRY_H 1
 
+#include <cstdint>
 #include <system_error>
 
 #include "path.h"
+#include "file_status.h"
+#include "fs_operations.h"
 
 namespace filesystem {
 inline namespace v1 {
 
-class file_status;
-
+/// directory_entry caches the metadata of the file it names.
+///
+/// The first observer to need it fetches type, permissions, size, link
+/// count and modification time with a single statx() (lstat semantics),
+/// and every later observer answers from memory. A symlink's target is
+/// only examined when a following observer asks for it. The cache is
+/// never refreshed behind the caller's back: it stays as it was until
+/// refresh() or invalidate() is called, or the entry is assigned a new
+/// path.
 class directory_entry
 {
  public:
@@ -31,6 +41,15 @@ class directory_entry
 
 	void replace_filename(const class path & p);
 
+	/// Re-reads the metadata now
+	void refresh();
+
+	void refresh(std::error_code & ec) noexcept;
+
+	/// Drops the cached metadata; the next observer re-reads it
+	void invalidate() noexcept
+		{ m_cached = 0; }
+
 	const class path & path() const noexcept
 		{ return pathname; }
 
@@ -45,6 +64,34 @@ class directory_entry
 
 	file_status symlink_status(std::error_code & ec) const noexcept;
 
+	bool exists() const;
+
+	bool exists(std::error_code & ec) const noexcept;
+
+	bool is_directory() const;
+
+	bool is_directory(std::error_code & ec) const noexcept;
+
+	bool is_regular_file() const;
+
+	bool is_regular_file(std::error_code & ec) const noexcept;
+
+	bool is_symlink() const;
+
+	bool is_symlink(std::error_code & ec) const noexcept;
+
+	uintmax_t file_size() const;
+
+	uintmax_t file_size(std::error_code & ec) const noexcept;
+
+	uintmax_t hard_link_count() const;
+
+	uintmax_t hard_link_count(std::error_code & ec) const noexcept;
+
+	file_time_type last_write_time() const;
+
+	file_time_type last_write_time(std::error_code & ec) const noexcept;
+
 	bool operator == (const directory_entry & rhs) const noexcept
 		{ return pathname == rhs.pathname; }
 
@@ -64,9 +111,87 @@ class directory_entry
 		{ return pathname >= rhs.pathname; }
 
  private:
+	struct attributes
+	{
+		file_status status;
+		uintmax_t size;
+		uintmax_t nlink;
+		file_time_type mtime;
+	};
+
+	enum : unsigned char
+	{
+		link_cached   = (1 << 0),
+		target_cached = (1 << 1),
+	};
+
+	static bool fetch(const char * p, bool follow, attributes & a,
+	                  std::error_code & ec) noexcept;
+
+	const attributes * link_attributes(std::error_code & ec) const noexcept;
+	const attributes * target_attributes(std::error_code & ec) const noexcept;
+
 	class path pathname;
+	mutable attributes m_link;    // the entry itself
+	mutable attributes m_target;  // what it resolves to
+	mutable unsigned char m_cached = 0;
 };
 
+// Overloads that answer from the entry's cache rather than the file system
+
+inline file_status status(const directory_entry & d)
+	{ return d.status(); }
+inline file_status status(const directory_entry & d,
+                          std::error_code & ec) noexcept
+	{ return d.status(ec); }
+
+inline file_status symlink_status(const directory_entry & d)
+	{ return d.symlink_status(); }
+inline file_status symlink_status(const directory_entry & d,
+                                  std::error_code & ec) noexcept
+	{ return d.symlink_status(ec); }
+
+inline bool exists(const directory_entry & d)
+	{ return d.exists(); }
+inline bool exists(const directory_entry & d, std::error_code & ec) noexcept
+	{ return d.exists(ec); }
+
+inline bool is_directory(const directory_entry & d)
+	{ return d.is_directory(); }
+inline bool is_directory(const directory_entry & d,
+                         std::error_code & ec) noexcept
+	{ return d.is_directory(ec); }
+
+inline bool is_regular_file(const directory_entry & d)
+	{ return d.is_regular_file(); }
+inline bool is_regular_file(const directory_entry & d,
+                            std::error_code & ec) noexcept
+	{ return d.is_regular_file(ec); }
+
+inline bool is_symlink(const directory_entry & d)
+	{ return d.is_symlink(); }
+inline bool is_symlink(const directory_entry & d,
+                       std::error_code & ec) noexcept
+	{ return d.is_symlink(ec); }
+
+inline uintmax_t file_size(const directory_entry & d)
+	{ return d.file_size(); }
+inline uintmax_t file_size(const directory_entry & d,
+                           std::error_code & ec) noexcept
+	{ return d.file_size(ec); }
+
+inline uintmax_t hard_link_count(const directory_entry & d)
+	{ return d.hard_link_count(); }
+inline uintmax_t hard_link_count(const directory_entry & d,
+                                 std::error_code & ec) noexcept
+	{ return d.hard_link_count(ec); }
+
+inline file_time_type last_write_time(const directory_entry & d)
+	{ return d.last_write_time(); }
+inline file_time_type last_write_time(const directory_entry & d,
+                                      std::error_code & ec) noexcept
+	{ return d.last_write_time(ec); }
+
 } // inline namespace v1
 } // namespace filesystem
 
@@ -0,0 +1,260 @@
+#include "disk_usage.h"
+#include "filesystem_error.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+
+namespace filesystem {
+inline namespace v1 {
+
+namespace {
+
+struct inode_key
+{
+	dev_t dev;
+	ino_t ino;
+
+	bool operator == (const inode_key & k) const noexcept
+		{ return (dev == k.dev) && (ino == k.ino); }
+};
+
+struct inode_hash
+{
+	std::size_t operator () (const inode_key & k) const noexcept
+	{
+		return static_cast<std::size_t>(
+		    (static_cast<std::uint64_t>(k.ino) * 0x9e3779b97f4a7c15ull)
+		  ^ static_cast<std::uint64_t>(k.dev));
+	}
+};
+
+inline disk_usage_totals own_usage(const struct stat & st) noexcept
+{
+	disk_usage_totals t;
+	t.apparent_bytes = st.st_size;
+	t.allocated_bytes = static_cast<uintmax_t>(st.st_blocks) * 512;
+	t.files = S_ISDIR(st.st_mode) ? 0 : 1;
+	t.directories = S_ISDIR(st.st_mode) ? 1 : 0;
+	return t;
+}
+
+inline bool is_dot_or_dot_dot(const char * s) noexcept
+{
+	return (s[0] == '.') && (s[1] == '\0' || (s[1] == '.' && s[2] == '\0'));
+}
+
+/// One open directory on the walk's stack
+struct frame
+{
+	DIR * dir;
+	std::size_t path_length;
+	disk_usage_totals totals;
+	disk_usage_node * node;
+};
+
+/// Depth-first walk below p using descriptor-relative fstatat()/openat(),
+/// so no path is ever resolved from the root again and one descriptor is
+/// open per level. Each frame's totals are folded into its parent when
+/// the frame is popped, which is also when the callback sees them.
+disk_usage_totals walk(const path & p, const disk_usage_callback * cb,
+                       disk_usage_options opts, std::size_t retain_depth,
+                       disk_usage_node * root_node, std::error_code & ec)
+{
+	const bool one_fs
+	  = ((opts & disk_usage_options::one_file_system)
+	     != disk_usage_options::none);
+	const bool skip_denied
+	  = ((opts & disk_usage_options::skip_permission_denied)
+	     != disk_usage_options::none);
+
+	disk_usage_totals result = disk_usage_totals();
+	struct stat st;
+
+	ec.clear();
+
+	if (fstatat(AT_FDCWD, p.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0)
+	{
+		ec = make_errno_ec();
+		return result;
+	}
+
+	if (root_node)
+		root_node->path = p;
+
+	if (! S_ISDIR(st.st_mode))
+	{
+		result = own_usage(st);
+		if (root_node) root_node->totals = result;
+		return result;
+	}
+
+	const dev_t root_dev = st.st_dev;
+	int fd = open(p.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	DIR * dir = (fd >= 0) ? fdopendir(fd) : nullptr;
+
+	if (! dir)
+	{
+		ec = make_errno_ec();
+		if (fd >= 0) close(fd);
+		return result;
+	}
+
+	std::string name = p.native();
+	std::unordered_set<inode_key, inode_hash> linked;
+	std::vector<frame> stack;
+
+	while (name.size() > 1 && name.back() == path::preferred_separator)
+		name.pop_back();
+
+	stack.push_back(frame{ dir, name.size(), own_usage(st), root_node });
+
+	while (! stack.empty())
+	{
+		frame & f = stack.back();
+
+		errno = 0;
+		struct dirent * de = readdir(f.dir);
+
+		if (! de)
+		{
+			if (errno != 0)
+			{
+				ec = make_errno_ec();
+				break;
+			}
+
+			closedir(f.dir);
+			const disk_usage_totals t = f.totals;
+			if (f.node) f.node->totals = t;
+			if (cb) (*cb)(path_view(name), t, stack.size() - 1);
+
+			stack.pop_back();
+
+			if (stack.empty())
+				result = t;
+			else
+			{
+				stack.back().totals += t;
+				name.resize(stack.back().path_length);
+			}
+			continue;
+		}
+
+		if (is_dot_or_dot_dot(de->d_name))
+			continue;
+
+		if (fstatat(dirfd(f.dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+		{
+			if (errno == ENOENT) // removed while we were looking
+				continue;
+			ec = make_errno_ec();
+			break;
+		}
+
+		if (! S_ISDIR(st.st_mode))
+		{
+			if (  (st.st_nlink > 1)
+			   && ! linked.insert(inode_key{ st.st_dev, st.st_ino }).second )
+				continue;
+
+			f.totals += own_usage(st);
+			continue;
+		}
+
+		if (one_fs && st.st_dev != root_dev)
+			continue;
+
+		fd = openat(dirfd(f.dir), de->d_name,
+		            O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		dir = (fd >= 0) ? fdopendir(fd) : nullptr;
+
+		if (! dir)
+		{
+			const int err = errno;
+			if (fd >= 0) close(fd);
+
+			if (err == ENOENT)
+				continue;
+
+			if (err == EACCES && skip_denied)
+			{
+				f.totals += own_usage(st);
+				continue;
+			}
+
+			ec = make_errno_ec(err);
+			break;
+		}
+
+		if (name.back() != path::preferred_separator)
+			name += path::preferred_separator;
+		name += de->d_name;
+
+		// a child pointer stays valid: its parent's vector only grows
+		// again once the child has been popped
+		disk_usage_node * node = nullptr;
+		if (f.node && stack.size() <= retain_depth)
+		{
+			f.node->children.push_back(disk_usage_node());
+			node = &f.node->children.back();
+			node->path = path(name);
+		}
+
+		stack.push_back(frame{ dir, name.size(), own_usage(st), node });
+	}
+
+	for (auto & s : stack)
+		closedir(s.dir);
+
+	return result;
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////
+disk_usage_node disk_usage(const path & p, std::size_t retain_depth,
+                           disk_usage_options opts)
+{
+	std::error_code ec;
+	disk_usage_node ret = disk_usage(p, retain_depth, opts, ec);
+	if (ec) throw filesystem_error("Could not compute disk usage", p, ec);
+	return ret;
+}
+
+disk_usage_node disk_usage(const path & p, std::size_t retain_depth,
+                           disk_usage_options opts, std::error_code & ec)
+{
+	disk_usage_node ret;
+	walk(p, nullptr, opts, retain_depth, &ret, ec);
+	if (ec) ret = disk_usage_node();
+	return ret;
+}
+
+disk_usage_totals for_each_disk_usage(const path & p,
+                                      const disk_usage_callback & cb,
+                                      disk_usage_options opts)
+{
+	std::error_code ec;
+	disk_usage_totals ret = for_each_disk_usage(p, cb, opts, ec);
+	if (ec) throw filesystem_error("Could not compute disk usage", p, ec);
+	return ret;
+}
+
+disk_usage_totals for_each_disk_usage(const path & p,
+                                      const disk_usage_callback & cb,
+                                      disk_usage_options opts,
+                                      std::error_code & ec)
+{
+	return walk(p, cb ? &cb : nullptr, opts, 0, nullptr, ec);
+}
+
+} // inline namespace v1
+} // namespace filesystem
@@ -0,0 +1,84 @@
+#ifndef GUARD_FS_DISK_USAGE_H
+#define GUARD_FS_DISK_USAGE_H 1
+
+#include <cstdint>
+#include <functional>
+#include <system_error>
+#include <vector>
+
+#include "utility/bitmask_operators.h"
+#include "path.h"
+#include "path_view.h"
+
+namespace filesystem {
+inline namespace v1 {
+
+enum class disk_usage_options
+{
+	none                   = 0,
+
+	// don't descend into directories on other devices
+	one_file_system        = 1,
+
+	// count unreadable directories by their own size instead of failing
+	skip_permission_denied = 2,
+};
+
+DEFINE_BITMASK_OPERATORS(disk_usage_options, unsigned int);
+
+/// Totals for a directory and everything below it. A file with several
+/// hard links inside the walk is counted once, under the first name the
+/// walk finds it by.
+struct disk_usage_totals
+{
+	uintmax_t apparent_bytes;   // sum of st_size
+	uintmax_t allocated_bytes;  // sum of st_blocks * 512
+	uintmax_t files;            // everything that isn't a directory
+	uintmax_t directories;      // including the directory itself
+
+	disk_usage_totals & operator += (const disk_usage_totals & t) noexcept
+	{
+		apparent_bytes += t.apparent_bytes;
+		allocated_bytes += t.allocated_bytes;
+		files += t.files;
+		directories += t.directories;
+		return *this;
+	}
+};
+
+struct disk_usage_node
+{
+	class path path;
+	disk_usage_totals totals;
+	std::vector<disk_usage_node> children;
+};
+
+/// Called once per directory after everything below it has been counted,
+/// i.e. in post-order. The view is only valid during the call; depth is
+/// 0 for the starting directory.
+typedef std::function<void (path_view dir, const disk_usage_totals & totals,
+                            std::size_t depth)> disk_usage_callback;
+
+/// Walks p and returns its totals as a tree of directories, keeping a
+/// node for each directory up to retain_depth levels below p. Deeper
+/// directories are still counted, in the totals of their nearest kept
+/// ancestor.
+disk_usage_node disk_usage(const path & p, std::size_t retain_depth = 1,
+                           disk_usage_options opts = disk_usage_options::none);
+disk_usage_node disk_usage(const path & p, std::size_t retain_depth,
+                           disk_usage_options opts, std::error_code & ec);
+
+/// Walks p, handing each directory's totals to cb instead of keeping
+/// them, and returns the totals for p. Memory use is bounded by the
+/// depth of the tree plus one entry per multiply linked file.
+disk_usage_totals for_each_disk_usage(const path & p,
+                           const disk_usage_callback & cb,
+                           disk_usage_options opts = disk_usage_options::none);
+disk_usage_totals for_each_disk_usage(const path & p,
+                           const disk_usage_callback & cb,
+                           disk_usage_options opts, std::error_code & ec);
+
+} // inline namespace v1
+} // namespace filesystem
+
+#endif // GUARD_FS_DISK_USAGE_H
@@ -2,46 +2,209 @@
 #include "directory_iterator.h"
 #include "filesystem_error.h"
 #include "recursive_directory_iterator.h"
+#include "stat_conversions.h"
 #include "time/timeutil.h"
 
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <sys/syscall.h>
 #include <fcntl.h>
 #include <unistd.h>
 
+#ifdef SYS_openat2
+#include <linux/openat2.h>
+#endif
+
+#include <atomic>
+
 #include <climits> // PATH_MAX is defined through this
 #include <cstdlib> // for realpath()
 #include <cstdio>  // P_tmpdir is defined here
+#include <cstring>
 
 namespace filesystem {
 inline namespace v1 {
 
-inline constexpr file_type st_mode_to_file_type(mode_t m)
+/// Returns a NUL terminated spelling of v, copying it into buf only when
+/// the view does not already end at a terminator.
+static const char * view_c_str(const path_view & v, char (&buf)[PATH_MAX],
+                               std::error_code & ec) noexcept
+{
+	if (v.is_terminated())
+		return v.data();
+
+	if (v.size() >= sizeof(buf))
+	{
+		ec = std::make_error_code(std::errc::filename_too_long);
+		return nullptr;
+	}
+
+	std::memcpy(buf, v.data(), v.size());
+	buf[v.size()] = '\0';
+	return buf;
+}
+
+static file_status stat_status(const char * p, bool follow,
+                               std::error_code & ec) noexcept
+{
+	struct stat st;
+	file_status ret;
+
+	ec.clear();
+
+	if ((follow ? stat(p, &st) : lstat(p, &st)) == 0)
+	{
+		ret.type(st_mode_to_file_type(st.st_mode));
+		ret.permissions(st_mode_to_perms(st.st_mode));
+	} else if (errno == ENOENT)
+		ret.type(file_type::not_found);
+	else
+		ec = make_errno_ec();
+
+	return ret;
+}
+
+static uintmax_t stat_file_size(const char * p, std::error_code & ec) noexcept
+{
+	struct stat st;
+	uintmax_t ret = static_cast<uintmax_t>(-1);
+
+	ec.clear();
+
+	if (stat(p, &st) == 0)
+	{
+		if (S_ISREG(st.st_mode))
+			ret = st.st_size;
+		else
+			ec = std::make_error_code(std::errc::not_supported);
+	} else
+		ec = make_errno_ec();
+
+	return ret;
+}
+
+/// Layout of the records getdents64() fills a buffer with
+struct linux_dirent64
+{
+	ino64_t d_ino;
+	off64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+constexpr std::size_t dirent_buffer_size = 32 * 1024;
+
+static int open_directory(const char * p, std::error_code & ec) noexcept
 {
-	return ( (S_ISREG(m) ? file_type::regular : 
-	         (S_ISDIR(m) ? file_type::directory :
-	         (S_ISCHR(m) ? file_type::character :
-	         (S_ISBLK(m) ? file_type::block :
-	         (S_ISFIFO(m) ? file_type::fifo :
-	         (S_ISLNK(m) ? file_type::symlink :
-	         (S_ISSOCK(m) ? file_type::socket :
-	         (file_type::unknown) ) ) ) ) ) ) ) );
+	int fd = open(p, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) ec = make_errno_ec();
+	return fd;
 }
 
-inline constexpr perms st_mode_to_perms(mode_t m)
+/// Hands every entry of the open directory fd but "." and ".." to f until
+/// f returns false. Returns 0, or the errno of a failed read.
+template <class F>
+static int scan_directory(int fd, char * buf, std::size_t len, F f) noexcept
 {
-	return ( ( (m & S_IRUSR) ? perms::owner_read : perms::none )
-	       | ( (m & S_IWUSR) ? perms::owner_write : perms::none )
-	       | ( (m & S_IXUSR) ? perms::owner_exec : perms::none )
-	       | ( (m & S_IRGRP) ? perms::group_read : perms::none )
-	       | ( (m & S_IWGRP) ? perms::group_write : perms::none )
-	       | ( (m & S_IXGRP) ? perms::group_exec : perms::none )
-	       | ( (m & S_IROTH) ? perms::others_read : perms::none )
-	       | ( (m & S_IWOTH) ? perms::others_write : perms::none )
-	       | ( (m & S_IXOTH) ? perms::others_exec : perms::none )
-	       | ( (m & S_ISUID) ? perms::set_uid : perms::none )
-	       | ( (m & S_ISGID) ? perms::set_gid : perms::none )
-	       | ( (m & S_ISVTX) ? perms::sticky_bit : perms::none ) );
+	for (;;)
+	{
+		long n = syscall(SYS_getdents64, fd, buf, len);
+
+		if (n < 0)
+		{
+			if (errno == EINTR) continue;
+			return errno;
+		}
+
+		if (n == 0)
+			return 0;
+
+		for (long off = 0; off < n; )
+		{
+			const linux_dirent64 * d
+			  = reinterpret_cast<const linux_dirent64 *>(buf + off);
+			const char * s = d->d_name;
+			off += d->d_reclen;
+
+			if (s[0] == '.' && (s[1] == '\0' || (s[1] == '.' && s[2] == '\0')))
+				continue;
+
+			if (! f(*d, fd))
+				return 0;
+		}
+	}
+}
+
+static uintmax_t count_entries(const char * p, std::error_code & ec) noexcept
+{
+	alignas(linux_dirent64) char buf[dirent_buffer_size];
+	uintmax_t count = 0;
+
+	ec.clear();
+
+	int fd = open_directory(p, ec);
+	if (fd < 0)
+		return static_cast<uintmax_t>(-1);
+
+	int err = scan_directory(fd, buf, sizeof(buf),
+	    [&count](const linux_dirent64 &, int) { ++count; return true; });
+	close(fd);
+
+	if (err)
+	{
+		ec = make_errno_ec(err);
+		return static_cast<uintmax_t>(-1);
+	}
+
+	return count;
+}
+
+static bool directory_is_empty(const char * p, std::error_code & ec) noexcept
+{
+	struct stat st;
+
+	ec.clear();
+
+	if (stat(p, &st) != 0)
+	{
+		ec = make_errno_ec();
+		return false;
+	}
+
+	if (! S_ISDIR(st.st_mode))
+	{
+		if (S_ISREG(st.st_mode))
+			return (st.st_size == 0);
+
+		ec = std::make_error_code(std::errc::not_supported);
+		return false;
+	}
+
+	// directories can't be hard linked, so any link beyond "." and the
+	// parent's entry is a subdirectory's ".."
+	if (st.st_nlink > 2)
+		return false;
+
+	// the first batch nearly always settles it, so don't ask for more
+	alignas(linux_dirent64) char buf[1024];
+	bool found = false;
+
+	int fd = open_directory(p, ec);
+	if (fd < 0)
+		return false;
+
+	int err = scan_directory(fd, buf, sizeof(buf),
+	    [&found](const linux_dirent64 &, int) { found = true; return false; });
+	close(fd);
+
+	if (err)
+	{
+		ec = make_errno_ec(err);
+		return false;
+	}
+
+	return ! found;
 }
 
 // Note: base defaults to current_path()
@@ -87,15 +250,66 @@ path absolute(const path & p, const path & base)
 	return ret;
 }
 
+/// Opens p as an O_PATH descriptor. openat2() is preferred so that /proc
+/// magic links are refused instead of being followed to objects that
+/// have no pathname; kernels without it get a plain open().
+static int open_path_fd(const char * p) noexcept
+{
+#ifdef SYS_openat2
+	static std::atomic<bool> have_openat2{true};
+
+	if (have_openat2.load(std::memory_order_relaxed))
+	{
+		struct open_how how;
+		std::memset(&how, 0, sizeof(how));
+		how.flags = O_PATH | O_CLOEXEC;
+		how.resolve = RESOLVE_NO_MAGICLINKS;
+
+		int fd = syscall(SYS_openat2, AT_FDCWD, p, &how, sizeof(how));
+		if (fd >= 0 || (errno != ENOSYS && errno != EPERM))
+			return fd;
+
+		if (errno == ENOSYS)
+			have_openat2.store(false, std::memory_order_relaxed);
+	}
+#endif
+	return open(p, O_PATH | O_CLOEXEC);
+}
+
 path canonical(const path & p, const path & base, std::error_code & ec)
 {
 	path ret = absolute(p, base);
 	char resolved[PATH_MAX];
 	char * rc = nullptr;
 
+	ec.clear();
+
+	// Fast path: the kernel resolves the whole path in a single walk and
+	// /proc reports the name it arrived at, instead of realpath()'s
+	// lstat/readlink per component.
+	int fd = open_path_fd(ret.c_str());
+	if (fd >= 0)
+	{
+		char proc[32];
+		snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+		ssize_t n = readlink(proc, resolved, sizeof(resolved) - 1);
+		close(fd);
+
+		if (n > 0 && n < ssize_t(sizeof(resolved) - 1) && resolved[0] == '/')
+		{
+			resolved[n] = '\0';
+			return path(static_cast<const char *>(resolved));
+		}
+	} else if (errno != ELOOP && errno != EXDEV)
+	{
+		// ELOOP may just be a refused magic link; realpath() decides
+		ec = make_errno_ec();
+		ret.clear();
+		return ret;
+	}
+
 	errno = 0;
 
-	// XXX - replace this with hand-rolled logic
 	if (  ( (rc = realpath(ret.c_str(), resolved)) == nullptr)
 	   || (errno != 0) )
 	{
@@ -567,6 +781,35 @@ bool equivalent(const path & p1, const path & p2,
 	return rc;
 }
 
+uintmax_t entry_count(const path & p)
+{
+	std::error_code ec;
+	uintmax_t ret = entry_count(p, ec);
+	if (ec) throw filesystem_error("Could not count directory entries", p, ec);
+	return ret;
+}
+
+uintmax_t entry_count(const path & p, std::error_code & ec) noexcept
+{
+	return count_entries(p.c_str(), ec);
+}
+
+uintmax_t entry_count(path_view p)
+{
+	std::error_code ec;
+	uintmax_t ret = entry_count(p, ec);
+	if (ec) throw filesystem_error("Could not count directory entries",
+	                               p.to_path(), ec);
+	return ret;
+}
+
+uintmax_t entry_count(path_view p, std::error_code & ec) noexcept
+{
+	char buf[PATH_MAX];
+	const char * s = view_c_str(p, buf, ec);
+	return s ? count_entries(s, ec) : static_cast<uintmax_t>(-1);
+}
+
 bool exists(const path & p)
 {
 	return exists(status(p));
@@ -587,23 +830,24 @@ uintmax_t file_size(const path & p)
 
 uintmax_t file_size(const path & p, std::error_code & ec) noexcept
 {
-	struct stat st;
-	uintmax_t ret = static_cast<uintmax_t>(-1);
-
-	ec.clear();
-
-	if (stat(p.c_str(), &st) == 0)
-	{
-		if (S_ISREG(st.st_mode))
-			ret = st.st_size;
-		else
-			ec = std::make_error_code(std::errc::not_supported);
-	} else
-		ec = make_errno_ec();
+	return stat_file_size(p.c_str(), ec);
+}
 
+uintmax_t file_size(path_view p)
+{
+	std::error_code  ec;
+	uintmax_t ret = file_size(p, ec);
+	if (ec) throw filesystem_error("Could not read file size", p.to_path(), ec);
 	return ret;
 }
 
+uintmax_t file_size(path_view p, std::error_code & ec) noexcept
+{
+	char buf[PATH_MAX];
+	const char * s = view_c_str(p, buf, ec);
+	return s ? stat_file_size(s, ec) : static_cast<uintmax_t>(-1);
+}
+
 uintmax_t hard_link_count(const path & p)
 {
 	std::error_code  ec;
@@ -655,19 +899,25 @@ bool is_empty(const path & p)
 
 bool is_empty(const path & p, std::error_code & ec) noexcept
 {
-	bool rc = false;
-	if (is_directory(p, ec))
-	{
-		rc = (directory_iterator(p) == end(directory_iterator(p)));
-	} else
-	{
-		rc = (file_size(p, ec) == 0);
-	}
+	return directory_is_empty(p.c_str(), ec);
+}
 
-	if (ec) rc = false;
+bool is_empty(path_view p)
+{
+	std::error_code ec;
+	bool rc = is_empty(p, ec);
+	if (ec) throw filesystem_error("Could not get size of directory",
+	                               p.to_path(), ec);
 	return rc;
 }
 
+bool is_empty(path_view p, std::error_code & ec) noexcept
+{
+	char buf[PATH_MAX];
+	const char * s = view_c_str(p, buf, ec);
+	return s ? directory_is_empty(s, ec) : false;
+}
+
 bool is_fifo(const path & p)
 	{ return is_fifo(status(p)); }
 
@@ -962,21 +1212,7 @@ space_info space(const path & p, std::error_code & ec) noexcept
 
 file_status status(const path & p, std::error_code & ec) noexcept
 {
-	struct stat st;
-	file_status ret;
-
-	ec.clear();
-
-	if (stat(p.c_str(), &st) == 0)
-	{
-		ret.type(st_mode_to_file_type(st.st_mode));
-		ret.permissions(st_mode_to_perms(st.st_mode));
-	} else if (errno == ENOENT)
-		ret.type(file_type::not_found);
-	else
-		ec = make_errno_ec();
-
-	return ret;
+	return stat_status(p.c_str(), true, ec);
 }
 
 file_status status(const path & p)
@@ -996,22 +1232,123 @@ file_status symlink_status(const path & p)
 }
 
 file_status symlink_status(const path & p, std::error_code & ec) noexcept
+{
+	return stat_status(p.c_str(), false, ec);
+}
+
+file_status status(path_view p)
+{
+	std::error_code  ec;
+	file_status ret = status(p, ec);
+	if (ec) throw filesystem_error("Could not stat file", p.to_path(), ec);
+	return ret;
+}
+
+file_status status(path_view p, std::error_code & ec) noexcept
+{
+	char buf[PATH_MAX];
+	const char * s = view_c_str(p, buf, ec);
+	return s ? stat_status(s, true, ec) : file_status();
+}
+
+file_status symlink_status(path_view p)
+{
+	std::error_code  ec;
+	file_status ret = symlink_status(p, ec);
+	if (ec) throw filesystem_error("Could not lstat file", p.to_path(), ec);
+	return ret;
+}
+
+file_status symlink_status(path_view p, std::error_code & ec) noexcept
+{
+	char buf[PATH_MAX];
+	const char * s = view_c_str(p, buf, ec);
+	return s ? stat_status(s, false, ec) : file_status();
+}
+
+bool exists(path_view p)
+{
+	return exists(status(p));
+}
+
+bool exists(path_view p, std::error_code & ec) noexcept
+{
+	return exists(status(p, ec));
+}
+
+bool is_directory(path_view p)
+	{ return is_directory(status(p)); }
+
+bool is_directory(path_view p, std::error_code & ec) noexcept
+	{ return is_directory(status(p, ec)); }
+
+bool is_regular_file(path_view p)
+	{ return is_regular_file(status(p)); }
+
+bool is_regular_file(path_view p, std::error_code & ec) noexcept
+	{ return is_regular_file(status(p, ec)); }
+
+uintmax_t subdirectory_count(const path & p)
+{
+	std::error_code ec;
+	uintmax_t ret = subdirectory_count(p, ec);
+	if (ec) throw filesystem_error("Could not count subdirectories", p, ec);
+	return ret;
+}
+
+uintmax_t subdirectory_count(const path & p, std::error_code & ec) noexcept
 {
 	struct stat st;
-	file_status ret;
+	uintmax_t count = 0;
 
 	ec.clear();
 
-	if (lstat(p.c_str(), &st) == 0)
+	if (stat(p.c_str(), &st) != 0)
 	{
-		ret.type(st_mode_to_file_type(st.st_mode));
-		ret.permissions(st_mode_to_perms(st.st_mode));
-	} else if (errno == ENOENT)
-		ret.type(file_type::not_found);
-	else
 		ec = make_errno_ec();
+		return static_cast<uintmax_t>(-1);
+	}
 
-	return ret;
+	if (! S_ISDIR(st.st_mode))
+	{
+		ec = std::make_error_code(std::errc::not_a_directory);
+		return static_cast<uintmax_t>(-1);
+	}
+
+	// btrfs, and ext4 past 65000 subdirectories, report a link count of
+	// 1 for directories; anything else keeps the classic count
+	if (st.st_nlink >= 2)
+		return st.st_nlink - 2;
+
+	alignas(linux_dirent64) char buf[dirent_buffer_size];
+
+	int fd = open_directory(p.c_str(), ec);
+	if (fd < 0)
+		return static_cast<uintmax_t>(-1);
+
+	int err = scan_directory(fd, buf, sizeof(buf),
+	    [&count](const linux_dirent64 & d, int dir)
+	    {
+	        struct stat sub;
+
+	        if (d.d_type == DT_DIR)
+	            ++count;
+	        else if (  (d.d_type == DT_UNKNOWN)
+	                && (fstatat(dir, d.d_name, &sub, AT_SYMLINK_NOFOLLOW) == 0)
+	                && S_ISDIR(sub.st_mode) )
+	            ++count;
+
+	        return true;
+	    });
+	close(fd);
+
+	if (err)
+	{
+		ec = make_errno_ec(err);
+		return static_cast<uintmax_t>(-1);
+	}
+
+	return count;
 }
 
 path system_complete(const path & p)
@@ -6,6 +6,7 @@
 
 #include "utility/bitmask_operators.h"
 #include "path.h"
+#include "path_view.h"
 #include "file_status.h"
 
 namespace filesystem {
@@ -105,6 +106,12 @@ void create_symlink(const path & to, const path & new_symlink);
 void create_symlink(const path & to, const path & new_symlink,
                     std::error_code & ec) noexcept;
 
+/// Number of entries in directory p, not counting "." and "..". The
+/// directory is read in large getdents64() batches without building a
+/// directory_entry or path per entry.
+uintmax_t entry_count(const path & p);
+uintmax_t entry_count(const path & p, std::error_code & ec) noexcept;
+
 bool exists(const path & p);
 bool exists(const path & p, std::error_code & ec) noexcept;
 
@@ -179,12 +186,44 @@ file_status status(const path & p, std::error_code & ec) noexcept;
 file_status symlink_status(const path & p);
 file_status symlink_status(const path & p, std::error_code & ec) noexcept;
 
+/// Number of directories in directory p. Answered from st_nlink alone
+/// where the file system keeps the classic "2 + subdirectories" count,
+/// otherwise by reading the directory.
+uintmax_t subdirectory_count(const path & p);
+uintmax_t subdirectory_count(const path & p, std::error_code & ec) noexcept;
+
 path system_complete(const path & p);
 path system_complete(const path & p, std::error_code & ec);
 
 path temp_directory_path();
 path temp_directory_path(std::error_code & ec);
 
+// path_view overloads reach the system call without building a path;
+// a view that is not NUL terminated is copied to a PATH_MAX stack buffer
+file_status status(path_view p);
+file_status status(path_view p, std::error_code & ec) noexcept;
+
+file_status symlink_status(path_view p);
+file_status symlink_status(path_view p, std::error_code & ec) noexcept;
+
+bool exists(path_view p);
+bool exists(path_view p, std::error_code & ec) noexcept;
+
+bool is_directory(path_view p);
+bool is_directory(path_view p, std::error_code & ec) noexcept;
+
+bool is_regular_file(path_view p);
+bool is_regular_file(path_view p, std::error_code & ec) noexcept;
+
+uintmax_t file_size(path_view p);
+uintmax_t file_size(path_view p, std::error_code & ec) noexcept;
+
+uintmax_t entry_count(path_view p);
+uintmax_t entry_count(path_view p, std::error_code & ec) noexcept;
+
+bool is_empty(path_view p);
+bool is_empty(path_view p, std::error_code & ec) noexcept;
+
 inline bool status_known(file_status s) noexcept
 	{ return (s.type() != file_type::none); }
 
@@ -2,6 +2,7 @@
 #include <cstring> // for strcmp
 
 #include "path.h"
+#include "path_view.h"
 #include "filesystem_error.h"
 
 namespace {
@@ -334,5 +335,39 @@ path path::extension() const
 	return ext;
 }
 
+//////////////////////////////////////////////////////////////////////
+// generation
+path path::lexically_normal() const
+{
+	string_type buf(pathname.length() + 1, '\0');
+	path_view v = path_view(*this).lexically_normal(&buf[0], buf.size());
+
+	path ret;
+	buf.resize(v.size());
+	ret.pathname.swap(buf);
+	return ret;
+}
+
+path path::lexically_relative(const path & base) const
+{
+	std::error_code ec;
+	string_type buf(3 * base.pathname.length() + pathname.length() + 2, '\0');
+	path_view v = path_view(*this).lexically_relative(base, &buf[0],
+	                                                  buf.size(), ec);
+	if (ec) throw filesystem_error("Could not make relative path", *this,
+	                               base, ec);
+
+	path ret;
+	buf.resize(v.size());
+	ret.pathname.swap(buf);
+	return ret;
+}
+
+path path::lexically_proximate(const path & base) const
+{
+	path ret = lexically_relative(base);
+	return ret.empty() ? *this : ret;
+}
+
 } /*v1*/
 } /*filesystem*/
@@ -192,6 +192,11 @@ class path
 	path stem() const;
 	path extension() const;
 
+	// generation
+	path lexically_normal() const;
+	path lexically_relative(const path & base) const;
+	path lexically_proximate(const path & base) const;
+
  private:
 
 	template <class ECharT>
@@ -0,0 +1,436 @@
+#include "path_table.h"
+#include "filesystem_error.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace filesystem {
+inline namespace v1 {
+
+constexpr path_table::handle path_table::relative_root;
+constexpr path_table::handle path_table::root;
+constexpr path_table::handle path_table::invalid;
+
+namespace {
+
+constexpr std::size_t initial_slots = 64;
+
+inline bool is_dot(const char * s, std::size_t n)
+	{ return (n == 1) && (s[0] == '.'); }
+
+} // namespace
+
+path_table::path_table()
+  : m_nodes()
+  , m_components()
+  , m_chars()
+  , m_component_slots(initial_slots, 0)
+  , m_edge_slots(initial_slots, 0)
+{
+	m_nodes.push_back(node{ invalid, invalid }); // relative_root
+	m_nodes.push_back(node{ invalid, invalid }); // root
+}
+
+path_table::~path_table() { }
+
+//////////////////////////////////////////////////////////////////////
+// hashing
+std::uint32_t path_table::hash_chars(const char * s, std::size_t n) noexcept
+{
+	// FNV-1a
+	std::uint32_t h = 2166136261u;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		h ^= static_cast<unsigned char>(s[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+std::uint32_t path_table::hash_edge(std::uint32_t parent,
+                                    std::uint32_t component) noexcept
+{
+	std::uint64_t k = (static_cast<std::uint64_t>(parent) << 32) | component;
+	k *= 0x9e3779b97f4a7c15ull;
+	return static_cast<std::uint32_t>(k >> 32);
+}
+
+//////////////////////////////////////////////////////////////////////
+// component storage
+std::uint32_t path_table::find_component(path_view c, std::uint32_t hash) const
+                                         noexcept
+{
+	const std::size_t mask = m_component_slots.size() - 1;
+
+	for (std::size_t i = hash & mask; ; i = (i + 1) & mask)
+	{
+		const std::uint32_t slot = m_component_slots[i];
+		if (slot == 0)
+			return invalid;
+
+		const component_ref & r = m_components[slot - 1];
+		if (  (r.hash == hash) && (r.length == c.size())
+		   && (std::memcmp(m_chars.data() + r.offset, c.data(), c.size()) == 0))
+			return slot - 1;
+	}
+}
+
+std::uint32_t path_table::intern_component(path_view c)
+{
+	const std::uint32_t hash = hash_chars(c.data(), c.size());
+	std::uint32_t id = find_component(c, hash);
+
+	if (id != invalid)
+		return id;
+
+	if (  (m_components.size() >= invalid - 1)
+	   || (m_chars.size() + c.size() > invalid) )
+		throw std::length_error("path_table: component space exhausted");
+
+	if ((m_components.size() + 1) * 8 > m_component_slots.size() * 7)
+		grow_components();
+
+	id = static_cast<std::uint32_t>(m_components.size());
+	m_components.push_back(component_ref{
+		static_cast<std::uint32_t>(m_chars.size()),
+		static_cast<std::uint32_t>(c.size()), hash });
+	m_chars.append(c.data(), c.size());
+
+	const std::size_t mask = m_component_slots.size() - 1;
+	std::size_t i = hash & mask;
+	while (m_component_slots[i] != 0)
+		i = (i + 1) & mask;
+	m_component_slots[i] = id + 1;
+
+	return id;
+}
+
+void path_table::grow_components()
+{
+	std::vector<std::uint32_t> slots(m_component_slots.size() * 2, 0);
+	const std::size_t mask = slots.size() - 1;
+
+	for (std::uint32_t id = 0; id < m_components.size(); ++id)
+	{
+		std::size_t i = m_components[id].hash & mask;
+		while (slots[i] != 0)
+			i = (i + 1) & mask;
+		slots[i] = id + 1;
+	}
+
+	m_component_slots.swap(slots);
+}
+
+void path_table::grow_edges()
+{
+	std::vector<std::uint32_t> slots(m_edge_slots.size() * 2, 0);
+	const std::size_t mask = slots.size() - 1;
+
+	for (handle h = root + 1; h < m_nodes.size(); ++h)
+	{
+		std::size_t i = hash_edge(m_nodes[h].parent, m_nodes[h].component)
+		              & mask;
+		while (slots[i] != 0)
+			i = (i + 1) & mask;
+		slots[i] = h;
+	}
+
+	m_edge_slots.swap(slots);
+}
+
+//////////////////////////////////////////////////////////////////////
+// interning
+
+path_table::handle path_table::intern(path_view p)
+{
+	return intern(p.has_root_directory() ? root : relative_root, p);
+}
+
+/// component may hold several separated components, in which case they
+/// are interned in turn below parent.
+path_table::handle path_table::intern(handle parent, path_view component)
+{
+	if (parent >= m_nodes.size())
+		throw filesystem_error("Invalid path_table handle",
+		                       std::make_error_code(std::errc::invalid_argument));
+
+	handle h = parent;
+	const char * s = component.data();
+	const std::size_t len = component.size();
+	std::size_t i = 0;
+
+	while (i < len)
+	{
+		while (i < len && s[i] == path::preferred_separator)
+			++i;
+
+		std::size_t j = i;
+		while (j < len && s[j] != path::preferred_separator)
+			++j;
+
+		if (j == i || is_dot(s + i, j - i))
+		{
+			i = j;
+			continue;
+		}
+
+		const std::uint32_t c = intern_component(path_view(s + i, j - i));
+		const std::uint32_t hash = hash_edge(h, c);
+		std::size_t mask = m_edge_slots.size() - 1;
+		std::size_t slot = hash & mask;
+		handle next = invalid;
+
+		for ( ; m_edge_slots[slot] != 0; slot = (slot + 1) & mask)
+		{
+			const node & n = m_nodes[m_edge_slots[slot]];
+			if (n.parent == h && n.component == c)
+			{
+				next = m_edge_slots[slot];
+				break;
+			}
+		}
+
+		if (next == invalid)
+		{
+			if (m_nodes.size() >= invalid)
+				throw std::length_error("path_table: handle space exhausted");
+
+			next = static_cast<handle>(m_nodes.size());
+			m_nodes.push_back(node{ h, c });
+
+			if ((m_nodes.size() - 1) * 8 > m_edge_slots.size() * 7)
+			{
+				grow_edges();
+			} else
+				m_edge_slots[slot] = next;
+		}
+
+		h = next;
+		i = j;
+	}
+
+	return h;
+}
+
+path_table::handle path_table::find(path_view p) const noexcept
+{
+	return child(p.has_root_directory() ? root : relative_root, p);
+}
+
+path_table::handle path_table::child(handle parent, path_view component) const
+                                     noexcept
+{
+	if (parent >= m_nodes.size())
+		return invalid;
+
+	handle h = parent;
+	const char * s = component.data();
+	const std::size_t len = component.size();
+	const std::size_t mask = m_edge_slots.size() - 1;
+	std::size_t i = 0;
+
+	while (i < len && h != invalid)
+	{
+		while (i < len && s[i] == path::preferred_separator)
+			++i;
+
+		std::size_t j = i;
+		while (j < len && s[j] != path::preferred_separator)
+			++j;
+
+		if (j == i || is_dot(s + i, j - i))
+		{
+			i = j;
+			continue;
+		}
+
+		const path_view name(s + i, j - i);
+		const std::uint32_t c = find_component(name,
+		                                       hash_chars(name.data(),
+		                                                  name.size()));
+		handle next = invalid;
+
+		if (c != invalid)
+		{
+			for (std::size_t slot = hash_edge(h, c) & mask;
+			     m_edge_slots[slot] != 0; slot = (slot + 1) & mask)
+			{
+				const node & n = m_nodes[m_edge_slots[slot]];
+				if (n.parent == h && n.component == c)
+				{
+					next = m_edge_slots[slot];
+					break;
+				}
+			}
+		}
+
+		h = next;
+		i = j;
+	}
+
+	return h;
+}
+
+//////////////////////////////////////////////////////////////////////
+// navigation
+path_table::handle path_table::parent(handle h) const noexcept
+{
+	return (h < m_nodes.size()) ? m_nodes[h].parent : invalid;
+}
+
+/// The returned view points into the table's character storage and is
+/// invalidated by the next call to intern().
+path_view path_table::component(handle h) const noexcept
+{
+	if (h == root)
+		return path_view("/", 1);
+
+	if (h == relative_root || h >= m_nodes.size())
+		return path_view();
+
+	const component_ref & r = m_components[m_nodes[h].component];
+	return path_view(m_chars.data() + r.offset, r.length);
+}
+
+std::size_t path_table::depth(handle h) const noexcept
+{
+	std::size_t d = 0;
+
+	if (h >= m_nodes.size())
+		return d;
+
+	for ( ; h != root && h != relative_root; h = m_nodes[h].parent)
+		++d;
+
+	return d;
+}
+
+bool path_table::has_prefix(handle h, handle prefix) const noexcept
+{
+	if (h >= m_nodes.size() || prefix >= m_nodes.size())
+		return false;
+
+	for ( ; h != invalid; h = m_nodes[h].parent)
+		if (h == prefix)
+			return true;
+
+	return false;
+}
+
+bool path_table::is_absolute(handle h) const noexcept
+{
+	if (h >= m_nodes.size())
+		return false;
+
+	while (h != root && h != relative_root)
+		h = m_nodes[h].parent;
+
+	return (h == root);
+}
+
+//////////////////////////////////////////////////////////////////////
+// reconstruction
+std::size_t path_table::length(handle h) const noexcept
+{
+	std::size_t len = 0;
+
+	if (h >= m_nodes.size())
+		return len;
+
+	if (h == root)
+		return 1;
+
+	for ( ; h != root && h != relative_root; h = m_nodes[h].parent)
+	{
+		len += m_components[m_nodes[h].component].length;
+		if (m_nodes[h].parent != relative_root)
+			++len; // the separator, or the root directory itself
+	}
+
+	return len;
+}
+
+/// Writes the path named by h, NUL terminated, into buf and returns its
+/// length. buf needs room for length(h) + 1 characters.
+std::size_t path_table::write(handle h, char * buf, std::size_t n,
+                              std::error_code & ec) const noexcept
+{
+	ec.clear();
+
+	if (h >= m_nodes.size())
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return 0;
+	}
+
+	const std::size_t len = length(h);
+
+	if (n < len + 1)
+	{
+		ec = std::make_error_code(std::errc::no_buffer_space);
+		return 0;
+	}
+
+	std::size_t pos = len;
+	buf[pos] = '\0';
+
+	if (h == root)
+		buf[0] = path::preferred_separator;
+
+	for ( ; h != root && h != relative_root; h = m_nodes[h].parent)
+	{
+		const component_ref & r = m_components[m_nodes[h].component];
+		pos -= r.length;
+		std::memcpy(buf + pos, m_chars.data() + r.offset, r.length);
+		if (m_nodes[h].parent != relative_root)
+			buf[--pos] = path::preferred_separator;
+	}
+
+	return len;
+}
+
+path path_table::to_path(handle h) const
+{
+	std::error_code ec;
+	std::string s(length(h) + 1, '\0');
+
+	write(h, &s[0], s.size(), ec);
+	if (ec) throw filesystem_error("Could not reconstruct interned path", ec);
+
+	s.pop_back();
+	return path(s);
+}
+
+//////////////////////////////////////////////////////////////////////
+// capacity
+std::size_t path_table::memory_usage() const noexcept
+{
+	return ( m_nodes.capacity() * sizeof(node)
+	       + m_components.capacity() * sizeof(component_ref)
+	       + m_chars.capacity()
+	       + m_component_slots.capacity() * sizeof(std::uint32_t)
+	       + m_edge_slots.capacity() * sizeof(std::uint32_t) );
+}
+
+void path_table::reserve(std::size_t nodes)
+{
+	m_nodes.reserve(nodes);
+
+	std::size_t slots = m_edge_slots.size();
+	while (nodes * 8 > slots * 7)
+		slots *= 2;
+
+	if (slots != m_edge_slots.size())
+	{
+		m_edge_slots.assign(slots / 2, 0);
+		grow_edges();
+	}
+}
+
+void path_table::clear()
+{
+	*this = path_table();
+}
+
+} // inline namespace v1
+} // namespace filesystem
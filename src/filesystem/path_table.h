@@ -0,0 +1,113 @@
+#ifndef GUARD_FS_PATH_TABLE_H
+#define GUARD_FS_PATH_TABLE_H 1
+
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "path.h"
+#include "path_view.h"
+
+namespace filesystem {
+inline namespace v1 {
+
+/// path_table interns paths as a tree of (parent, component) nodes.
+///
+/// Every distinct component string is stored once, and every distinct
+/// path is a single 8-byte node naming its parent node and its last
+/// component, so a manifest of paths sharing long prefixes costs roughly
+/// one node per unique path instead of one heap string per path. Paths
+/// are referred to by 32-bit handles that stay valid for the lifetime of
+/// the table.
+///
+/// Interning is purely lexical: empty and "." components are dropped
+/// (so "a//b/." and "a/b" share a handle) but ".." is kept as an
+/// ordinary component and symlinks are not consulted.
+///
+/// A path_table is not synchronized; concurrent readers are fine as long
+/// as nothing is being interned.
+class path_table
+{
+ public:
+	typedef std::uint32_t handle;
+
+	static constexpr handle relative_root = 0; // the empty relative path
+	static constexpr handle root = 1;          // "/"
+	static constexpr handle invalid = static_cast<handle>(-1);
+
+	path_table();
+	path_table(const path_table &) = default;
+	path_table(path_table &&) = default;
+	~path_table();
+
+	path_table & operator = (const path_table &) = default;
+	path_table & operator = (path_table &&) = default;
+
+	// interning
+	handle intern(path_view p);
+	handle intern(handle parent, path_view component);
+
+	// lookup without interning; invalid when not present
+	handle find(path_view p) const noexcept;
+	handle child(handle parent, path_view component) const noexcept;
+
+	// navigation
+	handle parent(handle h) const noexcept;
+	path_view component(handle h) const noexcept;
+	std::size_t depth(handle h) const noexcept;
+	bool has_prefix(handle h, handle prefix) const noexcept;
+	bool is_absolute(handle h) const noexcept;
+
+	// reconstruction
+	path to_path(handle h) const;
+	std::size_t length(handle h) const noexcept;
+	std::size_t write(handle h, char * buf, std::size_t n,
+	                  std::error_code & ec) const noexcept;
+
+	// capacity
+	std::size_t size() const noexcept { return m_nodes.size(); }
+	std::size_t component_count() const noexcept
+		{ return m_components.size(); }
+	std::size_t memory_usage() const noexcept;
+	void reserve(std::size_t nodes);
+	void clear();
+
+ private:
+	struct node
+	{
+		std::uint32_t parent;
+		std::uint32_t component;
+	};
+
+	struct component_ref
+	{
+		std::uint32_t offset;
+		std::uint32_t length;
+		std::uint32_t hash;
+	};
+
+	static std::uint32_t hash_chars(const char * s, std::size_t n) noexcept;
+	static std::uint32_t hash_edge(std::uint32_t parent,
+	                               std::uint32_t component) noexcept;
+
+	std::uint32_t find_component(path_view c, std::uint32_t hash) const
+	                             noexcept;
+	std::uint32_t intern_component(path_view c);
+	void grow_components();
+	void grow_edges();
+
+	std::vector<node> m_nodes;
+	std::vector<component_ref> m_components;
+	std::string m_chars;
+
+	// open-addressed indexes; slots hold component id + 1 and node
+	// handles respectively, 0 meaning empty (node 0 is never a child)
+	std::vector<std::uint32_t> m_component_slots;
+	std::vector<std::uint32_t> m_edge_slots;
+};
+
+} // inline namespace v1
+} // namespace filesystem
+
+#endif // GUARD_FS_PATH_TABLE_H
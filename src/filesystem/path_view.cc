@@ -0,0 +1,383 @@
+#include "path_view.h"
+#include "filesystem_error.h"
+
+namespace filesystem {
+inline namespace v1 {
+
+constexpr path_view::value_type path_view::preferred_separator;
+constexpr path_view::size_type path_view::npos;
+
+//////////////////////////////////////////////////////////////////////
+// compare
+int path_view::compare(const path_view & v) const noexcept
+{
+	const size_type n = std::min(m_size, v.m_size);
+	int rc = (n > 0) ? std::memcmp(m_data, v.m_data, n) : 0;
+
+	if (rc == 0)
+		rc = (m_size < v.m_size) ? -1 : ((m_size > v.m_size) ? 1 : 0);
+
+	return rc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// decomposition
+path_view path_view::root_directory() const noexcept
+{
+	return has_root_directory() ? substr(0, 1) : path_view();
+}
+
+/// Everything after the root directory, which takes in all of the
+/// leading separators: "//a/b" gives "a/b"
+path_view path_view::relative_path() const noexcept
+{
+	size_type pos = 0;
+
+	while (pos < m_size && m_data[pos] == preferred_separator)
+		++pos;
+
+	return substr(pos, m_size - pos);
+}
+
+/// Unlike path::parent_path() this does not rebuild the result, so any
+/// redundant separators inside the parent are preserved: the parent of
+/// "//a//b" is "//a", where path would give "/a".
+path_view path_view::parent_path() const noexcept
+{
+	size_type prev_end = 0;
+	size_type last_end = 0;
+	size_type count = 0;
+
+	for (iterator i = begin(); i != end(); ++i, ++count)
+	{
+		prev_end = last_end;
+		if (! i.m_trailing_dot)
+			last_end = i.m_pos + i.m_len;
+	}
+
+	return (count > 1) ? substr(0, prev_end) : path_view();
+}
+
+path_view path_view::filename() const noexcept
+{
+	if (empty())
+		return path_view();
+
+	if (m_data[m_size - 1] == preferred_separator)
+	{
+		for (size_type i = 0; i < m_size; ++i)
+			if (m_data[i] != preferred_separator)
+				return path_view(".", 1, true);
+
+		return substr(0, 1);
+	}
+
+	size_type pos = m_size;
+	while (pos > 0 && m_data[pos - 1] != preferred_separator)
+		--pos;
+
+	return substr(pos, m_size - pos);
+}
+
+path_view path_view::stem() const noexcept
+{
+	const path_view f = filename();
+
+	if (is_linking_directory(f))
+		return f;
+
+	for (size_type n = f.size(); n > 0; --n)
+		if (f[n - 1] == '.')
+			return path_view(f.data(), n - 1, false);
+
+	return f;
+}
+
+path_view path_view::extension() const noexcept
+{
+	const path_view f = filename();
+
+	if (is_linking_directory(f))
+		return path_view();
+
+	for (size_type n = f.size(); n > 0; --n)
+		if (f[n - 1] == '.')
+			return f.substr(n - 1, f.size() - (n - 1));
+
+	return path_view();
+}
+
+//////////////////////////////////////////////////////////////////////
+// lexical operations
+
+/// Single pass over the characters: components are copied forward into
+/// buf as they are accepted, and a ".." that cancels a preceding name
+/// simply rewinds the write position. Because the output never gets
+/// ahead of the input, buf may be the view's own storage.
+path_view path_view::lexically_normal(value_type * buf, size_type n,
+                                      std::error_code & ec) const noexcept
+{
+	const value_type * const src = m_data;
+	const size_type len = m_size;
+	size_type out = 0;        // write position in buf
+	size_type root = 0;       // 1 when the result keeps a root directory
+	size_type components = 0; // components currently in buf
+	size_type names = 0;      // trailing components that are not ".."
+	bool trailing = false;    // result should end with a separator
+
+	ec.clear();
+
+	if (n < len + 1)
+	{
+		ec = std::make_error_code(std::errc::no_buffer_space);
+		return path_view();
+	}
+
+	if (len == 0)
+	{
+		buf[0] = '\0';
+		return path_view(buf, 0, true);
+	}
+
+	if (src[0] == preferred_separator)
+	{
+		buf[0] = preferred_separator;
+		out = root = 1;
+	}
+
+	size_type i = 0;
+	while (i < len)
+	{
+		while (i < len && src[i] == preferred_separator)
+			++i;
+
+		if (i == len)
+			break;
+
+		size_type j = i;
+		while (j < len && src[j] != preferred_separator)
+			++j;
+
+		const size_type clen = j - i;
+
+		if (clen == 1 && src[i] == '.')
+		{
+			trailing = true;
+		} else if (clen == 2 && src[i] == '.' && src[i + 1] == '.')
+		{
+			if (names > 0)
+			{
+				while (out > root && buf[out - 1] != preferred_separator)
+					--out;
+				if (out > root)
+					--out;
+
+				--names;
+				--components;
+				trailing = true;
+			} else if (root)
+			{
+				trailing = true; // "/.." is "/"
+			} else
+			{
+				if (components > 0)
+					buf[out++] = preferred_separator;
+				buf[out++] = '.';
+				buf[out++] = '.';
+				++components;
+				trailing = false;
+			}
+		} else
+		{
+			if (components > 0)
+				buf[out++] = preferred_separator;
+			std::memmove(buf + out, src + i, clen);
+			out += clen;
+			++components;
+			++names;
+			trailing = (j < len);
+		}
+
+		i = j;
+	}
+
+	if (components == 0)
+	{
+		if (! root)
+			buf[out++] = '.';
+	} else if (trailing && names > 0)
+		buf[out++] = preferred_separator;
+
+	buf[out] = '\0';
+
+	return path_view(buf, out, true);
+}
+
+path_view path_view::lexically_normal(value_type * buf, size_type n) const
+{
+	std::error_code ec;
+	path_view ret = lexically_normal(buf, n, ec);
+	if (ec) throw filesystem_error("Could not normalize path", to_path(), ec);
+	return ret;
+}
+
+path_view path_view::lexically_relative(const path_view & base,
+                                        value_type * buf, size_type n,
+                                        std::error_code & ec) const noexcept
+{
+	size_type out = 0;
+	bool fits = true;
+
+	auto put = [&](const value_type * s, size_type len)
+	{
+		if (fits && out + len < n)
+		{
+			std::memcpy(buf + out, s, len);
+			out += len;
+		} else
+			fits = false;
+	};
+
+	ec.clear();
+
+	if (n == 0)
+	{
+		ec = std::make_error_code(std::errc::no_buffer_space);
+		return path_view();
+	}
+
+	buf[0] = '\0';
+
+	if (is_absolute() != base.is_absolute())
+		return path_view(buf, 0, true);
+
+	iterator a = begin(), b = base.begin();
+	const iterator a_end = end(), b_end = base.end();
+
+	while (a != a_end && b != b_end && *a == *b)
+	{
+		++a;
+		++b;
+	}
+
+	if (a == a_end && b == b_end)
+	{
+		put(".", 1);
+	} else
+	{
+		long count = 0;
+
+		for ( ; b != b_end; ++b)
+		{
+			const path_view e = *b;
+
+			if (e.size() == 2 && e[0] == '.' && e[1] == '.')
+				--count;
+			else if (! (e.size() == 1 && e[0] == '.'))
+				++count;
+		}
+
+		if (count < 0)
+			return path_view(buf, 0, true);
+
+		if (count == 0 && (a == a_end || a.m_trailing_dot))
+		{
+			put(".", 1);
+		} else
+		{
+			for (long i = 0; i < count; ++i)
+			{
+				if (out > 0)
+					put(&preferred_separator, 1);
+				put("..", 2);
+			}
+
+			for ( ; a != a_end; ++a)
+			{
+				const path_view e = *a;
+
+				if (out > 0 && buf[out - 1] != preferred_separator)
+					put(&preferred_separator, 1);
+
+				if (! a.m_trailing_dot)
+					put(e.data(), e.size());
+			}
+		}
+	}
+
+	if (! fits)
+	{
+		ec = std::make_error_code(std::errc::no_buffer_space);
+		buf[0] = '\0';
+		return path_view();
+	}
+
+	buf[out] = '\0';
+
+	return path_view(buf, out, true);
+}
+
+//////////////////////////////////////////////////////////////////////
+// iterator
+path_view::iterator::iterator(const path_view & v, size_type pos) noexcept
+  : m_view(v)
+  , m_pos(npos)
+  , m_len(0)
+  , m_trailing_dot(false)
+{
+	if (pos != npos && ! v.empty())
+	{
+		m_pos = 0;
+		if (v[0] == preferred_separator)
+			m_len = 1;
+		else
+			while (m_len < v.size() && v[m_len] != preferred_separator)
+				++m_len;
+	}
+}
+
+void path_view::iterator::advance() noexcept
+{
+	if (m_trailing_dot)
+	{
+		m_pos = npos;
+		m_len = 0;
+		m_trailing_dot = false;
+		return;
+	}
+
+	const size_type size = m_view.size();
+	const size_type cursor = m_pos + m_len;
+	size_type i = cursor;
+
+	while (i < size && m_view[i] == preferred_separator)
+		++i;
+
+	if (i == size)
+	{
+		const bool at_root = (  (m_pos == 0) && (m_len == 1)
+		                     && (m_view[0] == preferred_separator) );
+
+		if (! at_root && i > cursor)
+		{
+			m_pos = size;
+			m_len = 0;
+			m_trailing_dot = true;
+		} else
+		{
+			m_pos = npos;
+			m_len = 0;
+		}
+		return;
+	}
+
+	size_type j = i;
+	while (j < size && m_view[j] != preferred_separator)
+		++j;
+
+	m_pos = i;
+	m_len = j - i;
+}
+
+} // inline namespace v1
+} // namespace filesystem
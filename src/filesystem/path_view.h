@@ -0,0 +1,236 @@
+#ifndef GUARD_FS_PATH_VIEW_H
+#define GUARD_FS_PATH_VIEW_H 1
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include "path.h"
+
+namespace filesystem {
+inline namespace v1 {
+
+/// path_view is a non-owning pointer+length reference to a pathname.
+///
+/// It offers the read-only half of path (decomposition, comparison and
+/// component iteration) without copying the characters or running them
+/// through the path_traits/codecvt construction machinery. The viewed
+/// characters must outlive the view.
+///
+/// Decomposition follows the same element rules as path_iterator: a
+/// leading separator is yielded as "/", and a trailing separator is
+/// yielded as a final "." element.
+class path_view
+{
+ public:
+	typedef path::value_type value_type;
+	typedef std::size_t size_type;
+	static constexpr value_type preferred_separator
+	  = path::preferred_separator;
+	static constexpr size_type npos = static_cast<size_type>(-1);
+
+	class iterator;
+	typedef iterator const_iterator;
+
+	// constructors
+	constexpr path_view() noexcept
+	  : m_data(""), m_size(0), m_terminated(true) { }
+
+	explicit path_view(const value_type * s) noexcept
+	  : m_data(s), m_size(std::strlen(s)), m_terminated(true) { }
+
+	path_view(const value_type * s, size_type n) noexcept
+	  : m_data(s), m_size(n), m_terminated(false) { }
+
+	explicit path_view(const path::string_type & s) noexcept
+	  : m_data(s.c_str()), m_size(s.length()), m_terminated(true) { }
+
+	path_view(const path & p) noexcept
+	  : m_data(p.c_str()), m_size(p.native().length()), m_terminated(true)
+		{ }
+
+	path_view(const path_view &) = default;
+	path_view & operator = (const path_view &) = default;
+
+	// observers
+	const value_type * data() const noexcept { return m_data; }
+	size_type size() const noexcept { return m_size; }
+	size_type length() const noexcept { return m_size; }
+	bool empty() const noexcept { return (m_size == 0); }
+
+	/// true when data()[size()] is known to be a NUL, i.e. data() may be
+	/// handed directly to a system call
+	bool is_terminated() const noexcept { return m_terminated; }
+
+	value_type operator [] (size_type i) const noexcept { return m_data[i]; }
+
+	path::string_type string() const
+		{ return path::string_type(m_data, m_size); }
+
+	path to_path() const
+		{ return path(string()); }
+
+	// compare
+	int compare(const path_view & v) const noexcept;
+
+	// decomposition
+	path_view root_directory() const noexcept;
+	path_view relative_path() const noexcept;
+	path_view parent_path() const noexcept;
+	path_view filename() const noexcept;
+	path_view stem() const noexcept;
+	path_view extension() const noexcept;
+
+	// query
+	bool has_root_directory() const noexcept
+		{ return ( (m_size > 0) && (m_data[0] == preferred_separator) ); }
+	bool is_absolute() const noexcept { return has_root_directory(); }
+	bool is_relative() const noexcept { return ! has_root_directory(); }
+	bool has_relative_path() const noexcept
+		{ return ! relative_path().empty(); }
+	bool has_filename() const noexcept { return ! filename().empty(); }
+	bool has_parent_path() const noexcept
+		{ return ! parent_path().empty(); }
+	bool has_stem() const noexcept { return ! stem().empty(); }
+	bool has_extension() const noexcept { return ! extension().empty(); }
+
+	/// Writes the lexically normal form of this path (C++17 rules) into
+	/// buf and returns a view of it. buf needs room for size() + 1
+	/// characters; the result is always NUL terminated. buf may alias
+	/// data(), in which case the path is normalized in place.
+	path_view lexically_normal(value_type * buf, size_type n,
+	                           std::error_code & ec) const noexcept;
+	path_view lexically_normal(value_type * buf, size_type n) const;
+
+	/// Writes this path made relative to base (C++17 rules) into buf and
+	/// returns a view of it; the result is empty when there is no lexical
+	/// relation. The length needed is bounded by 3 * base.size() +
+	/// size() + 2.
+	path_view lexically_relative(const path_view & base, value_type * buf,
+	                             size_type n, std::error_code & ec) const
+	                             noexcept;
+
+	// iterators
+	iterator begin() const noexcept;
+	iterator end() const noexcept;
+
+ private:
+	path_view(const value_type * s, size_type n, bool terminated) noexcept
+	  : m_data(s), m_size(n), m_terminated(terminated) { }
+
+	path_view substr(size_type pos, size_type n) const noexcept
+	{
+		return path_view(m_data + pos, n,
+		                 m_terminated && (pos + n == m_size));
+	}
+
+	const value_type * m_data;
+	size_type m_size;
+	bool m_terminated;
+};
+
+/// path_view::iterator walks the elements of a path_view without
+/// allocating; each element is itself a path_view into the original
+/// characters (or into a static "." for a trailing separator).
+class path_view::iterator
+  : public std::iterator<std::forward_iterator_tag, path_view, void>
+{
+ public:
+	iterator() noexcept
+	  : m_view(), m_pos(npos), m_len(0), m_trailing_dot(false) { }
+
+	bool operator == (const iterator & other) const noexcept
+	{
+		return (  (m_view.data() == other.m_view.data())
+		       && (m_pos == other.m_pos)
+		       && (m_trailing_dot == other.m_trailing_dot) );
+	}
+
+	bool operator != (const iterator & other) const noexcept
+		{ return !(*this == other); }
+
+	iterator & operator ++ () noexcept
+	{
+		advance();
+		return *this;
+	}
+
+	iterator operator ++ (int) noexcept
+	{
+		iterator tmp(*this);
+		advance();
+		return tmp;
+	}
+
+	path_view operator * () const noexcept
+	{
+		return m_trailing_dot ? path_view(".", 1, true)
+		                      : m_view.substr(m_pos, m_len);
+	}
+
+ private:
+	friend class path_view;
+
+	iterator(const path_view & v, size_type pos) noexcept;
+
+	void advance() noexcept;
+
+	path_view m_view;
+	size_type m_pos;
+	size_type m_len;
+	bool m_trailing_dot;
+};
+
+inline path_view::iterator path_view::begin() const noexcept
+	{ return iterator(*this, 0); }
+
+inline path_view::iterator path_view::end() const noexcept
+	{ return iterator(*this, npos); }
+
+inline bool operator == (const path_view & lhs, const path_view & rhs) noexcept
+	{ return (lhs.compare(rhs) == 0); }
+inline bool operator != (const path_view & lhs, const path_view & rhs) noexcept
+	{ return (lhs.compare(rhs) != 0); }
+inline bool operator < (const path_view & lhs, const path_view & rhs) noexcept
+	{ return (lhs.compare(rhs) < 0); }
+inline bool operator <= (const path_view & lhs, const path_view & rhs) noexcept
+	{ return (lhs.compare(rhs) <= 0); }
+inline bool operator > (const path_view & lhs, const path_view & rhs) noexcept
+	{ return (lhs.compare(rhs) > 0); }
+inline bool operator >= (const path_view & lhs, const path_view & rhs) noexcept
+	{ return (lhs.compare(rhs) >= 0); }
+
+// mixed comparisons; path's converting constructor would otherwise make
+// these ambiguous
+inline bool operator == (const path_view & lhs, const path & rhs) noexcept
+	{ return (lhs.compare(rhs) == 0); }
+inline bool operator == (const path & lhs, const path_view & rhs) noexcept
+	{ return (rhs.compare(lhs) == 0); }
+inline bool operator != (const path_view & lhs, const path & rhs) noexcept
+	{ return (lhs.compare(rhs) != 0); }
+inline bool operator != (const path & lhs, const path_view & rhs) noexcept
+	{ return (rhs.compare(lhs) != 0); }
+
+inline bool is_linking_dot(const path_view & v) noexcept
+{
+	const path_view f = v.filename();
+	return ( (f.size() == 1) && (f[0] == '.') );
+}
+
+inline bool is_linking_dot_dot(const path_view & v) noexcept
+{
+	const path_view f = v.filename();
+	return ( (f.size() == 2) && (f[0] == '.') && (f[1] == '.') );
+}
+
+inline bool is_linking_directory(const path_view & v) noexcept
+{
+	return (is_linking_dot(v) || is_linking_dot_dot(v));
+}
+
+} // inline namespace v1
+} // namespace filesystem
+
+#endif // GUARD_FS_PATH_VIEW_H
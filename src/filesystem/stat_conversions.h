@@ -0,0 +1,42 @@
+#ifndef GUARD_FS_STAT_CONVERSIONS_H
+#define GUARD_FS_STAT_CONVERSIONS_H 1
+
+#include <sys/stat.h>
+
+#include "file_status.h"
+
+namespace filesystem {
+inline namespace v1 {
+
+inline constexpr file_type st_mode_to_file_type(mode_t m)
+{
+	return ( (S_ISREG(m) ? file_type::regular : 
+	         (S_ISDIR(m) ? file_type::directory :
+	         (S_ISCHR(m) ? file_type::character :
+	         (S_ISBLK(m) ? file_type::block :
+	         (S_ISFIFO(m) ? file_type::fifo :
+	         (S_ISLNK(m) ? file_type::symlink :
+	         (S_ISSOCK(m) ? file_type::socket :
+	         (file_type::unknown) ) ) ) ) ) ) ) );
+}
+
+inline constexpr perms st_mode_to_perms(mode_t m)
+{
+	return ( ( (m & S_IRUSR) ? perms::owner_read : perms::none )
+	       | ( (m & S_IWUSR) ? perms::owner_write : perms::none )
+	       | ( (m & S_IXUSR) ? perms::owner_exec : perms::none )
+	       | ( (m & S_IRGRP) ? perms::group_read : perms::none )
+	       | ( (m & S_IWGRP) ? perms::group_write : perms::none )
+	       | ( (m & S_IXGRP) ? perms::group_exec : perms::none )
+	       | ( (m & S_IROTH) ? perms::others_read : perms::none )
+	       | ( (m & S_IWOTH) ? perms::others_write : perms::none )
+	       | ( (m & S_IXOTH) ? perms::others_exec : perms::none )
+	       | ( (m & S_ISUID) ? perms::set_uid : perms::none )
+	       | ( (m & S_ISGID) ? perms::set_gid : perms::none )
+	       | ( (m & S_ISVTX) ? perms::sticky_bit : perms::none ) );
+}
+
+} // inline namespace v1
+} // namespace filesystem
+
+#endif // GUARD_FS_STAT_CONVERSIONS_H
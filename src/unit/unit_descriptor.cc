@@ -0,0 +1,286 @@
+#include "descriptor/descriptor.h"
+
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "cppunit-header.h"
+
+class Test_descriptor : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_descriptor);
+	CPPUNIT_TEST(no_virtual_io);
+	CPPUNIT_TEST(file_io);
+	CPPUNIT_TEST(scatter_gather);
+	CPPUNIT_TEST(file_management);
+	CPPUNIT_TEST(nonblocking);
+	CPPUNIT_TEST(move);
+	CPPUNIT_TEST(timer);
+	CPPUNIT_TEST(signals);
+	CPPUNIT_TEST(sockets);
+	CPPUNIT_TEST_SUITE_END();
+
+	std::string name;
+	filesystem::path file;
+
+ public:
+	void setUp()
+	{
+		char tmpl[] = "/tmp/descriptor.XXXXXX";
+		int fd = mkstemp(tmpl);
+		CPPUNIT_ASSERT(fd >= 0);
+		::close(fd);
+		name = tmpl;
+		file = filesystem::path(name);
+	}
+
+	void tearDown()
+	{
+		unlink(name.c_str());
+	}
+
+ protected:
+	void no_virtual_io()
+	{
+		// the I/O mix-ins add nothing beyond the descriptor itself
+		CPPUNIT_ASSERT(sizeof(io::file_descriptor) == sizeof(io::descriptor));
+		CPPUNIT_ASSERT(sizeof(io::io_descriptor) == sizeof(io::descriptor));
+		CPPUNIT_ASSERT(std::is_nothrow_move_constructible<
+		                   io::file_descriptor>::value);
+	}
+
+	void file_io()
+	{
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+		char buf[32];
+
+		CPPUNIT_ASSERT(f.is_open());
+		CPPUNIT_ASSERT(f.write("hello world", 11) == 11);
+		CPPUNIT_ASSERT(f.pwrite("W", 1, 6) == 1);
+		CPPUNIT_ASSERT(f.size() == 11);
+
+		CPPUNIT_ASSERT(f.pread(buf, sizeof(buf), 0) == 11);
+		CPPUNIT_ASSERT(std::string(buf, 11) == "hello World");
+
+		// at end of file
+		CPPUNIT_ASSERT(f.read(buf, sizeof(buf)) == 0);
+
+		std::error_code ec;
+		io::file_descriptor missing;
+		missing.open("/nonexistent/file", O_RDONLY, 0, ec);
+		CPPUNIT_ASSERT(ec == std::errc::no_such_file_or_directory);
+		CPPUNIT_ASSERT(!missing.is_open());
+		CPPUNIT_ASSERT_THROW(missing.open("/nonexistent/file"),
+		                     std::system_error);
+	}
+
+	void scatter_gather()
+	{
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+		char a[5], b[6];
+		struct iovec out[2] = {
+			{ const_cast<char *>("scatter"), 7 },
+			{ const_cast<char *>("gather"), 6 },
+		};
+		struct iovec in[2] = { { a, sizeof(a) }, { b, sizeof(b) } };
+
+		CPPUNIT_ASSERT(f.writev(out, 2) == 13);
+		CPPUNIT_ASSERT(f.preadv(in, 2, 2) == 11);
+		CPPUNIT_ASSERT(std::string(a, 5) == "atter");
+		CPPUNIT_ASSERT(std::string(b, 6) == "gather");
+
+		CPPUNIT_ASSERT(f.pwritev(out, 1, 13, io::rw_flags::dsync) == 7);
+		CPPUNIT_ASSERT(f.size() == 20);
+
+		// freshly written data is cached, so nowait doesn't need to wait;
+		// kernels or file systems without support report EOPNOTSUPP
+		std::error_code ec;
+		std::size_t n = f.preadv(in, 2, 0, io::rw_flags::nowait, ec);
+		CPPUNIT_ASSERT(  (!ec && n == 11)
+		              || ec == std::errc::operation_not_supported
+		              || ec == std::errc::resource_unavailable_try_again);
+
+		CPPUNIT_ASSERT(lseek(f.native_handle(), 0, SEEK_SET) == 0);
+		CPPUNIT_ASSERT(f.readv(in, 2) == 11);
+		CPPUNIT_ASSERT(std::string(a, 5) == "scatt");
+	}
+
+	void file_management()
+	{
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+
+		f.advise(io::advice::sequential);
+		f.allocate(0, 1 << 16);
+		CPPUNIT_ASSERT(f.size() == (1 << 16));
+
+		f.allocate(1 << 16, 1 << 16, io::allocate_mode::keep_size);
+		CPPUNIT_ASSERT(f.size() == (1 << 16));
+
+		f.truncate(100);
+		CPPUNIT_ASSERT(f.size() == 100);
+		f.sync(true);
+		f.sync();
+
+		std::error_code ec;
+		f.advise(static_cast<io::advice>(999), 0, 0, ec);
+		CPPUNIT_ASSERT(ec == std::errc::invalid_argument);
+	}
+
+	void nonblocking()
+	{
+		int fds[2];
+		CPPUNIT_ASSERT(pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+		io::io_descriptor rd(fds[0]), wr(fds[1]);
+		char buf[8];
+		std::error_code ec;
+
+		CPPUNIT_ASSERT(rd.read(buf, sizeof(buf), ec) == 0);
+		CPPUNIT_ASSERT(ec == std::errc::resource_unavailable_try_again);
+		CPPUNIT_ASSERT_THROW(rd.read(buf, sizeof(buf)), std::system_error);
+
+		CPPUNIT_ASSERT(wr.write("ping", 4, ec) == 4);
+		CPPUNIT_ASSERT(!ec);
+		CPPUNIT_ASSERT(rd.read(buf, sizeof(buf), ec) == 4);
+		CPPUNIT_ASSERT(!ec);
+
+		wr.close();
+		CPPUNIT_ASSERT(rd.read(buf, sizeof(buf), ec) == 0);
+		CPPUNIT_ASSERT(!ec);
+	}
+
+	void move()
+	{
+		io::file_descriptor a(file);
+		const int fd = a.native_handle();
+
+		io::file_descriptor b(std::move(a));
+		CPPUNIT_ASSERT(b.native_handle() == fd);
+		CPPUNIT_ASSERT(a.native_handle() == -1);
+
+		io::file_descriptor c;
+		c = std::move(b);
+		CPPUNIT_ASSERT(c.native_handle() == fd);
+		CPPUNIT_ASSERT(!b.is_open());
+	}
+
+	void timer()
+	{
+		typedef io::timer_descriptor<CLOCK_MONOTONIC> timer_t;
+		using std::chrono::milliseconds;
+
+		timer_t t(true);
+		std::error_code ec;
+
+		CPPUNIT_ASSERT(t.read_expirations(ec) == 0);
+		CPPUNIT_ASSERT(ec == std::errc::resource_unavailable_try_again);
+		CPPUNIT_ASSERT(t.remaining() == timer_t::duration::zero());
+
+		t.arm_relative_timer(milliseconds(1), milliseconds(1));
+		CPPUNIT_ASSERT(t.remaining() > timer_t::duration::zero());
+		usleep(10000);
+		CPPUNIT_ASSERT(t.read_expirations() >= 2);
+
+		t.disarm_timer();
+		CPPUNIT_ASSERT(t.remaining() == timer_t::duration::zero());
+
+		// a deadline in the past expires at once
+		t.arm_absolute_timer(timer_t::clock_type::now() - milliseconds(5));
+		timer_t blocking(false);
+		blocking.arm_absolute_timer(timer_t::clock_type::now()
+		                            + milliseconds(2));
+		CPPUNIT_ASSERT(blocking.read_expirations() == 1);
+		CPPUNIT_ASSERT(t.read_expirations() == 1);
+	}
+
+	void signals()
+	{
+		sigset_t old;
+		pthread_sigmask(SIG_SETMASK, nullptr, &old);
+
+		{
+			io::signal_descriptor s({ SIGUSR1, SIGUSR2 });
+			signalfd_siginfo info[4];
+
+			CPPUNIT_ASSERT(s.read_signals(info, 4) == 0);
+
+			raise(SIGUSR1);
+			raise(SIGUSR2);
+			CPPUNIT_ASSERT(s.read_signals(info, 4) == 2);
+			CPPUNIT_ASSERT(  info[0].ssi_signo == SIGUSR1
+			              || info[1].ssi_signo == SIGUSR1);
+
+			s.set_mask(io::signal_descriptor::make_mask({ SIGUSR2 }));
+			raise(SIGUSR1); // stays pending on the thread
+			raise(SIGUSR2);
+			CPPUNIT_ASSERT(s.read_signals(info, 4) == 1);
+			CPPUNIT_ASSERT(info[0].ssi_signo == SIGUSR2);
+
+			sigset_t usr1 = io::signal_descriptor::make_mask({ SIGUSR1 });
+			int sig = 0;
+			CPPUNIT_ASSERT(sigwait(&usr1, &sig) == 0 && sig == SIGUSR1);
+		}
+
+		pthread_sigmask(SIG_SETMASK, &old, nullptr);
+	}
+
+	void sockets()
+	{
+		auto p = io::socket_descriptor::pair();
+		char buf[8];
+
+		CPPUNIT_ASSERT(p.first.send("ping", 4) == 4);
+		CPPUNIT_ASSERT(p.second.recv(buf, sizeof(buf)) == 4);
+		CPPUNIT_ASSERT(p.second.write("pong", 4) == 4);
+		CPPUNIT_ASSERT(p.first.read(buf, sizeof(buf)) == 4);
+		CPPUNIT_ASSERT(std::string(buf, 4) == "pong");
+
+		p.second.shutdown(SHUT_WR);
+		CPPUNIT_ASSERT(p.first.recv(buf, sizeof(buf)) == 0);
+
+		// loopback TCP, nonblocking on the client side
+		io::socket_descriptor server(AF_INET, SOCK_STREAM);
+		struct sockaddr_in addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		server.set_option(SOL_SOCKET, SO_REUSEADDR, 1);
+		server.bind(reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+		server.listen();
+		server.local_address(reinterpret_cast<sockaddr *>(&addr),
+		                     sizeof(addr));
+		CPPUNIT_ASSERT(addr.sin_port != 0);
+
+		std::error_code ec;
+		io::socket_descriptor client(AF_INET, SOCK_STREAM | SOCK_NONBLOCK);
+		client.connect(reinterpret_cast<sockaddr *>(&addr), sizeof(addr), ec);
+		CPPUNIT_ASSERT(!ec || ec == std::errc::operation_in_progress);
+
+		io::socket_descriptor conn = server.accept();
+		CPPUNIT_ASSERT(conn.is_open());
+		CPPUNIT_ASSERT(!client.error());
+
+		CPPUNIT_ASSERT(client.recv(buf, sizeof(buf), 0, ec) == 0);
+		CPPUNIT_ASSERT(ec == std::errc::resource_unavailable_try_again);
+
+		// the flag applies to the accepted socket, not the listener
+		CPPUNIT_ASSERT(fcntl(server.native_handle(), F_SETFL, O_NONBLOCK) == 0);
+		CPPUNIT_ASSERT(!server.accept(true, ec).is_open());
+		CPPUNIT_ASSERT(ec == std::errc::resource_unavailable_try_again);
+
+		conn.close();
+		CPPUNIT_ASSERT(client.recv(buf, sizeof(buf), 0, ec) == 0);
+		CPPUNIT_ASSERT(!ec);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_descriptor);
@@ -1,7 +1,11 @@
 #include "filesystem/file_status.h"
 #include "filesystem/path.h"
 #include "filesystem/directory_entry.h"
+#include "filesystem/filesystem_error.h"
 
+#include <unistd.h>
+
+#include <fstream>
 #include <iostream>
 
 #include "cppunit-header.h"
@@ -18,8 +22,26 @@ class Test_directory_entry : public CppUnit::TestFixture
 	CPPUNIT_TEST(status);
 	CPPUNIT_TEST(symlink_status);
 	CPPUNIT_TEST(comparisons);
+	CPPUNIT_TEST(cached_attributes);
+	CPPUNIT_TEST(symlinks);
 	CPPUNIT_TEST_SUITE_END();
 
+	fs::path dir;
+
+ public:
+	void setUp()
+	{
+		dir = fs::temp_directory_path();
+		dir /= "directory_entry.";
+		dir += std::to_string(getpid());
+		fs::create_directories(dir);
+	}
+
+	void tearDown()
+	{
+		fs::remove_all(dir);
+	}
+
  protected:
 	void constructors()
 	{
@@ -201,6 +223,78 @@ class Test_directory_entry : public CppUnit::TestFixture
 		}
 	}
 
+	void cached_attributes()
+	{
+		const fs::path p = dir / "file";
+		std::ofstream(p.c_str()) << "12345";
+
+		fs::directory_entry e(p);
+		CPPUNIT_ASSERT(e.exists());
+		CPPUNIT_ASSERT(e.is_regular_file());
+		CPPUNIT_ASSERT(!e.is_directory());
+		CPPUNIT_ASSERT(!e.is_symlink());
+		CPPUNIT_ASSERT(e.file_size() == 5);
+		CPPUNIT_ASSERT(e.hard_link_count() == 1);
+		CPPUNIT_ASSERT(e.last_write_time() == fs::last_write_time(p));
+
+		// the free functions answer from the same cache
+		CPPUNIT_ASSERT(fs::file_size(e) == 5);
+		CPPUNIT_ASSERT(fs::is_regular_file(e));
+
+		// nothing is re-read until asked to
+		std::ofstream(p.c_str(), std::ios::app) << "678";
+		fs::create_hard_link(p, dir / "link");
+		CPPUNIT_ASSERT(e.file_size() == 5);
+		CPPUNIT_ASSERT(e.hard_link_count() == 1);
+
+		e.refresh();
+		CPPUNIT_ASSERT(e.file_size() == 8);
+		CPPUNIT_ASSERT(e.hard_link_count() == 2);
+
+		fs::remove(p);
+		CPPUNIT_ASSERT(e.exists());
+		e.invalidate();
+		CPPUNIT_ASSERT(!e.exists());
+		CPPUNIT_ASSERT(e.status().type() == fs::file_type::not_found);
+
+		std::error_code ec;
+		e.file_size(ec);
+		CPPUNIT_ASSERT(ec == std::errc::no_such_file_or_directory);
+		CPPUNIT_ASSERT_THROW(e.last_write_time(), fs::filesystem_error);
+
+		// assigning a new path drops the old path's attributes
+		e.assign(dir);
+		CPPUNIT_ASSERT(e.is_directory());
+		e.file_size(ec);
+		CPPUNIT_ASSERT(ec == std::errc::not_supported);
+
+		e.assign(p);
+		CPPUNIT_ASSERT(!e.exists());
+		e.replace_filename("link");
+		CPPUNIT_ASSERT(e.is_regular_file());
+		CPPUNIT_ASSERT(e.hard_link_count() == 1);
+	}
+
+	void symlinks()
+	{
+		const fs::path p = dir / "target";
+		std::ofstream(p.c_str()) << "abc";
+		fs::create_symlink(p, dir / "sym");
+		fs::create_symlink(dir / "missing", dir / "dangling");
+
+		fs::directory_entry e(dir / "sym");
+		CPPUNIT_ASSERT(e.is_symlink());
+		CPPUNIT_ASSERT(e.is_regular_file());
+		CPPUNIT_ASSERT(e.file_size() == 3);
+		CPPUNIT_ASSERT(e.symlink_status().type() == fs::file_type::symlink);
+		CPPUNIT_ASSERT(e.status().type() == fs::file_type::regular);
+
+		fs::directory_entry d(dir / "dangling");
+		CPPUNIT_ASSERT(d.is_symlink());
+		CPPUNIT_ASSERT(!d.exists());
+	}
+
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Test_directory_entry);
@@ -0,0 +1,160 @@
+#include "filesystem/disk_usage.h"
+#include "filesystem/filesystem_error.h"
+#include "filesystem/fs_operations.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "cppunit-header.h"
+
+namespace fs = filesystem::v1;
+
+class Test_disk_usage : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_disk_usage);
+	CPPUNIT_TEST(totals);
+	CPPUNIT_TEST(retained_tree);
+	CPPUNIT_TEST(streaming);
+	CPPUNIT_TEST(errors);
+	CPPUNIT_TEST_SUITE_END();
+
+	fs::path root;
+
+ public:
+	void setUp()
+	{
+		root = fs::temp_directory_path();
+		root /= "disk_usage.";
+		root += std::to_string(getpid());
+
+		// root/{a/{one,deep/two}, b/{one-link, sparse}, top}
+		fs::create_directories(root / "a" / "deep");
+		fs::create_directories(root / "b");
+		write(root / "a" / "one", 1000);
+		write(root / "a" / "deep" / "two", 200);
+		write(root / "top", 30);
+		fs::create_hard_link(root / "a" / "one", root / "b" / "one-link");
+
+		// one mebibyte that allocates nothing
+		write(root / "b" / "sparse", 0);
+		fs::resize_file(root / "b" / "sparse", 1 << 20);
+	}
+
+	void tearDown()
+	{
+		fs::remove_all(root);
+	}
+
+ protected:
+	static void write(const fs::path & p, std::size_t n)
+	{
+		std::ofstream(p.c_str()) << std::string(n, 'x');
+	}
+
+	static uintmax_t own_bytes(const fs::path & p)
+	{
+		struct stat st;
+		CPPUNIT_ASSERT(lstat(p.c_str(), &st) == 0);
+		return st.st_size;
+	}
+
+	void totals()
+	{
+		fs::disk_usage_node n = fs::disk_usage(root);
+
+		CPPUNIT_ASSERT(n.path == root);
+		CPPUNIT_ASSERT(n.totals.directories == 4);
+
+		// the hard link is only counted once
+		CPPUNIT_ASSERT(n.totals.files == 4);
+
+		const uintmax_t dirs = own_bytes(root) + own_bytes(root / "a")
+		                     + own_bytes(root / "a" / "deep")
+		                     + own_bytes(root / "b");
+		CPPUNIT_ASSERT(n.totals.apparent_bytes
+		               == dirs + 1000 + 200 + 30 + (1 << 20));
+
+		// sparse files take less space than they claim
+		fs::disk_usage_node b = fs::disk_usage(root / "b");
+		CPPUNIT_ASSERT(b.totals.allocated_bytes < b.totals.apparent_bytes);
+
+		// a plain file is its own total
+		fs::disk_usage_node f = fs::disk_usage(root / "top");
+		CPPUNIT_ASSERT(f.totals.apparent_bytes == 30);
+		CPPUNIT_ASSERT(f.totals.files == 1);
+		CPPUNIT_ASSERT(f.totals.directories == 0);
+		CPPUNIT_ASSERT(f.children.empty());
+	}
+
+	void retained_tree()
+	{
+		fs::disk_usage_node n = fs::disk_usage(root, 0);
+		CPPUNIT_ASSERT(n.children.empty());
+
+		n = fs::disk_usage(root / "/", 1);
+		CPPUNIT_ASSERT(n.children.size() == 2);
+
+		uintmax_t sum = own_bytes(root) + 30;
+		for (const auto & c : n.children)
+		{
+			CPPUNIT_ASSERT(c.path.parent_path() == root);
+			CPPUNIT_ASSERT(c.children.empty());
+			sum += c.totals.apparent_bytes;
+		}
+		CPPUNIT_ASSERT(sum == n.totals.apparent_bytes);
+
+		n = fs::disk_usage(root, 5);
+		const fs::disk_usage_node & a = (n.children[0].path.filename() == "a")
+		                              ? n.children[0] : n.children[1];
+		CPPUNIT_ASSERT(a.children.size() == 1);
+		CPPUNIT_ASSERT(a.children[0].path == root / "a" / "deep");
+		CPPUNIT_ASSERT(a.children[0].totals.files == 1);
+	}
+
+	void streaming()
+	{
+		std::vector<std::string> seen;
+		std::vector<std::size_t> depths;
+
+		fs::disk_usage_totals t = fs::for_each_disk_usage(root,
+		    [&](fs::path_view dir, const fs::disk_usage_totals &,
+		        std::size_t depth)
+		    {
+		        seen.push_back(dir.string());
+		        depths.push_back(depth);
+		    });
+
+		CPPUNIT_ASSERT(seen.size() == 4);
+		CPPUNIT_ASSERT(t.directories == 4);
+
+		// post-order: every directory after everything below it
+		CPPUNIT_ASSERT(seen.back() == root.native());
+		CPPUNIT_ASSERT(depths.back() == 0);
+
+		for (std::size_t i = 0; i < seen.size(); ++i)
+		{
+			if (seen[i] == (root / "a" / "deep").native())
+				CPPUNIT_ASSERT(depths[i] == 2);
+
+			for (std::size_t j = i + 1; j < seen.size(); ++j)
+				CPPUNIT_ASSERT(seen[i].compare(0, seen[j].size(), seen[j]) != 0
+				               || seen[i].size() > seen[j].size());
+		}
+	}
+
+	void errors()
+	{
+		std::error_code ec;
+		fs::disk_usage(root / "missing", 1, fs::disk_usage_options::none, ec);
+		CPPUNIT_ASSERT(ec == std::errc::no_such_file_or_directory);
+
+		CPPUNIT_ASSERT_THROW(fs::disk_usage(root / "missing"),
+		                     fs::filesystem_error);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_disk_usage);
@@ -0,0 +1,265 @@
+#include "descriptor/file_watcher.h"
+#include "filesystem/fs_operations.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "cppunit-header.h"
+
+namespace fs = filesystem::v1;
+
+class Test_file_watcher : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_file_watcher);
+	CPPUNIT_TEST(inotify_descriptor);
+	CPPUNIT_TEST(create_and_modify);
+	CPPUNIT_TEST(new_subdirectories);
+	CPPUNIT_TEST(coalescing);
+	CPPUNIT_TEST(run_and_stop);
+	CPPUNIT_TEST(watch_from_callback);
+	CPPUNIT_TEST_SUITE_END();
+
+	fs::path root;
+	std::vector<io::change_set> sets;
+
+ public:
+	void setUp()
+	{
+		root = fs::temp_directory_path();
+		root /= "file_watcher.";
+		root += std::to_string(getpid());
+		fs::create_directories(root);
+		sets.clear();
+	}
+
+	void tearDown()
+	{
+		fs::remove_all(root);
+	}
+
+ protected:
+	static void touch(const fs::path & p, const char * data = "x")
+	{
+		std::ofstream(p.c_str(), std::ios::app) << data;
+	}
+
+	// polls until a batch has been delivered or a second has passed
+	void wait_for_batch(io::file_watcher & w)
+	{
+		for (int i = 0; i < 100 && sets.empty(); ++i)
+			w.poll(std::chrono::milliseconds(10));
+	}
+
+	const io::change * find(const fs::path & p) const
+	{
+		for (const auto & s : sets)
+			for (const auto & c : s.changes)
+				if (c.path == p)
+					return &c;
+		return nullptr;
+	}
+
+	io::file_watcher::callback_t collector()
+	{
+		return [this](const io::change_set & cs) { sets.push_back(cs); };
+	}
+
+	void inotify_descriptor()
+	{
+		io::inotify_descriptor in;
+		int wd = in.add_watch(root, IN_CREATE);
+		CPPUNIT_ASSERT(wd >= 0);
+
+		alignas(inotify_event) char buf[4096];
+		CPPUNIT_ASSERT(in.read_events(buf, sizeof(buf)) == 0);
+
+		touch(root / "a");
+
+		std::size_t n = in.read_events(buf, sizeof(buf));
+		CPPUNIT_ASSERT(n > 0);
+
+		int count = 0;
+		io::inotify_descriptor::for_each_event(buf, n,
+		    [&](const inotify_event & ev)
+		    {
+		        CPPUNIT_ASSERT(ev.wd == wd);
+		        CPPUNIT_ASSERT(std::string(ev.name) == "a");
+		        ++count;
+		    });
+		CPPUNIT_ASSERT(count == 1);
+
+		in.remove_watch(wd);
+		std::error_code ec;
+		in.add_watch(root / "missing", IN_CREATE, ec);
+		CPPUNIT_ASSERT(ec);
+	}
+
+	void create_and_modify()
+	{
+		touch(root / "existing");
+
+		io::file_watcher w(std::chrono::milliseconds(20));
+		w.watch(root, collector());
+
+		touch(root / "new");
+		touch(root / "existing");
+
+		wait_for_batch(w);
+		CPPUNIT_ASSERT(sets.size() == 1);
+		CPPUNIT_ASSERT(sets[0].root == root);
+		CPPUNIT_ASSERT(!sets[0].overflowed);
+		CPPUNIT_ASSERT(sets[0].contains(root / "new"));
+
+		const io::change * c = find(root / "existing");
+		CPPUNIT_ASSERT(c != nullptr);
+		CPPUNIT_ASSERT((c->type & io::change_type::modified)
+		               != io::change_type::none);
+		CPPUNIT_ASSERT((c->type & io::change_type::created)
+		               == io::change_type::none);
+
+		fs::directory_entry e(root / "existing");
+		CPPUNIT_ASSERT(e.is_regular_file());
+
+		sets.clear();
+		fs::remove(root / "existing");
+		wait_for_batch(w);
+		c = find(root / "existing");
+		CPPUNIT_ASSERT(c != nullptr);
+		CPPUNIT_ASSERT(c->type == io::change_type::removed);
+
+		fs::directory_entry other(root / "other");
+		CPPUNIT_ASSERT(!sets[0].invalidate(other));
+		CPPUNIT_ASSERT(e.exists());
+		CPPUNIT_ASSERT(sets[0].invalidate(e));
+		CPPUNIT_ASSERT(!e.exists());
+
+		// nothing happening means nothing delivered
+		sets.clear();
+		CPPUNIT_ASSERT(w.poll(std::chrono::milliseconds(30)) == 0);
+		CPPUNIT_ASSERT(sets.empty());
+	}
+
+	void new_subdirectories()
+	{
+		io::file_watcher w(std::chrono::milliseconds(20));
+		w.watch(root, collector());
+		std::size_t initial = w.watch_count();
+
+		fs::create_directories(root / "a/b");
+		touch(root / "a/b/f");
+
+		wait_for_batch(w);
+		CPPUNIT_ASSERT(w.watch_count() == initial + 2);
+		CPPUNIT_ASSERT(find(root / "a") != nullptr);
+		CPPUNIT_ASSERT(find(root / "a/b/f") != nullptr);
+
+		// events from the new directories arrive too
+		sets.clear();
+		touch(root / "a/b/g");
+		wait_for_batch(w);
+		CPPUNIT_ASSERT(find(root / "a/b/g") != nullptr);
+
+		// moving a directory out of the tree drops its watches
+		sets.clear();
+		fs::path outside = root.native() + ".moved";
+		fs::rename(root / "a", outside);
+		wait_for_batch(w);
+		CPPUNIT_ASSERT(find(root / "a") != nullptr);
+		CPPUNIT_ASSERT(w.watch_count() == initial);
+		fs::remove_all(outside);
+	}
+
+	void coalescing()
+	{
+		io::file_watcher w(std::chrono::milliseconds(50));
+		w.watch(root, collector());
+
+		for (int i = 0; i < 20; ++i)
+			touch(root / "hot", "y");
+
+		touch(root / "transient");
+		fs::remove(root / "transient");
+
+		wait_for_batch(w);
+		CPPUNIT_ASSERT(sets.size() == 1);
+		CPPUNIT_ASSERT(sets[0].changes.size() == 1);
+		CPPUNIT_ASSERT(sets[0].changes[0].path == root / "hot");
+
+		// flush() delivers without waiting for the debounce interval
+		sets.clear();
+		touch(root / "hot");
+		usleep(1000);
+		w.flush();
+		CPPUNIT_ASSERT(sets.size() == 1);
+	}
+
+	void run_and_stop()
+	{
+		io::file_watcher w(std::chrono::milliseconds(5));
+		w.watch(root, [&w](const io::change_set &) { w.stop(); });
+
+		std::thread t([&w] { w.run(); });
+		touch(root / "trigger");
+		t.join();
+
+		// the stop request was used up, so it runs again
+		std::thread again([&w] { w.run(); });
+		touch(root / "trigger");
+		again.join();
+
+		io::file_watcher w2;
+		w2.watch(root, collector());
+		std::thread t2([&w2] { w2.run(); });
+		w2.stop();
+		t2.join();
+		CPPUNIT_ASSERT(sets.empty());
+	}
+
+	void watch_from_callback()
+	{
+		io::file_watcher w(std::chrono::milliseconds(5));
+		std::vector<fs::path> dirs;
+
+		for (const char * d : { "a", "b", "c", "d", "e", "f", "g", "h" })
+		{
+			dirs.push_back(root / d);
+			fs::create_directory(dirs.back());
+		}
+
+		// the first root's callback swaps itself out for the rest, which
+		// moves every root, the one whose callback is running included
+		int calls = 0;
+		w.watch(dirs[0], [&](const io::change_set & cs)
+		{
+			++calls;
+			CPPUNIT_ASSERT(cs.contains(dirs[0] / "x"));
+			w.unwatch(dirs[0]);
+			for (std::size_t i = 2; i < dirs.size(); ++i)
+				w.watch(dirs[i], collector());
+			CPPUNIT_ASSERT(cs.root == dirs[0]);
+		});
+		w.watch(dirs[1], collector());
+
+		touch(dirs[0] / "x");
+		touch(dirs[1] / "x");
+		usleep(1000);
+		CPPUNIT_ASSERT(w.flush() == 2);
+		CPPUNIT_ASSERT(calls == 1);
+		CPPUNIT_ASSERT(sets.size() == 1);
+		CPPUNIT_ASSERT(sets[0].root == dirs[1]);
+
+		sets.clear();
+		touch(dirs[0] / "y");
+		touch(dirs[7] / "y");
+		usleep(1000);
+		CPPUNIT_ASSERT(w.flush() == 1);
+		CPPUNIT_ASSERT(calls == 1);
+		CPPUNIT_ASSERT(find(dirs[7] / "y") != nullptr);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_file_watcher);
@@ -2,10 +2,12 @@
 #include "filesystem/directory_iterator.h"
 #include "filesystem/file_status.h"
 #include "filesystem/path.h"
+#include "filesystem/canonical_cache.h"
 
 #include <unistd.h>
 
 #include <cstdlib>
+#include <fstream>
 #include <string>
 #include <functional>
 
@@ -19,6 +21,7 @@ class Test_fs_operations : public CppUnit::TestFixture
 	CPPUNIT_TEST(copy_options_bitmask_operators);
 	CPPUNIT_TEST(absolute);
 	CPPUNIT_TEST(canonical);
+	CPPUNIT_TEST(canonical_cache);
 	CPPUNIT_TEST(copy_file);
 	CPPUNIT_TEST(copy_symlink);
 	CPPUNIT_TEST(create_directories);
@@ -26,6 +29,7 @@ class Test_fs_operations : public CppUnit::TestFixture
 	CPPUNIT_TEST(get_current_path);
 	CPPUNIT_TEST(set_current_path);
 	CPPUNIT_TEST(is_empty);
+	CPPUNIT_TEST(entry_count);
 	CPPUNIT_TEST(rename);
 	CPPUNIT_TEST(space);
 	CPPUNIT_TEST(status);
@@ -216,6 +220,37 @@ class Test_fs_operations : public CppUnit::TestFixture
 		fs::remove(bad_link);
 	}
 
+	void canonical_cache()
+	{
+		const fs::path tmp = fs::canonical(fs::temp_directory_path());
+		const fs::path real = tmp / "real";
+
+		fs::create_directory(real);
+		std::ofstream(fs::path(real / "f1").c_str()) << "f1";
+		std::ofstream(fs::path(real / "f2").c_str()) << "f2";
+		fs::create_directory_symlink(real, tmp / "link");
+		fs::create_symlink(real / "f1", real / "lf");
+
+		fs::canonical_cache cache(4);
+
+		CPPUNIT_ASSERT(cache.canonical(tmp / "link/f1") == real / "f1");
+		CPPUNIT_ASSERT(cache.misses() == 1);
+		CPPUNIT_ASSERT(cache.canonical(tmp / "link/f2") == real / "f2");
+		CPPUNIT_ASSERT(cache.hits() == 1);
+		CPPUNIT_ASSERT(cache.canonical(tmp / "link/lf") == real / "f1");
+		CPPUNIT_ASSERT(cache.canonical(tmp / "link/..") == tmp);
+		CPPUNIT_ASSERT(cache.size() == 1);
+
+		std::error_code ec;
+		CPPUNIT_ASSERT(cache.canonical(tmp / "link/missing", ec).empty());
+		CPPUNIT_ASSERT(ec);
+		CPPUNIT_ASSERT_THROW(cache.canonical(tmp / "nodir/f1"),
+		                     fs::filesystem_error);
+
+		cache.clear();
+		CPPUNIT_ASSERT(cache.size() == 0);
+	}
+
 	void copy_file()
 	{
 		using CO = fs::copy_options;
@@ -341,6 +376,45 @@ class Test_fs_operations : public CppUnit::TestFixture
 		CPPUNIT_ASSERT(!fs::is_empty(q));
 		CPPUNIT_ASSERT_NO_THROW(fs::resize_file(q, 0));
 		CPPUNIT_ASSERT(fs::is_empty(q));
+
+		// a lone file, so the link count doesn't give it away
+		CPPUNIT_ASSERT(fs::remove_all(p / "subdir") != 0);
+		CPPUNIT_ASSERT(!fs::is_empty(p));
+		CPPUNIT_ASSERT(!fs::is_empty(fs::path_view(p.c_str(), p.native().size())));
+		CPPUNIT_ASSERT(fs::remove_all(p) != 0);
+
+		fs::is_empty(p, ec);
+		CPPUNIT_ASSERT(ec == std::errc::no_such_file_or_directory);
+		CPPUNIT_ASSERT_THROW(fs::is_empty("/dev/null"), fs::filesystem_error);
+	}
+
+	void entry_count()
+	{
+		fs::path p = fs::temp_directory_path() / "countdir";
+		std::error_code ec;
+		try { fs::remove_all(p); } catch (...) { }
+		fs::create_directory(p);
+
+		CPPUNIT_ASSERT(fs::entry_count(p) == 0);
+		CPPUNIT_ASSERT(fs::subdirectory_count(p) == 0);
+
+		// enough names to take several getdents64 batches
+		for (int i = 0; i < 2000; ++i)
+			fs::create_symlink("target", p / ("link" + std::to_string(i)));
+		for (int i = 0; i < 5; ++i)
+			fs::create_directory(p / ("dir" + std::to_string(i)));
+
+		CPPUNIT_ASSERT(fs::entry_count(p) == 2005);
+		CPPUNIT_ASSERT(fs::entry_count(fs::path_view(p)) == 2005);
+		CPPUNIT_ASSERT(fs::subdirectory_count(p) == 5);
+
+		fs::entry_count(p / "link0", ec);
+		CPPUNIT_ASSERT(ec);
+		fs::subdirectory_count(p / "missing", ec);
+		CPPUNIT_ASSERT(ec == std::errc::no_such_file_or_directory);
+		CPPUNIT_ASSERT_THROW(fs::entry_count(p / "missing"),
+		                     fs::filesystem_error);
+
 		CPPUNIT_ASSERT(fs::remove_all(p) != 0);
 	}
 
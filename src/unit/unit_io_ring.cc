@@ -0,0 +1,296 @@
+#include "descriptor/io_ring.h"
+
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cppunit-header.h"
+
+class Test_io_ring : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_io_ring);
+	CPPUNIT_TEST(read_write);
+	CPPUNIT_TEST(futures);
+	CPPUNIT_TEST(open_and_stat);
+	CPPUNIT_TEST(splice);
+	CPPUNIT_TEST(registered);
+	CPPUNIT_TEST(many_in_flight);
+	CPPUNIT_TEST(reentrant_callbacks);
+	CPPUNIT_TEST_SUITE_END();
+
+	std::string name;
+	filesystem::path file;
+
+ public:
+	void setUp()
+	{
+		char tmpl[] = "/tmp/io_ring.XXXXXX";
+		int fd = mkstemp(tmpl);
+		CPPUNIT_ASSERT(fd >= 0);
+		::close(fd);
+		name = tmpl;
+		file = filesystem::path(name);
+	}
+
+	void tearDown()
+	{
+		unlink(name.c_str());
+	}
+
+ protected:
+	// every case runs on io_uring (where the kernel allows it) and on the
+	// thread pool fallback
+	void read_write()
+	{
+		check_read_write(false);
+		check_read_write(true);
+	}
+
+	void futures()
+	{
+		check_futures(false);
+		check_futures(true);
+	}
+
+	void open_and_stat()
+	{
+		check_open_and_stat(false);
+		check_open_and_stat(true);
+	}
+
+	void splice()
+	{
+		check_splice(false);
+		check_splice(true);
+	}
+
+	void registered()
+	{
+		check_registered(false);
+		check_registered(true);
+	}
+
+	void many_in_flight()
+	{
+		check_many_in_flight(false);
+		check_many_in_flight(true);
+	}
+
+	void reentrant_callbacks()
+	{
+		check_reentrant_callbacks(false);
+		check_reentrant_callbacks(true);
+	}
+
+	void check_read_write(bool fallback)
+	{
+		io::io_ring ring(8, fallback);
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+		int written = -1, synced = -1, got = -1;
+		char buf[16] = { };
+
+		if (fallback) CPPUNIT_ASSERT(!ring.uses_io_uring());
+
+		ring.write(f, "hello ring", 10, 0, [&](int r) { written = r; });
+		ring.fsync(f, true, [&](int r) { synced = r; });
+		CPPUNIT_ASSERT(ring.pending() == 2);
+
+		while (ring.pending() > 0)
+			ring.wait();
+		CPPUNIT_ASSERT(written == 10);
+		CPPUNIT_ASSERT(synced == 0);
+
+		ring.read(f, buf, sizeof(buf), 6, [&](int r) { got = r; });
+		CPPUNIT_ASSERT(ring.wait() == 1);
+		CPPUNIT_ASSERT(got == 4);
+		CPPUNIT_ASSERT(std::string(buf, 4) == "ring");
+
+		// errors arrive as -errno
+		io::file_descriptor ro(file);
+		ring.write(ro, "x", 1, 0, [&](int r) { written = r; });
+		ring.wait();
+		CPPUNIT_ASSERT(written == -EBADF);
+	}
+
+	void check_futures(bool fallback)
+	{
+		io::io_ring ring(8, fallback);
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+		char buf[8];
+
+		std::future<int> w = ring.write(f, "future", 6, 0);
+		ring.wait();
+		CPPUNIT_ASSERT(w.get() == 6);
+
+		std::future<int> r = ring.read(f, buf, sizeof(buf), 0);
+		std::future<int> s = ring.fsync(f);
+		ring.wait(2);
+		CPPUNIT_ASSERT(r.get() == 6);
+		CPPUNIT_ASSERT(s.get() == 0);
+		CPPUNIT_ASSERT(std::string(buf, 6) == "future");
+	}
+
+	void check_open_and_stat(bool fallback)
+	{
+		io::io_ring ring(8, fallback);
+		int fd = -1, stat_result = -1;
+		struct statx stx;
+
+		{
+			io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+			f.write("0123456789", 10);
+		}
+
+		ring.openat(io::ring_file::raw(AT_FDCWD), file, O_RDONLY | O_CLOEXEC, 0,
+		            [&](int r) { fd = r; });
+		ring.statx(io::ring_file::raw(AT_FDCWD), file, 0, STATX_SIZE, &stx,
+		           [&](int r) { stat_result = r; });
+		ring.wait(2);
+
+		CPPUNIT_ASSERT(fd >= 0);
+		CPPUNIT_ASSERT(stat_result == 0);
+		CPPUNIT_ASSERT(stx.stx_size == 10);
+
+		io::io_descriptor opened(fd);
+		char c;
+		CPPUNIT_ASSERT(opened.read(&c, 1) == 1 && c == '0');
+
+		ring.openat(io::ring_file::raw(AT_FDCWD),
+		            filesystem::path("/nonexistent/file"), O_RDONLY, 0,
+		            [&](int r) { fd = r; });
+		ring.wait();
+		CPPUNIT_ASSERT(fd == -ENOENT);
+	}
+
+	void check_splice(bool fallback)
+	{
+		io::io_ring ring(8, fallback);
+		int fds[2];
+		int moved = -1;
+		char buf[16];
+
+		{
+			io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+			f.write("spliced data", 12);
+		}
+
+		CPPUNIT_ASSERT(pipe2(fds, O_CLOEXEC) == 0);
+		io::io_descriptor rd(fds[0]), wr(fds[1]);
+		io::file_descriptor f(file);
+
+		ring.splice(f, 8, wr, -1, 4, 0, [&](int r) { moved = r; });
+		ring.wait();
+		CPPUNIT_ASSERT(moved == 4);
+		CPPUNIT_ASSERT(rd.read(buf, sizeof(buf)) == 4);
+		CPPUNIT_ASSERT(std::string(buf, 4) == "data");
+	}
+
+	void check_registered(bool fallback)
+	{
+		io::io_ring ring(8, fallback);
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+		std::vector<char> block(4096, 'r');
+		std::vector<char> back(4096);
+		struct iovec iov[2] = {
+			{ block.data(), block.size() },
+			{ back.data(), back.size() },
+		};
+		const int fds[1] = { f.native_handle() };
+		int written = -1, got = -1;
+
+		ring.register_buffers(iov, 2);
+		ring.register_files(fds, 1);
+
+		ring.write_fixed(io::ring_file::fixed(0), block.data(), block.size(),
+		                 0, 0, [&](int r) { written = r; });
+		ring.wait();
+		CPPUNIT_ASSERT(written == 4096);
+
+		ring.read_fixed(io::ring_file::fixed(0), back.data() + 1, 100, 1, 1,
+		                [&](int r) { got = r; });
+		ring.wait();
+		CPPUNIT_ASSERT(got == 100);
+		CPPUNIT_ASSERT(back[1] == 'r' && back[100] == 'r' && back[0] == 0);
+
+		ring.unregister_files();
+		ring.unregister_buffers();
+
+		// replacing a registered set is allowed
+		ring.register_files(fds, 1);
+		ring.register_files(fds, 1);
+	}
+
+	void check_many_in_flight(bool fallback)
+	{
+		// more operations than the rings hold
+		io::io_ring ring(4, fallback);
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+		std::vector<char> data(1000);
+		int total = 0;
+
+		for (std::size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<char>(i % 251);
+		f.write(data.data(), data.size());
+
+		std::vector<char> back(data.size());
+		for (std::size_t i = 0; i < back.size(); i += 10)
+			ring.read(f, &back[i], 10, static_cast<off_t>(i),
+			          [&](int r) { total += r; });
+
+		ring.wait(static_cast<unsigned>(ring.pending()));
+		CPPUNIT_ASSERT(ring.pending() == 0);
+		CPPUNIT_ASSERT(total == 1000);
+		CPPUNIT_ASSERT(back == data);
+	}
+
+	void check_reentrant_callbacks(bool fallback)
+	{
+		// the first callback polls the ring, which delivers completions
+		// from inside the outer delivery, and then queues more reads than
+		// there's room for, which waits from inside it as well
+		io::io_ring ring(4, fallback);
+		io::file_descriptor f(file, O_RDWR | O_TRUNC);
+		std::vector<char> data(16), back(16);
+		std::vector<int> calls(16, 0);
+
+		for (std::size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<char>('a' + i);
+		f.write(data.data(), data.size());
+
+		for (std::size_t i = 0; i < 8; ++i)
+		{
+			ring.read(f, &back[i], 1, static_cast<off_t>(i),
+			          [&, i](int r) {
+				CPPUNIT_ASSERT(r == 1);
+				++calls[i];
+
+				if (i != 0)
+					return;
+
+				ring.poll();
+				for (std::size_t j = 8; j < 16; ++j)
+					ring.read(f, &back[j], 1, static_cast<off_t>(j),
+					          [&, j](int r) {
+						CPPUNIT_ASSERT(r == 1);
+						++calls[j];
+					});
+			});
+		}
+
+		while (ring.pending() > 0)
+		{
+			CPPUNIT_ASSERT(ring.pending() <= 16);
+			ring.wait();
+		}
+
+		CPPUNIT_ASSERT(calls == std::vector<int>(16, 1));
+		CPPUNIT_ASSERT(back == data);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_io_ring);
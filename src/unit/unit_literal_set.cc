@@ -0,0 +1,226 @@
+#include "automata/literal_set.h"
+
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cppunit-header.h"
+
+namespace {
+
+typedef std::vector<automata::literal_set::match> matches;
+
+/// Every occurrence of every pattern, the slow way, in find_all's order
+matches brute_force(const std::vector<std::string> & patterns,
+                    const std::string & text)
+{
+	matches found;
+
+	for (std::size_t at = 0; at < text.size(); ++at)
+		for (std::size_t i = 0; i < patterns.size(); ++i)
+			if (text.compare(at, patterns[i].size(), patterns[i]) == 0)
+				found.push_back({ i, at });
+
+	return found;
+}
+
+bool same(const matches & a, const matches & b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (std::size_t i = 0; i < a.size(); ++i)
+		if ((a[i].pattern != b[i].pattern) || (a[i].offset != b[i].offset))
+			return false;
+
+	return true;
+}
+
+std::string random_string(std::mt19937 & rng, const char * alphabet,
+                          std::size_t length)
+{
+	const std::size_t n = strlen(alphabet);
+	std::string s;
+
+	for (std::size_t i = 0; i < length; ++i)
+		s += alphabet[rng() % n];
+
+	return s;
+}
+
+} // namespace
+
+class Test_literal_set : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_literal_set);
+	CPPUNIT_TEST(overlapping);
+	CPPUNIT_TEST(nothing_to_find);
+	CPPUNIT_TEST(empty_pattern);
+	CPPUNIT_TEST(classes);
+	CPPUNIT_TEST(matches_brute_force);
+	CPPUNIT_TEST(long_inputs);
+	CPPUNIT_TEST(every_byte);
+	CPPUNIT_TEST_SUITE_END();
+
+ public:
+	void overlapping()
+	{
+		const std::vector<std::string> patterns = {
+			"he", "she", "his", "hers"
+		};
+		const std::string text = "ushers";
+
+		for (bool prefilter : { false, true })
+		{
+			automata::literal_set set(patterns, prefilter);
+			const matches found = set.find_all(text.data(),
+			                                   text.data() + text.size());
+
+			CPPUNIT_ASSERT_EQUAL(std::size_t(3), found.size());
+			CPPUNIT_ASSERT_EQUAL(std::size_t(1), found[0].pattern);
+			CPPUNIT_ASSERT_EQUAL(std::size_t(1), found[0].offset);
+			CPPUNIT_ASSERT_EQUAL(std::size_t(0), found[1].pattern);
+			CPPUNIT_ASSERT_EQUAL(std::size_t(2), found[1].offset);
+			CPPUNIT_ASSERT_EQUAL(std::size_t(3), found[2].pattern);
+			CPPUNIT_ASSERT_EQUAL(std::size_t(2), found[2].offset);
+		}
+
+		// the same string twice is reported as both
+		automata::literal_set twice({ "ab", "b", "ab" });
+		const matches found = twice.find_all("xab", "xab" + 3);
+
+		CPPUNIT_ASSERT_EQUAL(std::size_t(3), found.size());
+		CPPUNIT_ASSERT_EQUAL(std::size_t(0), found[0].pattern);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(2), found[1].pattern);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(1), found[2].pattern);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(2), found[2].offset);
+	}
+
+	void nothing_to_find()
+	{
+		const std::string text = "some text";
+		automata::literal_set none(std::vector<std::string>{});
+
+		CPPUNIT_ASSERT_EQUAL(std::size_t(0), none.size());
+		CPPUNIT_ASSERT(! none.prefiltered());
+		CPPUNIT_ASSERT(none.find_all(text.data(), text.data() + 9).empty());
+
+		automata::literal_set absent({ "needle" });
+		CPPUNIT_ASSERT(absent.find_all(text.data(), text.data() + 9).empty());
+		CPPUNIT_ASSERT(absent.find_all(text.data(), text.data()).empty());
+	}
+
+	void empty_pattern()
+	{
+		CPPUNIT_ASSERT_THROW(automata::literal_set({ "a", "" }),
+		                     std::invalid_argument);
+	}
+
+	void classes()
+	{
+		automata::literal_set set({ "abc", "cab", "aaa" });
+
+		// a, b, c and the rest
+		CPPUNIT_ASSERT_EQUAL(std::size_t(4), set.class_count());
+
+		// the root, a, ab, abc, aa, aaa, c, ca, cab
+		CPPUNIT_ASSERT_EQUAL(std::size_t(9), set.state_count());
+	}
+
+	void matches_brute_force()
+	{
+		std::mt19937 rng(49);
+
+		for (unsigned i = 0; i < 300; ++i)
+		{
+			// few enough for the prefilter, or not
+			const std::size_t count = 1 + rng() % ((i % 3) ? 20 : 150);
+			const unsigned longest = 1 + rng() % 6;
+			std::vector<std::string> patterns;
+
+			for (std::size_t j = 0; j < count; ++j)
+				patterns.push_back(
+				  random_string(rng, "abcd\xff", 1 + rng() % longest));
+
+			const automata::literal_set scanned(patterns, false);
+			const automata::literal_set prefiltered(patterns, true);
+
+			for (unsigned j = 0; j < 10; ++j)
+			{
+				const std::string text =
+				  random_string(rng, "abcdefg\xff", rng() % 80);
+				const char * begin = text.data();
+				const char * end = begin + text.size();
+				const matches expected = brute_force(patterns, text);
+
+				CPPUNIT_ASSERT(same(expected, scanned.find_all(begin, end)));
+				CPPUNIT_ASSERT(same(expected,
+				                    prefiltered.find_all(begin, end)));
+			}
+		}
+	}
+
+	void long_inputs()
+	{
+		// one, two and three leading bytes for the prefilter
+		const std::vector<std::vector<std::string>> sets = {
+			{ "x", "needle", "pin" },
+			{ "needle", "pi", "thread" },
+			{ "needle", "pin", "thread", "haystack", "straw" },
+			{ "needle", "thread", "haystack" },
+		};
+		std::mt19937 rng(7);
+
+		for (const auto & patterns : sets)
+		{
+			const automata::literal_set set(patterns);
+
+			for (std::size_t size : { 15, 16, 17, 31, 32, 33, 4096 })
+			{
+				const std::string text =
+				  random_string(rng, "neptdhas ", size);
+
+				for (const std::string & word : patterns)
+				{
+					for (std::size_t at : { std::size_t(0), size / 2,
+					                        size - (size % 16), size })
+					{
+						std::string planted = text;
+						planted.insert(at, word);
+
+						const char * begin = planted.data();
+						const char * end = begin + planted.size();
+
+						CPPUNIT_ASSERT(same(brute_force(patterns, planted),
+						                    set.find_all(begin, end)));
+					}
+				}
+			}
+		}
+	}
+
+	void every_byte()
+	{
+		// no bytes are left for a class of their own
+		std::vector<std::string> patterns;
+
+		for (unsigned b = 0; b < 256; ++b)
+			patterns.push_back(std::string(1, static_cast<char>(b)) + "z");
+
+		const automata::literal_set set(patterns);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(256), set.class_count());
+
+		const std::string text("\0z\xffzz", 5);
+		const matches found = set.find_all(text.data(),
+		                                   text.data() + text.size());
+
+		CPPUNIT_ASSERT_EQUAL(std::size_t(3), found.size());
+		CPPUNIT_ASSERT_EQUAL(std::size_t(0), found[0].pattern);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(255), found[1].pattern);
+		CPPUNIT_ASSERT_EQUAL(std::size_t('z'), found[2].pattern);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_literal_set);
@@ -0,0 +1,90 @@
+#include "automata/table.h"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+
+#include "cppunit-header.h"
+
+namespace {
+
+typedef static_lookup_table<uint8_t, 3, 4> small_table;
+
+/// A table of constants, which has to be made at compile time
+constexpr small_table counting(small_table::values_type{{
+	 0,  1,  2,  3,
+	 4,  5,  6,  7,
+	 8,  9, 10, 11
+}});
+
+static_assert(counting.at(0, 0) == 0, "first element");
+static_assert(counting.at(1, 2) == 6, "rows of four");
+static_assert(counting.at(2, 3) == 11, "last element");
+static_assert(counting.data()[7] == 7, "last index varies fastest");
+static_assert(small_table::element_count == 12, "three by four");
+static_assert(table_strides<5, 6, 7>::offset(1, 2, 3) == 1 * 42 + 2 * 7 + 3,
+              "strides are products of the later dimensions");
+
+} // namespace
+
+class Test_lookup_table : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_lookup_table);
+	CPPUNIT_TEST(same_layout);
+	CPPUNIT_TEST(bounds);
+	CPPUNIT_TEST(default_values);
+	CPPUNIT_TEST_SUITE_END();
+
+ public:
+	void same_layout()
+	{
+		lookup_table<uint32_t, 3> dynamic(
+		  lookup_table<uint32_t, 3>::index_type{{ 3, 5, 7 }});
+		static_lookup_table<uint32_t, 3, 5, 7> fixed;
+		std::mt19937 rng(50);
+
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			for (std::size_t j = 0; j < 5; ++j)
+			{
+				for (std::size_t k = 0; k < 7; ++k)
+				{
+					const uint32_t v = rng();
+
+					dynamic[{{ i, j, k }}] = v;
+					fixed[{{ i, j, k }}] = v;
+				}
+			}
+		}
+
+		for (std::size_t i = 0; i < 3 * 5 * 7; ++i)
+			CPPUNIT_ASSERT_EQUAL(dynamic.data()[i], fixed.data()[i]);
+
+		CPPUNIT_ASSERT_EQUAL(dynamic.at(2, 4, 6), fixed.at(2, 4, 6));
+		CPPUNIT_ASSERT_EQUAL(dynamic.translate_index({{ 1, 2, 3 }}),
+		                     fixed.translate_index({{ 1, 2, 3 }}));
+	}
+
+	void bounds()
+	{
+		static_lookup_table<int, 2, 3> table;
+		const static_lookup_table<int, 2, 3> & view = table;
+
+		table.at({{ 1, 2 }}) = 5;
+		CPPUNIT_ASSERT_EQUAL(5, view.at({{ 1, 2 }}));
+		CPPUNIT_ASSERT_THROW(table.at({{ 2, 0 }}), std::out_of_range);
+		CPPUNIT_ASSERT_THROW(view.at({{ 0, 3 }}), std::out_of_range);
+	}
+
+	void default_values()
+	{
+		const static_lookup_table<double, 4, 4> zero;
+
+		for (std::size_t i = 0; i < 16; ++i)
+			CPPUNIT_ASSERT_EQUAL(0.0, zero.data()[i]);
+
+		CPPUNIT_ASSERT_EQUAL(uint8_t(9), (counting[{{ 2, 1 }}]));
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_lookup_table);
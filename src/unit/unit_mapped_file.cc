@@ -0,0 +1,186 @@
+#include "descriptor/mapped_file.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "utility/crc.h"
+
+#include "cppunit-header.h"
+
+class Test_mapped_file : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_mapped_file);
+	CPPUNIT_TEST(read_only);
+	CPPUNIT_TEST(read_write);
+	CPPUNIT_TEST(copy_on_write);
+	CPPUNIT_TEST(windows);
+	CPPUNIT_TEST(advice);
+	CPPUNIT_TEST(empty_and_move);
+	CPPUNIT_TEST_SUITE_END();
+
+	std::string name;
+	filesystem::path file;
+	std::string data;
+
+	std::string contents()
+	{
+		io::file_descriptor f(file);
+		std::string s(f.size(), '\0');
+		f.pread(&s[0], s.size(), 0);
+		return s;
+	}
+
+ public:
+	void setUp()
+	{
+		char tmpl[] = "/tmp/mapped_file.XXXXXX";
+		int fd = mkstemp(tmpl);
+		CPPUNIT_ASSERT(fd >= 0);
+		io::io_descriptor f(fd);
+		name = tmpl;
+		file = filesystem::path(name);
+
+		// a few pages and a bit, none of them alike
+		data.clear();
+		for (std::size_t i = 0; i < 3 * io::mapped_file::page_size() + 100; ++i)
+			data += static_cast<char>('a' + (i * 7 + i / 26) % 26);
+		f.write(data.data(), data.size());
+	}
+
+	void tearDown()
+	{
+		unlink(name.c_str());
+	}
+
+ protected:
+	void read_only()
+	{
+		io::mapped_file m(file);
+
+		CPPUNIT_ASSERT(m.is_mapped());
+		CPPUNIT_ASSERT(m.size() == data.size());
+		CPPUNIT_ASSERT(m.file_size() == static_cast<off_t>(data.size()));
+		CPPUNIT_ASSERT(m.offset() == 0);
+		CPPUNIT_ASSERT(std::memcmp(m.data(), data.data(), data.size()) == 0);
+
+		// checksummed in place, with no copy
+		io::span<const char> b = m.bytes();
+		CRC_32 in_place, copied;
+		in_place(b.data(), b.size());
+		copied(data.data(), data.size());
+		CPPUNIT_ASSERT(in_place.get() == copied.get());
+
+		CPPUNIT_ASSERT(b.subspan(10, 5).size() == 5);
+		CPPUNIT_ASSERT(b.subspan(10, 5)[0] == data[10]);
+		CPPUNIT_ASSERT(b.subspan(data.size() - 2).size() == 2);
+		CPPUNIT_ASSERT(b.subspan(data.size() + 10).empty());
+	}
+
+	void read_write()
+	{
+		{
+			io::mapped_file m(file, io::map_mode::read_write);
+			io::span<char> w = m.writable_bytes();
+
+			std::memcpy(w.data() + 5000, "HELLO", 5);
+			m.sync(5000, 5);
+			m.sync();
+		}
+
+		data.replace(5000, 5, "HELLO");
+		CPPUNIT_ASSERT(contents() == data);
+
+		// sync of a read-only mapping does nothing
+		io::mapped_file r(file);
+		r.sync();
+	}
+
+	void copy_on_write()
+	{
+		io::mapped_file m(file, io::map_mode::copy_on_write);
+
+		m.writable_bytes()[0] = '#';
+		CPPUNIT_ASSERT(m.data()[0] == '#');
+		m.sync();
+		CPPUNIT_ASSERT(contents() == data);
+	}
+
+	void windows()
+	{
+		const std::size_t page = io::mapped_file::page_size();
+		io::mapped_file m(file, io::map_mode::read_only, page);
+
+		CPPUNIT_ASSERT(m.size() == page);
+		CPPUNIT_ASSERT(m.window() == page);
+
+		// walking the file a window at a time sees all of it
+		std::string seen(m.data(), m.size());
+		for (io::span<const char> s = m.next(); !s.empty(); s = m.next())
+			seen.append(s.data(), s.size());
+		CPPUNIT_ASSERT(seen == data);
+		CPPUNIT_ASSERT(m.offset() == static_cast<off_t>(data.size()));
+
+		// windows needn't start on a page boundary
+		io::span<const char> s = m.map(page + 123, 1000);
+		CPPUNIT_ASSERT(s.size() == 1000);
+		CPPUNIT_ASSERT(m.offset() == static_cast<off_t>(page + 123));
+		CPPUNIT_ASSERT(std::memcmp(s.data(), data.data() + page + 123, 1000)
+		               == 0);
+
+		// clamped at the end of the file
+		s = m.map(data.size() - 10, 1000);
+		CPPUNIT_ASSERT(s.size() == 10);
+
+		std::error_code ec;
+		m.map(-1, 0, ec);
+		CPPUNIT_ASSERT(ec == std::errc::invalid_argument);
+	}
+
+	void advice()
+	{
+		io::mapped_file m(file);
+		std::error_code ec;
+
+		m.advise(io::map_advice::sequential);
+		m.advise(io::map_advice::will_need, 100, 5000);
+		m.advise(io::map_advice::random, 4097, 1);
+
+		// these depend on the kernel and filesystem
+		m.advise(io::map_advice::populate_read, 0, 0, ec);
+		CPPUNIT_ASSERT(!ec || ec == std::errc::invalid_argument);
+		m.advise(io::map_advice::huge_page, 0, 0, ec);
+		CPPUNIT_ASSERT(!ec || ec == std::errc::invalid_argument);
+
+		CPPUNIT_ASSERT(std::memcmp(m.data(), data.data(), data.size()) == 0);
+	}
+
+	void empty_and_move()
+	{
+		io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+		f.close();
+
+		io::mapped_file e(file);
+		CPPUNIT_ASSERT(!e.is_mapped());
+		CPPUNIT_ASSERT(e.bytes().empty());
+		e.advise(io::map_advice::sequential);
+		CPPUNIT_ASSERT(e.next().empty());
+
+		io::file_descriptor g(file, O_WRONLY);
+		g.write("xyz", 3);
+
+		io::mapped_file a(file);
+		io::mapped_file b(std::move(a));
+		CPPUNIT_ASSERT(!a.is_mapped());
+		CPPUNIT_ASSERT(b.size() == 3);
+
+		io::mapped_file c;
+		c = std::move(b);
+		CPPUNIT_ASSERT(std::string(c.data(), c.size()) == "xyz");
+		CPPUNIT_ASSERT(c.file().is_open());
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_mapped_file);
@@ -90,6 +90,8 @@ class Test_Path : public CppUnit::TestFixture
 	CPPUNIT_TEST(has_relative_path);
 	CPPUNIT_TEST(has_parent_path);
 	CPPUNIT_TEST(has_extension);
+	CPPUNIT_TEST(lexically_normal);
+	CPPUNIT_TEST(lexically_relative);
 	CPPUNIT_TEST_SUITE_END();
 
 	std::vector<path> path_list = {
@@ -619,6 +621,47 @@ class Test_Path : public CppUnit::TestFixture
 			CPPUNIT_ASSERT(!p.has_stem());
 		}
 	}
+
+	void lexically_normal()
+	{
+		for (const auto & c : { operands_and_result<path>("", ""),
+		                        operands_and_result<path>(".", "."),
+		                        operands_and_result<path>("a/./b/..", "a/"),
+		                        operands_and_result<path>("/a/../..", "/"),
+		                        operands_and_result<path>("../a/../..", "../.."),
+		                        operands_and_result<path>("a//b", "a/b"),
+		                        operands_and_result<path>("a/b/..", "a/") })
+		{
+			if (config::verbose) printf("%s\n", c.operand1.c_str());
+			CPPUNIT_ASSERT(c.operand1.lexically_normal() == c.result);
+		}
+	}
+
+	void lexically_relative()
+	{
+		for (const auto & c : {
+		       operands_and_result<path>("/a/d", "/a/b/c", "../../d"),
+		       operands_and_result<path>("/a/b/c", "/a/d", "../b/c"),
+		       operands_and_result<path>("a/b/c", "a", "b/c"),
+		       operands_and_result<path>("a/b/c", "a/b/c/x/y", "../.."),
+		       operands_and_result<path>("a/b/c", "a/b/c", "."),
+		       operands_and_result<path>("a/b", "c/d", "../../a/b"),
+		       operands_and_result<path>("a/b/", "a", "b/"),
+		       operands_and_result<path>("a", "a/b/..", "."),
+		       operands_and_result<path>("a", "../b", "a"),
+		       operands_and_result<path>("a", "../../b", ""),
+		       operands_and_result<path>("/a", "a", ""),
+		       operands_and_result<path>("a", "/a", "") })
+		{
+			if (config::verbose)
+				printf("%s %s\n", c.operand1.c_str(), c.operand2.c_str());
+			CPPUNIT_ASSERT(c.operand1.lexically_relative(c.operand2)
+			               == c.result);
+		}
+
+		CPPUNIT_ASSERT(path("a").lexically_proximate("/b") == path("a"));
+		CPPUNIT_ASSERT(path("/a/b").lexically_proximate("/a") == path("b"));
+	}
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Test_Path);
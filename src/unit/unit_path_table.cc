@@ -0,0 +1,142 @@
+#include "filesystem/path_table.h"
+
+#include "cppunit-header.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace fs = filesystem::v1;
+
+class Test_path_table : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_path_table);
+	CPPUNIT_TEST(roots);
+	CPPUNIT_TEST(intern);
+	CPPUNIT_TEST(navigation);
+	CPPUNIT_TEST(reconstruction);
+	CPPUNIT_TEST(sharing);
+	CPPUNIT_TEST_SUITE_END();
+
+ protected:
+	void roots()
+	{
+		fs::path_table t;
+
+		CPPUNIT_ASSERT(t.intern(fs::path_view("")) == fs::path_table::relative_root);
+		CPPUNIT_ASSERT(t.intern(fs::path_view(".")) == fs::path_table::relative_root);
+		CPPUNIT_ASSERT(t.intern(fs::path_view("/")) == fs::path_table::root);
+		CPPUNIT_ASSERT(t.intern(fs::path_view("//.//")) == fs::path_table::root);
+		CPPUNIT_ASSERT(t.to_path(fs::path_table::root) == fs::path("/"));
+		CPPUNIT_ASSERT(t.to_path(fs::path_table::relative_root).empty());
+		CPPUNIT_ASSERT(t.parent(fs::path_table::root) == fs::path_table::invalid);
+		CPPUNIT_ASSERT(t.size() == 2);
+	}
+
+	void intern()
+	{
+		fs::path_table t;
+
+		auto a = t.intern(fs::path("/usr/lib/libc.so"));
+		auto b = t.intern(fs::path_view("/usr//lib/./libc.so/"));
+		auto c = t.intern(fs::path_view("usr/lib/libc.so"));
+
+		CPPUNIT_ASSERT(a == b);
+		CPPUNIT_ASSERT(a != c);
+		CPPUNIT_ASSERT(t.is_absolute(a));
+		CPPUNIT_ASSERT(!t.is_absolute(c));
+
+		// "usr", "lib" and "libc.so" are shared between both trees
+		CPPUNIT_ASSERT(t.component_count() == 3);
+		CPPUNIT_ASSERT(t.size() == 2 + 6);
+
+		CPPUNIT_ASSERT(t.find(fs::path_view("/usr/lib")) == t.parent(a));
+		CPPUNIT_ASSERT(t.find(fs::path_view("/usr/bin")) == fs::path_table::invalid);
+		CPPUNIT_ASSERT(t.find(fs::path_view("/nope/lib")) == fs::path_table::invalid);
+	}
+
+	void navigation()
+	{
+		fs::path_table t;
+
+		auto usr = t.intern(fs::path_view("/usr"));
+		auto lib = t.intern(usr, fs::path_view("lib"));
+		auto so = t.intern(lib, fs::path_view("x86_64/libc.so"));
+
+		CPPUNIT_ASSERT(t.child(usr, fs::path_view("lib")) == lib);
+		CPPUNIT_ASSERT(t.child(usr, fs::path_view("lib/x86_64/libc.so")) == so);
+		CPPUNIT_ASSERT(t.child(lib, fs::path_view("missing")) == fs::path_table::invalid);
+
+		CPPUNIT_ASSERT(t.component(so) == fs::path_view("libc.so"));
+		CPPUNIT_ASSERT(t.component(fs::path_table::root) == fs::path_view("/"));
+		CPPUNIT_ASSERT(t.parent(t.parent(so)) == lib);
+		CPPUNIT_ASSERT(t.depth(so) == 4);
+		CPPUNIT_ASSERT(t.depth(fs::path_table::root) == 0);
+
+		CPPUNIT_ASSERT(t.has_prefix(so, usr));
+		CPPUNIT_ASSERT(t.has_prefix(so, fs::path_table::root));
+		CPPUNIT_ASSERT(t.has_prefix(so, so));
+		CPPUNIT_ASSERT(!t.has_prefix(usr, so));
+		CPPUNIT_ASSERT(!t.has_prefix(so, fs::path_table::relative_root));
+	}
+
+	void reconstruction()
+	{
+		fs::path_table t;
+
+		for (const char * s : { "/a", "/a/b/c", "a", "a/b", "../x/y" })
+		{
+			if (config::verbose) printf("%s\n", s);
+
+			auto h = t.intern(fs::path_view(s));
+			CPPUNIT_ASSERT(t.to_path(h) == fs::path(s));
+			CPPUNIT_ASSERT(t.length(h) == fs::path(s).native().length());
+
+			char buf[64];
+			std::error_code ec;
+			std::size_t n = t.write(h, buf, sizeof(buf), ec);
+			CPPUNIT_ASSERT(!ec);
+			CPPUNIT_ASSERT(std::string(buf, n) == s);
+			CPPUNIT_ASSERT(buf[n] == '\0');
+
+			t.write(h, buf, n, ec);
+			CPPUNIT_ASSERT(ec == std::errc::no_buffer_space);
+		}
+
+		std::error_code ec;
+		char buf[4];
+		t.write(fs::path_table::invalid, buf, sizeof(buf), ec);
+		CPPUNIT_ASSERT(ec);
+	}
+
+	void sharing()
+	{
+		fs::path_table t;
+		std::vector<fs::path_table::handle> handles;
+		char name[64];
+
+		for (int i = 0; i < 20000; ++i)
+		{
+			snprintf(name, sizeof(name), "/srv/data/%d/%d/file%d.dat",
+			         i % 7, i % 13, i);
+			handles.push_back(t.intern(fs::path_view(name)));
+		}
+
+		for (int i = 0; i < 20000; ++i)
+		{
+			snprintf(name, sizeof(name), "/srv/data/%d/%d/file%d.dat",
+			         i % 7, i % 13, i);
+			CPPUNIT_ASSERT(t.find(fs::path_view(name)) == handles[i]);
+			CPPUNIT_ASSERT(t.to_path(handles[i]) == fs::path(name));
+		}
+
+		// 2 roots, srv, data, 7 + 7 * 13 directories and one node per file
+		CPPUNIT_ASSERT(t.size() == 2 + 2 + 7 + 7 * 13 + 20000);
+
+		t.clear();
+		CPPUNIT_ASSERT(t.size() == 2);
+		CPPUNIT_ASSERT(t.find(fs::path_view("/srv")) == fs::path_table::invalid);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_path_table);
@@ -0,0 +1,228 @@
+#include "filesystem/filesystem"
+#include "filesystem/path_view.h"
+
+#include "cppunit-header.h"
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace fs = filesystem::v1;
+
+class Test_path_view : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_path_view);
+	CPPUNIT_TEST(constructors);
+	CPPUNIT_TEST(compare);
+	CPPUNIT_TEST(iteration);
+	CPPUNIT_TEST(decomposition);
+	CPPUNIT_TEST(lexically_normal);
+	CPPUNIT_TEST(lexically_normal_in_place);
+	CPPUNIT_TEST(operations);
+	CPPUNIT_TEST_SUITE_END();
+
+	static constexpr const char * samples[] = {
+		"", "/", "//", "a", "a/", "/a", "/a/", "a/b", "/a/b", "/a/b/",
+		"foo.txt", "/usr/lib/libc.so.6", ".bashrc", "a/..", "a/.",
+		".", "..", "/a/b/../c.d/", "x/y.tar.gz",
+	};
+
+ protected:
+	void constructors()
+	{
+		fs::path_view v0;
+		CPPUNIT_ASSERT(v0.empty());
+		CPPUNIT_ASSERT(v0.is_terminated());
+
+		const char * s = "/tmp/foo";
+		fs::path_view v1(s);
+		CPPUNIT_ASSERT(v1.data() == s);
+		CPPUNIT_ASSERT(v1.size() == strlen(s));
+
+		fs::path_view v2(s, 4);
+		CPPUNIT_ASSERT(v2.size() == 4);
+		CPPUNIT_ASSERT(!v2.is_terminated());
+		CPPUNIT_ASSERT(v2.string() == "/tmp");
+
+		fs::path p(s);
+		fs::path_view v3(p);
+		CPPUNIT_ASSERT(v3.data() == p.c_str());
+		CPPUNIT_ASSERT(v3 == p);
+		CPPUNIT_ASSERT(v3.to_path() == p);
+	}
+
+	void compare()
+	{
+		fs::path_view a("/a/b"), b("/a/c"), c("/a/b/c");
+
+		CPPUNIT_ASSERT(a == fs::path_view("/a/b/c", 4));
+		CPPUNIT_ASSERT(a < b);
+		CPPUNIT_ASSERT(a < c);
+		CPPUNIT_ASSERT(c > a);
+		CPPUNIT_ASSERT(a != c);
+
+		for (const char * s1 : samples)
+			for (const char * s2 : samples)
+			{
+				int expected = fs::path(s1).compare(fs::path(s2));
+				int got = fs::path_view(s1).compare(fs::path_view(s2));
+				CPPUNIT_ASSERT((expected < 0) == (got < 0));
+				CPPUNIT_ASSERT((expected == 0) == (got == 0));
+			}
+	}
+
+	void iteration()
+	{
+		for (const char * s : samples)
+		{
+			if (config::verbose) printf("%s\n", s);
+
+			fs::path p(s);
+			fs::path_view v(s);
+
+			std::vector<std::string> expected, got;
+			for (const auto & e : p)
+				expected.push_back(e.string());
+			for (const auto & e : v)
+				got.push_back(e.string());
+
+			CPPUNIT_ASSERT(expected == got);
+		}
+	}
+
+	void decomposition()
+	{
+		for (const char * s : samples)
+		{
+			if (config::verbose) printf("%s\n", s);
+
+			fs::path p(s);
+			fs::path_view v(s);
+
+			CPPUNIT_ASSERT(v.filename() == p.filename());
+			CPPUNIT_ASSERT(v.stem() == p.stem());
+			CPPUNIT_ASSERT(v.extension() == p.extension());
+			CPPUNIT_ASSERT(v.has_root_directory() == (!p.empty()
+			               && p.has_root_directory()));
+		}
+
+		CPPUNIT_ASSERT(fs::path_view("/a/b").parent_path() == fs::path("/a"));
+		CPPUNIT_ASSERT(fs::path_view("/a/b/").parent_path()
+		               == fs::path("/a/b"));
+		CPPUNIT_ASSERT(fs::path_view("/a").parent_path() == fs::path("/"));
+		CPPUNIT_ASSERT(fs::path_view("/").parent_path().empty());
+		CPPUNIT_ASSERT(fs::path_view("a").parent_path().empty());
+		CPPUNIT_ASSERT(fs::path_view("//a//b").parent_path()
+		               == fs::path("//a"));
+
+		CPPUNIT_ASSERT(fs::path_view("/a/b").relative_path()
+		               == fs::path("a/b"));
+		CPPUNIT_ASSERT(fs::path_view("//a//b/").relative_path()
+		               == fs::path("a//b/"));
+		CPPUNIT_ASSERT(fs::path_view("a/b").relative_path()
+		               == fs::path("a/b"));
+		CPPUNIT_ASSERT(fs::path_view("/").relative_path().empty());
+		CPPUNIT_ASSERT(! fs::path_view("//").has_relative_path());
+		CPPUNIT_ASSERT(fs::path_view("").relative_path().empty());
+		CPPUNIT_ASSERT(fs::path_view("/a").relative_path().is_terminated());
+
+		// a sub-view reaching the end of a terminated view stays terminated
+		CPPUNIT_ASSERT(fs::path_view("/a/b").filename().is_terminated());
+		CPPUNIT_ASSERT(!fs::path_view("/a/b").parent_path().is_terminated());
+	}
+
+	void lexically_normal()
+	{
+		const char * cases[][2] = {
+			{ "", "" },
+			{ ".", "." },
+			{ "./", "." },
+			{ "..", ".." },
+			{ "../", ".." },
+			{ "/", "/" },
+			{ "//", "/" },
+			{ "/..", "/" },
+			{ "/../a", "/a" },
+			{ "/./", "/" },
+			{ "a", "a" },
+			{ "a/", "a/" },
+			{ "a/.", "a/" },
+			{ "a/./", "a/" },
+			{ "a/..", "." },
+			{ "a/../", "." },
+			{ "a/b/..", "a/" },
+			{ "a/b/../", "a/" },
+			{ "./a", "a" },
+			{ "a//b", "a/b" },
+			{ "foo/./bar/..", "foo/" },
+			{ "foo/.///bar/../", "foo/" },
+			{ "../a/..", ".." },
+			{ "a/../../b/..", ".." },
+			{ "../../x", "../../x" },
+			{ "/a/b/../../..", "/" },
+			{ "/usr//lib/./../bin/", "/usr/bin/" },
+		};
+
+		for (const auto & c : cases)
+		{
+			if (config::verbose) printf("%s -> %s\n", c[0], c[1]);
+
+			fs::path_view v(c[0]);
+			std::vector<char> buf(v.size() + 1);
+			std::error_code ec;
+			fs::path_view n = v.lexically_normal(buf.data(), buf.size(), ec);
+
+			CPPUNIT_ASSERT(!ec);
+			CPPUNIT_ASSERT(n == fs::path_view(c[1]));
+			CPPUNIT_ASSERT(n.is_terminated());
+			CPPUNIT_ASSERT(n.data()[n.size()] == '\0');
+		}
+
+		char small[2];
+		std::error_code ec;
+		fs::path_view("/a/b").lexically_normal(small, sizeof(small), ec);
+		CPPUNIT_ASSERT(ec);
+		CPPUNIT_ASSERT_THROW(fs::path_view("/a/b").lexically_normal(small,
+		                                                  sizeof(small)),
+		                     fs::filesystem_error);
+	}
+
+	void lexically_normal_in_place()
+	{
+		char buf[] = "/usr//lib/./../bin/";
+		fs::path_view v(buf);
+		fs::path_view n = v.lexically_normal(buf, sizeof(buf));
+
+		CPPUNIT_ASSERT(n.data() == buf);
+		CPPUNIT_ASSERT(strcmp(buf, "/usr/bin/") == 0);
+	}
+
+	void operations()
+	{
+		const std::string s = "/tmp/this-does-not-exist";
+		fs::path_view tmp(s.c_str(), 4);
+
+		CPPUNIT_ASSERT(fs::exists(tmp));
+		CPPUNIT_ASSERT(fs::is_directory(tmp));
+		CPPUNIT_ASSERT(!fs::is_regular_file(tmp));
+		CPPUNIT_ASSERT(fs::status(tmp).type() == fs::file_type::directory);
+		CPPUNIT_ASSERT(fs::symlink_status(fs::path_view(s)).type()
+		               == fs::file_type::not_found);
+		CPPUNIT_ASSERT(!fs::exists(fs::path_view(s)));
+
+		std::error_code ec;
+		fs::file_size(tmp, ec);
+		CPPUNIT_ASSERT(ec);
+		CPPUNIT_ASSERT_THROW(fs::file_size(tmp), fs::filesystem_error);
+
+		std::string longname(PATH_MAX + 16, 'x');
+		fs::status(fs::path_view(longname.data(), longname.size()), ec);
+		CPPUNIT_ASSERT(ec == std::errc::filename_too_long);
+	}
+};
+
+constexpr const char * Test_path_view::samples[];
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_path_view);
@@ -0,0 +1,342 @@
+#include "buffer/pipebuffer.h"
+#include "buffer/pipebufferpool.h"
+#include "buffer/splicerelay.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "cppunit-header.h"
+
+class Test_pipebuffer : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_pipebuffer);
+	CPPUNIT_TEST(read_write);
+	CPPUNIT_TEST(capacity);
+	CPPUNIT_TEST(vmsplice);
+	CPPUNIT_TEST(move);
+	CPPUNIT_TEST(pool);
+	CPPUNIT_TEST(relay_files);
+	CPPUNIT_TEST(relay_nonblocking);
+	CPPUNIT_TEST(relay_slow_sink);
+	CPPUNIT_TEST_SUITE_END();
+
+	std::string dir;
+	std::string data;
+
+ public:
+	void setUp()
+	{
+		char tmpl[] = "/tmp/pipebuffer.XXXXXX";
+		CPPUNIT_ASSERT(mkdtemp(tmpl) != nullptr);
+		dir = tmpl;
+
+		data.resize(3 * 1024 * 1024 + 17);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<char>((i * 2654435761u) >> 13);
+	}
+
+	void tearDown()
+	{
+		for (const char * f : { "/in", "/out", "/tee" })
+			unlink((dir + f).c_str());
+		rmdir(dir.c_str());
+	}
+
+ protected:
+	int open_file(const char * name, int flags)
+	{
+		int fd = open((dir + name).c_str(), flags | O_CLOEXEC, 0600);
+		CPPUNIT_ASSERT(fd >= 0);
+		return fd;
+	}
+
+	std::string contents(const char * name)
+	{
+		std::string s;
+		char buf[65536];
+		int fd = open_file(name, O_RDONLY);
+		ssize_t n;
+		while ((n = read(fd, buf, sizeof(buf))) > 0)
+			s.append(buf, n);
+		close(fd);
+		return s;
+	}
+
+	void read_write()
+	{
+		PipeBuffer a, b;
+		char buf[16];
+
+		CPPUNIT_ASSERT(a.writeIn("hello", 5) == 5);
+		CPPUNIT_ASSERT(a.level() == 5);
+
+		CPPUNIT_ASSERT(a.teeOut(b, 5) == 5);
+		CPPUNIT_ASSERT(a.level() == 5);
+		CPPUNIT_ASSERT(b.level() == 5);
+
+		CPPUNIT_ASSERT(a.readOut(buf, sizeof(buf)) == 5);
+		CPPUNIT_ASSERT(std::string(buf, 5) == "hello");
+		CPPUNIT_ASSERT(b.readOut(buf, sizeof(buf)) == 5);
+		CPPUNIT_ASSERT(std::string(buf, 5) == "hello");
+		CPPUNIT_ASSERT(a.level() == 0);
+	}
+
+	void capacity()
+	{
+		PipeBuffer a;
+		CPPUNIT_ASSERT(a.capacity() == 64 * 1024);
+		CPPUNIT_ASSERT(a.size() == 0);
+
+		CPPUNIT_ASSERT(a.resize(256 * 1024) == 256 * 1024);
+		CPPUNIT_ASSERT(a.capacity() == 256 * 1024);
+
+		// clamped rather than refused
+		CPPUNIT_ASSERT(a.resize(PipeBuffer::maxCapacity() * 2)
+		               == PipeBuffer::maxCapacity());
+
+		std::string s(100000, 'x');
+		CPPUNIT_ASSERT(a.writeIn(s.data(), s.size()) == int(s.size()));
+		CPPUNIT_ASSERT(a.size() == a.level());
+		CPPUNIT_ASSERT(a.size() == int(s.size()));
+
+		// can't shrink below what is buffered
+		CPPUNIT_ASSERT_THROW(a.resize(4096), std::system_error);
+
+		PipeBuffer b(O_CLOEXEC, 128 * 1024);
+		CPPUNIT_ASSERT(b.capacity() == 128 * 1024);
+	}
+
+	void vmsplice()
+	{
+		PipeBuffer a;
+		char buf[16];
+		const char one[] = "zero";
+		const char two[] = "-copy";
+		struct iovec iov[2] = {
+			{ const_cast<char *>(one), 4 },
+			{ const_cast<char *>(two), 5 },
+		};
+
+		CPPUNIT_ASSERT(a.vmspliceIn(iov, 2) == 9);
+		CPPUNIT_ASSERT(a.level() == 9);
+		CPPUNIT_ASSERT(a.readOut(buf, sizeof(buf)) == 9);
+		CPPUNIT_ASSERT(std::string(buf, 9) == "zero-copy");
+
+		// gifted pages must be whole and aligned
+		CPPUNIT_ASSERT(a.giftIn(iov, 1) == -1);
+		CPPUNIT_ASSERT(errno == EINVAL);
+
+		const size_t page = sysconf(_SC_PAGESIZE);
+		const size_t len = 4 * page;
+		void * p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+		                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		CPPUNIT_ASSERT(p != MAP_FAILED);
+		memcpy(p, data.data(), len);
+
+		struct iovec g = { p, len };
+		CPPUNIT_ASSERT(a.giftIn(&g, 1) == int(len));
+		munmap(p, len); // the pipe holds its own reference
+
+		int out = open_file("/out", O_WRONLY | O_CREAT | O_TRUNC);
+		CPPUNIT_ASSERT(a.spliceAllOut(out) == int(len));
+		close(out);
+		CPPUNIT_ASSERT(contents("/out") == data.substr(0, len));
+	}
+
+	void move()
+	{
+		PipeBuffer a;
+		CPPUNIT_ASSERT(a.writeIn("abc", 3) == 3);
+
+		PipeBuffer b(std::move(a));
+		CPPUNIT_ASSERT(b.level() == 3);
+		CPPUNIT_ASSERT(a.level() == 0);
+
+		a = std::move(b);
+		CPPUNIT_ASSERT(a.level() == 3);
+		CPPUNIT_ASSERT(a.drain());
+		CPPUNIT_ASSERT(a.size() == 0);
+	}
+
+	void pool()
+	{
+		PipeBufferPool pool(128 * 1024, 2);
+
+		for (int i = 0; i < 100; ++i)
+		{
+			PipeBufferPool::Lease l = pool.acquire();
+			CPPUNIT_ASSERT(l->size() == 0);
+			CPPUNIT_ASSERT(l->writeIn("leftover", 8) == 8);
+		}
+
+		// one pipe served every transfer, and came back empty each time
+		CPPUNIT_ASSERT(pool.created() == 1);
+		CPPUNIT_ASSERT(pool.idle() == 1);
+		CPPUNIT_ASSERT(pool.acquire()->capacity() == 128 * 1024);
+
+		{
+			PipeBufferPool::Lease a = pool.acquire();
+			PipeBufferPool::Lease b = pool.acquire();
+			PipeBufferPool::Lease c = pool.acquire();
+			CPPUNIT_ASSERT(pool.idle() == 0);
+		}
+
+		// no more than maxIdle are kept
+		CPPUNIT_ASSERT(pool.created() == 3);
+		CPPUNIT_ASSERT(pool.idle() == 2);
+
+		// other threads keep lists of their own
+		std::thread t([&pool]()
+		{
+			CPPUNIT_ASSERT(pool.idle() == 0);
+			pool.reserve(2);
+			CPPUNIT_ASSERT(pool.idle() == 2);
+			pool.acquire();
+		});
+		t.join();
+		CPPUNIT_ASSERT(pool.created() == 5);
+		CPPUNIT_ASSERT(pool.idle() == 2);
+	}
+
+	void relay_files()
+	{
+		int fd = open_file("/in", O_WRONLY | O_CREAT | O_TRUNC);
+		CPPUNIT_ASSERT(write(fd, data.data(), data.size())
+		               == ssize_t(data.size()));
+		close(fd);
+
+		int in = open_file("/in", O_RDONLY);
+		int out = open_file("/out", O_WRONLY | O_CREAT | O_TRUNC);
+		int copy = open_file("/tee", O_WRONLY | O_CREAT | O_TRUNC);
+
+		SpliceRelayOptions opts;
+		opts.teeFd = copy;
+		opts.pipeSize = 1024 * 1024;
+		SpliceRelayStats s = spliceRelay(in, out, opts);
+
+		close(in);
+		close(out);
+		close(copy);
+
+		CPPUNIT_ASSERT(s.bytes == data.size());
+		CPPUNIT_ASSERT(s.teeBytes == data.size());
+		CPPUNIT_ASSERT(s.waits == 0);
+		CPPUNIT_ASSERT(contents("/out") == data);
+		CPPUNIT_ASSERT(contents("/tee") == data);
+
+		// a byte limit stops the relay early
+		in = open_file("/in", O_RDONLY);
+		out = open_file("/out", O_WRONLY | O_TRUNC);
+		opts = SpliceRelayOptions();
+		opts.maxBytes = 100000;
+		opts.chunkSize = 4096;
+		s = spliceRelay(in, out, opts);
+		close(in);
+		close(out);
+
+		CPPUNIT_ASSERT(s.bytes == 100000);
+		CPPUNIT_ASSERT(contents("/out") == data.substr(0, 100000));
+	}
+
+	void relay_nonblocking()
+	{
+		int sv[2];
+		CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)
+		               == 0);
+		CPPUNIT_ASSERT(fcntl(sv[0], F_SETFL, O_NONBLOCK) == 0);
+
+		// the writer trickles the data so that the relay runs dry
+		std::thread writer([&]()
+		{
+			for (size_t off = 0; off < data.size(); )
+			{
+				ssize_t n = write(sv[1], data.data() + off,
+				                  std::min<size_t>(256 * 1024,
+				                                   data.size() - off));
+				if (n <= 0) break;
+				off += n;
+				usleep(1000);
+			}
+			close(sv[1]);
+		});
+
+		int out = open_file("/out", O_WRONLY | O_CREAT | O_TRUNC);
+		SpliceRelayOptions opts;
+		opts.timeoutMs = 5000;
+		SpliceRelayStats s = spliceRelay(sv[0], out, opts);
+		writer.join();
+		close(out);
+		close(sv[0]);
+
+		CPPUNIT_ASSERT(s.bytes == data.size());
+		CPPUNIT_ASSERT(s.waits > 0);
+		CPPUNIT_ASSERT(s.bytesPerSecond() > 0);
+		CPPUNIT_ASSERT(contents("/out") == data);
+	}
+
+	void relay_slow_sink()
+	{
+		int in[2], out[2];
+		CPPUNIT_ASSERT(pipe2(in, O_CLOEXEC) == 0);
+		CPPUNIT_ASSERT(pipe2(out, O_CLOEXEC) == 0);
+		CPPUNIT_ASSERT(fcntl(in[0], F_SETFL, O_NONBLOCK) == 0);
+		CPPUNIT_ASSERT(fcntl(out[1], F_SETFL, O_NONBLOCK) == 0);
+
+		// the source is empty at first, so the relay waits on it, and
+		// from then on always has more while the sink is slow to drain
+		std::thread writer([&]()
+		{
+			usleep(10000);
+			for (size_t off = 0; off < data.size(); )
+			{
+				ssize_t n = write(in[1], data.data() + off,
+				                  data.size() - off);
+				if (n <= 0) break;
+				off += n;
+			}
+			close(in[1]);
+		});
+
+		std::string received;
+		std::thread reader([&]()
+		{
+			char buf[65536];
+			ssize_t n;
+			while ((n = read(out[0], buf, sizeof(buf))) > 0)
+			{
+				received.append(buf, n);
+				usleep(1000);
+			}
+		});
+
+		SpliceRelayOptions opts;
+		opts.timeoutMs = 5000;
+		SpliceRelayStats s = spliceRelay(in[0], out[1], opts);
+		close(out[1]);
+		writer.join();
+		reader.join();
+		close(in[0]);
+		close(out[0]);
+
+		CPPUNIT_ASSERT(s.bytes == data.size());
+		CPPUNIT_ASSERT(received == data);
+
+		// a readable source doesn't wake a wait for the sink, so there
+		// are no more waits than pages the reader frees
+		CPPUNIT_ASSERT(s.waits > 0);
+		CPPUNIT_ASSERT(s.waits <= data.size() / 4096);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_pipebuffer);
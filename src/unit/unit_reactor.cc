@@ -0,0 +1,213 @@
+#include "descriptor/reactor.h"
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "cppunit-header.h"
+
+class Test_reactor : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_reactor);
+	CPPUNIT_TEST(timers);
+	CPPUNIT_TEST(sockets);
+	CPPUNIT_TEST(signals);
+	CPPUNIT_TEST(remove_in_handler);
+	CPPUNIT_TEST(readd_in_handler);
+	CPPUNIT_TEST(stop_from_thread);
+	CPPUNIT_TEST_SUITE_END();
+
+	typedef io::timer_descriptor<CLOCK_MONOTONIC> timer_t;
+
+	struct context
+	{
+		io::reactor * r;
+		timer_t * t;
+		io::reactor::handle h;
+		int calls;
+		context * next;
+	};
+
+	// small enough to be stored inside the std::function, so a slot
+	// reused while it runs would overwrite it
+	static io::reactor::handler_t handler(context * c)
+	{
+		return [c](std::uint32_t) {
+			std::error_code ec;
+			c->t->read_expirations(ec);
+			++c->calls;
+
+			if (c->next)
+			{
+				c->r->remove(c->h);
+				c->next->h = c->r->add(*c->t, EPOLLIN, handler(c->next));
+			}
+
+			++c->calls;
+		};
+	}
+
+ protected:
+	void timers()
+	{
+		using std::chrono::milliseconds;
+
+		io::reactor r;
+		timer_t periodic, once;
+		std::uint64_t ticks = 0;
+		bool fired = false;
+
+		r.add_timer(periodic, [&](std::uint64_t n) { ticks += n; });
+		r.add_timer(once, [&](std::uint64_t) { fired = true; r.stop(); });
+		CPPUNIT_ASSERT(r.size() == 2);
+
+		periodic.arm_relative_timer(milliseconds(1), milliseconds(1));
+		once.arm_relative_timer(milliseconds(20));
+		r.run();
+
+		CPPUNIT_ASSERT(fired);
+		CPPUNIT_ASSERT(ticks >= 5);
+
+		// nothing pending: a zero timeout returns at once
+		periodic.disarm_timer();
+		r.run_once(milliseconds(0));
+		CPPUNIT_ASSERT(r.run_once(milliseconds(0)) == 0);
+	}
+
+	void sockets()
+	{
+		io::reactor r(4);
+		auto p = io::socket_descriptor::pair();
+		std::string received;
+		bool closed = false;
+		int writable = 0;
+
+		io::socket_descriptor & rd = p.second;
+		r.add(rd, EPOLLIN | EPOLLRDHUP, [&](std::uint32_t ev) {
+			char buf[3]; // small, so draining takes several reads
+			std::error_code ec;
+			std::size_t n;
+
+			while ((n = rd.recv(buf, sizeof(buf), 0, ec)) > 0)
+				received.append(buf, n);
+
+			if (!ec || (ev & EPOLLRDHUP))
+				closed = true;
+		});
+
+		io::reactor::handle w = r.add(p.first, EPOLLOUT,
+		                              [&](std::uint32_t) { ++writable; });
+
+		// edge-triggered: writable is reported once, not on every pass
+		r.run_once(std::chrono::milliseconds(100));
+		r.run_once(std::chrono::milliseconds(0));
+		CPPUNIT_ASSERT(writable == 1);
+
+		p.first.send("hello reactor", 13);
+		while (received.size() < 13)
+			r.run_once(std::chrono::milliseconds(1000));
+		CPPUNIT_ASSERT(received == "hello reactor");
+
+		r.remove(w);
+		r.remove(w); // already gone
+		CPPUNIT_ASSERT(r.size() == 1);
+
+		p.first.close();
+		while (! closed)
+			r.run_once(std::chrono::milliseconds(1000));
+	}
+
+	void signals()
+	{
+		sigset_t old;
+		pthread_sigmask(SIG_SETMASK, nullptr, &old);
+
+		{
+			io::reactor r;
+			io::signal_descriptor s({ SIGUSR1 });
+			int count = 0;
+
+			r.add_signals(s, [&](const signalfd_siginfo & info) {
+				if (info.ssi_signo == SIGUSR1) ++count;
+			});
+
+			raise(SIGUSR1);
+			r.run_once(std::chrono::milliseconds(1000));
+			CPPUNIT_ASSERT(count == 1);
+		}
+
+		pthread_sigmask(SIG_SETMASK, &old, nullptr);
+	}
+
+	void remove_in_handler()
+	{
+		io::reactor r;
+		timer_t a, b;
+		io::reactor::handle ha = 0, hb = 0;
+		int calls = 0;
+
+		// whichever runs first removes both; the other's event, already
+		// collected in the same batch, must not be dispatched
+		ha = r.add_timer(a, [&](std::uint64_t) {
+			++calls; r.remove(ha); r.remove(hb);
+		});
+		hb = r.add_timer(b, [&](std::uint64_t) {
+			++calls; r.remove(ha); r.remove(hb);
+		});
+
+		a.arm_relative_timer(std::chrono::milliseconds(1));
+		b.arm_relative_timer(std::chrono::milliseconds(1));
+		usleep(5000);
+
+		CPPUNIT_ASSERT(r.run_once(std::chrono::milliseconds(1000)) == 1);
+		CPPUNIT_ASSERT(calls == 1);
+		CPPUNIT_ASSERT(r.size() == 0);
+
+		// the freed slot is reused under a new handle
+		timer_t c;
+		io::reactor::handle hc = r.add_timer(c, [&](std::uint64_t) { });
+		CPPUNIT_ASSERT(hc != ha && hc != hb && hc != 0);
+	}
+
+	void readd_in_handler()
+	{
+		io::reactor r;
+		timer_t t;
+		context second = { &r, &t, 0, 0, nullptr };
+		context first = { &r, &t, 0, 0, &second };
+
+		// the first handler hands the timer over to the second
+		first.h = r.add(t, EPOLLIN, handler(&first));
+		t.arm_relative_timer(std::chrono::milliseconds(1));
+		CPPUNIT_ASSERT(r.run_once(std::chrono::milliseconds(1000)) == 1);
+
+		CPPUNIT_ASSERT(first.calls == 2);
+		CPPUNIT_ASSERT(second.calls == 0);
+		CPPUNIT_ASSERT(second.h != first.h);
+		CPPUNIT_ASSERT(r.size() == 1);
+
+		t.arm_relative_timer(std::chrono::milliseconds(1));
+		while (second.calls == 0)
+			r.run_once(std::chrono::milliseconds(1000));
+
+		CPPUNIT_ASSERT(first.calls == 2);
+		CPPUNIT_ASSERT(second.calls == 2);
+	}
+
+	void stop_from_thread()
+	{
+		io::reactor r;
+		std::thread t([&r]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			r.stop();
+		});
+
+		r.run();
+		t.join();
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_reactor);
@@ -0,0 +1,328 @@
+#include "automata/regex.h"
+
+#include <random>
+#include <regex>
+#include <string>
+
+#include "cppunit-header.h"
+
+namespace {
+
+const char text_alphabet[] = { 'a', 'b', 'c', '1', ' ', '\n', '\r', '\xff' };
+
+/// A random pattern over a few letters that std::regex also understands
+std::string random_pattern(std::mt19937 & rng, unsigned depth)
+{
+	static const char * const atoms[] = {
+		"a", "b", "c", ".", "[ab]", "[^a]", "[a-c1]", "\\d", "\\w", "\\s",
+		"\\S", "\\n", "\\x61"
+	};
+	static const char * const repeats[] = {
+		"*", "+", "?", "{2}", "{1,3}", "{2,}", "{0,2}"
+	};
+
+	const unsigned kind = (depth > 2) ? 0 : rng() % 5;
+	std::string out;
+
+	switch (kind)
+	{
+	case 0:
+	case 1:
+		out = atoms[rng() % (sizeof(atoms) / sizeof(atoms[0]))];
+		break;
+
+	case 2:
+		for (unsigned n = 1 + rng() % 3; n > 0; --n)
+			out += random_pattern(rng, depth + 1);
+
+		// so a repeat after it isn't read as lazy
+		out = "(?:" + out + ")";
+		break;
+
+	case 3:
+		out = "(" + random_pattern(rng, depth + 1) + "|"
+		    + random_pattern(rng, depth + 1) + ")";
+		break;
+
+	case 4:
+		out = "(?:" + random_pattern(rng, depth + 1) + ")";
+		break;
+	}
+
+	if ((rng() % 3) == 0)
+		out += repeats[rng() % (sizeof(repeats) / sizeof(repeats[0]))];
+
+	return out;
+}
+
+/// The end of the match ending first, the slow way
+std::ptrdiff_t earliest_end(const std::regex & re, const std::string & text,
+                            bool anchored_start, bool anchored_end)
+{
+	for (std::size_t e = anchored_end ? text.size() : 0; e <= text.size(); ++e)
+		for (std::size_t s = 0; s <= (anchored_start ? 0 : e); ++s)
+			if (std::regex_match(text.begin() + s, text.begin() + e, re))
+				return e;
+
+	return -1;
+}
+
+std::ptrdiff_t found(const automata::regex & re, const std::string & text)
+{
+	const char * end = re.search(text.data(), text.data() + text.size());
+	return (end ? (end - text.data()) : -1);
+}
+
+} // namespace
+
+class Test_regex : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_regex);
+	CPPUNIT_TEST(literals);
+	CPPUNIT_TEST(anchors);
+	CPPUNIT_TEST(escapes_and_classes);
+	CPPUNIT_TEST(counted_repeats);
+	CPPUNIT_TEST(matches_std_regex);
+	CPPUNIT_TEST(minimal);
+	CPPUNIT_TEST(classes_are_merged);
+	CPPUNIT_TEST(long_inputs);
+	CPPUNIT_TEST(malformed);
+	CPPUNIT_TEST(too_many_states);
+	CPPUNIT_TEST_SUITE_END();
+
+ public:
+	void literals()
+	{
+		automata::regex re("error");
+
+		CPPUNIT_ASSERT_EQUAL(std::ptrdiff_t(10), found(re, "some error here"));
+		CPPUNIT_ASSERT_EQUAL(std::ptrdiff_t(-1), found(re, "some erro here"));
+		CPPUNIT_ASSERT_EQUAL(std::ptrdiff_t(-1), found(re, ""));
+		CPPUNIT_ASSERT(re.search("errorerror"));
+
+		// the match ending first, not the longest
+		automata::regex plus("ab+");
+		CPPUNIT_ASSERT_EQUAL(std::ptrdiff_t(3), found(plus, "xabbbb"));
+
+		// an empty pattern matches before anything
+		automata::regex empty("");
+		CPPUNIT_ASSERT_EQUAL(std::ptrdiff_t(0), found(empty, "abc"));
+		CPPUNIT_ASSERT_EQUAL(std::ptrdiff_t(0), found(empty, ""));
+	}
+
+	void anchors()
+	{
+		automata::regex start("^ab");
+		CPPUNIT_ASSERT(start.search("abc"));
+		CPPUNIT_ASSERT(! start.search("cab"));
+
+		automata::regex end("ab$");
+		CPPUNIT_ASSERT(end.search("cab"));
+		CPPUNIT_ASSERT(! end.search("abc"));
+		CPPUNIT_ASSERT(! end.search(""));
+
+		automata::regex both("^a*$");
+		CPPUNIT_ASSERT(both.search(""));
+		CPPUNIT_ASSERT(both.search("aaaa"));
+		CPPUNIT_ASSERT(! both.search("aaba"));
+
+		// an escaped $ at the end is a literal
+		automata::regex dollar("a\\$");
+		CPPUNIT_ASSERT(dollar.search("xa$y"));
+		CPPUNIT_ASSERT(! dollar.search("xa"));
+
+		automata::regex backslash("a\\\\$");
+		CPPUNIT_ASSERT(backslash.search("xa\\"));
+		CPPUNIT_ASSERT(! backslash.search("xa\\y"));
+	}
+
+	void escapes_and_classes()
+	{
+		CPPUNIT_ASSERT(automata::regex("\\x41\\t\\0").search(
+		                 std::string("A\t\0", 3)));
+		CPPUNIT_ASSERT(automata::regex("[\\]\\-]").search("-"));
+		CPPUNIT_ASSERT(automata::regex("[]a]").search("]"));
+		CPPUNIT_ASSERT(automata::regex("[a-]").search("-"));
+		CPPUNIT_ASSERT(! automata::regex("[^\\d\\s]").search("1 2\t3"));
+		CPPUNIT_ASSERT(automata::regex("[^\\d\\s]").search("1 x"));
+		CPPUNIT_ASSERT(automata::regex("\\.\\*").search("a.*b"));
+		CPPUNIT_ASSERT(! automata::regex("\\.\\*").search("a.b"));
+		CPPUNIT_ASSERT(! automata::regex("a.b").search("a\nb"));
+		CPPUNIT_ASSERT(automata::regex("a.b").search("a\xff" "b"));
+		CPPUNIT_ASSERT(automata::regex("\xc3\xa9+").search("caf\xc3\xa9"));
+	}
+
+	void counted_repeats()
+	{
+		automata::regex three("^a{3}$");
+		CPPUNIT_ASSERT(! three.search("aa"));
+		CPPUNIT_ASSERT(three.search("aaa"));
+		CPPUNIT_ASSERT(! three.search("aaaa"));
+
+		automata::regex range("^(ab){1,2}$");
+		CPPUNIT_ASSERT(! range.search(""));
+		CPPUNIT_ASSERT(range.search("ab"));
+		CPPUNIT_ASSERT(range.search("abab"));
+		CPPUNIT_ASSERT(! range.search("ababab"));
+
+		automata::regex at_least("^x{2,}$");
+		CPPUNIT_ASSERT(! at_least.search("x"));
+		CPPUNIT_ASSERT(at_least.search(std::string(500, 'x')));
+
+		// counts cost states, not time
+		automata::regex big("^[0-9]{1000}$");
+		CPPUNIT_ASSERT(big.search(std::string(1000, '7')));
+		CPPUNIT_ASSERT(! big.search(std::string(999, '7')));
+	}
+
+	void matches_std_regex()
+	{
+		std::mt19937 rng(48);
+
+		for (unsigned i = 0; i < 150; ++i)
+		{
+			const bool anchored_start = (rng() % 4) == 0;
+			const bool anchored_end = (rng() % 4) == 0;
+			const std::string body = random_pattern(rng, 0);
+			const std::string pattern = (anchored_start ? "^" : "") + body
+			                          + (anchored_end ? "$" : "");
+
+			const automata::regex re(pattern);
+			const std::regex expected(body);
+
+			for (unsigned j = 0; j < 20; ++j)
+			{
+				std::string text;
+
+				for (unsigned n = rng() % 10; n > 0; --n)
+					text += text_alphabet[rng() % sizeof(text_alphabet)];
+
+				CPPUNIT_ASSERT_EQUAL_MESSAGE(pattern + " on " + text,
+				  earliest_end(expected, text, anchored_start, anchored_end),
+				  found(re, text));
+			}
+		}
+	}
+
+	void minimal()
+	{
+		// the textbook example: four states, plus the dead one
+		automata::regex re("^(a|b)*abb$");
+
+		CPPUNIT_ASSERT_EQUAL(std::size_t(5), re.machine().state_count());
+
+		// a, b and everything else
+		CPPUNIT_ASSERT_EQUAL(std::size_t(3), re.machine().class_count());
+	}
+
+	void classes_are_merged()
+	{
+		automata::regex re("(a|c)b");
+		const automata::dfa & m = re.machine();
+
+		CPPUNIT_ASSERT_EQUAL(std::size_t(3), m.class_count());
+		CPPUNIT_ASSERT_EQUAL(m.input_class('a'), m.input_class('c'));
+		CPPUNIT_ASSERT(m.input_class('a') != m.input_class('b'));
+		CPPUNIT_ASSERT_EQUAL(m.input_class('x'), m.input_class('\0'));
+		CPPUNIT_ASSERT_EQUAL(m.input_class('x'), m.input_class('\xff'));
+	}
+
+	void long_inputs()
+	{
+		// one, two and three bytes leaving the start state, and more
+		const char * const patterns[] = {
+			"needle", "(needle|pin)", "(needle|pin|thread)", "[a-z]{7}q"
+		};
+		std::mt19937 rng(7);
+
+		for (const char * pattern : patterns)
+		{
+			const automata::regex re(pattern);
+			const std::regex expected(pattern);
+
+			for (std::size_t size : { 15, 16, 17, 63, 64, 65, 4096 })
+			{
+				std::string text;
+
+				for (std::size_t i = 0; i < size; ++i)
+					text += "nptxyz QRS"[rng() % 10];
+
+				CPPUNIT_ASSERT_EQUAL(std::ptrdiff_t(-1), found(re, text));
+
+				for (const char * word :
+				     { "needle", "pin", "thread", "abcdefgq" })
+				{
+					for (std::size_t at : { std::size_t(0), size / 3, size })
+					{
+						std::string planted = text;
+						planted.insert(at, word);
+
+						// nothing in text can be part of a match, so the
+						// one starting first is also the one ending first
+						std::smatch m;
+						const std::ptrdiff_t first =
+						  std::regex_search(planted, m, expected)
+						    ? m.position(0) + m.length(0) : -1;
+
+						CPPUNIT_ASSERT_EQUAL(first, found(re, planted));
+					}
+				}
+			}
+		}
+	}
+
+	void malformed()
+	{
+		const struct
+		{
+			const char * pattern;
+			std::size_t offset;
+		} cases[] = {
+			{ "(ab", 3 },
+			{ "ab)", 2 },
+			{ "[ab", 3 },
+			{ "*a", 0 },
+			{ "a|+", 2 },
+			{ "a{2", 3 },
+			{ "a{3,2}", 5 },
+			{ "a{1001}", 5 },
+			{ "a{}", 2 },
+			{ "a^b", 1 },
+			{ "a$b", 1 },
+			{ "\\q", 1 },
+			{ "\\x4", 3 },
+			{ "ab\\", 3 },
+			{ "[z-a]", 4 },
+		};
+
+		for (const auto & c : cases)
+		{
+			try
+			{
+				automata::regex re(c.pattern);
+				CPPUNIT_ASSERT_MESSAGE(c.pattern, false);
+			} catch (const automata::regex_error & e)
+			{
+				CPPUNIT_ASSERT_EQUAL_MESSAGE(c.pattern, c.offset, e.offset());
+			}
+		}
+
+		CPPUNIT_ASSERT_THROW(automata::regex(std::string(300, '(')),
+		                     automata::regex_error);
+	}
+
+	void too_many_states()
+	{
+		// the n-th byte from the end needs 2^n states
+		CPPUNIT_ASSERT_THROW(automata::regex("[ab]*a[ab]{20}"),
+		                     automata::regex_error);
+		CPPUNIT_ASSERT_THROW(automata::regex("[ab]*a[ab]{8}", 100),
+		                     automata::regex_error);
+
+		automata::regex re("[ab]*a[ab]{5}");
+		CPPUNIT_ASSERT(re.search("ababbb"));
+		CPPUNIT_ASSERT(! re.search("bbbbbbbbb"));
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_regex);
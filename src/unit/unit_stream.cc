@@ -0,0 +1,277 @@
+#include "descriptor/stream.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cppunit-header.h"
+
+class Test_stream : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_stream);
+	CPPUNIT_TEST(lines);
+	CPPUNIT_TEST(long_lines);
+	CPPUNIT_TEST(peek_consume);
+	CPPUNIT_TEST(bulk_read);
+	CPPUNIT_TEST(formatting);
+	CPPUNIT_TEST(prepare_commit);
+	CPPUNIT_TEST(policies);
+	CPPUNIT_TEST(nonblocking);
+	CPPUNIT_TEST_SUITE_END();
+
+	std::string name;
+	filesystem::path file;
+
+	std::string contents()
+	{
+		io::file_descriptor f(file);
+		std::string s;
+		char buf[4096];
+		std::size_t n;
+
+		while ((n = f.read(buf, sizeof(buf))) > 0)
+			s.append(buf, n);
+		return s;
+	}
+
+	void store(const std::string & s)
+	{
+		io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+		f.write(s.data(), s.size());
+	}
+
+ public:
+	void setUp()
+	{
+		char tmpl[] = "/tmp/stream.XXXXXX";
+		int fd = mkstemp(tmpl);
+		CPPUNIT_ASSERT(fd >= 0);
+		::close(fd);
+		name = tmpl;
+		file = filesystem::path(name);
+	}
+
+	void tearDown()
+	{
+		unlink(name.c_str());
+	}
+
+ protected:
+	void lines()
+	{
+		store("one\ntwo\n\nlast");
+
+		io::file_descriptor f(file);
+		io::reader r(f, 4); // smaller than the lines
+		std::vector<std::string> got;
+		io::text_view line;
+
+		while (r.getline(line))
+			got.push_back(line.string());
+
+		CPPUNIT_ASSERT(got.size() == 4);
+		CPPUNIT_ASSERT(got[0] == "one" && got[1] == "two");
+		CPPUNIT_ASSERT(got[2].empty() && got[3] == "last");
+		CPPUNIT_ASSERT(r.eof());
+		CPPUNIT_ASSERT(!r.getline(line));
+
+		// other delimiters
+		store("a,b,c");
+		io::file_descriptor g(file);
+		io::reader r2(g);
+		CPPUNIT_ASSERT(r2.getline(line, ','));
+		CPPUNIT_ASSERT(line == "a");
+		CPPUNIT_ASSERT(r2.getline(line, ','));
+		CPPUNIT_ASSERT(r2.getline(line, ','));
+		CPPUNIT_ASSERT(line == "c");
+	}
+
+	void long_lines()
+	{
+		std::string big(100000, 'x');
+		store(big + "\nshort\n" + big);
+
+		io::file_descriptor f(file);
+		io::reader r(f, 1024);
+		io::text_view line;
+
+		CPPUNIT_ASSERT(r.getline(line) && line.size() == big.size());
+		CPPUNIT_ASSERT(line == big);
+		CPPUNIT_ASSERT(r.capacity() >= big.size());
+		CPPUNIT_ASSERT(r.getline(line) && line == "short");
+		CPPUNIT_ASSERT(r.getline(line) && line == big);
+		CPPUNIT_ASSERT(!r.getline(line));
+	}
+
+	void peek_consume()
+	{
+		store("HDR1payload");
+
+		io::file_descriptor f(file);
+		io::reader r(f);
+
+		CPPUNIT_ASSERT(r.peek().empty());
+		io::text_view v = r.peek(4);
+		CPPUNIT_ASSERT(v.size() >= 4);
+		CPPUNIT_ASSERT(io::text_view(v.data(), 4) == "HDR1");
+		r.consume(4);
+		CPPUNIT_ASSERT(r.peek() == "payload");
+
+		// more than there is: stops at end of file
+		v = r.peek(1000);
+		CPPUNIT_ASSERT(v == "payload");
+		CPPUNIT_ASSERT(r.eof());
+
+		r.consume(1000);
+		CPPUNIT_ASSERT(r.size() == 0);
+	}
+
+	void bulk_read()
+	{
+		std::string data;
+		for (int i = 0; i < 50000; ++i)
+			data += static_cast<char>('a' + i % 26);
+		store(data);
+
+		io::file_descriptor f(file);
+		io::reader r(f, 64);
+		std::string got;
+		char small[10];
+		std::vector<char> large(20000);
+
+		// buffered and direct reads mixed
+		got.append(small, r.read(small, sizeof(small)));
+		std::size_t n;
+		while ((n = r.read(large.data(), large.size())) > 0)
+		{
+			got.append(large.data(), n);
+			got.append(small, r.read(small, sizeof(small)));
+		}
+
+		CPPUNIT_ASSERT(got == data);
+	}
+
+	void formatting()
+	{
+		{
+			io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+			io::writer w(f);
+
+			w << "n=" << 42 << ' ' << -7L << ' ' << 18446744073709551615ULL
+			  << ' ' << 0.1 << ' ' << 2.5f << ' ' << true << ' '
+			  << std::string("str") << io::text_view("view") << '\n';
+
+			// nothing reaches the file until a flush
+			CPPUNIT_ASSERT(contents().empty());
+			w.flush();
+			CPPUNIT_ASSERT(w.size() == 0);
+		}
+
+		CPPUNIT_ASSERT(contents()
+		               == "n=42 -7 18446744073709551615 0.1 2.5 true strview\n");
+
+		// the destructor flushes, and output larger than the buffer
+		// goes straight through
+		std::string big(5000, 'y');
+		{
+			io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+			io::writer w(f, 100);
+			w << "a";
+			w << big;
+			w << 1;
+		}
+		CPPUNIT_ASSERT(contents() == "a" + big + "1");
+	}
+
+	void prepare_commit()
+	{
+		std::string expect;
+		{
+			io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+			io::writer w(f, 64);
+
+			// formatting in place, across many buffer flushes
+			for (int i = 0; i < 100; ++i)
+			{
+				char * const start = w.prepare(8);
+				char * p = to_chars(start, start + 8, i).ptr;
+				*p++ = ';';
+				w.commit(p - start);
+				expect += std::to_string(i) + ";";
+			}
+
+			// more than the buffer holds: it grows
+			char * p = w.prepare(1000);
+			std::memset(p, '-', 1000);
+			w.commit(1000);
+			CPPUNIT_ASSERT(w.capacity() >= 1000);
+			expect += std::string(1000, '-');
+		}
+		CPPUNIT_ASSERT(contents() == expect);
+	}
+
+	void policies()
+	{
+		io::file_descriptor f(file, O_WRONLY | O_TRUNC);
+		io::writer w(f, 1024, io::flush_policy::line);
+
+		w << "partial";
+		CPPUNIT_ASSERT(contents().empty());
+		w << " line\nand";
+		CPPUNIT_ASSERT(contents() == "partial line\nand");
+
+		w.policy(io::flush_policy::always);
+		w << 'x';
+		CPPUNIT_ASSERT(contents() == "partial line\nandx");
+
+		w.policy(io::flush_policy::full);
+		w << "\n";
+		CPPUNIT_ASSERT(w.size() == 1);
+	}
+
+	void nonblocking()
+	{
+		int fds[2];
+		CPPUNIT_ASSERT(pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+		io::io_descriptor rd(fds[0]), wr(fds[1]);
+
+		io::reader r(rd);
+		io::writer w(wr);
+		io::text_view line;
+		std::error_code ec;
+
+		CPPUNIT_ASSERT(!r.getline(line, '\n', ec));
+		CPPUNIT_ASSERT(ec == std::errc::resource_unavailable_try_again);
+
+		// half a line stays buffered until the rest arrives
+		w << "hel";
+		w.flush();
+		CPPUNIT_ASSERT(!r.getline(line, '\n', ec));
+		CPPUNIT_ASSERT(r.size() == 3);
+		w << "lo\n";
+		w.flush();
+		CPPUNIT_ASSERT(r.getline(line, '\n', ec));
+		CPPUNIT_ASSERT(!ec && line == "hello");
+		CPPUNIT_ASSERT_THROW(r.getline(line), std::system_error);
+
+		// a full pipe leaves the rest buffered
+		std::string chunk(4096, 'z');
+		for (int i = 0; i < 64 && !ec; ++i)
+			w.write(chunk.data(), chunk.size(), ec);
+		w.flush(ec);
+		CPPUNIT_ASSERT(ec == std::errc::resource_unavailable_try_again);
+		CPPUNIT_ASSERT(w.size() > 0);
+
+		// drain, then the rest goes
+		char buf[4096];
+		while (rd.read(buf, sizeof(buf), ec) > 0) { }
+		w.flush(ec);
+		CPPUNIT_ASSERT(!ec && w.size() == 0);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_stream);
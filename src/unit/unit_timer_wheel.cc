@@ -0,0 +1,188 @@
+#include "descriptor/timer_wheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "cppunit-header.h"
+
+class Test_timer_wheel : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_timer_wheel);
+	CPPUNIT_TEST(ordering);
+	CPPUNIT_TEST(cancel_and_restart);
+	CPPUNIT_TEST(cascading);
+	CPPUNIT_TEST(callbacks_modify);
+	CPPUNIT_TEST(randomized);
+	CPPUNIT_TEST(with_reactor);
+	CPPUNIT_TEST_SUITE_END();
+
+	typedef io::timer_wheel wheel;
+	typedef std::chrono::milliseconds ms;
+
+ protected:
+	void ordering()
+	{
+		wheel w;
+		const wheel::time_point t0 = wheel::clock_type::now();
+		std::vector<int> order;
+
+		w.add_at(t0 + ms(30), [&]() { order.push_back(30); });
+		w.add_at(t0 + ms(10), [&]() { order.push_back(10); });
+		w.add_at(t0 + ms(20), [&]() { order.push_back(20); });
+		w.add_at(t0 + ms(10), [&]() { order.push_back(11); });
+		CPPUNIT_ASSERT(w.size() == 4);
+
+		CPPUNIT_ASSERT(w.expire(t0 + ms(5)) == 0);
+
+		// both due in the same tick fire in one batch; deadlines round up
+		// to a tick, hence the extra one
+		CPPUNIT_ASSERT(w.expire(t0 + ms(11)) == 2);
+		CPPUNIT_ASSERT(order.size() == 2);
+
+		CPPUNIT_ASSERT(w.expire(t0 + ms(100)) == 2);
+		CPPUNIT_ASSERT(order.size() == 4);
+		CPPUNIT_ASSERT(order[2] == 20 && order[3] == 30);
+		CPPUNIT_ASSERT(w.size() == 0);
+
+		// a deadline already past fires on the next expiry
+		bool late = false;
+		w.add_at(t0, [&]() { late = true; });
+		w.expire(t0 + ms(102));
+		CPPUNIT_ASSERT(late);
+	}
+
+	void cancel_and_restart()
+	{
+		wheel w;
+		const wheel::time_point t0 = wheel::clock_type::now();
+		int fired = 0;
+
+		wheel::timer_id a = w.add_at(t0 + ms(10), [&]() { ++fired; });
+		wheel::timer_id b = w.add_at(t0 + ms(10), [&]() { fired += 10; });
+
+		CPPUNIT_ASSERT(w.cancel(a));
+		CPPUNIT_ASSERT(!w.cancel(a));
+		CPPUNIT_ASSERT(w.restart_at(b, t0 + ms(50)));
+		CPPUNIT_ASSERT(w.size() == 1);
+
+		CPPUNIT_ASSERT(w.expire(t0 + ms(20)) == 0);
+		CPPUNIT_ASSERT(w.expire(t0 + ms(51)) == 1);
+		CPPUNIT_ASSERT(fired == 10);
+
+		// stale ids stay stale after their slot is reused
+		CPPUNIT_ASSERT(!w.restart_at(b, t0 + ms(60)));
+		wheel::timer_id c = w.add_at(t0 + ms(70), [&]() { });
+		CPPUNIT_ASSERT(c != a && c != b);
+		CPPUNIT_ASSERT(!w.cancel(a) && !w.cancel(b));
+		CPPUNIT_ASSERT(w.cancel(c));
+		CPPUNIT_ASSERT(!w.cancel(0));
+	}
+
+	void cascading()
+	{
+		// timeouts on every level, and one beyond the wheel's reach
+		wheel w(std::chrono::microseconds(1));
+		const wheel::time_point t0 = wheel::clock_type::now();
+		const std::chrono::microseconds at[] = {
+			std::chrono::microseconds(300),
+			std::chrono::microseconds(70000),
+			std::chrono::microseconds(20000000),
+			std::chrono::microseconds(5000000000LL),
+		};
+		const std::chrono::microseconds tick(1);
+		std::vector<int> fired;
+
+		for (int i = 3; i >= 0; --i)
+			w.add_at(t0 + at[i], [&fired, i]() { fired.push_back(i); });
+
+		for (int i = 0; i < 4; ++i)
+		{
+			w.expire(t0 + at[i] - tick);
+			CPPUNIT_ASSERT(fired.size() == static_cast<std::size_t>(i));
+			w.expire(t0 + at[i] + tick);
+			CPPUNIT_ASSERT(fired.size() == static_cast<std::size_t>(i + 1));
+			CPPUNIT_ASSERT(fired.back() == i);
+		}
+	}
+
+	void callbacks_modify()
+	{
+		wheel w;
+		const wheel::time_point t0 = wheel::clock_type::now();
+		wheel::timer_id victim = 0;
+		int chained = 0;
+		bool victim_fired = false;
+
+		// a callback cancels another due in the same expiry, and adds one
+		// that is already due: it goes in the next tick, which the same
+		// expiry still reaches, and one further out, which it doesn't
+		w.add_at(t0 + ms(5), [&]() {
+			w.cancel(victim);
+			w.add_at(t0 + ms(5), [&]() { ++chained; });
+			w.add_at(t0 + ms(20), [&]() { ++chained; });
+		});
+		victim = w.add_at(t0 + ms(7), [&]() { victim_fired = true; });
+
+		CPPUNIT_ASSERT(w.expire(t0 + ms(10)) == 2);
+		CPPUNIT_ASSERT(!victim_fired);
+		CPPUNIT_ASSERT(chained == 1);
+		CPPUNIT_ASSERT(w.expire(t0 + ms(21)) == 1);
+		CPPUNIT_ASSERT(chained == 2);
+	}
+
+	void randomized()
+	{
+		// every timer fires exactly once, in its own tick, in order
+		wheel w(std::chrono::microseconds(10));
+		const wheel::time_point t0 = wheel::clock_type::now();
+		std::mt19937 rng(7);
+		std::uniform_int_distribution<long> delay(1, 3000000);
+		std::vector<long> due, fired_at;
+		long now = 0;
+
+		for (int i = 0; i < 5000; ++i)
+		{
+			long d = delay(rng) * 10;
+			due.push_back(d);
+			w.add_at(t0 + std::chrono::microseconds(d),
+			         [&, d]() { CPPUNIT_ASSERT(now >= d); fired_at.push_back(d); });
+		}
+
+		std::uniform_int_distribution<long> step(1, 200000);
+		while (w.size() > 0)
+		{
+			now += step(rng);
+			w.expire(t0 + std::chrono::microseconds(now));
+		}
+
+		std::sort(due.begin(), due.end());
+		CPPUNIT_ASSERT(fired_at.size() == due.size());
+		CPPUNIT_ASSERT(std::is_sorted(fired_at.begin(), fired_at.end()));
+		CPPUNIT_ASSERT(fired_at == due);
+	}
+
+	void with_reactor()
+	{
+		io::reactor r;
+		wheel w;
+		int fired = 0;
+
+		w.attach(r);
+		w.add(ms(5), [&]() { ++fired; });
+		w.add(ms(10), [&]() { ++fired; });
+		wheel::timer_id never = w.add(ms(15), [&]() { fired += 100; });
+		w.add(ms(20), [&]() { ++fired; r.stop(); });
+		w.cancel(never);
+
+		const wheel::time_point start = wheel::clock_type::now();
+		r.run();
+
+		CPPUNIT_ASSERT(fired == 3);
+		CPPUNIT_ASSERT(wheel::clock_type::now() - start >= ms(15));
+		CPPUNIT_ASSERT(w.size() == 0);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_timer_wheel);
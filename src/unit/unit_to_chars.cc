@@ -0,0 +1,185 @@
+#include "utility/to_chars.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+#include "cppunit-header.h"
+
+class Test_to_chars : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_to_chars);
+	CPPUNIT_TEST(integers);
+	CPPUNIT_TEST(integers_match_printf);
+	CPPUNIT_TEST(bases);
+	CPPUNIT_TEST(floats_round_trip);
+	CPPUNIT_TEST(fixed);
+	CPPUNIT_TEST(too_small);
+	CPPUNIT_TEST_SUITE_END();
+
+	template <class T>
+	static std::string str(T value)
+	{
+		char buf[64];
+		to_chars_result r = to_chars(buf, buf + sizeof(buf), value);
+		CPPUNIT_ASSERT(r.ec == std::errc());
+		return std::string(buf, r.ptr);
+	}
+
+	static std::string reference(double d)
+	{
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%.15g", d);
+		if (std::strtod(buf, nullptr) != d)
+			snprintf(buf, sizeof(buf), "%.17g", d);
+		return buf;
+	}
+
+ protected:
+	void integers()
+	{
+		CPPUNIT_ASSERT(str(0) == "0");
+		CPPUNIT_ASSERT(str(7) == "7");
+		CPPUNIT_ASSERT(str(10) == "10");
+		CPPUNIT_ASSERT(str(-10) == "-10");
+		CPPUNIT_ASSERT(str(99) == "99");
+		CPPUNIT_ASSERT(str(100) == "100");
+		CPPUNIT_ASSERT(str(12345) == "12345");
+		CPPUNIT_ASSERT(str(static_cast<signed char>(-128)) == "-128");
+		CPPUNIT_ASSERT(str(static_cast<unsigned char>(255)) == "255");
+		CPPUNIT_ASSERT(str(std::numeric_limits<int>::min()) == "-2147483648");
+		CPPUNIT_ASSERT(str(std::numeric_limits<std::int64_t>::min())
+		               == "-9223372036854775808");
+		CPPUNIT_ASSERT(str(std::numeric_limits<std::uint64_t>::max())
+		               == "18446744073709551615");
+	}
+
+	void integers_match_printf()
+	{
+		std::mt19937_64 rng(1);
+		char buf[32];
+
+		for (int i = 0; i < 100000; ++i)
+		{
+			// a spread of magnitudes, not just 19 and 20 digit values
+			std::int64_t v = static_cast<std::int64_t>(rng())
+			                 >> (rng() % 64);
+			snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v));
+			CPPUNIT_ASSERT(str(v) == buf);
+		}
+	}
+
+	void bases()
+	{
+		char buf[80];
+		to_chars_result r;
+
+		r = to_chars(buf, buf + sizeof(buf), 255, 16);
+		CPPUNIT_ASSERT(std::string(buf, r.ptr) == "ff");
+
+		r = to_chars(buf, buf + sizeof(buf), -5, 2);
+		CPPUNIT_ASSERT(std::string(buf, r.ptr) == "-101");
+
+		r = to_chars(buf, buf + sizeof(buf), 35u, 36);
+		CPPUNIT_ASSERT(std::string(buf, r.ptr) == "z");
+
+		r = to_chars(buf, buf + sizeof(buf),
+		             std::numeric_limits<std::uint64_t>::max(), 2);
+		CPPUNIT_ASSERT(r.ptr - buf == 64);
+	}
+
+	void floats_round_trip()
+	{
+		CPPUNIT_ASSERT(str(0.1) == "0.1");
+		CPPUNIT_ASSERT(str(0.1f) == "0.1");
+		CPPUNIT_ASSERT(str(1.0) == "1");
+		CPPUNIT_ASSERT(str(-2.5) == "-2.5");
+		CPPUNIT_ASSERT(str(1e300) == "1e+300");
+		CPPUNIT_ASSERT(str(0.1 + 0.2) == "0.30000000000000004");
+		CPPUNIT_ASSERT(str(std::numeric_limits<double>::infinity()) == "inf");
+
+		std::mt19937_64 rng(2);
+		for (int i = 0; i < 20000; ++i)
+		{
+			std::uint64_t bits = rng();
+			double d;
+			std::memcpy(&d, &bits, sizeof(d));
+			if (d != d)
+				continue;
+
+			CPPUNIT_ASSERT(std::strtod(str(d).c_str(), nullptr) == d);
+
+			float f = static_cast<float>(i) / 7.0f;
+			CPPUNIT_ASSERT(std::strtof(str(f).c_str(), nullptr) == f);
+
+			// the digits10 form whenever it round trips, as checking every
+			// value with strtod() would give
+			if (std::fpclassify(d) == FP_NORMAL)
+				CPPUNIT_ASSERT(str(d) == reference(d));
+
+			const double decimal = static_cast<double>(rng() % 1000000) / 1000;
+			CPPUNIT_ASSERT(str(decimal) == reference(decimal));
+			CPPUNIT_ASSERT(str(decimal).size() <= 10);
+		}
+	}
+
+	void fixed()
+	{
+		char buf[400];
+		to_chars_result r;
+
+		r = to_chars(buf, buf + sizeof(buf), 3.14159, 2);
+		CPPUNIT_ASSERT(std::string(buf, r.ptr) == "3.14");
+
+		r = to_chars(buf, buf + sizeof(buf), 1e300, 0);
+		CPPUNIT_ASSERT(r.ec == std::errc());
+		CPPUNIT_ASSERT(r.ptr - buf == 301);
+		CPPUNIT_ASSERT(buf[0] == '1');
+
+		// exactly as long as the space, which leaves none for a NUL
+		r = to_chars(buf, buf + 301, 1e300, 0);
+		CPPUNIT_ASSERT(r.ec == std::errc());
+		CPPUNIT_ASSERT(r.ptr - buf == 301);
+		CPPUNIT_ASSERT(buf[0] == '1' && buf[300] == '0');
+
+		r = to_chars(buf, buf + 4, 3.14159, 2);
+		CPPUNIT_ASSERT(std::string(buf, r.ptr) == "3.14");
+
+		// rounding carries into another integer digit
+		r = to_chars(buf, buf + 3, -9.6, 0);
+		CPPUNIT_ASSERT(std::string(buf, r.ptr) == "-10");
+	}
+
+	void too_small()
+	{
+		char buf[4];
+		to_chars_result r;
+
+		r = to_chars(buf, buf + 4, 12345);
+		CPPUNIT_ASSERT(r.ec == std::errc::value_too_large);
+		CPPUNIT_ASSERT(r.ptr == buf + 4);
+
+		r = to_chars(buf, buf + 4, 1234);
+		CPPUNIT_ASSERT(r.ec == std::errc() && r.ptr == buf + 4);
+
+		r = to_chars(buf, buf, -1);
+		CPPUNIT_ASSERT(r.ec == std::errc::value_too_large);
+
+		r = to_chars(buf, buf + 4, 0.125);
+		CPPUNIT_ASSERT(r.ec == std::errc::value_too_large);
+
+		r = to_chars(buf, buf + 4, 0.125, 3);
+		CPPUNIT_ASSERT(r.ec == std::errc::value_too_large);
+		CPPUNIT_ASSERT(r.ptr == buf + 4);
+
+		r = to_chars(buf, buf, 1.0, 0);
+		CPPUNIT_ASSERT(r.ec == std::errc::value_too_large);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_to_chars);
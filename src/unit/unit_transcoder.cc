@@ -0,0 +1,351 @@
+#include "descriptor/transcoder.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "codecvt/codecvt"
+
+#include "cppunit-header.h"
+
+class Test_transcoder : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_transcoder);
+	CPPUNIT_TEST(utf16_to_utf8);
+	CPPUNIT_TEST(buffer_boundaries);
+	CPPUNIT_TEST(from_mapping);
+	CPPUNIT_TEST(native_order);
+	CPPUNIT_TEST(invalid_input);
+	CPPUNIT_TEST(truncated_input);
+	CPPUNIT_TEST(unencodable);
+	CPPUNIT_TEST(reuse);
+	CPPUNIT_TEST_SUITE_END();
+
+	typedef std::codecvt_utf16<char32_t, 0x10ffff, std::little_endian> utf16le;
+	typedef std::codecvt_utf8<char32_t> utf8;
+	typedef io::transcoder<utf16le, utf8> utf16_to_utf8_type;
+
+	std::string in_name, out_name;
+	filesystem::path in_file, out_file;
+
+	utf16le decoder;
+	utf8 encoder;
+
+	static std::string temp()
+	{
+		char tmpl[] = "/tmp/transcoder.XXXXXX";
+		int fd = mkstemp(tmpl);
+		CPPUNIT_ASSERT(fd >= 0);
+		close(fd);
+		return tmpl;
+	}
+
+	static void put_utf16(std::string & s, char32_t c)
+	{
+		if (c >= 0x10000)
+		{
+			c -= 0x10000;
+			put_utf16(s, 0xd800 + (c >> 10));
+			c = 0xdc00 + (c & 0x3ff);
+		}
+		s += static_cast<char>(c & 0xff);
+		s += static_cast<char>(c >> 8);
+	}
+
+	static void put_utf8(std::string & s, char32_t c)
+	{
+		if (c < 0x80)
+			s += static_cast<char>(c);
+		else if (c < 0x800)
+		{
+			s += static_cast<char>(0xc0 | (c >> 6));
+			s += static_cast<char>(0x80 | (c & 0x3f));
+		}
+		else if (c < 0x10000)
+		{
+			s += static_cast<char>(0xe0 | (c >> 12));
+			s += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+			s += static_cast<char>(0x80 | (c & 0x3f));
+		}
+		else
+		{
+			s += static_cast<char>(0xf0 | (c >> 18));
+			s += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+			s += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+			s += static_cast<char>(0x80 | (c & 0x3f));
+		}
+	}
+
+	/// Random text of every UTF-8 length, with no surrogates or NULs
+	static void text(std::size_t n, unsigned seed,
+	                 std::string & in, std::string & out)
+	{
+		std::mt19937 rng(seed);
+		static const char32_t top[] = { 0x80, 0x800, 0xd800, 0x110000 };
+
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			char32_t c = 1 + rng() % (top[rng() % 4] - 1);
+			if (c >= 0xd800 && c < 0xe000)
+				c -= 0x800;
+			put_utf16(in, c);
+			put_utf8(out, c);
+		}
+	}
+
+	void put(const std::string & s)
+	{
+		io::file_descriptor f(in_file, O_WRONLY | O_TRUNC);
+		f.write(s.data(), s.size());
+	}
+
+	std::string output()
+	{
+		io::file_descriptor f(out_file);
+		std::string s(f.size(), '\0');
+		f.pread(&s[0], s.size(), 0);
+		return s;
+	}
+
+	/// Decoders may read a little way into a bad sequence before
+	/// reporting it
+	static bool near(std::uint64_t at, std::size_t offset)
+	{
+		return (at >= offset && at < offset + 4);
+	}
+
+	io::transcode_result run(utf16_to_utf8_type & t)
+	{
+		io::file_descriptor from(in_file);
+		io::file_descriptor to(out_file, O_WRONLY | O_TRUNC);
+		return t.run(from, to);
+	}
+
+ public:
+	void setUp()
+	{
+		in_name = temp();
+		out_name = temp();
+		in_file = filesystem::path(in_name);
+		out_file = filesystem::path(out_name);
+	}
+
+	void tearDown()
+	{
+		unlink(in_name.c_str());
+		unlink(out_name.c_str());
+	}
+
+ protected:
+	void utf16_to_utf8()
+	{
+		std::string in, expected;
+		text(100000, 1, in, expected);
+		put(in);
+
+		utf16_to_utf8_type t(decoder, encoder);
+		io::transcode_result r = run(t);
+
+		CPPUNIT_ASSERT(r);
+		CPPUNIT_ASSERT(r.bytes_in == in.size());
+		CPPUNIT_ASSERT(r.bytes_out == expected.size());
+		CPPUNIT_ASSERT(r.characters == 100000);
+		CPPUNIT_ASSERT(output() == expected);
+	}
+
+	void buffer_boundaries()
+	{
+		std::string in, expected;
+		text(2000, 2, in, expected);
+		put(in);
+
+		// surrogate pairs and multibyte output cut at every position
+		for (std::size_t chunk = 64; chunk < 72; ++chunk)
+		{
+			utf16_to_utf8_type t(decoder, encoder, chunk);
+			io::transcode_result r = run(t);
+
+			CPPUNIT_ASSERT(r);
+			CPPUNIT_ASSERT(r.bytes_in == in.size());
+			CPPUNIT_ASSERT(output() == expected);
+		}
+	}
+
+	void from_mapping()
+	{
+		std::string in, expected;
+		text(5000, 3, in, expected);
+		put(in);
+
+		io::mapped_file m(in_file);
+		io::file_descriptor to(out_file, O_WRONLY | O_TRUNC);
+		utf16_to_utf8_type t(decoder, encoder, 100);
+
+		io::transcode_result r = t.run(m.bytes(), to);
+		CPPUNIT_ASSERT(r);
+		CPPUNIT_ASSERT(r.bytes_in == in.size());
+		CPPUNIT_ASSERT(output() == expected);
+	}
+
+	void native_order()
+	{
+		// the test data is little endian
+		const std::uint16_t one = 1;
+		if (*reinterpret_cast<const char *>(&one) != 1)
+			return;
+
+		std::string in, expected;
+		text(2000, 7, in, expected);
+		put(in);
+
+		io::native_utf16 copier;
+		std::codecvt_utf8_utf16<char16_t> utf8_utf16;
+
+		for (std::size_t chunk = 64; chunk < 72; ++chunk)
+		{
+			io::transcoder<io::native_utf16, std::codecvt_utf8_utf16<char16_t> >
+			    t(copier, utf8_utf16, chunk);
+
+			io::file_descriptor from(in_file);
+			io::file_descriptor to(out_file, O_WRONLY | O_TRUNC);
+			io::transcode_result r = t.run(from, to);
+
+			CPPUNIT_ASSERT(r);
+			CPPUNIT_ASSERT(r.bytes_in == in.size());
+			CPPUNIT_ASSERT(output() == expected);
+		}
+
+		// a high surrogate waits for a low one that never comes
+		in.clear();
+		put_utf16(in, 'a');
+		put_utf16(in, 0x1f600);
+		in.resize(4);
+		put(in);
+
+		io::transcoder<io::native_utf16, std::codecvt_utf8_utf16<char16_t> >
+		    t(copier, utf8_utf16, 64);
+		io::mapped_file m(in_file);
+		io::file_descriptor to(out_file, O_WRONLY | O_TRUNC);
+		io::transcode_result r = t.run(m.bytes(), to);
+
+		CPPUNIT_ASSERT(r.status == io::transcode_result::truncated);
+		CPPUNIT_ASSERT(r.bytes_in == 2);
+		CPPUNIT_ASSERT(output() == "a");
+	}
+
+	void invalid_input()
+	{
+		std::string in, expected;
+		text(300, 4, in, expected);
+		const std::size_t offset = in.size();
+
+		// a low surrogate with no high one before it
+		put_utf16(in, 0xdc00);
+		in.append("a\0b\0", 4);
+		put(in);
+
+		utf16_to_utf8_type t(decoder, encoder, 64);
+		io::transcode_result r = run(t);
+
+		CPPUNIT_ASSERT(r.status == io::transcode_result::invalid);
+		CPPUNIT_ASSERT(near(r.bytes_in, offset));
+		CPPUNIT_ASSERT(output() == expected);
+
+		// the same from a mapping
+		io::mapped_file m(in_file);
+		io::file_descriptor to(out_file, O_WRONLY | O_TRUNC);
+		r = t.run(m.bytes(), to);
+		CPPUNIT_ASSERT(r.status == io::transcode_result::invalid);
+		CPPUNIT_ASSERT(near(r.bytes_in, offset));
+	}
+
+	void truncated_input()
+	{
+		std::string in, expected;
+		text(300, 5, in, expected);
+		const std::size_t offset = in.size();
+
+		// half of a surrogate pair
+		put_utf16(in, 0xd801);
+		put(in);
+
+		utf16_to_utf8_type t(decoder, encoder, 64);
+		io::transcode_result r = run(t);
+
+		CPPUNIT_ASSERT(r.status == io::transcode_result::truncated);
+		CPPUNIT_ASSERT(near(r.bytes_in, offset));
+		CPPUNIT_ASSERT(output() == expected);
+
+		// an odd number of bytes, which some decoders call invalid
+		in.resize(offset + 1);
+		put(in);
+		r = run(t);
+		CPPUNIT_ASSERT(!r);
+		CPPUNIT_ASSERT(near(r.bytes_in, offset));
+		CPPUNIT_ASSERT(output() == expected);
+	}
+
+	void unencodable()
+	{
+		// an encoder limited to the BMP refuses what the decoder passes
+		std::codecvt_utf8<char32_t, 0xffff> bmp;
+		io::transcoder<utf16le, std::codecvt_utf8<char32_t, 0xffff> >
+		    t(decoder, bmp, 64);
+
+		std::string in, expected;
+		for (int i = 0; i < 100; ++i)
+		{
+			put_utf16(in, 0x400 + i);
+			put_utf8(expected, 0x400 + i);
+		}
+		const std::size_t offset = in.size();
+		put_utf16(in, 0x1f600);
+		put_utf16(in, 'z');
+		put(in);
+
+		io::file_descriptor from(in_file);
+		io::file_descriptor to(out_file, O_WRONLY | O_TRUNC);
+		io::transcode_result r = t.run(from, to);
+
+		CPPUNIT_ASSERT(r.status == io::transcode_result::invalid);
+		CPPUNIT_ASSERT(near(r.bytes_in, offset));
+		CPPUNIT_ASSERT(r.characters == 100);
+		CPPUNIT_ASSERT(output() == expected);
+	}
+
+	void reuse()
+	{
+		utf16_to_utf8_type t(decoder, encoder, 64);
+
+		// a failed run leaves nothing behind for the next
+		std::string in;
+		put_utf16(in, 0xd801);
+		put(in);
+		CPPUNIT_ASSERT(run(t).status == io::transcode_result::truncated);
+
+		std::string expected;
+		in.clear();
+		text(100, 6, in, expected);
+		put(in);
+		CPPUNIT_ASSERT(run(t));
+		CPPUNIT_ASSERT(output() == expected);
+
+		// empty input, empty output
+		put(std::string());
+		io::transcode_result r = run(t);
+		CPPUNIT_ASSERT(r && r.bytes_in == 0 && r.bytes_out == 0);
+		CPPUNIT_ASSERT(output().empty());
+
+		// I/O errors go through ec
+		io::file_descriptor from(in_file);
+		io::file_descriptor to(out_file);  // not open for writing
+		put(in);
+		std::error_code ec;
+		t.run(from, to, ec);
+		CPPUNIT_ASSERT(ec == std::errc::bad_file_descriptor);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_transcoder);
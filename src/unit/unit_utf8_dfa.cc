@@ -0,0 +1,218 @@
+#include "codecvt/codecvt"
+#include "codecvt/utf8_dfa.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cppunit-header.h"
+
+namespace {
+
+/// Lets the tests decode with and without the tables
+template <class Facet>
+struct exposed : public Facet
+{
+	using Facet::convert_in;
+};
+
+/// UTF-8 of random code points of every length up to six bytes, mostly in
+/// runs of one length, with some bytes damaged
+std::string random_utf8(std::mt19937 & rng, std::size_t n)
+{
+	static const uint32_t limits[] = {
+		0x80, 0x800, 0x10000, 0x200000, 0x4000000, 0x80000000
+	};
+
+	std::string out;
+
+	while (out.size() < n)
+	{
+		const unsigned kind = rng() % 10;
+		const unsigned length = (kind < 4) ? 1 : (kind < 6) ? 2
+		                      : (kind < 8) ? 3 : 4 + rng() % 3;
+		const std::size_t run = 1 + rng() % 50;
+
+		for (std::size_t i = 0; (i < run) && (out.size() < n); ++i)
+		{
+			const uint32_t c = rng() % limits[length - 1];
+
+			if (length == 1)
+				out += static_cast<char>(c);
+			else
+			{
+				out += static_cast<char>(
+				         (0xff00u >> length) | (c >> (6 * (length - 1))));
+
+				for (unsigned j = length - 1; j > 0; --j)
+					out += static_cast<char>(
+					         0x80u | ((c >> (6 * (j - 1))) & 0x3fu));
+			}
+		}
+	}
+
+	const std::size_t damaged = out.empty() ? 0 : rng() % 4;
+
+	for (std::size_t i = 0; i < damaged; ++i)
+		out[rng() % out.size()] = static_cast<char>(rng());
+
+	return out;
+}
+
+bool same_state(const std::mbstate_t & a, const std::mbstate_t & b)
+{
+	return (  a.__count == b.__count
+	       && a.__value.__wch == b.__value.__wch);
+}
+
+} // namespace
+
+class Test_utf8_dfa : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_utf8_dfa);
+	CPPUNIT_TEST(tables_follow_the_machine);
+	CPPUNIT_TEST(in_matches_scalar);
+	CPPUNIT_TEST(in_six_byte_sequences);
+	CPPUNIT_TEST_SUITE_END();
+
+	/// The input a piece at a time, into outputs of various sizes, with
+	/// and without the tables
+	template <class Facet>
+	static void check_in(const std::string & in, std::mt19937 & rng)
+	{
+		typedef typename Facet::intern_type Elem;
+		exposed<Facet> f;
+		std::mbstate_t fast = std::mbstate_t(), slow = std::mbstate_t();
+		std::vector<Elem> a(300), b(300);
+
+		const char * from = in.data();
+		const char * const end = from + in.size();
+
+		for (int calls = 0; from < end && calls < 100000; ++calls)
+		{
+			const char * from_end = from + std::min<std::size_t>(
+			                                   end - from, 1 + rng() % 200);
+			const std::size_t room = rng() % 2 ? rng() % 8 : rng() % 300;
+			const char * fast_next, * slow_next;
+			Elem * fast_to, * slow_to;
+
+			std::codecvt_base::result fr
+			  = f.convert_in(fast, from, from_end, fast_next,
+			                 a.data(), a.data() + room, fast_to, true);
+			std::codecvt_base::result sr
+			  = f.convert_in(slow, from, from_end, slow_next,
+			                 b.data(), b.data() + room, slow_to, false);
+
+			CPPUNIT_ASSERT(fr == sr);
+			CPPUNIT_ASSERT(fast_next == slow_next);
+			CPPUNIT_ASSERT(fast_to - a.data() == slow_to - b.data());
+			CPPUNIT_ASSERT(std::equal(a.data(), fast_to, b.data()));
+			CPPUNIT_ASSERT(same_state(fast, slow));
+
+			from = fast_next;
+
+			// carry on after the bad byte
+			if (fr == std::codecvt_base::error)
+			{
+				++from;
+				fast = slow = std::mbstate_t();
+			}
+		}
+	}
+
+ protected:
+	void tables_follow_the_machine()
+	{
+		namespace dfa = utf8_dfa;
+
+		for (std::size_t b = 0; b < 256; ++b)
+		{
+			const uint8_t cls = dfa::class_table::values[b];
+			const std::size_t length = utf8_conversion::codepoint_length(b);
+
+			if ((b & 0xc0u) == 0x80u)
+			{
+				CPPUNIT_ASSERT(cls == dfa::continuation);
+				CPPUNIT_ASSERT((0xffu >> cls) == 0x3fu);
+			}
+			else if (length == 0)
+				CPPUNIT_ASSERT(cls == dfa::invalid);
+			else
+			{
+				// leaders go to the state with the rest of them to come,
+				// and the mask keeps their data bits
+				CPPUNIT_ASSERT(dfa::next_state(dfa::accept, cls)
+				               == length - 1);
+				CPPUNIT_ASSERT((0xffu >> cls)
+				               == ((1u << (7 - (length > 1) * length)) - 1));
+			}
+		}
+
+		for (std::size_t s = 0; s < dfa::state_count; ++s)
+		{
+			for (std::size_t cls = 0; cls < dfa::class_count; ++cls)
+			{
+				const uint8_t next = dfa::next_state(s, cls);
+
+				if (s == dfa::reject)
+					CPPUNIT_ASSERT(next == dfa::reject);
+				else if (cls == dfa::continuation)
+					CPPUNIT_ASSERT(next == ((s == dfa::accept) ? dfa::reject
+					                                           : s - 1));
+				else if ((s != dfa::accept) || (cls == dfa::invalid))
+					CPPUNIT_ASSERT(next == dfa::reject);
+			}
+		}
+	}
+
+	void in_matches_scalar()
+	{
+		std::mt19937 rng(1);
+
+		for (int i = 0; i < 200; ++i)
+		{
+			const std::string in = random_utf8(rng, rng() % 3000);
+
+			check_in<std::codecvt_utf8<char32_t>>(in, rng);
+			check_in<std::codecvt_utf8<char32_t, 0x7fffffff>>(in, rng);
+			check_in<std::codecvt_utf8<char16_t, 0xffff>>(in, rng);
+			check_in<std::codecvt_utf8<wchar_t, 0x7f>>(in, rng);
+			check_in<std::codecvt_utf8<wchar_t, 0x10ffff,
+			                           std::consume_header>>(
+			           "\xef\xbb\xbf" + in, rng);
+		}
+	}
+
+	void in_six_byte_sequences()
+	{
+		std::codecvt_utf8<char32_t, 0x7fffffff> f;
+		const std::string in = "a\xf8\x88\x80\x80\x80"
+		                       "\xfc\x84\x80\x80\x80\x80"
+		                       "\xfd\xbf\xbf\xbf\xbf\xbf";
+		const char32_t expected[] = { U'a', 0x200000, 0x4000000, 0x7fffffff };
+
+		std::mbstate_t state = std::mbstate_t();
+		char32_t buf[8];
+		const char * from_next;
+		char32_t * to_next;
+
+		CPPUNIT_ASSERT(f.in(state, in.data(), in.data() + in.size(),
+		                    from_next, buf, buf + 8, to_next)
+		               == std::codecvt_base::ok);
+		CPPUNIT_ASSERT(from_next == in.data() + in.size());
+		CPPUNIT_ASSERT(to_next == buf + 4);
+		CPPUNIT_ASSERT(std::equal(buf, to_next, expected));
+
+		// and past the largest the facet allows
+		std::codecvt_utf8<char32_t> g;
+		state = std::mbstate_t();
+
+		CPPUNIT_ASSERT(g.in(state, in.data(), in.data() + in.size(),
+		                    from_next, buf, buf + 8, to_next)
+		               == std::codecvt_base::error);
+		CPPUNIT_ASSERT(from_next == in.data() + 5);
+		CPPUNIT_ASSERT(to_next == buf + 1);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_utf8_dfa);
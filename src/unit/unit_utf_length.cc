@@ -0,0 +1,280 @@
+#include "codecvt/codecvt"
+#include "codecvt/utf_length_helpers.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cppunit-header.h"
+
+namespace {
+
+/// Lets the tests measure with and without the kernels
+template <class Facet>
+struct exposed : public Facet
+{
+	using Facet::measure_length;
+};
+
+/// Code points of every UTF-8 length, mostly in runs of one length
+std::u32string random_text(std::mt19937 & rng, std::size_t n)
+{
+	std::u32string s;
+
+	while (s.size() < n)
+	{
+		const unsigned kind = rng() % 10;
+		const std::size_t run = 1 + rng() % 100;
+
+		for (std::size_t i = 0; (i < run) && (s.size() < n); ++i)
+		{
+			char32_t c;
+
+			if (kind < 5)
+				c = rng() % 0x80;
+			else if (kind < 7)
+				c = 0x80 + rng() % 0x780;
+			else if (kind < 9)
+			{
+				do c = 0x800 + rng() % 0xf800;
+				while ((c >= 0xd800) && (c < 0xe000));
+			}
+			else
+				c = 0x10000 + rng() % 0x100000;
+
+			s += c;
+		}
+	}
+
+	return s;
+}
+
+std::string to_utf8(const std::u32string & text)
+{
+	std::codecvt_utf8<char32_t> f;
+	std::mbstate_t state = std::mbstate_t();
+	std::string out(text.size() * 4, '\0');
+	const char32_t * from_next;
+	char * to_next;
+
+	f.out(state, text.data(), text.data() + text.size(), from_next,
+	      &out[0], &out[0] + out.size(), to_next);
+	out.resize(to_next - out.data());
+	return out;
+}
+
+std::u16string to_utf16(const std::u32string & text)
+{
+	std::u16string out;
+
+	for (char32_t c : text)
+	{
+		if (c < 0x10000)
+			out += static_cast<char16_t>(c);
+		else
+		{
+			out += static_cast<char16_t>(0xd800 + ((c - 0x10000) >> 10));
+			out += static_cast<char16_t>(0xdc00 + (c & 0x3ff));
+		}
+	}
+
+	return out;
+}
+
+/// text as UTF-16 bytes, big endian, with some of them damaged
+std::string to_utf16_bytes(std::mt19937 & rng, const std::u32string & text)
+{
+	std::string out;
+
+	for (char16_t u : to_utf16(text))
+	{
+		out += static_cast<char>(u >> 8);
+		out += static_cast<char>(u & 0xff);
+	}
+
+	const std::size_t damaged = out.empty() ? 0 : rng() % 4;
+
+	for (std::size_t i = 0; i < damaged; ++i)
+		out[rng() % out.size()] = static_cast<char>(rng());
+
+	return out;
+}
+
+/// UTF-8 of random_text(), often with one length of character only, as
+/// that's what do_length() passes over, and with some bytes damaged
+std::string random_utf8(std::mt19937 & rng, std::size_t n)
+{
+	std::u32string text = random_text(rng, n);
+	const unsigned only = rng() % 4;
+
+	for (char32_t & c : text)
+	{
+		if (only == 1)
+			c &= 0x7f;
+		else if (only == 2)
+			c = 0x80 + (c % 0x780);
+	}
+
+	std::string out = to_utf8(text);
+
+	const std::size_t damaged = out.empty() ? 0 : rng() % 4;
+
+	for (std::size_t i = 0; i < damaged; ++i)
+		out[rng() % out.size()] = static_cast<char>(rng());
+
+	return out;
+}
+
+bool same_state(const std::mbstate_t & a, const std::mbstate_t & b)
+{
+	return (  a.__count == b.__count
+	       && a.__value.__wch == b.__value.__wch);
+}
+
+} // namespace
+
+class Test_utf_length : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_utf_length);
+	CPPUNIT_TEST(lengths_match_conversions);
+	CPPUNIT_TEST(lengths_of_short_ranges);
+	CPPUNIT_TEST(do_length_matches_scalar);
+	CPPUNIT_TEST(do_length_counts_characters);
+	CPPUNIT_TEST_SUITE_END();
+
+	/// do_length() with and without the kernels, from a few states and
+	/// with a few limits
+	template <class Facet>
+	static void check_length(const std::string & in, std::mt19937 & rng)
+	{
+		exposed<Facet> f;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			const std::size_t max = (i == 0) ? in.size() : rng() % 300;
+			const std::size_t start = (i < 4) ? 0 : rng() % (in.size() + 1);
+			std::mbstate_t fast = std::mbstate_t(), slow = std::mbstate_t();
+
+			const int a = f.measure_length(fast, in.data() + start,
+			                               in.data() + in.size(), max, true);
+			const int b = f.measure_length(slow, in.data() + start,
+			                               in.data() + in.size(), max, false);
+
+			CPPUNIT_ASSERT(a == b);
+			CPPUNIT_ASSERT(same_state(fast, slow));
+		}
+	}
+
+ protected:
+	void lengths_match_conversions()
+	{
+		std::mt19937 rng(1);
+
+		for (int i = 0; i < 200; ++i)
+		{
+			const std::u32string text = random_text(rng, rng() % 3000);
+			const std::string utf8 = to_utf8(text);
+			const std::u16string utf16 = to_utf16(text);
+			const std::u32string wide(utf16.begin(), utf16.end());
+
+			const char * b8 = utf8.data();
+			const char * e8 = b8 + utf8.size();
+
+			CPPUNIT_ASSERT(utf_length::utf32_length_from_utf8(b8, e8)
+			               == text.size());
+			CPPUNIT_ASSERT(utf_length::utf16_length_from_utf8(b8, e8)
+			               == utf16.size());
+
+			CPPUNIT_ASSERT(utf_length::utf8_length_from_utf16(
+			                 utf16.data(), utf16.data() + utf16.size())
+			               == utf8.size());
+			CPPUNIT_ASSERT(utf_length::utf32_length_from_utf16(
+			                 utf16.data(), utf16.data() + utf16.size())
+			               == text.size());
+
+			// UTF-16 held in 32 bit units goes the generic way
+			CPPUNIT_ASSERT(utf_length::utf8_length_from_utf16(
+			                 wide.data(), wide.data() + wide.size())
+			               == utf8.size());
+			CPPUNIT_ASSERT(utf_length::utf32_length_from_utf16(
+			                 wide.data(), wide.data() + wide.size())
+			               == text.size());
+
+			CPPUNIT_ASSERT(utf_length::utf8_length_from_utf32(
+			                 text.data(), text.data() + text.size())
+			               == utf8.size());
+			CPPUNIT_ASSERT(utf_length::utf16_length_from_utf32(
+			                 text.data(), text.data() + text.size())
+			               == utf16.size());
+		}
+	}
+
+	void lengths_of_short_ranges()
+	{
+		// every length and alignment around the blocks
+		const std::string utf8 = to_utf8(U"aé中😀aé中😀aé中😀aé中😀aé中😀aé中😀"
+		                                 U"aé中😀aé中😀aé中😀aé中😀aé中😀aé中😀");
+
+		for (std::size_t from = 0; from < 8; ++from)
+		{
+			for (std::size_t to = from; to <= utf8.size(); ++to)
+			{
+				std::size_t points = 0, units = 0;
+
+				for (std::size_t i = from; i < to; ++i)
+				{
+					const uint8_t b = static_cast<uint8_t>(utf8[i]);
+					points += ((b & 0xc0) != 0x80);
+					units += ((b & 0xc0) != 0x80) + (b >= 0xf0);
+				}
+
+				CPPUNIT_ASSERT(utf_length::utf32_length_from_utf8(
+				                 utf8.data() + from, utf8.data() + to)
+				               == points);
+				CPPUNIT_ASSERT(utf_length::utf16_length_from_utf8(
+				                 utf8.data() + from, utf8.data() + to)
+				               == units);
+			}
+		}
+	}
+
+	void do_length_matches_scalar()
+	{
+		std::mt19937 rng(2);
+
+		for (int i = 0; i < 300; ++i)
+		{
+			const std::string utf8 = random_utf8(rng, rng() % 2000);
+
+			check_length<std::codecvt_utf8_utf16<char16_t>>(utf8, rng);
+			check_length<std::codecvt_utf8<char32_t>>(utf8, rng);
+			check_length<std::codecvt_utf8<wchar_t, 0x7ff>>(utf8, rng);
+			check_length<std::codecvt_utf8<char16_t, 0x7f>>(utf8, rng);
+
+			const std::string utf16 = to_utf16_bytes(rng,
+			                            random_text(rng, rng() % 2000));
+
+			check_length<std::codecvt_utf16<char32_t>>(utf16, rng);
+			check_length<std::codecvt_utf16<char16_t, 0x10ffff,
+			                                std::consume_header>>(
+			               "\xfe\xff" + utf16, rng);
+		}
+	}
+
+	void do_length_counts_characters()
+	{
+		std::codecvt_utf8<char32_t> f;
+		const std::string in = to_utf8(std::u32string(100, U'é'));
+
+		for (std::size_t max = 0; max < 110; ++max)
+		{
+			std::mbstate_t state = std::mbstate_t();
+
+			CPPUNIT_ASSERT(
+			  f.length(state, in.data(), in.data() + in.size(), max)
+			  == static_cast<int>(2 * std::min<std::size_t>(max, 100)));
+		}
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_utf_length);
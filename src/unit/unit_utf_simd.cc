@@ -0,0 +1,444 @@
+#include "codecvt/codecvt"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cppunit-header.h"
+
+namespace {
+
+/// Lets the tests call the conversions with and without the kernels
+template <class Facet>
+struct exposed : public Facet
+{
+	using Facet::convert_in;
+	using Facet::convert_out;
+};
+
+typedef std::codecvt_utf8_utf16<char16_t> plain16;
+typedef std::codecvt_utf8_utf16<char16_t, 0x10ffff,
+          std::codecvt_mode(std::generate_header | std::consume_header)>
+        headers16;
+typedef std::codecvt_utf8_utf16<char32_t> plain32;
+typedef std::codecvt_utf8_utf16<wchar_t> plainw;
+
+typedef std::codecvt_utf16<char16_t> big16;
+typedef std::codecvt_utf16<char32_t, 0x10ffff, std::little_endian> little32;
+typedef std::codecvt_utf16<wchar_t, 0x10ffff,
+          std::codecvt_mode(std::generate_header | std::consume_header)>
+        headersw;
+typedef std::codecvt_utf16<char16_t, 0x7ff, std::little_endian> narrow16;
+
+bool same_state(const std::mbstate_t & a, const std::mbstate_t & b)
+{
+	return (  a.__count == b.__count
+	       && a.__value.__wch == b.__value.__wch);
+}
+
+/// Mostly long runs, which the kernels take, broken up by everything
+/// that they don't
+template <class Elem>
+std::basic_string<Elem> random_units(std::mt19937 & rng, std::size_t n)
+{
+	std::basic_string<Elem> s;
+
+	while (s.size() < n)
+	{
+		const unsigned kind = rng() % 16;
+		const std::size_t run = 1 + rng() % 70;
+
+		for (std::size_t i = 0; i < run; ++i)
+		{
+			switch (kind)
+			{
+			 case 0: case 1: case 2: case 3: case 4: case 5:
+				s += static_cast<Elem>(rng() % 0x80);
+				break;
+			 case 6: case 7:
+				s += static_cast<Elem>(0x80 + rng() % 0x780);
+				break;
+			 case 8: case 9:
+				s += static_cast<Elem>(0x800 + rng() % 0xd000);
+				break;
+			 case 10:
+				s += static_cast<Elem>(0xe000 + rng() % 0x2000);
+				break;
+			 case 11:
+				s += static_cast<Elem>(0xd800 + rng() % 0x400);
+				s += static_cast<Elem>(0xdc00 + rng() % 0x400);
+				break;
+			 case 12:
+				// unpaired surrogates
+				s += static_cast<Elem>(0xd800 + rng() % 0x800);
+				break;
+			 default:
+				s += static_cast<Elem>(rng() % 0x10000);
+				break;
+			}
+		}
+	}
+
+	return s;
+}
+
+/// UTF-8 made from random_units(), with some bytes damaged: truncated,
+/// overlong and stray continuation bytes, and four byte sequences
+std::string random_bytes(std::mt19937 & rng, std::size_t n)
+{
+	std::string s;
+	std::mbstate_t state = std::mbstate_t();
+	exposed<plain16> f;
+
+	const std::u16string units = random_units<char16_t>(rng, n);
+	const char16_t * from = units.data();
+	const char16_t * from_end = from + units.size();
+
+	while (from < from_end)
+	{
+		char buf[256];
+		char * to = buf;
+		const char16_t * from_next;
+		char * to_next;
+
+		if (f.convert_out(state, from, from_end, from_next,
+		                  buf, buf + sizeof(buf), to_next, false)
+		    == std::codecvt_base::error)
+		{
+			++from_next;
+			state = std::mbstate_t();
+		}
+
+		s.append(to, to_next);
+		from = from_next;
+	}
+
+	for (std::size_t i = 0; i < s.size() / 50; ++i)
+		s[rng() % s.size()] = static_cast<char>(rng());
+
+	// the BOM, which consume_header skips
+	if (rng() % 2)
+		s.insert(0, "\xef\xbb\xbf");
+	return s;
+}
+
+/// Code points for codecvt_utf16: random_units(), with NULs and, if
+/// they fit, characters outside the BMP
+template <class Elem>
+std::basic_string<Elem> random_code_points(std::mt19937 & rng, std::size_t n)
+{
+	std::basic_string<Elem> s = random_units<Elem>(rng, n);
+
+	for (std::size_t i = 0; i < s.size() / 40; ++i)
+		s[rng() % s.size()] = 0;
+
+	if (sizeof(Elem) == 4)
+	{
+		for (std::size_t i = 0; i < s.size() / 20; ++i)
+			s[rng() % s.size()] = static_cast<Elem>(0x10000 + rng() % 0x100000);
+	}
+
+	return s;
+}
+
+/// UTF-16 in either byte order made from random_units(), damaged as
+/// random_bytes() does, sometimes with a BOM and sometimes with an odd
+/// byte at the end
+std::string random_utf16(std::mt19937 & rng, std::size_t n, bool little)
+{
+	const std::u16string units = random_units<char16_t>(rng, n);
+	std::string s;
+
+	if (rng() % 2)
+		s = little ? "\xff\xfe" : "\xfe\xff";
+
+	for (char16_t u : units)
+	{
+		const char high = static_cast<char>(u >> 8);
+		const char low = static_cast<char>(u & 0xff);
+		s += little ? low : high;
+		s += little ? high : low;
+	}
+
+	for (std::size_t i = 0; i < s.size() / 50; ++i)
+		s[rng() % s.size()] = static_cast<char>(rng());
+
+	if (rng() % 4 == 0)
+		s.resize(s.size() - 1);
+	return s;
+}
+
+} // namespace
+
+class Test_utf_simd : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE(Test_utf_simd);
+	CPPUNIT_TEST(out_ascii_blocks);
+	CPPUNIT_TEST(in_ascii_blocks);
+	CPPUNIT_TEST(out_matches_scalar);
+	CPPUNIT_TEST(in_matches_scalar);
+	CPPUNIT_TEST(headers);
+	CPPUNIT_TEST(utf16_out_matches_scalar);
+	CPPUNIT_TEST(utf16_in_matches_scalar);
+	CPPUNIT_TEST(utf16_characters);
+	CPPUNIT_TEST_SUITE_END();
+
+	/// Converts in with random input and output sizes, with and without
+	/// the kernels in lockstep, checking each call does the same
+	template <class Facet>
+	static void check_out(const std::basic_string<typename Facet::intern_type>
+	                          & in,
+	                      std::mt19937 & rng)
+	{
+		typedef typename Facet::intern_type Elem;
+		exposed<Facet> f;
+		std::mbstate_t fast = std::mbstate_t(), slow = std::mbstate_t();
+		std::vector<char> a(400), b(400);
+
+		const Elem * from = in.data();
+		const Elem * const end = from + in.size();
+
+		for (int calls = 0; from < end && calls < 100000; ++calls)
+		{
+			const Elem * from_end = from + std::min<std::size_t>(
+			                                   end - from, 1 + rng() % 300);
+			const std::size_t room = rng() % 2 ? rng() % 8 : rng() % 400;
+			const Elem * fast_next, * slow_next;
+			char * fast_to, * slow_to;
+
+			std::codecvt_base::result fr
+			  = f.convert_out(fast, from, from_end, fast_next,
+			                  a.data(), a.data() + room, fast_to, true);
+			std::codecvt_base::result sr
+			  = f.convert_out(slow, from, from_end, slow_next,
+			                  b.data(), b.data() + room, slow_to, false);
+
+			CPPUNIT_ASSERT(fr == sr);
+			CPPUNIT_ASSERT(fast_next == slow_next);
+			CPPUNIT_ASSERT(fast_to - a.data() == slow_to - b.data());
+			CPPUNIT_ASSERT(std::memcmp(a.data(), b.data(),
+			                           fast_to - a.data()) == 0);
+			CPPUNIT_ASSERT(same_state(fast, slow));
+
+			from = fast_next;
+
+			// carry on after the bad unit
+			if (fr == std::codecvt_base::error)
+			{
+				++from;
+				fast = slow = std::mbstate_t();
+			}
+		}
+	}
+
+	template <class Facet>
+	static void check_in(const std::string & in, std::mt19937 & rng)
+	{
+		typedef typename Facet::intern_type Elem;
+		exposed<Facet> f;
+		std::mbstate_t fast = std::mbstate_t(), slow = std::mbstate_t();
+		std::vector<Elem> a(400), b(400);
+
+		const char * from = in.data();
+		const char * const end = from + in.size();
+
+		for (int calls = 0; from < end && calls < 100000; ++calls)
+		{
+			const char * from_end = from + std::min<std::size_t>(
+			                                   end - from, 1 + rng() % 300);
+			const std::size_t room = rng() % 2 ? rng() % 8 : rng() % 400;
+			const char * fast_next, * slow_next;
+			Elem * fast_to, * slow_to;
+
+			std::codecvt_base::result fr
+			  = f.convert_in(fast, from, from_end, fast_next,
+			                 a.data(), a.data() + room, fast_to, true);
+			std::codecvt_base::result sr
+			  = f.convert_in(slow, from, from_end, slow_next,
+			                 b.data(), b.data() + room, slow_to, false);
+
+			CPPUNIT_ASSERT(fr == sr);
+			CPPUNIT_ASSERT(fast_next == slow_next);
+			CPPUNIT_ASSERT(fast_to - a.data() == slow_to - b.data());
+			CPPUNIT_ASSERT(std::equal(a.data(), fast_to, b.data()));
+			CPPUNIT_ASSERT(same_state(fast, slow));
+
+			from = fast_next;
+
+			// carry on after the bad unit
+			if (fr == std::codecvt_base::error)
+			{
+				++from;
+				fast = slow = std::mbstate_t();
+			}
+		}
+	}
+
+ protected:
+	void out_ascii_blocks()
+	{
+		plain16 f;
+
+		// one non-ASCII character at each position around the blocks
+		for (std::size_t at = 0; at < 80; ++at)
+		{
+			std::u16string in(100, u'x');
+			in[at] = u'é';
+
+			std::mbstate_t state = std::mbstate_t();
+			char buf[200];
+			const char16_t * from_next;
+			char * to_next;
+
+			CPPUNIT_ASSERT(f.out(state, in.data(), in.data() + in.size(),
+			                     from_next, buf, buf + sizeof(buf), to_next)
+			               == std::codecvt_base::ok);
+
+			std::string expected(at, 'x');
+			expected += "\xc3\xa9";
+			expected.append(99 - at, 'x');
+			CPPUNIT_ASSERT(std::string(buf, to_next) == expected);
+		}
+	}
+
+	void in_ascii_blocks()
+	{
+		plain16 f;
+
+		for (std::size_t at = 0; at < 80; ++at)
+		{
+			std::string in(100, 'x');
+			in.replace(at, 1, "\xe4\xb8\xad");
+
+			std::mbstate_t state = std::mbstate_t();
+			char16_t buf[200];
+			const char * from_next;
+			char16_t * to_next;
+
+			CPPUNIT_ASSERT(f.in(state, in.data(), in.data() + in.size(),
+			                    from_next, buf, buf + 200, to_next)
+			               == std::codecvt_base::ok);
+
+			std::u16string expected(at, u'x');
+			expected += u'中';
+			expected.append(99 - at, u'x');
+			CPPUNIT_ASSERT(std::u16string(buf, to_next) == expected);
+		}
+	}
+
+	void out_matches_scalar()
+	{
+		std::mt19937 rng(1);
+
+		for (int i = 0; i < 100; ++i)
+		{
+			check_out<plain16>(random_units<char16_t>(rng, 2000), rng);
+			check_out<plain32>(random_units<char32_t>(rng, 500), rng);
+			check_out<plainw>(random_units<wchar_t>(rng, 500), rng);
+		}
+	}
+
+	void in_matches_scalar()
+	{
+		std::mt19937 rng(2);
+
+		for (int i = 0; i < 100; ++i)
+		{
+			check_in<plain16>(random_bytes(rng, 2000), rng);
+			check_in<plain32>(random_bytes(rng, 500), rng);
+			check_in<plainw>(random_bytes(rng, 500), rng);
+		}
+	}
+
+	void headers()
+	{
+		std::mt19937 rng(3);
+
+		for (int i = 0; i < 100; ++i)
+		{
+			check_out<headers16>(random_units<char16_t>(rng, 1000), rng);
+			check_in<headers16>(random_bytes(rng, 1000), rng);
+		}
+
+		// a BOM, then everything that was asked for
+		headers16 f;
+		const std::u16string in = u"abé";
+		std::mbstate_t state = std::mbstate_t();
+		char buf[16];
+		const char16_t * from_next;
+		char * to_next;
+
+		f.out(state, in.data(), in.data() + in.size(), from_next,
+		      buf, buf + sizeof(buf), to_next);
+		CPPUNIT_ASSERT(std::string(buf, to_next) == "\xef\xbb\xbf" "ab\xc3\xa9");
+	}
+
+	void utf16_out_matches_scalar()
+	{
+		std::mt19937 rng(4);
+
+		for (int i = 0; i < 100; ++i)
+		{
+			check_out<big16>(random_code_points<char16_t>(rng, 2000), rng);
+			check_out<little32>(random_code_points<char32_t>(rng, 1000), rng);
+			check_out<headersw>(random_code_points<wchar_t>(rng, 1000), rng);
+			check_out<narrow16>(random_code_points<char16_t>(rng, 1000), rng);
+		}
+	}
+
+	void utf16_in_matches_scalar()
+	{
+		std::mt19937 rng(5);
+
+		for (int i = 0; i < 100; ++i)
+		{
+			check_in<big16>(random_utf16(rng, 2000, false), rng);
+			check_in<little32>(random_utf16(rng, 1000, true), rng);
+			check_in<headersw>(random_utf16(rng, 1000, rng() % 2), rng);
+			check_in<narrow16>(random_utf16(rng, 1000, true), rng);
+		}
+	}
+
+	void utf16_characters()
+	{
+		std::codecvt_utf16<char32_t> f;
+		const std::u32string text = U"\U00010000\U0001f600" + std::u32string(1, 0)
+		                          + U"a";
+		const std::string bytes("\xd8\x00\xdc\x00\xd8\x3d\xde\x00"
+		                        "\x00\x00\x00\x61", 12);
+
+		std::mbstate_t state = std::mbstate_t();
+		char buf[16];
+		const char32_t * from_next;
+		char * to_next;
+
+		CPPUNIT_ASSERT(f.out(state, text.data(), text.data() + text.size(),
+		                     from_next, buf, buf + sizeof(buf), to_next)
+		               == std::codecvt_base::ok);
+		CPPUNIT_ASSERT(std::string(buf, to_next) == bytes);
+
+		// back again, NUL and all
+		char32_t units[8];
+		const char * in_next;
+		char32_t * units_next;
+		state = std::mbstate_t();
+
+		CPPUNIT_ASSERT(f.in(state, bytes.data(), bytes.data() + bytes.size(),
+		                    in_next, units, units + 8, units_next)
+		               == std::codecvt_base::ok);
+		CPPUNIT_ASSERT(std::u32string(units, units_next) == text);
+
+		// a low surrogate can't start a character
+		const std::string lone("\x00\x61\xdc\x00\xdc\x00", 6);
+		state = std::mbstate_t();
+
+		CPPUNIT_ASSERT(f.in(state, lone.data(), lone.data() + lone.size(),
+		                    in_next, units, units + 8, units_next)
+		               == std::codecvt_base::error);
+		CPPUNIT_ASSERT(units_next == units + 1);
+		CPPUNIT_ASSERT(in_next < lone.data() + 4);
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Test_utf_simd);
@@ -0,0 +1,266 @@
+#ifndef GUARD_TO_CHARS_H
+#define GUARD_TO_CHARS_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <system_error>
+#include <type_traits>
+
+///
+/// Number to text conversion in the manner of C++17's <charconv>: no
+/// streams, no terminating NUL. On success ptr is one past
+/// the last character written; when the range is too small, ec is
+/// std::errc::value_too_large, ptr is last, and the range's contents are
+/// unspecified.
+///
+struct to_chars_result
+{
+	char * ptr;
+	std::errc ec;
+};
+
+namespace to_chars_detail {
+
+/// "00" through "99", for producing decimal digits two at a time
+static constexpr char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+inline unsigned decimal_digits(std::uint64_t v) noexcept
+{
+	unsigned n = 1;
+
+	for (;;)
+	{
+		if (v < 10) return n;
+		if (v < 100) return n + 1;
+		if (v < 1000) return n + 2;
+		if (v < 10000) return n + 3;
+		v /= 10000;
+		n += 4;
+	}
+}
+
+inline to_chars_result unsigned_to_chars(char * first, char * last,
+                                         std::uint64_t v, int base) noexcept
+{
+	if (base == 10)
+	{
+		const unsigned n = decimal_digits(v);
+		if (last - first < static_cast<std::ptrdiff_t>(n))
+			return { last, std::errc::value_too_large };
+
+		char * p = first + n;
+		while (v >= 100)
+		{
+			const unsigned i = static_cast<unsigned>(v % 100) * 2;
+			v /= 100;
+			*--p = digit_pairs[i + 1];
+			*--p = digit_pairs[i];
+		}
+
+		if (v >= 10)
+		{
+			*--p = digit_pairs[v * 2 + 1];
+			*--p = digit_pairs[v * 2];
+		} else
+			*--p = static_cast<char>('0' + v);
+
+		return { first + n, std::errc() };
+	}
+
+	// other bases are rare enough to go a digit at a time, backwards
+	// into a scratch buffer wide enough for base 2
+	char buf[64];
+	char * p = buf + sizeof(buf);
+
+	do {
+		const unsigned d = static_cast<unsigned>(v % base);
+		*--p = "0123456789abcdefghijklmnopqrstuvwxyz"[d];
+		v /= base;
+	} while (v != 0);
+
+	const std::size_t n = buf + sizeof(buf) - p;
+	if (static_cast<std::size_t>(last - first) < n)
+		return { last, std::errc::value_too_large };
+
+	std::memcpy(first, p, n);
+	return { first + n, std::errc() };
+}
+
+constexpr double pow10(int n) noexcept
+	{ return (n == 0) ? 1.0 : 10.0 * pow10(n - 1); }
+
+/// printf() with digits10 significant digits when that reads back as
+/// the same value, which is what short decimal inputs like 0.1 come out
+/// as, and with max_digits10, which always does, otherwise.
+///
+/// The max_digits10 text comes first. A shorter text within half an ulp
+/// of value can only differ from it by a few units in the last place,
+/// so unless the digits that would be dropped are close to all zeros or
+/// all nines, it's the answer, without the cost of a strtod() check.
+template <class T>
+inline to_chars_result float_to_chars(char * first, char * last,
+                                      T value) noexcept
+{
+	typedef std::numeric_limits<T> limits;
+
+	constexpr unsigned long_digits = limits::max_digits10;
+	constexpr unsigned short_digits = limits::digits10;
+
+	// the dropped digits, as a number, against the most that half an ulp
+	// (plus the rounding in the long text) can move them
+	constexpr double span = pow10(long_digits - short_digits);
+	constexpr double slack = limits::epsilon() / 2 * pow10(long_digits) + 1;
+
+	char buf[64];
+	int n = snprintf(buf, sizeof(buf), "%.*g", static_cast<int>(long_digits),
+	                 static_cast<double>(value));
+
+	// collect the trailing significant digits; %g drops trailing zeros,
+	// which count as a tail of zeros
+	unsigned digits = 0, tail = 0;
+	bool significant = false;
+
+	for (int i = 0; i < n && buf[i] != 'e'; ++i)
+	{
+		const char c = buf[i];
+		if (c < '0' || c > '9')
+			continue;
+		if (c != '0')
+			significant = true;
+		if (! significant)
+			continue;
+		if (++digits > short_digits)
+			tail = tail * 10 + (c - '0');
+	}
+
+	if (digits > short_digits && digits < long_digits)
+		tail *= static_cast<unsigned>(pow10(long_digits - digits));
+
+	// NaN and infinity have no digits and are already as short as can be
+	if (digits > 0 && (tail < slack || span - tail < slack))
+	{
+		char shorter[64];
+		int m = snprintf(shorter, sizeof(shorter), "%.*g",
+		                 static_cast<int>(short_digits),
+		                 static_cast<double>(value));
+
+		if (static_cast<T>(std::strtod(shorter, nullptr)) == value)
+		{
+			std::memcpy(buf, shorter, m);
+			n = m;
+		}
+	}
+
+	if (last - first < n)
+		return { last, std::errc::value_too_large };
+
+	std::memcpy(first, buf, n);
+	return { first + n, std::errc() };
+}
+
+template <class T>
+constexpr bool is_negative(T v, std::true_type) noexcept { return v < 0; }
+
+template <class T>
+constexpr bool is_negative(T, std::false_type) noexcept { return false; }
+
+} // namespace to_chars_detail
+
+///
+/// Writes value in base (2 through 36; lower case letters above 9)
+///
+template <class T>
+inline typename std::enable_if<  std::is_integral<T>::value
+                               && ! std::is_same<T, bool>::value,
+                               to_chars_result>::type
+	to_chars(char * first, char * last, T value, int base = 10) noexcept
+{
+	typedef typename std::make_unsigned<T>::type utype;
+	utype u = static_cast<utype>(value);
+
+	if (to_chars_detail::is_negative(value, std::is_signed<T>()))
+	{
+		if (first == last)
+			return { last, std::errc::value_too_large };
+		*first++ = '-';
+		u = static_cast<utype>(utype(0) - u);
+	}
+
+	return to_chars_detail::unsigned_to_chars(first, last, u, base);
+}
+
+///
+/// Writes "%.{digits10}g" if that reads back as value, or else
+/// "%.{max_digits10}g", so the text always round trips and is short for
+/// values that started out as short decimals. Like the C library, the
+/// decimal point comes from LC_NUMERIC, which is "." unless the program
+/// has called setlocale().
+///
+inline to_chars_result to_chars(char * first, char * last,
+                                double value) noexcept
+	{ return to_chars_detail::float_to_chars(first, last, value); }
+
+inline to_chars_result to_chars(char * first, char * last,
+                                float value) noexcept
+	{ return to_chars_detail::float_to_chars(first, last, value); }
+
+///
+/// Writes value in fixed notation with precision digits after the point
+///
+inline to_chars_result to_chars(char * first, char * last, double value,
+                                int precision) noexcept
+{
+	// at most a sign, the integer digits (one more than the decimal
+	// exponent, and another when rounding carries), the point and the
+	// fraction; NaN and infinity are shorter still
+	int exponent = 0;
+	std::frexp(value, &exponent);
+
+	const std::size_t room = last - first;
+	const std::size_t bound = 4 + std::max(exponent, 1) * 30103 / 100000
+	                        + ((precision < 0) ? 6 : precision);
+
+	// the text goes straight into place when there's surely room for
+	// snprintf's NUL too; otherwise it's measured first and, if it fits,
+	// made in a buffer of its own, sized by the bound so that
+	// -Wformat-truncation can see it's never cut short
+	if (bound < room)
+	{
+		const int n = snprintf(first, room, "%.*f", precision, value);
+		if (n < 0)
+			return { last, std::errc::value_too_large };
+		return { first + n, std::errc() };
+	}
+
+	const int n = snprintf(nullptr, 0, "%.*f", precision, value);
+
+	if (n < 0 || room < static_cast<std::size_t>(n))
+		return { last, std::errc::value_too_large };
+
+	char * text = static_cast<char *>(std::malloc(bound + 1));
+	if (text == nullptr)
+		return { last, std::errc::not_enough_memory };
+
+	snprintf(text, bound + 1, "%.*f", precision, value);
+	std::memcpy(first, text, n);
+	std::free(text);
+
+	return { first + n, std::errc() };
+}
+
+#endif // GUARD_TO_CHARS_H